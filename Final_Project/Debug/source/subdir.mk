@@ -4,58 +4,118 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
+../source/blackbox.c \
 ../source/clock.c \
+../source/cobs.c \
+../source/crc16.c \
 ../source/i2c.c \
+../source/i2c_account.c \
+../source/i2c_bus.c \
+../source/i2c_dma.c \
+../source/i2c_irq.c \
+../source/i2c_trace.c \
 ../source/i2carbiter.c \
 ../source/init_sensors.c \
 ../source/led.c \
+../source/lptmr.c \
 ../source/main.c \
 ../source/mma8451q.c \
+../source/mma8451q_drdy.c \
+../source/mma8451q_fifo.c \
+../source/mma8451q_profile.c \
 ../source/mtb.c \
+../source/nvm.c \
+../source/power.c \
+../source/profile.c \
 ../source/queue.c \
+../source/scheduler.c \
 ../source/semihost_hardfault.c \
 ../source/statemachine.c \
 ../source/sysclock.c \
 ../source/systick.c \
+../source/telemetry.c \
 ../source/test_i2c.c \
 ../source/test_queue.c \
-../source/uart.c 
+../source/tilt.c \
+../source/timer_wheel.c \
+../source/uart.c \
+../source/uart_dma.c 
 
 OBJS += \
+./source/blackbox.o \
 ./source/clock.o \
+./source/cobs.o \
+./source/crc16.o \
 ./source/i2c.o \
+./source/i2c_account.o \
+./source/i2c_bus.o \
+./source/i2c_dma.o \
+./source/i2c_irq.o \
+./source/i2c_trace.o \
 ./source/i2carbiter.o \
 ./source/init_sensors.o \
 ./source/led.o \
+./source/lptmr.o \
 ./source/main.o \
 ./source/mma8451q.o \
+./source/mma8451q_drdy.o \
+./source/mma8451q_fifo.o \
+./source/mma8451q_profile.o \
 ./source/mtb.o \
+./source/nvm.o \
+./source/power.o \
+./source/profile.o \
 ./source/queue.o \
+./source/scheduler.o \
 ./source/semihost_hardfault.o \
 ./source/statemachine.o \
 ./source/sysclock.o \
 ./source/systick.o \
+./source/telemetry.o \
 ./source/test_i2c.o \
 ./source/test_queue.o \
-./source/uart.o 
+./source/tilt.o \
+./source/timer_wheel.o \
+./source/uart.o \
+./source/uart_dma.o 
 
 C_DEPS += \
+./source/blackbox.d \
 ./source/clock.d \
+./source/cobs.d \
+./source/crc16.d \
 ./source/i2c.d \
+./source/i2c_account.d \
+./source/i2c_bus.d \
+./source/i2c_dma.d \
+./source/i2c_irq.d \
+./source/i2c_trace.d \
 ./source/i2carbiter.d \
 ./source/init_sensors.d \
 ./source/led.d \
+./source/lptmr.d \
 ./source/main.d \
 ./source/mma8451q.d \
+./source/mma8451q_drdy.d \
+./source/mma8451q_fifo.d \
+./source/mma8451q_profile.d \
 ./source/mtb.d \
+./source/nvm.d \
+./source/power.d \
+./source/profile.d \
 ./source/queue.d \
+./source/scheduler.d \
 ./source/semihost_hardfault.d \
 ./source/statemachine.d \
 ./source/sysclock.d \
 ./source/systick.d \
+./source/telemetry.d \
 ./source/test_i2c.d \
 ./source/test_queue.d \
-./source/uart.d 
+./source/tilt.d \
+./source/timer_wheel.d \
+./source/uart.d \
+./source/uart_dma.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
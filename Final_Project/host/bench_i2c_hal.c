@@ -0,0 +1,102 @@
+/*
+ * bench_i2c_hal.c
+ *
+ *  Created on: Dec 20, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host benchmark of the MMA8451Q driver stack on the simulated I2C backend: per
+ *   		operation the host time through driver, engine and simulation, and what it puts
+ *   		on the simulated bus (bytes, bus time at 375 kHz, IICIF interrupts).
+ *   		Run with make -C host bench.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "mma8451q.h"
+#include "i2c_hal_sim.h"
+
+#define BENCH_ROUNDS	(100000)
+
+static sim_i2c_t sim;
+
+static double seconds_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void op_sample(void)
+{
+	mma8451q_acc_t acc;
+	MMA8451Q_ReadAcceleration14bitNoFifo(&acc);
+}
+
+static void op_register(void)
+{
+	MMA8451Q_Status();
+}
+
+static void op_fetch(void)
+{
+	mma8451q_confreg_t configuration;
+	MMA8451Q_ShadowInvalidate();
+	MMA8451Q_FetchConfiguration(&configuration);
+}
+
+static void op_store_full(void)
+{
+	mma8451q_confreg_t configuration;
+	memset(&configuration, 0, sizeof(configuration));
+	MMA8451Q_ShadowInvalidate();
+	MMA8451Q_StoreConfiguration(&configuration);
+}
+
+static void op_store_same(void)
+{
+	mma8451q_confreg_t configuration;
+	memset(&configuration, 0, sizeof(configuration));
+	MMA8451Q_StoreConfiguration(&configuration);
+}
+
+/*
+ * @brief Runs an operation and reports its cost per call
+ */
+static void bench(const char *name, void (*op)(void))
+{
+	SimI2C_Init(&sim, MMA8451Q_I2CADDR);
+	I2C_HalSimAttach(&sim);
+	MMA8451Q_ShadowInvalidate();
+
+	/* the bus traffic of one call once warmed up */
+	op();
+	const uint32_t bytes = sim.bytes;
+	const uint32_t interrupts = sim.interrupts;
+	op();
+	const uint32_t busBytes = sim.bytes - bytes;
+	const uint32_t busInterrupts = sim.interrupts - interrupts;
+	const uint32_t busTime = (uint32_t)(((uint64_t)busBytes * SIM_I2C_CLOCKS_PER_BYTE * 1000000u) / SIM_I2C_SCL_HZ);
+
+	const double start = seconds_now();
+	for (int i = 0; i < BENCH_ROUNDS; ++i) {
+		op();
+	}
+	const double elapsed = seconds_now() - start;
+
+	printf("  %-22s %7.1f ns/op %5lu bytes %5lu us bus %4lu interrupts\n", name,
+			elapsed * 1e9 / BENCH_ROUNDS, (unsigned long)busBytes, (unsigned long)busTime, (unsigned long)busInterrupts);
+}
+
+int main(void)
+{
+	printf("%s: driver stack on the simulated I2C backend, %d rounds\n", __FILE__, BENCH_ROUNDS);
+
+	bench("status register", op_register);
+	bench("status + XYZ sample", op_sample);
+	bench("fetch configuration", op_fetch);
+	bench("store, nothing known", op_store_full);
+	bench("store, unchanged", op_store_same);
+	return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * bench_queue.c
+ *
+ *  Created on: Dec 17, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host benchmark of the byte queue of queue.c: cost per byte for the chunk sizes the
+ *   		firmware uses (single bytes from the UART interrupt, log lines from __sys_write),
+ *   		in one thread and with producer and consumer on two threads.
+ *   		Run with make -C host bench.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "queue.h"
+
+#define BENCH_BYTES		(64u * 1024u * 1024u)
+
+#define QUEUE_SIZE	(1024)
+
+static uint8_t storage[QUEUE_SIZE];
+static Q_T q = Q_INITIALIZER(storage);
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * @brief Enqueue then dequeue one chunk at a time, nothing else runs
+ */
+static void bench_single(size_t chunk)
+{
+	uint8_t buffer[QUEUE_SIZE];
+	size_t moved = 0;
+
+	Q_Init(&q);
+	const double start = now();
+	while (moved < BENCH_BYTES) {
+		Q_Enqueue(&q, buffer, chunk);
+		moved += Q_Dequeue(&q, buffer, chunk);
+	}
+	const double elapsed = now() - start;
+
+	printf("  1 thread   chunk %4zu: %7.2f ns/byte %8.1f MB/s %7.1f ns/op\n", chunk,
+			elapsed * 1e9 / moved, moved / elapsed / 1e6, elapsed * 1e9 / (2.0 * moved / chunk));
+}
+
+/*
+ * @brief One byte at a time in place, the way UART0_IRQHandler moves RxQ and TxQ bytes
+ */
+static void bench_zero_copy(void)
+{
+	Q_Span_T span[2];
+	size_t moved = 0;
+	uint8_t byte = 0;
+
+	Q_Init(&q);
+	const double start = now();
+	while (moved < BENCH_BYTES) {
+		Q_Reserve(&q, 1, span);
+		*span[0].data = byte;
+		Q_Commit(&q, 1);
+		Q_Peek(&q, span);
+		byte += *span[0].data;
+		Q_Release(&q, 1);
+		moved++;
+	}
+	const double elapsed = now() - start;
+
+	printf("  1 thread   in place  1: %7.2f ns/byte %8.1f MB/s (%u)\n",
+			elapsed * 1e9 / moved, moved / elapsed / 1e6, byte);
+}
+
+static size_t pairChunk;
+
+static void *bench_producer(void *unused)
+{
+	uint8_t buffer[QUEUE_SIZE] = { 0 };
+	size_t moved = 0;
+
+	while (moved < BENCH_BYTES) {
+		const size_t n = Q_Enqueue(&q, buffer, pairChunk);
+		if (n == 0) {
+			sched_yield();
+		}
+		moved += n;
+	}
+	return 0;
+}
+
+/*
+ * @brief Producer and consumer on two threads
+ */
+static void bench_pair(size_t chunk)
+{
+	uint8_t buffer[QUEUE_SIZE];
+	pthread_t producer;
+	size_t moved = 0;
+
+	Q_Init(&q);
+	pairChunk = chunk;
+	const double start = now();
+	pthread_create(&producer, 0, bench_producer, 0);
+	while (moved < BENCH_BYTES) {
+		const size_t n = Q_Dequeue(&q, buffer, chunk);
+		if (n == 0) {
+			sched_yield();
+		}
+		moved += n;
+	}
+	pthread_join(producer, 0);
+	const double elapsed = now() - start;
+
+	printf("  2 threads  chunk %4zu: %7.2f ns/byte %8.1f MB/s\n", chunk,
+			elapsed * 1e9 / moved, moved / elapsed / 1e6);
+}
+
+int main(void)
+{
+	static const size_t chunks[] = { 1, 16, 80, 256 };
+
+	printf("%s: %u MB through a %u byte queue\n", __FILE__, BENCH_BYTES >> 20, QUEUE_SIZE);
+	for (int i = 0; i < sizeof(chunks) / sizeof(chunks[0]); ++i) {
+		bench_single(chunks[i]);
+	}
+	bench_zero_copy();
+	for (int i = 0; i < sizeof(chunks) / sizeof(chunks[0]); ++i) {
+		bench_pair(chunks[i]);
+	}
+	return 0;
+}
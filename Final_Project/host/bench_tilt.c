@@ -0,0 +1,85 @@
+/*
+ * bench_tilt.c
+ *
+ *  Created on: Dec 19, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host benchmark of the integer tilt kernel of tilt.c against the float roll and
+ *   		pitch it replaced. The host has an FPU and a fast libm, where the float version
+ *   		may well win; on the M0+ every float operation of it, and the double precision
+ *   		atan2 and sqrt, are software library calls, while the kernel is 32 rounds of
+ *   		shifts and adds. Compare the two here to track the kernel, not to size the gain.
+ *   		Run with make -C host bench.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <math.h>
+
+#include "tilt.h"
+
+#define BENCH_SAMPLES	(4096)
+#define BENCH_ROUNDS	(4096)
+
+#define COUNTS_PER_G	(4096.0)
+
+static int16_t samples[BENCH_SAMPLES][3];
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * @brief The float version convert_xyz_to_roll_pitch used before
+ */
+static void float_roll_pitch(const int16_t xyz[3], float *roll, float *pitch)
+{
+	float ax = xyz[0]/COUNTS_PER_G,
+			ay = xyz[1]/COUNTS_PER_G,
+			az = xyz[2]/COUNTS_PER_G;
+
+	*roll = atan2(ay, az)*180/M_PI;
+	*pitch = atan2(ax, sqrt(ay*ay + az*az))*180/M_PI;
+}
+
+int main(void)
+{
+	/* 1 g pointing all around the sphere, with some noise */
+	uint32_t seed = 1;
+	for (int i = 0; i < BENCH_SAMPLES; ++i) {
+		const double theta = 2 * M_PI * i / BENCH_SAMPLES, phi = M_PI * ((i * 37) % BENCH_SAMPLES) / BENCH_SAMPLES;
+		seed = seed * 1664525 + 1013904223;
+		samples[i][0] = (int16_t)(4096 * sin(phi) * cos(theta)) + (int)(seed >> 28) - 8;
+		samples[i][1] = (int16_t)(4096 * sin(phi) * sin(theta));
+		samples[i][2] = (int16_t)(4096 * cos(phi));
+	}
+
+	volatile float floatSink = 0;
+	double start = now();
+	for (int round = 0; round < BENCH_ROUNDS; ++round) {
+		for (int i = 0; i < BENCH_SAMPLES; ++i) {
+			float roll, pitch;
+			float_roll_pitch(samples[i], &roll, &pitch);
+			floatSink += roll + pitch;
+		}
+	}
+	const double floatTime = (now() - start) * 1e9 / ((double)BENCH_ROUNDS * BENCH_SAMPLES);
+
+	volatile int32_t fixedSink = 0;
+	start = now();
+	for (int round = 0; round < BENCH_ROUNDS; ++round) {
+		for (int i = 0; i < BENCH_SAMPLES; ++i) {
+			int16_t roll, pitch;
+			Tilt_RollPitch(samples[i][0], samples[i][1], samples[i][2], &roll, &pitch);
+			fixedSink += roll + pitch;
+		}
+	}
+	const double fixedTime = (now() - start) * 1e9 / ((double)BENCH_ROUNDS * BENCH_SAMPLES);
+
+	printf("tilt: float atan2/sqrt %7.2f ns/sample, CORDIC %7.2f ns/sample, %.1fx\n",
+			floatTime, fixedTime, floatTime / fixedTime);
+	return 0;
+}
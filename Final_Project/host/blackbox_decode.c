@@ -0,0 +1,159 @@
+/*
+ * blackbox_decode.c
+ *
+ *  Created on: Dec 30, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Turns a console capture of the black box dump into CSV.
+ *
+ *   		blackbox_decode [capture] [csv]
+ *
+ *   		Reads what the console printed after a 'b' (stdin if no file is named), picks
+ *   		the "bbx <offset> <bytes>" lines of {@see BlackBox_Dump} out of the other text,
+ *   		checks every record against its CRC and writes event,sample,time_us,x,y,z with
+ *   		one line per sample (stdout if no file is named). time_us is the trigger's
+ *   		{@see timestamp_us} plus the sample's distance from the trigger at the output
+ *   		data rate, so the samples before the trigger come out earlier. The record and
+ *   		corrupt counts are reported on stderr; the exit status is 1 if a record was
+ *   		corrupt or cut short.
+ *
+ *   		e.g. (printf b; sleep 3) | picocom -b 115200 -q /dev/ttyACM0 > capture.txt
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "blackbox.h"
+#include "crc16.h"
+
+static uint8_t record[BLACKBOX_SLOT_SIZE];
+static uint32_t filled;			/* bytes of the record received in order */
+static int broken;				/* a line of the record went missing */
+static uint32_t records, corrupt;
+
+static uint16_t get16(const uint8_t *at)
+{
+	return (uint16_t)(at[0] | (at[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *at)
+{
+	return get16(at) | ((uint32_t)get16(at + 2) << 16);
+}
+
+/* writes the record received so far, if it is whole */
+static void flush(FILE *csv)
+{
+	if ((filled == 0) && !broken) {
+		return;
+	}
+
+	const uint32_t pre = get16(&record[20]);
+	const uint32_t post = get16(&record[22]);
+	const uint32_t count = pre + post;
+	const uint32_t length = BLACKBOX_HEADER_SIZE + count * BLACKBOX_SAMPLE_SIZE;
+
+	uint16_t crc = 0;
+	if ((filled >= BLACKBOX_HEADER_SIZE) && (count <= BLACKBOX_MAX_SAMPLES) && (filled >= length)) {
+		crc = CRC16_Compute(record, BLACKBOX_CRC_OFFSET);
+		crc = CRC16_Update(crc, &record[BLACKBOX_HEADER_SIZE], count * BLACKBOX_SAMPLE_SIZE);
+	}
+	if (broken || (filled < BLACKBOX_HEADER_SIZE) || (get32(&record[0]) != BLACKBOX_MAGIC)
+			|| (get16(&record[26]) != BLACKBOX_VERSION) || (count > BLACKBOX_MAX_SAMPLES)
+			|| (filled < length) || (crc != get16(&record[BLACKBOX_CRC_OFFSET]))) {
+		corrupt++;
+		filled = 0;
+		broken = 0;
+		return;
+	}
+
+	const uint32_t event = get32(&record[4]);
+	const uint64_t trigger = get32(&record[8]) | ((uint64_t)get32(&record[12]) << 32);
+	const uint32_t first = get32(&record[16]);
+	const uint32_t rate = get16(&record[24]);
+
+	for (uint32_t k = 0; k < count; ++k) {
+		const uint8_t *at = &record[BLACKBOX_HEADER_SIZE + k * BLACKBOX_SAMPLE_SIZE];
+		const int64_t offset = rate ? ((int64_t)k - (int64_t)pre) * 1000000 / (int64_t)rate : 0;
+
+		fprintf(csv, "%" PRIu32 ",%" PRIu32 ",%" PRId64 ",%d,%d,%d\n", event, first + k, (int64_t)trigger + offset,
+				(int16_t)get16(at), (int16_t)get16(at + 2), (int16_t)get16(at + 4));
+	}
+	records++;
+	filled = 0;
+}
+
+static int hex(char c)
+{
+	if ((c >= '0') && (c <= '9')) {
+		return c - '0';
+	}
+	if ((c >= 'a') && (c <= 'f')) {
+		return c - 'a' + 10;
+	}
+	if ((c >= 'A') && (c <= 'F')) {
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+/* takes a "bbx <offset> <bytes>" line */
+static void take(FILE *csv, const char *text)
+{
+	unsigned offset;
+	int skip;
+
+	if (sscanf(text, "bbx %x %n", &offset, &skip) != 1) {
+		return;
+	}
+	if (offset == 0) {
+		flush(csv);
+	}
+	else if (broken || (offset != filled)) {
+		/* a line was lost: the record is given up at its end */
+		broken = 1;
+		return;
+	}
+
+	for (const char *at = text + skip; (hex(at[0]) >= 0) && (hex(at[1]) >= 0); at += 2) {
+		if (filled >= sizeof(record)) {
+			break;
+		}
+		record[filled++] = (uint8_t)((hex(at[0]) << 4) | hex(at[1]));
+	}
+}
+
+int main(int argc, char **argv)
+{
+	FILE *capture = stdin;
+	FILE *csv = stdout;
+
+	if ((argc > 1) && !(capture = fopen(argv[1], "r"))) {
+		perror(argv[1]);
+		return 2;
+	}
+	if ((argc > 2) && !(csv = fopen(argv[2], "w"))) {
+		perror(argv[2]);
+		return 2;
+	}
+
+	fprintf(csv, "event,sample,time_us,x,y,z\n");
+
+	char line[512];
+	while (fgets(line, sizeof(line), capture) != NULL) {
+		/* the console starts its lines with \r\n, anything may come before */
+		const char *at = strstr(line, "bbx ");
+		if (at != NULL) {
+			take(csv, at);
+		}
+	}
+	flush(csv);
+
+	fprintf(stderr, "%" PRIu32 " records, %" PRIu32 " corrupt or cut short\n", records, corrupt);
+
+	if (csv != stdout) {
+		fclose(csv);
+	}
+	return corrupt ? 1 : 0;
+}
@@ -0,0 +1,1317 @@
+/*
+ * board.c
+ *
+ *  Created on: Dec 23, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: The FRDM-KL25Z simulated as a Linux process, see board.h.
+ *
+ *      		The state of the board is only touched inside sections marked busy. A pacing
+ *      		signal arriving meanwhile is deferred to the next one, so the models never see
+ *      		themselves re-entered; the firmware's handlers run outside those sections and
+ *      		may be preempted by signals and nested interrupts like on the core.
+ *
+ *    Sources of Reference :
+ * 		ARMv6-M Architecture Reference Manual, B1.5 (Exception model), B3.3 (SysTick), B3.4 (NVIC)
+ * 		KL25 Sub-Family Reference Manual, Chapter 11.14.1 (PORTx_PCRn IRQC), 39.2.5 (UART0 S1),
+ * 		7.2.3 (VLPS), 33.4 (LPTMR functional description)
+ */
+
+/* fopencookie, sigaction, setitimer and clock_gettime of a strict C99 build */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#include "board.h"
+#include "replay.h"
+#include "mma8451q.h"
+#include "statemachine.h"
+#include "queue.h"
+#include "uart.h"
+#include "lptmr.h"
+#include "fsl_smc.h"
+
+/**
+ * @brief Redlib's console hook in uart.c, behind printf on the target
+ */
+int __sys_write(int handle, char *buffer, int count);
+
+/* the jerk flag of statemachine.c, set while the state machine is in s_ACCEL */
+extern volatile uint8_t flag __attribute__((weak));
+
+/* the firmware's vectors; weak, a build without one of them still links */
+extern void SysTick_Handler(void) __attribute__((weak));
+extern void DMA0_IRQHandler(void) __attribute__((weak));
+extern void DMA1_IRQHandler(void) __attribute__((weak));
+extern void I2C0_IRQHandler(void) __attribute__((weak));
+extern void UART0_IRQHandler(void) __attribute__((weak));
+extern void PORTA_IRQHandler(void) __attribute__((weak));
+extern void LPTMR0_IRQHandler(void) __attribute__((weak));
+
+/**
+ * @brief Exception numbers: SysTick and the interrupts, 16 above their IRQn
+ */
+#define BOARD_SYSTICK			(15)
+#define BOARD_IRQ(irq)			(16 + (irq))
+
+/**
+ * @brief The MMA8451Q on the FRDM-KL25Z: SA0 pulled high, INT1 on PTA14, INT2 on PTA15
+ */
+#define BOARD_MMA8451Q_ADDRESS	(0x1D)
+#define BOARD_INT1_PIN			(14)
+#define BOARD_INT2_PIN			(15)
+#define BOARD_INT_PINS			((1u << BOARD_INT1_PIN) | (1u << BOARD_INT2_PIN))
+
+/**
+ * @brief An event that is not scheduled
+ */
+#define BOARD_NEVER				(UINT64_MAX)
+
+/**
+ * @brief Virtual time past the end of the run after which a firmware that never sleeps is stopped
+ */
+#define BOARD_STALL_CYCLES		((uint64_t)SYSTEM_CLOCK_FREQ)
+
+/**
+ * @brief Reads of SysTick or UART0 without WFI after which a firmware in lockstep counts as spinning on them
+ */
+#define BOARD_LOCKSTEP_POLLS	(32)
+
+/**
+ * @brief UART0 frame: start, 8 data and a stop bit; the baud rate before Init_UART0 programs one
+ */
+#define BOARD_UART_FRAME_BITS	(10)
+#define BOARD_UART_BAUD			(115200)
+
+/**
+ * @brief Most bytes one I2C0 interrupt service moves, against a driver that never stops
+ */
+#define BOARD_I2C_STEPS			(4096)
+
+/*
+ * The peripherals, see include/MKL25Z4.h
+ */
+SIM_Type board_sim;
+MCG_Type board_mcg;
+OSC_Type board_osc0;
+board_port_t board_ports[5];
+GPIO_Type board_gpio[5];
+UART0_Type board_uart0;
+TPM_Type board_tpm[3];
+sim_i2c_t board_i2c0;
+I2C_Type board_i2c1;
+DMA_Type board_dma0;
+DMAMUX_Type board_dmamux0;
+SMC_Type board_smc;
+SysTick_Type board_systick;
+SCB_Type board_scb;
+NVIC_Type board_nvic;
+
+sim_mma8451q_t board_mma8451q;
+
+/**
+ * @brief The core clock of sim_i2c.c: the wire time of the I2C bytes, absorbed by {@see Board_Now}
+ */
+volatile uint32_t host_cycles = 0;
+
+/**
+ * @brief Names of the LEDs, in the order of {@see Board_LedWatch}
+ */
+static const char *const led_names[3] = { "red", "green", "blue" };
+
+/**
+ * @brief The board
+ */
+static struct {
+	volatile sig_atomic_t busy;		/*< inside a section touching the board */
+	volatile sig_atomic_t deferred;	/*< pacing signals that arrived while busy */
+	uint64_t cycles;				/*< the virtual core clock */
+	uint32_t hostSeen;				/*< host_cycles when last absorbed */
+	uint64_t quantum;				/*< virtual cycles per pacing signal */
+	bool lockstep;					/*< no virtual time passes while the firmware computes */
+	uint32_t polls;					/*< accesses to SysTick and UART0 since the last WFI */
+	uint32_t spun;					/*< quanta advanced in lockstep for a firmware waiting without WFI */
+	uint64_t runEnd;				/*< when to report and exit */
+	uint64_t slept;					/*< cycles skipped in WFI */
+	uint64_t stopped;				/*< of those, cycles in VLPS */
+	uint32_t stops;					/*< WFI entered as VLPS */
+	uint64_t stalled;				/*< cycles the core stalled on flash commands */
+	struct timespec started;		/*< real time at power on */
+	bool trace;						/*< log LED changes and accelerometer events */
+	FILE *events;					/*< the event log, or NULL */
+
+	replay_t replay;				/*< the trace feeding the accelerometer */
+	bool replaying;					/*< the accelerometer plays the trace */
+	bool replayEnds;				/*< the run ends with the trace */
+
+	uint64_t pending;				/*< pending exceptions, by number */
+	uint64_t enabled;				/*< enabled exceptions, by number */
+	uint8_t priority[BOARD_EXCEPTIONS];	/*< their priorities, 0 is the most urgent */
+	uint8_t current;				/*< execution priority */
+	uint8_t depth;					/*< exceptions active */
+	uint8_t deepest;				/*< most exceptions active at once */
+	uint32_t taken[BOARD_EXCEPTIONS];	/*< exceptions entered */
+
+	bool systickRunning;			/*< ENABLE was seen set */
+	uint64_t systickEpoch;			/*< the last reload */
+	uint64_t systickPeriod;			/*< LOAD + 1 as taken at that reload */
+	uint64_t systickNext;			/*< the next reload */
+	uint32_t systickShown;			/*< VAL as last mirrored, a different one was written by the firmware */
+
+	uint64_t lptmrStart;			/*< when the low power timer started */
+	uint64_t lptmrNext;				/*< its compare */
+
+	uint64_t mmaNext;				/*< the next accelerometer sample */
+	uint32_t portaLevels;			/*< levels of the interrupt pins */
+	uint32_t portaFlags;			/*< ISFR as owned by the board */
+	uint32_t portaArrived;			/*< flags raised since PORTA_IRQHandler was entered */
+	bool i2cStep;					/*< a driver step on I2C0 was seen by the previous pacing signal */
+
+	uint8_t uartStatus;				/*< S1 as owned by the board */
+	uint64_t uartShifted;			/*< when the byte in the shifter is out */
+	const uint8_t *dmaData;			/*< the rest of the DMA region */
+	size_t dmaLength;				/*< its bytes */
+	bool dmaActive;					/*< the channel owns a region */
+	uint8_t *rxData;				/*< characters to receive */
+	size_t rxLength;				/*< their number */
+	size_t rxIndex;					/*< the next one */
+	uint64_t rxNext;				/*< when it arrives */
+	uint32_t uartSent;				/*< bytes transmitted */
+	uint32_t uartReceived;			/*< bytes received */
+	uint32_t uartOverruns;			/*< bytes received over an unread one */
+	uint32_t uartLost;				/*< bytes arriving in VLPS */
+	FILE *uartOut;					/*< where transmitted bytes go */
+
+	uint16_t leds[3];				/*< duty cycles of red, green and blue */
+	uint32_t ledChanges[3];			/*< their changes */
+	uint8_t jerk;					/*< the jerk flag as last seen */
+} board;
+
+/**
+ * @brief Marks the board busy
+ * @return Whether it already was
+ */
+static inline sig_atomic_t Board_Enter(void)
+{
+	const sig_atomic_t was = board.busy;
+	board.busy = 1;
+	__atomic_signal_fence(__ATOMIC_SEQ_CST);
+	return was;
+}
+
+/**
+ * @brief Ends a section opened by {@see Board_Enter}
+ */
+static inline void Board_Leave(sig_atomic_t was)
+{
+	__atomic_signal_fence(__ATOMIC_SEQ_CST);
+	board.busy = was;
+}
+
+/**
+ * @brief Writes a line to a file descriptor without the stdio buffers, safe from the pacing signal
+ */
+static void Board_Write(int fd, const char *format, va_list args)
+{
+	char line[256];
+	const int length = vsnprintf(line, sizeof(line), format, args);
+	const ssize_t written = write(fd, line, (length < (int)sizeof(line)) ? (size_t)length : sizeof(line) - 1);
+	(void)written;
+}
+
+/**
+ * @brief Prints a line of the report
+ */
+static void Board_Print(const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	Board_Write(STDOUT_FILENO, format, args);
+	va_end(args);
+}
+
+/**
+ * @brief Logs an event with its virtual time to stderr, if tracing
+ */
+static void Board_Trace(const char *format, ...)
+{
+	char prefixed[192];
+	va_list args;
+
+	if (!board.trace) {
+		return;
+	}
+	snprintf(prefixed, sizeof(prefixed), "board: %10llu us %s\n",
+			(unsigned long long)(board.cycles / BOARD_CYCLES_PER_US), format);
+	va_start(args, format);
+	Board_Write(STDERR_FILENO, prefixed, args);
+	va_end(args);
+}
+
+/**
+ * @brief Appends an event with its virtual time to the event log, if there is one
+ */
+static void Board_Event(const char *format, ...)
+{
+	va_list args;
+
+	if (board.events == NULL) {
+		return;
+	}
+	fprintf(board.events, "%llu,", (unsigned long long)(board.cycles / BOARD_CYCLES_PER_US));
+	va_start(args, format);
+	vfprintf(board.events, format, args);
+	va_end(args);
+	fputc('\n', board.events);
+}
+
+/**
+ * @brief SysTick enabled or VAL written by the firmware: the counter starts over from LOAD at the
+ * 		  time the board last saw, before the wire time of a transfer since moves the clock.
+ * 		  Enabled again after a stop with VAL untouched, it counts on from where it stood.
+ */
+static void Board_SysTickWatch(void)
+{
+	if (!(board_systick.CTRL & SysTick_CTRL_ENABLE_Msk)) {
+		return;
+	}
+	if (!board.systickRunning && (board_systick.VAL == board.systickShown) && (board_systick.VAL != 0)) {
+		board.systickRunning = true;
+		board.systickEpoch = board.cycles - (board.systickPeriod - 1 - board_systick.VAL);
+	}
+	else if (!board.systickRunning || (board_systick.VAL != board.systickShown)) {
+		board.systickRunning = true;
+		board.systickEpoch = board.cycles;
+		board.systickPeriod = (board_systick.LOAD & SysTick_LOAD_RELOAD_Msk) + 1;
+		board_systick.VAL = board.systickPeriod - 1;
+		board.systickShown = board_systick.VAL;
+		board_systick.CTRL &= ~SysTick_CTRL_COUNTFLAG_Msk;
+	}
+}
+
+/**
+ * @brief The virtual clock after the wire time the I2C model added
+ */
+static uint64_t Board_Now(void)
+{
+	const uint32_t cycles = host_cycles;
+
+	Board_SysTickWatch();
+	board.cycles += (uint32_t)(cycles - board.hostSeen);
+	board.hostSeen = cycles;
+	return board.cycles;
+}
+
+/*
+ * NVIC
+ */
+
+/**
+ * @brief Tells the intrinsics of cmsis_host.h whether unmasking has something to take
+ */
+static void Board_Pending(void)
+{
+	host_pending = (board.pending & board.enabled) != 0;
+}
+
+static void Board_Pend(int exception)
+{
+	board.pending |= 1ull << exception;
+	if (exception == BOARD_SYSTICK) {
+		board_scb.ICSR |= SCB_ICSR_PENDSTSET_Msk;
+	}
+	Board_Pending();
+}
+
+static void Board_Unpend(int exception)
+{
+	board.pending &= ~(1ull << exception);
+	if (exception == BOARD_SYSTICK) {
+		board_scb.ICSR &= ~SCB_ICSR_PENDSTSET_Msk;
+	}
+	Board_Pending();
+}
+
+/**
+ * @brief The exception that would preempt the execution priority, PRIMASK aside
+ * @return Its number, or -1; of equal priorities the lower number
+ */
+static int Board_Next(void)
+{
+	int best = -1;
+	uint8_t level = board.current;
+
+	for (uint64_t ready = board.pending & board.enabled; ready != 0; ready &= ready - 1) {
+		const int exception = __builtin_ctzll(ready);
+		if (board.priority[exception] < level) {
+			best = exception;
+			level = board.priority[exception];
+		}
+	}
+	return best;
+}
+
+static void Board_Dispatch(void);
+
+void Board_NvicEnableIRQ(IRQn_Type irq)
+{
+	if (irq < 0) {
+		return;
+	}
+	const sig_atomic_t was = Board_Enter();
+	board.enabled |= 1ull << BOARD_IRQ(irq);
+	Board_Pending();
+	Board_Leave(was);
+	Board_Dispatch();
+}
+
+void Board_NvicDisableIRQ(IRQn_Type irq)
+{
+	if (irq < 0) {
+		return;
+	}
+	const sig_atomic_t was = Board_Enter();
+	board.enabled &= ~(1ull << BOARD_IRQ(irq));
+	Board_Pending();
+	Board_Leave(was);
+}
+
+uint32_t Board_NvicGetPendingIRQ(IRQn_Type irq)
+{
+	return (board.pending >> BOARD_IRQ(irq)) & 1;
+}
+
+void Board_NvicSetPendingIRQ(IRQn_Type irq)
+{
+	const sig_atomic_t was = Board_Enter();
+	Board_Pend(BOARD_IRQ(irq));
+	Board_Leave(was);
+	Board_Dispatch();
+}
+
+void Board_NvicClearPendingIRQ(IRQn_Type irq)
+{
+	const sig_atomic_t was = Board_Enter();
+	Board_Unpend(BOARD_IRQ(irq));
+	Board_Leave(was);
+}
+
+void Board_NvicSetPriority(IRQn_Type irq, uint32_t priority)
+{
+	/* the core implements the two upper bits of the priority */
+	board.priority[BOARD_IRQ(irq)] = priority & 0x03;
+}
+
+uint32_t Board_NvicGetPriority(IRQn_Type irq)
+{
+	return board.priority[BOARD_IRQ(irq)];
+}
+
+/*
+ * Peripherals
+ */
+
+/**
+ * @brief ICSR PENDSTCLR written by the firmware: unpends SysTick before anything is taken
+ */
+static void Board_ScbWatch(void)
+{
+	if (board_scb.ICSR & SCB_ICSR_PENDSTCLR_Msk) {
+		board_scb.ICSR &= ~SCB_ICSR_PENDSTCLR_Msk;
+		Board_Unpend(BOARD_SYSTICK);
+	}
+}
+
+/**
+ * @brief SysTick: VAL counts down from LOAD, every reload takes LOAD again, sets COUNTFLAG and pends
+ * 		  the exception with TICKINT; a write to VAL clears the counter, which reloads at once.
+ * 		  Seen disabled, it counts up to the time the board last saw and VAL holds from there.
+ */
+static void Board_SysTickStep(void)
+{
+	const bool enabled = (board_systick.CTRL & SysTick_CTRL_ENABLE_Msk) != 0;
+
+	if (!enabled && !board.systickRunning) {
+		board.systickNext = BOARD_NEVER;
+		return;
+	}
+
+	Board_SysTickWatch();
+
+	uint64_t elapsed = board.cycles - board.systickEpoch;
+	if (elapsed >= board.systickPeriod) {
+		board.systickEpoch += board.systickPeriod;
+		board.systickPeriod = (board_systick.LOAD & SysTick_LOAD_RELOAD_Msk) + 1;
+		elapsed = board.cycles - board.systickEpoch;
+		board.systickEpoch += elapsed - elapsed % board.systickPeriod;
+		board_systick.CTRL |= SysTick_CTRL_COUNTFLAG_Msk;
+		if (board_systick.CTRL & SysTick_CTRL_TICKINT_Msk) {
+			Board_Pend(BOARD_SYSTICK);
+		}
+	}
+	board_systick.VAL = (uint32_t)(board.systickPeriod - 1 - (board.cycles - board.systickEpoch));
+	board.systickShown = board_systick.VAL;
+	board.systickNext = board.systickEpoch + board.systickPeriod;
+
+	if (!enabled) {
+		board.systickRunning = false;
+		board.systickNext = BOARD_NEVER;
+	}
+}
+
+/**
+ * @brief Mirrors the flags the board owns into PORTA ISFR and the ISF of the pins' PCR
+ */
+static void Board_PortaMirror(void)
+{
+	PORT_Type *port = &board_ports[0].port;
+
+	port->ISFR = board.portaFlags;
+	for (int pin = BOARD_INT1_PIN; pin <= BOARD_INT2_PIN; ++pin) {
+		if (board.portaFlags & (1u << pin)) {
+			port->PCR[pin] |= PORT_PCR_ISF_MASK;
+		}
+		else {
+			port->PCR[pin] &= ~PORT_PCR_ISF_MASK;
+		}
+	}
+}
+
+/**
+ * @brief Samples the accelerometer's interrupt pins into PDIR and flags them as their PCR IRQC asks
+ */
+static void Board_PortaSample(void)
+{
+	PORT_Type *port = &board_ports[0].port;
+	uint32_t levels = 0, flags = 0;
+
+	levels |= SimMma8451q_PinHigh(&board_mma8451q, SIM_MMA8451Q_INT1) ? (1u << BOARD_INT1_PIN) : 0;
+	levels |= SimMma8451q_PinHigh(&board_mma8451q, SIM_MMA8451Q_INT2) ? (1u << BOARD_INT2_PIN) : 0;
+	*(volatile uint32_t *)&board_gpio[0].PDIR = (board_gpio[0].PDIR & ~BOARD_INT_PINS) | levels;
+
+	const uint32_t changed = levels ^ board.portaLevels;
+	board.portaLevels = levels;
+
+	for (int pin = BOARD_INT1_PIN; pin <= BOARD_INT2_PIN; ++pin) {
+		const uint32_t bit = 1u << pin;
+		const bool high = levels & bit;
+		const bool edge = changed & bit;
+
+		switch ((port->PCR[pin] & PORT_PCR_IRQC_MASK) >> PORT_PCR_IRQC_SHIFT) {
+		case 0x8: flags |= !high ? bit : 0; break;				/* logic zero */
+		case 0x9: flags |= (edge && high) ? bit : 0; break;		/* rising edge */
+		case 0xA: flags |= (edge && !high) ? bit : 0; break;	/* falling edge */
+		case 0xB: flags |= edge ? bit : 0; break;				/* either edge */
+		case 0xC: flags |= high ? bit : 0; break;				/* logic one */
+		default: break;
+		}
+	}
+
+	if (flags != 0) {
+		board.portaFlags |= flags;
+		board.portaArrived |= flags;
+		Board_PortaMirror();
+		Board_Pend(BOARD_IRQ(PORTA_IRQn));
+	}
+}
+
+/**
+ * @brief Pends the I2C0 service for a step the driver made on the module; one seen by a pacing
+ * 		  signal may be half done (D is written after C1), so it waits for the next signal
+ * @param[in] settled The firmware is at a point where its step is complete
+ */
+static void Board_I2cWatch(bool settled)
+{
+	const uint8_t c1 = board_i2c0.regs.C1;
+	const bool step = ((c1 & ~I2C_C1_RSTA_MASK) != board_i2c0.lastC1) || (c1 & I2C_C1_RSTA_MASK);
+
+	if (!step) {
+		board.i2cStep = false;
+	}
+	else if (settled || board.i2cStep) {
+		board.i2cStep = false;
+		Board_Pend(BOARD_IRQ(I2C0_IRQn));
+	}
+	else {
+		board.i2cStep = true;
+	}
+}
+
+/**
+ * @brief Core clock cycles of one UART0 frame at the programmed baud rate
+ */
+static uint64_t Board_UartFrameCycles(void)
+{
+	const uint32_t sbr = ((board_uart0.BDH & UART0_BDH_SBR_MASK) << 8) | board_uart0.BDL;
+	const uint32_t osr = (board_uart0.C4 & UART0_C4_OSR_MASK) + 1;
+
+	if ((sbr == 0) || (osr < 4)) {
+		return (uint64_t)SYSTEM_CLOCK_FREQ * BOARD_UART_FRAME_BITS / BOARD_UART_BAUD;
+	}
+	return (uint64_t)BOARD_UART_FRAME_BITS * sbr * osr;
+}
+
+/**
+ * @brief Moves a byte into the shifter
+ */
+static void Board_UartShift(uint8_t value)
+{
+	board.uartSent++;
+	fputc(value, board.uartOut);
+	board.uartStatus &= ~(UART0_S1_TDRE_MASK | UART0_S1_TC_MASK);
+	board.uartShifted = board.cycles + Board_UartFrameCycles();
+}
+
+/**
+ * @brief Mirrors S1 and pends UART0 while one of its enabled requests stands
+ */
+static void Board_UartWatch(void)
+{
+	const uint8_t c2 = board_uart0.C2;
+	const uint8_t status = board.uartStatus;
+
+	board_uart0.S1 = status;
+
+	if ((board.rxIndex < board.rxLength) && (board.rxNext == BOARD_NEVER) && (c2 & UART0_C2_RE_MASK)) {
+		board.rxNext = board.cycles + Board_UartFrameCycles();
+	}
+
+	const bool request = ((c2 & UART0_C2_TIE_MASK) && (status & UART0_S1_TDRE_MASK) && !(board_uart0.C5 & UART0_C5_TDMAE_MASK))
+			|| ((c2 & UART0_C2_TCIE_MASK) && (status & UART0_S1_TC_MASK))
+			|| ((c2 & UART0_C2_RIE_MASK) && (status & (UART0_S1_RDRF_MASK | UART0_S1_OR_MASK)));
+	if (request) {
+		Board_Pend(BOARD_IRQ(UART0_IRQn));
+	}
+	else {
+		Board_Unpend(BOARD_IRQ(UART0_IRQn));
+	}
+}
+
+/**
+ * @brief Watches the duty cycles of the RGB LED
+ */
+static void Board_LedWatch(void)
+{
+	const uint16_t duty[3] = {
+		(uint16_t)board_tpm[2].CONTROLS[0].CnV, (uint16_t)board_tpm[2].CONTROLS[1].CnV, (uint16_t)board_tpm[0].CONTROLS[1].CnV
+	};
+
+	bool changed = false;
+
+	for (int led = 0; led < 3; ++led) {
+		if (duty[led] != board.leds[led]) {
+			board.leds[led] = duty[led];
+			board.ledChanges[led]++;
+			changed = true;
+			Board_Trace("led %s %u", led_names[led], duty[led]);
+		}
+	}
+	if (changed) {
+		Board_Event("pwm,%u,%u,%u", board.leds[0], board.leds[1], board.leds[2]);
+	}
+}
+
+/**
+ * @brief Watches the jerk flag of the state machine for its transitions
+ */
+static void Board_StateWatch(void)
+{
+	if (&flag == NULL) {
+		return;
+	}
+
+	const uint8_t jerk = flag;
+	if (jerk != board.jerk) {
+		board.jerk = jerk;
+		Board_Event("state,%s", jerk ? "ACCEL" : "ROUTINE");
+	}
+}
+
+/**
+ * @brief The next event of the models
+ */
+static uint64_t Board_NextEvent(void)
+{
+	uint64_t next = board.mmaNext;
+	next = (board.uartShifted < next) ? board.uartShifted : next;
+	next = (board.rxNext < next) ? board.rxNext : next;
+	next = (board.lptmrNext < next) ? board.lptmrNext : next;
+	return next;
+}
+
+/**
+ * @brief Runs the events of the clocks that run in VLPS due by now: the accelerometer and the LPTMR
+ */
+static void Board_RunStopEvents(void)
+{
+	if (board.lptmrNext <= board.cycles) {
+		board.lptmrNext = BOARD_NEVER;
+		Board_Pend(BOARD_IRQ(LPTMR0_IRQn));
+	}
+
+	if (board.mmaNext <= board.cycles) {
+		const sim_mma8451q_stats_t before = board_mma8451q.stats;
+		SimMma8451q_Acquire(&board_mma8451q, board.mmaNext / BOARD_CYCLES_PER_US);
+		if (board_mma8451q.stats.motionEvents != before.motionEvents) {
+			Board_Trace("mma8451q motion event");
+			Board_Event("motion");
+		}
+		if (board_mma8451q.stats.transientEvents != before.transientEvents) {
+			Board_Trace("mma8451q transient event");
+			Board_Event("transient");
+		}
+
+		const uint32_t periodUs = SimMma8451q_PeriodUs(&board_mma8451q);
+		board.mmaNext = (periodUs == 0) ? BOARD_NEVER : board.mmaNext + (uint64_t)periodUs * BOARD_CYCLES_PER_US;
+		Board_PortaSample();
+
+		/* the firmware gets one more period to take the last sample of a trace */
+		if (board.replayEnds && board.replay.ended && (board.runEnd == BOARD_NEVER)) {
+			board.runEnd = board.mmaNext;
+		}
+	}
+}
+
+/**
+ * @brief Runs the events of the models due by now
+ */
+static void Board_RunEvents(void)
+{
+	Board_RunStopEvents();
+
+	if (board.uartShifted <= board.cycles) {
+		board.uartShifted = BOARD_NEVER;
+		if (board.dmaLength != 0) {
+			board.dmaLength--;
+			Board_UartShift(*board.dmaData++);
+		}
+		else {
+			board.uartStatus |= UART0_S1_TDRE_MASK | UART0_S1_TC_MASK;
+			if (board.dmaActive) {
+				board.dmaActive = false;
+				Board_Pend(BOARD_IRQ(DMA1_IRQn));
+			}
+		}
+	}
+
+	if (board.rxNext <= board.cycles) {
+		if (board.uartStatus & UART0_S1_RDRF_MASK) {
+			board.uartStatus |= UART0_S1_OR_MASK;
+			board.uartOverruns++;
+		}
+		else {
+			board_uart0.D = board.rxData[board.rxIndex];
+			board.uartStatus |= UART0_S1_RDRF_MASK;
+		}
+		board.uartReceived++;
+		board.rxIndex++;
+		board.rxNext = (board.rxIndex < board.rxLength) ? board.rxNext + Board_UartFrameCycles() : BOARD_NEVER;
+	}
+}
+
+/**
+ * @brief Advances the clock to a target, running the events on the way, then lets every
+ * 		  peripheral react to what the firmware did since the last time
+ * @param[in] target The virtual time to reach; the clock never goes back
+ * @param[in] settled The firmware is at a point where its I2C step is complete
+ */
+static void Board_Advance(uint64_t target, bool settled)
+{
+	Board_Now();
+
+	for (uint64_t next = Board_NextEvent(); next <= target; next = Board_NextEvent()) {
+		if (next > board.cycles) {
+			board.cycles = next;
+		}
+		Board_RunEvents();
+	}
+	if (target > board.cycles) {
+		board.cycles = target;
+	}
+
+	/* a sensor just made active starts sampling one period later */
+	if (board.mmaNext == BOARD_NEVER) {
+		const uint32_t periodUs = SimMma8451q_PeriodUs(&board_mma8451q);
+		board.mmaNext = (periodUs == 0) ? BOARD_NEVER : board.cycles + (uint64_t)periodUs * BOARD_CYCLES_PER_US;
+	}
+
+	Board_ScbWatch();
+	Board_SysTickStep();
+	Board_I2cWatch(settled);
+	Board_UartWatch();
+	Board_PortaSample();
+	Board_LedWatch();
+	Board_StateWatch();
+}
+
+/*
+ * Vectors
+ */
+
+/**
+ * @brief I2C0: the module reacts to the driver's step, then the handler to the module, until the module waits for the driver
+ */
+static void Board_I2c0Service(void)
+{
+	for (int steps = 0; steps < BOARD_I2C_STEPS; ++steps) {
+		const sig_atomic_t was = Board_Enter();
+		const bool raised = SimI2C_Clock(&board_i2c0) && (board_i2c0.regs.C1 & I2C_C1_IICIE_MASK);
+		Board_Leave(was);
+
+		if (!raised || (I2C0_IRQHandler == NULL)) {
+			return;
+		}
+		I2C0_IRQHandler();
+	}
+}
+
+/**
+ * @brief PORTA: the flags the handler saw at entry count as cleared on its return
+ */
+static void Board_PortaService(void)
+{
+	sig_atomic_t was = Board_Enter();
+	const uint32_t seen = board.portaFlags;
+	board.portaArrived = 0;
+	Board_PortaMirror();
+	Board_Leave(was);
+
+	if (PORTA_IRQHandler != NULL) {
+		PORTA_IRQHandler();
+	}
+
+	was = Board_Enter();
+	board.portaFlags = (board.portaFlags & ~seen) | board.portaArrived;
+	Board_PortaMirror();
+	if (board.portaFlags != 0) {
+		Board_Pend(BOARD_IRQ(PORTA_IRQn));
+	}
+	Board_Leave(was);
+}
+
+/**
+ * @brief UART0: reading D took the received byte; a byte was written to D if TDRE was set and TIE stayed set
+ */
+static void Board_Uart0Service(void)
+{
+	sig_atomic_t was = Board_Enter();
+	board_uart0.S1 = board.uartStatus;
+	const bool transmit = (board_uart0.C2 & UART0_C2_TIE_MASK) && (board.uartStatus & UART0_S1_TDRE_MASK)
+			&& !(board_uart0.C5 & UART0_C5_TDMAE_MASK);
+	const uint8_t received = board.uartStatus & (UART0_S1_RDRF_MASK | UART0_S1_OR_MASK);
+	Board_Leave(was);
+
+	if (UART0_IRQHandler != NULL) {
+		UART0_IRQHandler();
+	}
+
+	was = Board_Enter();
+	board.uartStatus &= ~received;
+	if (transmit && (board_uart0.C2 & UART0_C2_TIE_MASK)) {
+		Board_UartShift(board_uart0.D);
+	}
+	Board_UartWatch();
+	Board_Leave(was);
+}
+
+/**
+ * @brief An exception the firmware has no handler for; the default handler of the startup code would hang
+ */
+static void Board_Unhandled(void)
+{
+	Board_Print("board: unhandled exception %u\n", (unsigned)host_ipsr);
+	Board_Report();
+	_exit(1);
+}
+
+/**
+ * @brief The vector of an exception
+ */
+static void (*Board_Vector(int exception))(void)
+{
+	void (*vector)(void) = NULL;
+
+	switch (exception) {
+	case BOARD_SYSTICK:				vector = SysTick_Handler; break;
+	case BOARD_IRQ(DMA0_IRQn):		vector = DMA0_IRQHandler; break;
+	case BOARD_IRQ(DMA1_IRQn):		vector = DMA1_IRQHandler; break;
+	case BOARD_IRQ(I2C0_IRQn):		return Board_I2c0Service;
+	case BOARD_IRQ(UART0_IRQn):		return Board_Uart0Service;
+	case BOARD_IRQ(PORTA_IRQn):		return Board_PortaService;
+	case BOARD_IRQ(LPTMR0_IRQn):	vector = LPTMR0_IRQHandler; break;
+	default:						break;
+	}
+	return (vector != NULL) ? vector : Board_Unhandled;
+}
+
+/**
+ * @brief Takes pending exceptions as long as one preempts the execution priority and PRIMASK is clear
+ */
+static void Board_Dispatch(void)
+{
+	for (;;) {
+		sig_atomic_t was = Board_Enter();
+		Board_ScbWatch();
+		const int exception = host_primask ? -1 : Board_Next();
+		if (exception < 0) {
+			Board_Leave(was);
+			return;
+		}
+
+		Board_Unpend(exception);
+		const uint8_t preempted = board.current;
+		const uint32_t ipsr = host_ipsr;
+		board.current = board.priority[exception];
+		host_ipsr = exception;
+		board.taken[exception]++;
+		if (++board.depth > board.deepest) {
+			board.deepest = board.depth;
+		}
+		Board_Leave(was);
+
+		Board_Vector(exception)();
+
+		was = Board_Enter();
+		board.depth--;
+		board.current = preempted;
+		host_ipsr = ipsr;
+		Board_Advance(Board_Now(), true);
+		Board_Leave(was);
+	}
+}
+
+/*
+ * The core
+ */
+
+/**
+ * @brief Stops the run
+ */
+static void Board_Finish(int status)
+{
+	const struct itimerval stop = { { 0, 0 }, { 0, 0 } };
+	setitimer(ITIMER_REAL, &stop, NULL);
+
+	fflush(board.uartOut);
+	Board_Report();
+	fclose(board.uartOut);
+	if (board.events != NULL) {
+		fclose(board.events);
+	}
+	if (board.replay.error[0] != '\0') {
+		status = 1;
+	}
+	_exit(status);
+}
+
+/**
+ * @brief Virtual time passes while the firmware computes, interrupts are taken in between
+ * @param[in] quanta Quanta to advance
+ */
+static void Board_Quantum(uint64_t quanta)
+{
+	const sig_atomic_t was = Board_Enter();
+	Board_Advance(Board_Now() + quanta * board.quantum, false);
+	const bool stalled = (board.cycles >= board.runEnd) && (board.cycles - board.runEnd >= BOARD_STALL_CYCLES);
+	Board_Leave(was);
+
+	if (stalled) {
+		Board_Print("board: the firmware did not sleep since the end of the run\n");
+		Board_Finish(1);
+	}
+	Board_Dispatch();
+}
+
+/**
+ * @brief The pacing signal: a quantum per signal, those that arrived while busy included
+ */
+static void Board_Pace(int signal)
+{
+	(void)signal;
+
+	if (board.busy) {
+		board.deferred++;
+		return;
+	}
+
+	const int saved = errno;
+	const uint64_t quanta = 1 + board.deferred;
+	board.deferred = 0;
+	Board_Quantum(quanta);
+	errno = saved;
+}
+
+/**
+ * @brief In lockstep only a firmware waiting for time without WFI, on SysTick or a UART0 flag say,
+ * 		  gets it: a quantum per BOARD_LOCKSTEP_POLLS accesses, counted in its own instructions,
+ * 		  so the run still repeats exactly
+ */
+void *Board_Poll(void *peripheral)
+{
+	if (board.lockstep && !board.busy && (++board.polls >= BOARD_LOCKSTEP_POLLS)) {
+		board.polls = 0;
+		board.spun++;
+		Board_Quantum(1);
+	}
+	return peripheral;
+}
+
+/**
+ * @brief VLPS: only the accelerometer and the LPTMR run until one of them raises its interrupt;
+ * 		  the clocks of SysTick and UART0 stand still, characters arriving meanwhile are lost
+ */
+static void Board_Stop(void)
+{
+	const uint64_t wakes = (1ull << BOARD_IRQ(PORTA_IRQn)) | (1ull << BOARD_IRQ(LPTMR0_IRQn));
+	const uint64_t from = board.cycles;
+
+	board.stops++;
+	while (!(board.pending & board.enabled & wakes) && (board.cycles < board.runEnd)) {
+		uint64_t next = (board.lptmrNext < board.mmaNext) ? board.lptmrNext : board.mmaNext;
+		next = (board.runEnd < next) ? board.runEnd : next;
+		board.cycles = (next > board.cycles) ? next : board.cycles + 1;
+		Board_RunStopEvents();
+	}
+
+	const uint64_t stopped = board.cycles - from;
+	board.stopped += stopped;
+	board.slept += stopped;
+	board.systickEpoch += stopped;
+	board.uartShifted += (board.uartShifted != BOARD_NEVER) ? stopped : 0;
+	while (board.rxNext <= board.cycles) {
+		board.uartLost++;
+		board.uartReceived++;
+		board.rxIndex++;
+		board.rxNext = (board.rxIndex < board.rxLength) ? board.rxNext + Board_UartFrameCycles() : BOARD_NEVER;
+	}
+	Board_Advance(board.cycles, true);
+}
+
+/**
+ * @brief WFI: sleeps until the next event unless an interrupt is ready to preempt; stops with SLEEPDEEP in VLPS
+ */
+void Host_WaitForInterrupt(void)
+{
+	const sig_atomic_t was = Board_Enter();
+	board.polls = 0;
+	Board_Advance(Board_Now(), true);
+
+	const bool vlps = (board_scb.SCR & SCB_SCR_SLEEPDEEP_Msk)
+			&& (((board_smc.PMCTRL & SMC_PMCTRL_STOPM_MASK) >> SMC_PMCTRL_STOPM_SHIFT) == kSMC_StopVlps);
+	if ((Board_Next() < 0) && vlps) {
+		board.deferred = 0;
+		Board_Stop();
+	}
+	else if (Board_Next() < 0) {
+		uint64_t next = Board_NextEvent();
+		next = (board.systickNext < next) ? board.systickNext : next;
+		next = (board.runEnd < next) ? board.runEnd : next;
+		if (next <= board.cycles) {
+			next = board.cycles + 1;
+		}
+		board.slept += next - board.cycles;
+		board.deferred = 0;
+		Board_Advance(next, true);
+	}
+	const bool finished = board.cycles >= board.runEnd;
+	Board_Leave(was);
+
+	if (finished) {
+		Board_Finish(0);
+	}
+	Board_Dispatch();
+}
+
+/**
+ * @brief PRIMASK was cleared with an interrupt pending
+ */
+void Host_InterruptsUnmasked(void)
+{
+	if (!board.busy) {
+		Board_Dispatch();
+	}
+}
+
+/**
+ * @brief The virtual core clock
+ */
+uint64_t Board_Cycles(void)
+{
+	const sig_atomic_t was = Board_Enter();
+	const uint64_t cycles = Board_Now();
+	Board_Leave(was);
+	return cycles;
+}
+
+/**
+ * @brief Queues characters for the UART0 receiver
+ */
+void Board_UartReceive(const uint8_t *data, size_t length)
+{
+	const sig_atomic_t was = Board_Enter();
+	uint8_t *queued = realloc(board.rxData, board.rxLength - board.rxIndex + length);
+	if (queued != NULL) {
+		memmove(queued, queued + board.rxIndex, board.rxLength - board.rxIndex);
+		memcpy(queued + board.rxLength - board.rxIndex, data, length);
+		board.rxData = queued;
+		board.rxLength = board.rxLength - board.rxIndex + length;
+		board.rxIndex = 0;
+	}
+	Board_Leave(was);
+}
+
+/**
+ * @brief Starts the DMA channel on a region for the UART0 transmitter
+ */
+void Board_UartDmaStart(const uint8_t *data, size_t length)
+{
+	const sig_atomic_t was = Board_Enter();
+	Board_Now();
+	board.dmaData = data;
+	board.dmaLength = length;
+	board.dmaActive = true;
+	if ((board.uartShifted == BOARD_NEVER) && (board.dmaLength != 0)) {
+		board.dmaLength--;
+		Board_UartShift(*board.dmaData++);
+	}
+	Board_Leave(was);
+}
+
+/**
+ * @brief Starts the low power timer
+ */
+void Board_LptmrStart(uint32_t counts)
+{
+	const sig_atomic_t was = Board_Enter();
+	board.lptmrStart = Board_Now();
+	board.lptmrNext = board.lptmrStart + (uint64_t)counts * SYSTEM_CLOCK_FREQ / LPTMR_CLOCK_HZ;
+	Board_Leave(was);
+}
+
+/**
+ * @brief Stops the low power timer
+ */
+uint32_t Board_LptmrStop(void)
+{
+	const sig_atomic_t was = Board_Enter();
+	const uint64_t counts = (Board_Now() - board.lptmrStart) * LPTMR_CLOCK_HZ / SYSTEM_CLOCK_FREQ;
+	board.lptmrNext = BOARD_NEVER;
+	Board_Unpend(BOARD_IRQ(LPTMR0_IRQn));
+	Board_Leave(was);
+	return (uint32_t)counts;
+}
+
+/**
+ * @brief The core stalls on a flash command
+ */
+void Board_Stall(uint64_t cycles)
+{
+	const sig_atomic_t was = Board_Enter();
+	/* SysTick stopped for the stall holds where it stood when the stall began */
+	Board_Advance(Board_Now(), true);
+	board.stalled += cycles;
+	Board_Advance(board.cycles + cycles, true);
+	Board_Leave(was);
+}
+
+/**
+ * @brief Prints what the run did
+ */
+void Board_Report(void)
+{
+	static const struct { int exception; const char *name; } names[] = {
+		{ BOARD_SYSTICK, "SysTick" }, { BOARD_IRQ(DMA0_IRQn), "DMA0" }, { BOARD_IRQ(DMA1_IRQn), "DMA1" },
+		{ BOARD_IRQ(I2C0_IRQn), "I2C0" }, { BOARD_IRQ(UART0_IRQn), "UART0" }, { BOARD_IRQ(PORTA_IRQn), "PORTA" },
+		{ BOARD_IRQ(LPTMR0_IRQn), "LPTMR0" }
+	};
+	struct timespec now;
+	char exceptions[192];
+	int length = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	const double real = (double)(now.tv_sec - board.started.tv_sec) + (double)(now.tv_nsec - board.started.tv_nsec) / 1e9;
+	const double simulated = (double)board.cycles / SYSTEM_CLOCK_FREQ;
+
+	fflush(stdout);
+	Board_Print("\nboard: %.3f s simulated in %.3f s (%.1fx), core asleep %.1f%%\n", simulated, real,
+			(real > 0) ? simulated / real : 0.0, (board.cycles != 0) ? 100.0 * board.slept / board.cycles : 0.0);
+
+	for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+		length += snprintf(exceptions + length, sizeof(exceptions) - length, " %s %lu", names[i].name,
+				(unsigned long)board.taken[names[i].exception]);
+	}
+	Board_Print("board: exceptions%s, deepest nesting %u\n", exceptions, board.deepest);
+	Board_Print("board: I2C0 %lu starts, %lu bytes, %lu us on the wire\n", (unsigned long)board_i2c0.starts,
+			(unsigned long)board_i2c0.bytes, (unsigned long)SimI2C_BusTimeUs(&board_i2c0));
+	Board_Print("board: MMA8451Q %lu samples, %lu FIFO overflows, %lu motion and %lu transient events, %lu resets\n",
+			(unsigned long)board_mma8451q.stats.samples, (unsigned long)board_mma8451q.stats.overflows,
+			(unsigned long)board_mma8451q.stats.motionEvents, (unsigned long)board_mma8451q.stats.transientEvents,
+			(unsigned long)board_mma8451q.stats.resets);
+	Board_Print("board: UART0 %lu bytes sent, %lu received, %lu overruns\n", (unsigned long)board.uartSent,
+			(unsigned long)board.uartReceived, (unsigned long)board.uartOverruns);
+	if (board.stops != 0) {
+		Board_Print("board: VLPS %lu times, %.1f%% of the time, %lu bytes received meanwhile lost\n",
+				(unsigned long)board.stops, 100.0 * board.stopped / board.cycles, (unsigned long)board.uartLost);
+	}
+	if (board.stalled != 0) {
+		Board_Print("board: flash commands stalled the core %lu us\n", (unsigned long)(board.stalled / BOARD_CYCLES_PER_US));
+	}
+	Board_Print("board: LED %s %u %s %u %s %u, changed %lu/%lu/%lu times\n", led_names[0], board.leds[0],
+			led_names[1], board.leds[1], led_names[2], board.leds[2], (unsigned long)board.ledChanges[0],
+			(unsigned long)board.ledChanges[1], (unsigned long)board.ledChanges[2]);
+	if (board.lockstep) {
+		Board_Print("board: lockstep, %lu quanta spun without WFI\n", (unsigned long)board.spun);
+	}
+	if (board.replaying) {
+		const replay_stats_t *stats = &board.replay.stats;
+		const double traceSeconds = (double)(board.replay.current.timeUs - board.replay.startUs) / 1e6;
+		Board_Print("board: replay %lu samples over %.3f s of trace, %lu presented, %lu held, %lu skipped, %.0f samples/s\n",
+				(unsigned long)stats->samples, traceSeconds, (unsigned long)stats->presented,
+				(unsigned long)stats->held, (unsigned long)stats->skipped, (real > 0) ? stats->presented / real : 0.0);
+		if (board.replay.error[0] != '\0') {
+			Board_Print("board: replay stopped early, %s\n", board.replay.error);
+		}
+	}
+}
+
+/**
+ * @brief The tilt conversion of Control_RGB_LEDs, logged (linked with --wrap=convert_xyz_to_roll_pitch)
+ */
+void __real_convert_xyz_to_roll_pitch(mma8451q_acc_t *acc, int16_t *roll, int16_t *pitch);
+void __wrap_convert_xyz_to_roll_pitch(mma8451q_acc_t *acc, int16_t *roll, int16_t *pitch)
+{
+	__real_convert_xyz_to_roll_pitch(acc, roll, pitch);
+
+	const sig_atomic_t was = Board_Enter();
+	Board_Now();
+	Board_Event("angles,%d,%d,%d,%d,%d", acc->x, acc->y, acc->z, *roll, *pitch);
+	Board_Leave(was);
+}
+
+/**
+ * @brief The firmware's stdout: as with Redlib, printf goes through __sys_write into TxQ. What does
+ * 		  not fit waits in WFI rather than in __sys_write's loop, so logging costs no real time in lockstep.
+ */
+static ssize_t Board_Console(void *cookie, const char *buffer, size_t size)
+{
+	(void)cookie;
+
+	for (size_t written = 0; written < size; ) {
+		const size_t space = Q_Capacity(&TxQ) - Q_Length(&TxQ);
+		if (space == 0) {
+			__WFI();
+			continue;
+		}
+		const size_t chunk = (size - written < space) ? size - written : space;
+		__sys_write(1, (char *)buffer + written, (int)chunk);
+		written += chunk;
+	}
+	return (ssize_t)size;
+}
+
+/**
+ * @brief Powers the board on before main(): reset values, the configuration from the environment, the pacing signal
+ */
+__attribute__((constructor)) static void Board_PowerOn(void)
+{
+	const char *value;
+
+	SimI2C_Init(&board_i2c0, BOARD_MMA8451Q_ADDRESS);
+	SimMma8451q_Init(&board_mma8451q, &board_i2c0);
+
+	value = getenv("BOARD_WAVEFORM");
+	if ((value != NULL) && !SimMma8451q_WaveformParse(&board_mma8451q.waveform, value)) {
+		fprintf(stderr, "board: cannot parse BOARD_WAVEFORM \"%s\"\n", value);
+		exit(2);
+	}
+
+	/* reset values: pins pulled up, the UART transmitter empty at 0x0004 SBR and 16x oversampling */
+	for (int port = 0; port < 5; ++port) {
+		*(volatile uint32_t *)&board_gpio[port].PDIR = 0xFFFFFFFFu;
+	}
+	board.portaLevels = BOARD_INT_PINS;
+	board.uartStatus = UART0_S1_TDRE_MASK | UART0_S1_TC_MASK;
+	board_uart0.S1 = board.uartStatus;
+	board_uart0.BDL = 0x04;
+	board_uart0.C4 = 0x0F;
+
+	board.current = BOARD_THREAD_PRIORITY;
+	board.enabled = 1ull << BOARD_SYSTICK;
+	board.systickNext = BOARD_NEVER;
+	board.lptmrNext = BOARD_NEVER;
+	board.mmaNext = BOARD_NEVER;
+	board.uartShifted = BOARD_NEVER;
+	board.rxNext = BOARD_NEVER;
+
+	value = getenv("BOARD_REPLAY");
+	if (value != NULL) {
+		if (!Replay_Open(&board.replay, value)) {
+			fprintf(stderr, "board: cannot replay \"%s\": %s\n", value, board.replay.error);
+			exit(2);
+		}
+		SimMma8451q_SetSource(&board_mma8451q, Replay_Source, &board.replay);
+		board.replaying = true;
+	}
+
+	value = getenv("BOARD_RUN_MS");
+	board.replayEnds = board.replaying && (value == NULL);
+	const unsigned long runMs = (value != NULL) ? strtoul(value, NULL, 10) : BOARD_RUN_MS_DEFAULT;
+	board.runEnd = board.replayEnds ? BOARD_NEVER : (uint64_t)runMs * (SYSTEM_CLOCK_FREQ / 1000);
+
+	/* speed 0 is lockstep: time only passes in WFI, on the wire and to a firmware spinning on
+	 * SysTick or UART0, never on the real-time pacing signal, so runs repeat exactly */
+	value = getenv("BOARD_SPEED");
+	const double speed = (value != NULL) ? strtod(value, NULL) : 1.0;
+	board.lockstep = (speed == 0);
+	board.quantum = (uint64_t)(BOARD_PACE_US * BOARD_CYCLES_PER_US * ((speed > 0) ? speed : 1.0));
+	board.quantum = (board.quantum != 0) ? board.quantum : 1;
+
+	value = getenv("BOARD_UART_RX");
+	if (value != NULL) {
+		Board_UartReceive((const uint8_t *)value, strlen(value));
+	}
+
+	value = getenv("BOARD_UART_OUT");
+	board.uartOut = (value != NULL) ? fopen(value, "wb") : fdopen(dup(STDOUT_FILENO), "wb");
+	if (board.uartOut == NULL) {
+		fprintf(stderr, "board: cannot open BOARD_UART_OUT \"%s\"\n", value);
+		exit(2);
+	}
+
+	const cookie_io_functions_t console = { .write = Board_Console };
+	stdout = fopencookie(NULL, "w", console);
+	setvbuf(stdout, NULL, _IONBF, 0);
+
+	value = getenv("BOARD_TRACE");
+	board.trace = (value != NULL) && (atoi(value) != 0);
+
+	value = getenv("BOARD_EVENTS");
+	if (value != NULL) {
+		board.events = fopen(value, "w");
+		if (board.events == NULL) {
+			fprintf(stderr, "board: cannot open BOARD_EVENTS \"%s\"\n", value);
+			exit(2);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &board.started);
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = Board_Pace;
+	action.sa_flags = SA_RESTART | SA_NODEFER;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGALRM, &action, NULL);
+
+	if (!board.lockstep) {
+		const struct itimerval pace = { { 0, BOARD_PACE_US }, { 0, BOARD_PACE_US } };
+		setitimer(ITIMER_REAL, &pace, NULL);
+	}
+}
@@ -0,0 +1,142 @@
+/*
+ * board.h
+ *
+ *  Created on: Dec 23, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: The FRDM-KL25Z simulated as a Linux process, for running main() and
+ *      		state_machine() unmodified (build with HOST_BOARD, see include/MKL25Z4.h).
+ *
+ *      		The peripherals the firmware touches are plain structures; board.c plays the
+ *      		silicon behind them on a virtual core clock of 48 MHz:
+ *      		- SysTick counts down VAL and pends its exception on every reload, takes LOAD
+ *      		  at the reload, starts over on a write to VAL and unpends on ICSR PENDSTCLR
+ *      		- WFI with SCR SLEEPDEEP and SMC PMCTRL STOPM at VLPS stops the clocks: SysTick
+ *      		  and UART0 stand still, characters arriving are lost, and only a PORTA edge
+ *      		  or the LPTMR compare wakes the core
+ *      		- LPTMR counts on in VLPS and raises its interrupt at the compare, see board_lptmr.c
+ *      		- the flash region of nvm.h erases and programs as NOR flash in the data sheet's typical
+ *      		  times, stalling the core, see board_nvm.c
+ *      		- I2C0 is the module of sim_i2c.h with the MMA8451Q model of sim_mma8451q.h behind it
+ *      		- PORTA sees INT1 on PTA14 and INT2 on PTA15, with the edges of PCR IRQC, ISFR and PDIR
+ *      		- UART0 shifts out a byte per 10 bit times at the programmed baud rate, receives
+ *      		  scripted input and serves the DMA channel of board_uart_dma.c
+ *      		- TPM0/TPM2 duty cycles are watched as the RGB LED
+ *      		- SIM, MCG, OSC0, the other ports and GPIO are register storage only
+ *
+ *      		An NVIC takes the pending exception of the best priority whenever the execution
+ *      		priority and PRIMASK allow, nesting as the core does. Everything runs on the
+ *      		firmware's own thread: a real-time pacing signal advances the clock and takes
+ *      		interrupts in between firmware instructions, and WFI skips the clock ahead to
+ *      		the next event, so the firmware runs faster than real time whenever it sleeps.
+ *
+ *      		Registers with write-one-to-clear flags (PORTA ISFR, UART0 S1) cannot be told
+ *      		apart from plain writes, so the board owns those flags: the ones a handler saw
+ *      		at entry count as cleared when it returns. A transmit byte is taken from UART0 D
+ *      		when the handler that found TDRE set left TIE set.
+ *
+ *      		Configured from the environment at start-up:
+ *      		- BOARD_RUN_MS		virtual milliseconds to run, then report and exit (default 15000, or
+ *      						until a replayed trace ends)
+ *      		- BOARD_SPEED		virtual time per real time while the firmware computes (default 1);
+ *      						0 is lockstep, where time passes only in WFI, on the I2C wire and for
+ *      						a firmware spinning on SysTick or UART0, never with real time, so
+ *      						every run of the same input takes the same path
+ *      		- BOARD_WAVEFORM	the accelerometer's input, see {@see SimMma8451q_WaveformParse}
+ *      		- BOARD_REPLAY		a recorded trace as the accelerometer's input instead, see replay.h
+ *      		- BOARD_UART_RX		characters received on UART0, one per byte time once RE is set
+ *      		- BOARD_UART_OUT	file receiving what UART0 transmits, stdout by default; printf reaches
+ *      						UART0 through __sys_write of uart.c as with Redlib on the target
+ *      		- BOARD_TRACE		nonzero logs LED changes and accelerometer events to stderr
+ *      		- BOARD_FLASH		file holding the flash region of nvm.h, read at start-up and written
+ *      						after every command, so it survives the run; erased flash without it
+ *      		- BOARD_EVENTS		file receiving "<virtual us>,<event>" lines of what the firmware did:
+ *      						pwm,r,g,b on LED changes, state,ACCEL|ROUTINE, motion and transient
+ *      						interrupts, and angles,x,y,z,roll,pitch per converted sample
+ */
+
+#ifndef BOARD_H_
+#define BOARD_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "MKL25Z4.h"
+#include "sim_i2c.h"
+#include "sim_mma8451q.h"
+
+/**
+ * @brief Real time between two pacing signals
+ */
+#define BOARD_PACE_US			(20)
+
+/**
+ * @brief Virtual time run without BOARD_RUN_MS
+ */
+#define BOARD_RUN_MS_DEFAULT	(15000)
+
+/**
+ * @brief Exception numbers the NVIC knows: the core's 16 and 32 interrupts
+ */
+#define BOARD_EXCEPTIONS		(16 + 32)
+
+/**
+ * @brief Execution priority of thread mode, below every exception's
+ */
+#define BOARD_THREAD_PRIORITY	(4)
+
+/**
+ * @brief Core clock cycles per microsecond
+ */
+#define BOARD_CYCLES_PER_US		(SYSTEM_CLOCK_FREQ / 1000000u)
+
+/**
+ * @brief The accelerometer on the board
+ */
+extern sim_mma8451q_t board_mma8451q;
+
+/**
+ * @brief The virtual core clock
+ * @return Cycles since power on
+ */
+uint64_t Board_Cycles(void);
+
+/**
+ * @brief Queues characters for the UART0 receiver, one per byte time
+ * @param[in] data The characters; copied
+ * @param[in] length Their number
+ */
+void Board_UartReceive(const uint8_t *data, size_t length);
+
+/**
+ * @brief Starts the DMA channel on a region for the UART0 transmitter; raises DMA1_IRQn after its last byte
+ * @param[in] data The region, must stay valid until the interrupt
+ * @param[in] length Its number of bytes
+ */
+void Board_UartDmaStart(const uint8_t *data, size_t length);
+
+/**
+ * @brief Starts the low power timer from 0, raises LPTMR0_IRQn after counts
+ * @param[in] counts Counts of {@see LPTMR_CLOCK_HZ}
+ */
+void Board_LptmrStart(uint32_t counts);
+
+/**
+ * @brief Stops the low power timer and unpends its interrupt
+ * @return Counts since {@see Board_LptmrStart}
+ */
+uint32_t Board_LptmrStop(void);
+
+/**
+ * @brief The core stalls with the interrupts masked on a flash command: time passes for the models,
+ * 		  interrupts only pend, and SysTick if stopped for it holds
+ * @param[in] cycles Core clock cycles of the command
+ */
+void Board_Stall(uint64_t cycles);
+
+/**
+ * @brief Prints what the run did
+ */
+void Board_Report(void);
+
+#endif /* BOARD_H_ */
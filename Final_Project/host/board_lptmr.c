@@ -0,0 +1,49 @@
+/*
+ * board_lptmr.c
+ *
+ *  Created on: Dec 29, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Board simulation stand-in for lptmr.c.
+ *
+ *      		The counter register CNR is latched by a write before it is read, which plain
+ *      		memory cannot play. Here the timer is the one modelled by board.c: it counts
+ *      		{@see LPTMR_CLOCK_HZ} on the virtual clock from {@see Board_LptmrStart}, also
+ *      		in VLPS, and raises LPTMR0_IRQn at the compare.
+ */
+
+#include "lptmr.h"
+#include "board.h"
+
+/**
+ * @brief NVIC priority as in lptmr.c
+ */
+void LPTMR_Init()
+{
+	NVIC_SetPriority(LPTMR0_IRQn, 3);
+	NVIC_ClearPendingIRQ(LPTMR0_IRQn);
+	NVIC_EnableIRQ(LPTMR0_IRQn);
+}
+
+/**
+ * @brief Starts the counter with the compare interrupt after counts
+ */
+void LPTMR_Start(uint32_t counts)
+{
+	Board_LptmrStart(counts);
+}
+
+/**
+ * @brief Stops the counter and tells the counts passed
+ */
+uint32_t LPTMR_Stop()
+{
+	return Board_LptmrStop();
+}
+
+/**
+ * @brief The compare interrupt, the board clears the flag
+ */
+void LPTMR0_IRQHandler()
+{
+}
@@ -0,0 +1,166 @@
+/*
+ * board_nvm.c
+ *
+ *  Created on: Dec 30, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Board simulation stand-in for nvm.c.
+ *
+ *      		fsl_flash drives the FTFA command registers and runs its command loop from
+ *      		RAM, neither of which plain memory can play. Here the region of nvm.h is an
+ *      		array with the rules of the flash: an erase sets a whole sector to ones, a
+ *      		program only clears bits, and programming a bit already cleared to one again
+ *      		fails as the module's verify would. Every command takes the typical time of
+ *      		the data sheet through {@see Power_Stall}, as on the target, so the tick
+ *      		accounting of power.c is the one exercised.
+ *
+ *      		With BOARD_FLASH set the region is loaded from that file at {@see Nvm_Init}
+ *      		and written back after every command.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nvm.h"
+#include "power.h"
+#include "board.h"
+
+/**
+ * @brief Typical command times of the data sheet, in core clock cycles
+ */
+#define BOARD_NVM_ERASE_CYCLES		(14000ull * BOARD_CYCLES_PER_US)
+#define BOARD_NVM_LONGWORD_CYCLES	(65ull * BOARD_CYCLES_PER_US)
+
+nvm_stats_t nvm_stats;
+
+/**
+ * @brief The region, aligned as the headers read from it
+ */
+static uint64_t words[NVM_SIZE / sizeof(uint64_t)];
+static uint8_t *const flash = (uint8_t *)words;
+
+/**
+ * @brief BOARD_FLASH, or NULL
+ */
+static const char *path;
+
+/**
+ * @brief The region is loaded
+ */
+static bool ready;
+
+/**
+ * @brief A program command for {@see Power_Stall}
+ */
+typedef struct {
+	uint32_t address;
+	const uint32_t *data;
+	uint32_t length;
+} nvm_program_t;
+
+static bool Nvm_Inside(uint32_t address, uint32_t length)
+{
+	return (address >= NVM_BASE) && (length <= NVM_SIZE) && (address - NVM_BASE <= NVM_SIZE - length);
+}
+
+/**
+ * @brief Writes the region back to BOARD_FLASH
+ */
+static void Nvm_Save(void)
+{
+	if (path == NULL) {
+		return;
+	}
+	FILE *file = fopen(path, "wb");
+	if (file != NULL) {
+		fwrite(flash, 1, NVM_SIZE, file);
+		fclose(file);
+	}
+}
+
+static int32_t Nvm_EraseCommand(void *context)
+{
+	memset(&flash[*(uint32_t *)context - NVM_BASE], 0xFF, NVM_SECTOR_SIZE);
+	Board_Stall(BOARD_NVM_ERASE_CYCLES);
+	return 0;
+}
+
+static int32_t Nvm_ProgramCommand(void *context)
+{
+	const nvm_program_t *program = (const nvm_program_t *)context;
+	uint8_t *at = &flash[program->address - NVM_BASE];
+	const uint8_t *data = (const uint8_t *)program->data;
+	int32_t status = 0;
+
+	for (uint32_t i = 0; i < program->length; ++i) {
+		if (data[i] & ~at[i]) {
+			status = -1;
+		}
+		at[i] &= data[i];
+	}
+	Board_Stall((program->length / NVM_WRITE_SIZE) * BOARD_NVM_LONGWORD_CYCLES);
+	return status;
+}
+
+/**
+ * @brief Erased flash, or the contents of BOARD_FLASH; once
+ */
+bool Nvm_Init()
+{
+	if (ready) {
+		return true;
+	}
+	ready = true;
+	memset(&nvm_stats, 0, sizeof(nvm_stats));
+	memset(flash, 0xFF, NVM_SIZE);
+
+	path = getenv("BOARD_FLASH");
+	if (path != NULL) {
+		FILE *file = fopen(path, "rb");
+		if (file != NULL) {
+			if (fread(flash, 1, NVM_SIZE, file) != NVM_SIZE) {
+				memset(flash, 0xFF, NVM_SIZE);
+			}
+			fclose(file);
+		}
+	}
+	return true;
+}
+
+bool Nvm_Erase(uint32_t address)
+{
+	if (!Nvm_Inside(address, NVM_SECTOR_SIZE) || (address % NVM_SECTOR_SIZE != 0)) {
+		nvm_stats.errors++;
+		return false;
+	}
+
+	(void)Power_Stall(Nvm_EraseCommand, &address);
+	nvm_stats.erases++;
+	Nvm_Save();
+	return true;
+}
+
+bool Nvm_Program(uint32_t address, const uint32_t *data, uint32_t length)
+{
+	nvm_program_t program = { .address = address, .data = data, .length = length };
+
+	if (!Nvm_Inside(address, length) || (address % NVM_WRITE_SIZE != 0) || (length % NVM_WRITE_SIZE != 0)) {
+		nvm_stats.errors++;
+		return false;
+	}
+
+	const int32_t status = Power_Stall(Nvm_ProgramCommand, &program);
+	Nvm_Save();
+	if (status != 0) {
+		nvm_stats.errors++;
+		return false;
+	}
+	nvm_stats.programs++;
+	nvm_stats.bytes += length;
+	return true;
+}
+
+const uint8_t *Nvm_Map(uint32_t address)
+{
+	return &flash[address - NVM_BASE];
+}
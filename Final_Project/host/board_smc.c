@@ -0,0 +1,53 @@
+/*
+ * board_smc.c
+ *
+ *  Created on: Dec 29, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Board simulation stand-in for the SDK's fsl_smc.c.
+ *
+ *      		fsl_smc.c turns the flash prefetch off around stop modes through fsl_flash,
+ *      		which the host does not build. The modes themselves are those of the SDK:
+ *      		SMC PMCTRL STOPM and SCB SCR SLEEPDEEP are set as on silicon and WFI sleeps,
+ *      		board.c reads both to tell VLPS from WAIT.
+ */
+
+#include "fsl_smc.h"
+
+void SMC_PreEnterStopModes(void)
+{
+	__disable_irq();
+	__ISB();
+}
+
+void SMC_PostExitStopModes(void)
+{
+	__enable_irq();
+	__ISB();
+}
+
+status_t SMC_SetPowerModeWait(SMC_Type *base)
+{
+	SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+	__DSB();
+	__WFI();
+	__ISB();
+
+	return kStatus_Success;
+}
+
+status_t SMC_SetPowerModeVlps(SMC_Type *base)
+{
+	uint8_t reg = base->PMCTRL;
+	reg &= ~SMC_PMCTRL_STOPM_MASK;
+	reg |= (kSMC_StopVlps << SMC_PMCTRL_STOPM_SHIFT);
+	base->PMCTRL = reg;
+
+	SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+
+	__DSB();
+	__WFI();
+	__ISB();
+
+	return (base->PMCTRL & SMC_PMCTRL_STOPA_MASK) ? kStatus_SMC_StopAbort : kStatus_Success;
+}
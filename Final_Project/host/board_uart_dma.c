@@ -0,0 +1,197 @@
+/*
+ * board_uart_dma.c
+ *
+ *  Created on: Dec 23, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Board simulation stand-in for uart_dma.c.
+ *
+ *      		uart_dma.c drives the channel through the SDK's fsl_dma and fsl_lpsci_dma, which
+ *      		the host does not build. Here the channel is the one modelled by board.c: a
+ *      		transfer started with {@see Board_UartDmaStart} moves its region into the
+ *      		transmitter at the byte rate of UART0 and raises DMA1_IRQn when done. Selection,
+ *      		chaining and the accounting are those of uart_dma.c.
+ */
+
+#include <string.h>
+#include "uart_dma.h"
+#include "uart.h"
+#include "board.h"
+#include "global_defs.h"
+
+/**
+ * @brief NVIC priority of the channel interrupt, the same as UART0_IRQHandler
+ */
+#define UART_TX_DMA_PRIORITY	(2)
+
+/**
+ * @brief Totals, indexed by {@see uart_tx_path_t}
+ */
+uart_account_t uart_accounts[UART_TX_PATH_COUNT];
+
+/**
+ * @brief Printable path names, indexed by {@see uart_tx_path_t}
+ */
+static const char *const path_names[UART_TX_PATH_COUNT] = { "irq", "dma" };
+
+/**
+ * @brief Whether TxQ is drained by DMA
+ */
+static volatile bool selected;
+
+/**
+ * @brief Bytes of TxQ owned by the running transfer, 0 while idle
+ */
+static volatile size_t inFlight;
+
+/**
+ * @brief Hands the oldest contiguous region of TxQ to the channel; the caller owns the channel
+ */
+static void UART_TxDmaStart()
+{
+	Q_Span_T span[2];
+
+	if ((inFlight != 0) || (Q_Peek(&TxQ, span) == 0)) {
+		return;
+	}
+
+	inFlight = span[0].length;
+	UART0->C5 |= UART0_C5_TDMAE_MASK;
+	Board_UartDmaStart(span[0].data, span[0].length);
+}
+
+/**
+ * @brief Routes the transmit request to the channel
+ */
+void UART_TxDmaInit()
+{
+	NVIC_SetPriority(DMA1_IRQn, UART_TX_DMA_PRIORITY);
+	NVIC_EnableIRQ(DMA1_IRQn);
+
+	inFlight = 0;
+	selected = false;
+}
+
+/**
+ * @brief Sleeps until TxQ is drained and the transmitter went idle
+ */
+void UART_TxDrain()
+{
+	/* the interrupt path drops TIE on an empty queue, the DMA path drops it with the transmit
+	 * request after the last region; with PRIMASK set the interrupt that does so still ends WFI,
+	 * it is taken once PRIMASK is cleared, so it cannot be slept through */
+	for (;;) {
+		__disable_irq();
+		const bool idle = Q_Empty(&TxQ) && (inFlight == 0) && !(UART0->C2 & UART0_C2_TIE_MASK);
+		if (!idle) {
+			__DSB();
+			__WFI();
+		}
+		__enable_irq();
+
+		if (idle) {
+			return;
+		}
+	}
+}
+
+/**
+ * @brief Switches between the interrupt and the DMA path once the transmitter went idle
+ */
+void UART_TxDmaSelect(bool enable)
+{
+	if (enable == selected) {
+		return;
+	}
+
+	UART_TxDrain();
+
+	selected = enable;
+
+	if (enable) {
+		UART_TxDmaKick();
+	}
+	else if (!Q_Empty(&TxQ)) {
+		UART0->C2 |= UART0_C2_TIE(1);
+	}
+}
+
+/**
+ * @brief Whether TxQ is drained by DMA
+ */
+bool UART_TxDmaSelected()
+{
+	return selected;
+}
+
+/**
+ * @brief Starts a transfer of the oldest contiguous region of TxQ unless one is running
+ */
+void UART_TxDmaKick()
+{
+	if (inFlight != 0) {
+		return;
+	}
+
+	UART_ACCOUNT_BEGIN();
+
+	NVIC_DisableIRQ(DMA1_IRQn);
+	UART_TxDmaStart();
+	NVIC_EnableIRQ(DMA1_IRQn);
+
+	UART_ACCOUNT_END(UART_TX_PATH_DMA, 0);
+}
+
+/**
+ * @brief Whether a transfer is running
+ */
+bool UART_TxDmaBusy()
+{
+	return inFlight != 0;
+}
+
+/**
+ * @brief DMA channel 1 interrupt handler: the region went out, release it and chain the next
+ */
+void DMA1_IRQHandler()
+{
+	UART_ACCOUNT_BEGIN();
+	const size_t sent = inFlight;
+
+	UART0->C5 &= ~UART0_C5_TDMAE_MASK;
+	Q_Release(&TxQ, sent);
+	inFlight = 0;
+	UART_TxDmaStart();
+
+	UART_ACCOUNT_END(UART_TX_PATH_DMA, sent);
+	(void)sent;
+}
+
+/**
+ * @brief Clears all totals
+ */
+void UART_AccountReset()
+{
+	memset(uart_accounts, 0, sizeof(uart_accounts));
+}
+
+/**
+ * @brief Logs the totals of both paths and the CPU load they caused over a period
+ */
+void UART_AccountReport(uint32_t elapsed)
+{
+	LOG("\r\n UART accounting: path, bytes, entries, cycles/byte, load over %lu cycles", (unsigned long)elapsed);
+
+	for (int path = 0; path < UART_TX_PATH_COUNT; ++path) {
+		const uart_account_t *account = &uart_accounts[path];
+		if ((account->bytes == 0) || (elapsed == 0)) {
+			continue;
+		}
+
+		const uint32_t load = (uint32_t)(((uint64_t)account->cycles * 10000u) / elapsed);
+		LOG("\r\n   %-6s %7lu %6lu %6lu %3lu.%02lu%%", path_names[path],
+				(unsigned long)account->bytes, (unsigned long)account->entries,
+				(unsigned long)(account->cycles / account->bytes),
+				(unsigned long)(load / 100), (unsigned long)(load % 100));
+	}
+}
@@ -0,0 +1,30 @@
+/*
+ * cmsis_host.c
+ *
+ *  Created on: Dec 14, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Host (Linux) backing for the core intrinsics of cmsis_host.h
+ */
+
+#include <sched.h>
+#include "cmsis_host.h"
+
+volatile uint32_t host_primask = 0;
+volatile uint32_t host_ipsr = 0;
+volatile uint32_t host_pending = 0;
+
+/**
+ * @brief Nothing can interrupt a host thread, so simply give up the time slice; the board simulation overrides it
+ */
+__attribute__((weak)) void Host_WaitForInterrupt(void)
+{
+	sched_yield();
+}
+
+/**
+ * @brief Nothing is ever held back outside the board simulation
+ */
+__attribute__((weak)) void Host_InterruptsUnmasked(void)
+{
+}
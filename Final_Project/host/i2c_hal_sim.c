@@ -0,0 +1,43 @@
+/*
+ * i2c_hal_sim.c
+ *
+ *  Created on: Dec 20, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Simulated backend of the I2C access layer.
+ */
+
+#include "i2c_hal_sim.h"
+
+/**
+ * @brief The simulation the engine is bound to
+ */
+static sim_i2c_t *bus;
+
+/**
+ * @brief Binds {@see i2c0_engine} to the simulation
+ */
+void I2C_HalSimAttach(sim_i2c_t *sim)
+{
+	bus = sim;
+	I2C_IrqInit(&i2c0_engine, &sim->regs);
+}
+
+/**
+ * @brief Plays the role of the NVIC: runs the handler for as long as the module raises IICIF with IICIE set.
+ * 		  If that leaves a transfer pending on a bus that made no progress, the core sleeps until the next SysTick.
+ */
+void I2C_HalSimRun()
+{
+	int guard = I2C_HAL_SIM_GUARD;
+	bool progress = false;
+
+	while ((bus != 0) && SimI2C_Clock(bus) && (bus->regs.C1 & I2C_C1_IICIE_MASK) && --guard) {
+		I2C_IrqHandler(&i2c0_engine);
+		progress = true;
+	}
+
+	if (!progress && !I2C_IrqIdle(&i2c0_engine)) {
+		host_cycles += HOST_CYCLES_PER_TICK;
+	}
+}
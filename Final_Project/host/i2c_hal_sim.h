@@ -0,0 +1,33 @@
+/*
+ * i2c_hal_sim.h
+ *
+ *  Created on: Dec 20, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Simulated backend of the I2C access layer (source/i2c_hal.h, I2C_HAL_SIM).
+ *
+ *      		Binds {@see i2c0_engine} to the register block of a {@see sim_i2c_t}, so every
+ *      		I2C_Hal call of the drivers runs the real interrupt driven engine against the
+ *      		simulated module and its slave. Blocking calls and {@see I2C_HalWait} run the
+ *      		bus through {@see I2C_HalSimRun}; transfers submitted from "interrupt" context
+ *      		complete whenever the test runs the bus.
+ */
+
+#ifndef I2C_HAL_SIM_H_
+#define I2C_HAL_SIM_H_
+
+#include "i2c_hal.h"
+#include "sim_i2c.h"
+
+/**
+ * @brief Bus events run by a single {@see I2C_HalSimRun}, guards against a driver that never finishes
+ */
+#define I2C_HAL_SIM_GUARD	(10000)
+
+/**
+ * @brief Binds {@see i2c0_engine} to the simulation, without a DMA channel
+ * @param[inout] sim The simulation, already set up by {@see SimI2C_Init}; Must stay valid while in use.
+ */
+void I2C_HalSimAttach(sim_i2c_t *sim);
+
+#endif /* I2C_HAL_SIM_H_ */
@@ -0,0 +1,160 @@
+/*
+ * MKL25Z4.h
+ *
+ *  Created on: Dec 14, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Host (Linux) stand-in for the device header.
+ *
+ *      		Found ahead of CMSIS/MKL25Z4.h on the host include path. It provides the
+ *      		core intrinsics in plain C (see cmsis_host.h) so that no ARM assembly is
+ *      		emitted, then pulls in the real device header for the register layouts.
+ *
+ *      		With HOST_BOARD (the board simulation of board.c) every peripheral the firmware
+ *      		touches is a plain structure in host memory instead of an address, and the NVIC
+ *      		functions go to the board's interrupt controller. Ports stay 0x1000 apart as on
+ *      		silicon, so a port number computed from a base address still comes out right.
+ *      		SysTick and UART0, the time and status a firmware polls, go through Board_Poll
+ *      		so that the board sees it spinning on them.
+ */
+
+#ifndef HOST_MKL25Z4_H_
+#define HOST_MKL25Z4_H_
+
+#include "cmsis_host.h"
+#include_next "MKL25Z4.h"
+
+#ifdef HOST_BOARD
+
+#include <stdint.h>
+
+/**
+ * @brief A port, padded to its spacing in the memory map
+ */
+typedef union {
+	PORT_Type port;
+	uint8_t space[PORTB_BASE - PORTA_BASE];
+} board_port_t;
+
+struct sim_i2c;
+
+/**
+ * @brief Every access to a polled peripheral: in lockstep, time passes for a firmware spinning on one
+ * @param[in] peripheral Its registers
+ * @return The same
+ */
+void *Board_Poll(void *peripheral);
+
+extern SIM_Type board_sim;
+extern MCG_Type board_mcg;
+extern OSC_Type board_osc0;
+extern board_port_t board_ports[5];
+extern GPIO_Type board_gpio[5];
+extern UART0_Type board_uart0;
+extern TPM_Type board_tpm[3];
+extern struct sim_i2c board_i2c0;
+extern I2C_Type board_i2c1;
+extern DMA_Type board_dma0;
+extern DMAMUX_Type board_dmamux0;
+extern SMC_Type board_smc;
+extern SysTick_Type board_systick;
+extern SCB_Type board_scb;
+extern NVIC_Type board_nvic;
+
+#undef SIM
+#undef MCG
+#undef OSC0
+#define SIM				(&board_sim)
+#define MCG				(&board_mcg)
+#define OSC0			(&board_osc0)
+
+#undef PORTA
+#undef PORTB
+#undef PORTC
+#undef PORTD
+#undef PORTE
+#define PORTA			(&board_ports[0].port)
+#define PORTB			(&board_ports[1].port)
+#define PORTC			(&board_ports[2].port)
+#define PORTD			(&board_ports[3].port)
+#define PORTE			(&board_ports[4].port)
+
+#undef PORTA_BASE
+#undef PORTB_BASE
+#undef PORTC_BASE
+#undef PORTD_BASE
+#undef PORTE_BASE
+#define PORTA_BASE		((uint32_t)(uintptr_t)PORTA)
+#define PORTB_BASE		((uint32_t)(uintptr_t)PORTB)
+#define PORTC_BASE		((uint32_t)(uintptr_t)PORTC)
+#define PORTD_BASE		((uint32_t)(uintptr_t)PORTD)
+#define PORTE_BASE		((uint32_t)(uintptr_t)PORTE)
+
+/* the fast GPIO of the IOPORT has the layout of GPIO and the same pins */
+#undef GPIOA
+#undef GPIOB
+#undef GPIOC
+#undef GPIOD
+#undef GPIOE
+#define GPIOA			(&board_gpio[0])
+#define GPIOB			(&board_gpio[1])
+#define GPIOC			(&board_gpio[2])
+#define GPIOD			(&board_gpio[3])
+#define GPIOE			(&board_gpio[4])
+#undef FGPIOA
+#undef FGPIOB
+#undef FGPIOC
+#undef FGPIOD
+#undef FGPIOE
+#define FGPIOA			((FGPIO_Type *)&board_gpio[0])
+#define FGPIOB			((FGPIO_Type *)&board_gpio[1])
+#define FGPIOC			((FGPIO_Type *)&board_gpio[2])
+#define FGPIOD			((FGPIO_Type *)&board_gpio[3])
+#define FGPIOE			((FGPIO_Type *)&board_gpio[4])
+
+#undef UART0
+#undef TPM0
+#undef TPM1
+#undef TPM2
+#undef I2C0
+#undef I2C1
+#undef DMA0
+#undef DMAMUX0
+#define UART0			((UART0_Type *)Board_Poll(&board_uart0))
+#define TPM0			(&board_tpm[0])
+#define TPM1			(&board_tpm[1])
+#define TPM2			(&board_tpm[2])
+#define I2C0			((I2C_Type *)&board_i2c0)
+#define I2C1			(&board_i2c1)
+#define DMA0			(&board_dma0)
+#define DMAMUX0			(&board_dmamux0)
+
+#undef SMC
+#define SMC				(&board_smc)
+
+#undef SysTick
+#undef SCB
+#undef NVIC
+#define SysTick			((SysTick_Type *)Board_Poll(&board_systick))
+#define SCB				(&board_scb)
+#define NVIC			(&board_nvic)
+
+void Board_NvicEnableIRQ(IRQn_Type irq);
+void Board_NvicDisableIRQ(IRQn_Type irq);
+uint32_t Board_NvicGetPendingIRQ(IRQn_Type irq);
+void Board_NvicSetPendingIRQ(IRQn_Type irq);
+void Board_NvicClearPendingIRQ(IRQn_Type irq);
+void Board_NvicSetPriority(IRQn_Type irq, uint32_t priority);
+uint32_t Board_NvicGetPriority(IRQn_Type irq);
+
+#define NVIC_EnableIRQ			Board_NvicEnableIRQ
+#define NVIC_DisableIRQ			Board_NvicDisableIRQ
+#define NVIC_GetPendingIRQ		Board_NvicGetPendingIRQ
+#define NVIC_SetPendingIRQ		Board_NvicSetPendingIRQ
+#define NVIC_ClearPendingIRQ	Board_NvicClearPendingIRQ
+#define NVIC_SetPriority		Board_NvicSetPriority
+#define NVIC_GetPriority		Board_NvicGetPriority
+
+#endif /* HOST_BOARD */
+
+#endif /* HOST_MKL25Z4_H_ */
@@ -0,0 +1,80 @@
+/*
+ * cmsis_host.h
+ *
+ *  Created on: Dec 14, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Host (Linux) implementation of the CMSIS core intrinsics used by the firmware.
+ *
+ *      		Defines the include guard of CMSIS/cmsis_gcc.h so that the ARM inline assembly
+ *      		is never seen by the host compiler. PRIMASK and IPSR are plain variables; WFI
+ *      		hands control to the host environment (see cmsis_host.c). Unmasking with an
+ *      		interrupt pending lets the environment take it, as the core would.
+ */
+
+#ifndef CMSIS_HOST_H_
+#define CMSIS_HOST_H_
+
+#include <stdint.h>
+
+/* keep CMSIS/cmsis_gcc.h out of the host build */
+#define __CMSIS_GCC_H
+
+/**
+ * @brief Simulated PRIMASK, nonzero while interrupts are masked
+ */
+extern volatile uint32_t host_primask;
+
+/**
+ * @brief Simulated IPSR, the exception number a test pretends to run in; 0 is thread mode
+ */
+extern volatile uint32_t host_ipsr;
+
+/**
+ * @brief Nonzero while the host environment holds an interrupt back, see {@see Host_InterruptsUnmasked}
+ */
+extern volatile uint32_t host_pending;
+
+/**
+ * @brief Called by __WFI(); lets the host environment make progress
+ */
+void Host_WaitForInterrupt(void);
+
+/**
+ * @brief Called when PRIMASK is cleared with {@see host_pending} set; lets the environment take the interrupt
+ */
+void Host_InterruptsUnmasked(void);
+
+static inline void __enable_irq(void)
+{
+	host_primask = 0;
+	__sync_synchronize();
+	if (host_pending) {
+		Host_InterruptsUnmasked();
+	}
+}
+static inline void __disable_irq(void)					{ host_primask = 1; __sync_synchronize(); }
+static inline uint32_t __get_PRIMASK(void)				{ return host_primask; }
+static inline void __set_PRIMASK(uint32_t priMask)
+{
+	__sync_synchronize();
+	host_primask = priMask;
+	if (!priMask && host_pending) {
+		Host_InterruptsUnmasked();
+	}
+}
+static inline uint32_t __get_IPSR(void)					{ return host_ipsr; }
+
+static inline void __NOP(void)							{ }
+static inline void __WFI(void)							{ Host_WaitForInterrupt(); }
+static inline void __WFE(void)							{ Host_WaitForInterrupt(); }
+static inline void __SEV(void)							{ }
+static inline void __ISB(void)							{ __sync_synchronize(); }
+static inline void __DSB(void)							{ __sync_synchronize(); }
+static inline void __DMB(void)							{ __sync_synchronize(); }
+
+static inline uint32_t __REV(uint32_t value)			{ return __builtin_bswap32(value); }
+static inline uint32_t __REV16(uint32_t value)			{ return ((value & 0xFF00FF00u) >> 8) | ((value & 0x00FF00FFu) << 8); }
+static inline int32_t __REVSH(int32_t value)			{ return (int16_t)__builtin_bswap16((uint16_t)value); }
+
+#endif /* CMSIS_HOST_H_ */
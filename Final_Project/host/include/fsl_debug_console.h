@@ -0,0 +1,17 @@
+/*
+ * fsl_debug_console.h
+ *
+ *  Created on: Dec 23, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Host (Linux) stand-in for the SDK debug console, whose PRINTF is printf here.
+ */
+
+#ifndef HOST_FSL_DEBUG_CONSOLE_H_
+#define HOST_FSL_DEBUG_CONSOLE_H_
+
+#include <stdio.h>
+
+#define PRINTF	printf
+
+#endif /* HOST_FSL_DEBUG_CONSOLE_H_ */
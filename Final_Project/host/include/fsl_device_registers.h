@@ -0,0 +1,23 @@
+/*
+ * fsl_device_registers.h
+ *
+ *  Created on: Dec 29, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Host (Linux) stand-in for the SDK's device header selection.
+ *
+ *      		The SDK headers (fsl_common.h and the drivers) reach the device header
+ *      		through this one. The original in CMSIS/ includes MKL25Z4.h from its own
+ *      		directory and so would bypass include/MKL25Z4.h; this one takes the host
+ *      		intrinsics and, with HOST_BOARD, the peripherals of the board. It includes
+ *      		in angle brackets, so the #include_next of include/MKL25Z4.h goes on past
+ *      		include/ rather than finding it again.
+ */
+
+#ifndef HOST_FSL_DEVICE_REGISTERS_H_
+#define HOST_FSL_DEVICE_REGISTERS_H_
+
+#include <MKL25Z4.h>
+#include <MKL25Z4_features.h>
+
+#endif /* HOST_FSL_DEVICE_REGISTERS_H_ */
@@ -0,0 +1,336 @@
+/*
+ * replay.c
+ *
+ *  Created on: Dec 24, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Recorded accelerometer traces played back into the MMA8451Q model, see replay.h.
+ */
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "replay.h"
+
+/**
+ * @brief Columns of a CSV line the reader looks at
+ */
+#define REPLAY_CSV_COLUMNS	(16)
+
+enum { COLUMN_TIME, COLUMN_X, COLUMN_Y, COLUMN_Z };
+
+static bool Replay_Fail(replay_t *replay, const char *what)
+{
+	if (replay->binary) {
+		snprintf(replay->error, sizeof(replay->error), "%s", what);
+	}
+	else {
+		snprintf(replay->error, sizeof(replay->error), "line %lu: %s", (unsigned long)replay->line, what);
+	}
+	return false;
+}
+
+/**
+ * @brief Splits a CSV line in place
+ * @return The number of fields, at most {@see REPLAY_CSV_COLUMNS}
+ */
+static int Replay_Split(char *line, char *fields[REPLAY_CSV_COLUMNS])
+{
+	int count = 0;
+
+	for (char *cursor = line; count < REPLAY_CSV_COLUMNS; ) {
+		while (isspace((unsigned char)*cursor)) {
+			cursor++;
+		}
+		fields[count++] = cursor;
+
+		char *comma = strchr(cursor, ',');
+		char *end = (comma != NULL) ? comma : cursor + strlen(cursor);
+		while ((end > cursor) && isspace((unsigned char)end[-1])) {
+			end--;
+		}
+		if (comma == NULL) {
+			*end = '\0';
+			break;
+		}
+		*end = '\0';
+		cursor = comma + 1;
+	}
+	return count;
+}
+
+/**
+ * @brief The next line that is neither blank nor a comment
+ */
+static bool Replay_Line(replay_t *replay, char *line, size_t size)
+{
+	while (fgets(line, (int)size, replay->file) != NULL) {
+		replay->line++;
+		const char *first = line;
+		while (isspace((unsigned char)*first)) {
+			first++;
+		}
+		if ((*first != '\0') && (*first != '#')) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Takes the column names of a CSV header
+ */
+static bool Replay_Header(replay_t *replay, char *fields[], int count)
+{
+	bool mg = false, counts = false;
+
+	memset(replay->columns, -1, sizeof(replay->columns));
+	for (int i = 0; i < count; ++i) {
+		static const char *const names[2][4] = { { "time_us", "x", "y", "z" }, { "time_us", "x_mg", "y_mg", "z_mg" } };
+		for (int unit = 0; unit < 2; ++unit) {
+			for (int column = 0; column < 4; ++column) {
+				if (strcmp(fields[i], names[unit][column]) == 0) {
+					replay->columns[column] = (int8_t)i;
+					mg |= (unit == 1) && (column != COLUMN_TIME);
+					counts |= (unit == 0) && (column != COLUMN_TIME);
+				}
+			}
+		}
+	}
+
+	if (mg && counts) {
+		return Replay_Fail(replay, "both counts and milli-g columns");
+	}
+	for (int column = 0; column < 4; ++column) {
+		if (replay->columns[column] < 0) {
+			return Replay_Fail(replay, "header lacks time_us, x, y or z");
+		}
+	}
+	replay->unit = mg ? REPLAY_UNIT_MG : REPLAY_UNIT_COUNTS;
+	return true;
+}
+
+/**
+ * @brief Micro-g of a value in a trace's unit
+ */
+static int32_t Replay_ToUg(replay_unit_t unit, int32_t value)
+{
+	return (unit == REPLAY_UNIT_MG) ? value * 1000 : Replay_CountsToUg(value);
+}
+
+static bool Replay_ParseCsv(replay_t *replay, char *line, replay_sample_t *sample)
+{
+	char *fields[REPLAY_CSV_COLUMNS];
+	const int count = Replay_Split(line, fields);
+	char *end;
+
+	for (int column = 0; column < 4; ++column) {
+		if (replay->columns[column] >= count) {
+			return Replay_Fail(replay, "missing column");
+		}
+	}
+
+	const double time = strtod(fields[replay->columns[COLUMN_TIME]], &end);
+	if ((end == fields[replay->columns[COLUMN_TIME]]) || (*end != '\0') || !(time >= 0)) {
+		return Replay_Fail(replay, "bad time_us");
+	}
+	sample->timeUs = (uint64_t)llround(time);
+
+	for (int axis = 0; axis < 3; ++axis) {
+		const char *field = fields[replay->columns[COLUMN_X + axis]];
+		const long value = strtol(field, &end, 10);
+		if ((end == field) || (*end != '\0') || (value < -32768) || (value > 32767)) {
+			return Replay_Fail(replay, "bad sample");
+		}
+		sample->ug[axis] = Replay_ToUg(replay->unit, (int32_t)value);
+	}
+	return true;
+}
+
+static bool Replay_ParseBinary(replay_t *replay, replay_sample_t *sample)
+{
+	uint8_t record[REPLAY_RECORD_SIZE];
+	const size_t got = fread(record, 1, sizeof(record), replay->file);
+
+	if (got == 0) {
+		return false;
+	}
+	if (got != sizeof(record)) {
+		return Replay_Fail(replay, "truncated sample");
+	}
+
+	sample->timeUs = (uint32_t)record[0] | ((uint32_t)record[1] << 8) | ((uint32_t)record[2] << 16) | ((uint32_t)record[3] << 24);
+	for (int axis = 0; axis < 3; ++axis) {
+		const int16_t value = (int16_t)(record[4 + 2 * axis] | (record[5 + 2 * axis] << 8));
+		sample->ug[axis] = Replay_ToUg(replay->unit, value);
+	}
+	return true;
+}
+
+/**
+ * @brief Opens a trace and reads its header
+ */
+bool Replay_Open(replay_t *replay, const char *path)
+{
+	uint8_t header[REPLAY_HEADER_SIZE];
+
+	memset(replay, 0, sizeof(*replay));
+	replay->file = fopen(path, "rb");
+	if (replay->file == NULL) {
+		return Replay_Fail(replay, "cannot open");
+	}
+
+	const size_t got = fread(header, 1, sizeof(header), replay->file);
+	if ((got == sizeof(header)) && (memcmp(header, REPLAY_MAGIC, 4) == 0)) {
+		replay->binary = true;
+		replay->unit = (replay_unit_t)header[5];
+		if (header[4] != REPLAY_VERSION) {
+			return Replay_Fail(replay, "unknown version");
+		}
+		if ((replay->unit != REPLAY_UNIT_COUNTS) && (replay->unit != REPLAY_UNIT_MG)) {
+			return Replay_Fail(replay, "unknown unit");
+		}
+		return true;
+	}
+
+	/* CSV: a first line not starting with a number is the header */
+	char line[256];
+	char *fields[REPLAY_CSV_COLUMNS];
+	char *end;
+	rewind(replay->file);
+	if (!Replay_Line(replay, line, sizeof(line))) {
+		return Replay_Fail(replay, "no samples");
+	}
+
+	const int count = Replay_Split(line, fields);
+	strtod(fields[0], &end);
+	if (end == fields[0]) {
+		return Replay_Header(replay, fields, count);
+	}
+
+	for (int column = 0; column < 4; ++column) {
+		replay->columns[column] = (int8_t)column;
+	}
+	replay->unit = REPLAY_UNIT_COUNTS;
+	rewind(replay->file);
+	replay->line = 0;
+	return true;
+}
+
+/**
+ * @brief Closes a trace
+ */
+void Replay_Close(replay_t *replay)
+{
+	if (replay->file != NULL) {
+		fclose(replay->file);
+		replay->file = NULL;
+	}
+}
+
+/**
+ * @brief Reads the next sample
+ */
+bool Replay_Read(replay_t *replay, replay_sample_t *sample)
+{
+	char line[256];
+	bool read;
+
+	if ((replay->file == NULL) || (replay->error[0] != '\0')) {
+		return false;
+	}
+
+	if (replay->binary) {
+		read = Replay_ParseBinary(replay, sample);
+	}
+	else {
+		read = Replay_Line(replay, line, sizeof(line)) && Replay_ParseCsv(replay, line, sample);
+	}
+	if (read) {
+		replay->stats.samples++;
+	}
+	return read;
+}
+
+/**
+ * @brief The trace as a source of the model: sample-and-hold on the trace's own time line
+ */
+void Replay_Source(void *context, uint64_t timeUs, int32_t ug[3])
+{
+	replay_t *replay = context;
+
+	if (!replay->started) {
+		replay->started = true;
+		replay->originUs = timeUs;
+		if (!Replay_Read(replay, &replay->current)) {
+			memset(&replay->current, 0, sizeof(replay->current));
+		}
+		replay->startUs = replay->current.timeUs;
+		replay->haveNext = Replay_Read(replay, &replay->next);
+	}
+
+	const uint64_t traceUs = replay->startUs + (timeUs - replay->originUs);
+	while (replay->haveNext && (replay->next.timeUs <= traceUs)) {
+		if (!replay->taken) {
+			replay->stats.skipped++;
+		}
+		replay->current = replay->next;
+		replay->taken = false;
+		replay->haveNext = Replay_Read(replay, &replay->next);
+	}
+
+	if (replay->taken) {
+		replay->stats.held++;
+	}
+	else {
+		replay->stats.presented++;
+		replay->taken = true;
+	}
+	replay->ended = !replay->haveNext;
+	memcpy(ug, replay->current.ug, sizeof(replay->current.ug));
+}
+
+static bool Replay_Write16(uint8_t *record, int32_t value)
+{
+	if ((value < -32768) || (value > 32767)) {
+		return false;
+	}
+	record[0] = (uint8_t)(value & 0xFF);
+	record[1] = (uint8_t)((value >> 8) & 0xFF);
+	return true;
+}
+
+/**
+ * @brief Writes the header of a binary trace
+ */
+bool Replay_WriteHeader(FILE *file, replay_unit_t unit)
+{
+	const uint8_t header[REPLAY_HEADER_SIZE] = { 'M', 'M', 'A', 'R', REPLAY_VERSION, (uint8_t)unit, 0, 0 };
+	return fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+/**
+ * @brief Writes a sample of a binary trace
+ */
+bool Replay_WriteSample(FILE *file, replay_unit_t unit, const replay_sample_t *sample)
+{
+	uint8_t record[REPLAY_RECORD_SIZE];
+
+	if (sample->timeUs > UINT32_MAX) {
+		return false;
+	}
+	record[0] = (uint8_t)sample->timeUs;
+	record[1] = (uint8_t)(sample->timeUs >> 8);
+	record[2] = (uint8_t)(sample->timeUs >> 16);
+	record[3] = (uint8_t)(sample->timeUs >> 24);
+	for (int axis = 0; axis < 3; ++axis) {
+		const int32_t ug = sample->ug[axis];
+		const int32_t value = (unit == REPLAY_UNIT_MG) ? (ug + ((ug < 0) ? -500 : 500)) / 1000 : Replay_UgToCounts(ug);
+		if (!Replay_Write16(&record[4 + 2 * axis], value)) {
+			return false;
+		}
+	}
+	return fwrite(record, 1, sizeof(record), file) == sizeof(record);
+}
@@ -0,0 +1,149 @@
+/*
+ * replay.h
+ *
+ *  Created on: Dec 24, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Recorded accelerometer traces played back into the MMA8451Q model of sim_mma8451q.h.
+ *
+ *   		A trace is a list of timestamped x, y, z samples, in one of two formats:
+ *
+ *   		CSV, one sample per line. A header names the columns: time_us and either x, y, z
+ *   		in 14 bit counts of the 2 g range (1/4096 g, what telemetry_decode writes) or
+ *   		x_mg, y_mg, z_mg in milli-g; other columns such as sequence are ignored. Without a
+ *   		header the columns are time_us,x,y,z in counts. Times may carry a fraction, blank
+ *   		lines and lines starting with # are skipped.
+ *
+ *   		Binary, little-endian:
+ *
+ *   			offset	size	field
+ *   			0		4		magic "MMAR"
+ *   			4		1		version, {@see REPLAY_VERSION}
+ *   			5		1		unit of x, y, z, {@see replay_unit_t}
+ *   			6		2		reserved, zero
+ *   			8		10 n	per sample: time in microseconds (uint32), then x, y, z (int16)
+ *
+ *   		As a source of the model the trace is sample-and-hold: at every output data rate
+ *   		tick the model is handed the newest sample not later than that instant, with the
+ *   		trace's first sample at the first tick. Samples are carried in micro-g, so counts
+ *   		come out of the model's data registers exactly as they were captured.
+ */
+
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define REPLAY_MAGIC		"MMAR"
+#define REPLAY_VERSION		(1)
+#define REPLAY_HEADER_SIZE	(8)
+#define REPLAY_RECORD_SIZE	(10)
+
+/**
+ * @brief Units of a trace's samples
+ */
+typedef enum {
+	REPLAY_UNIT_COUNTS	= 0,	/*< 14 bit counts of the 2 g range, 4096 per g */
+	REPLAY_UNIT_MG		= 1		/*< milli-g */
+} replay_unit_t;
+
+/**
+ * @brief A sample of a trace
+ */
+typedef struct {
+	uint64_t timeUs;			/*< time in the trace */
+	int32_t ug[3];				/*< x, y, z in micro-g */
+} replay_sample_t;
+
+/**
+ * @brief Counters of a replay
+ */
+typedef struct {
+	uint32_t samples;			/*< samples read from the trace */
+	uint32_t presented;			/*< samples handed to the model at least once */
+	uint32_t held;				/*< ticks that repeated the previous sample */
+	uint32_t skipped;			/*< samples superseded before a tick took them */
+} replay_stats_t;
+
+/**
+ * @brief A trace being read
+ */
+typedef struct {
+	FILE *file;
+	bool binary;				/*< the binary format, else CSV */
+	replay_unit_t unit;
+	int8_t columns[4];			/*< CSV columns of time_us, x, y and z */
+	uint32_t line;				/*< CSV line last read */
+	char error[96];				/*< what stopped the trace early, empty if nothing */
+
+	bool started;				/*< the first tick was taken */
+	uint64_t originUs;			/*< time of that tick */
+	uint64_t startUs;			/*< trace time of the first sample */
+	replay_sample_t current;	/*< the sample held */
+	replay_sample_t next;		/*< the sample after it */
+	bool haveNext;				/*< next is valid */
+	bool taken;					/*< current was handed out */
+	bool ended;					/*< the last sample is held */
+
+	replay_stats_t stats;
+} replay_t;
+
+/**
+ * @brief Opens a trace and reads its header
+ * @param[out] replay The trace
+ * @param[in] path Its file
+ * @return false with replay->error set if it cannot be read
+ */
+bool Replay_Open(replay_t *replay, const char *path);
+
+/**
+ * @brief Closes a trace
+ */
+void Replay_Close(replay_t *replay);
+
+/**
+ * @brief Reads the next sample
+ * @param[inout] replay The trace
+ * @param[out] sample The sample
+ * @return false at the end of the trace, or on a malformed sample with replay->error set
+ */
+bool Replay_Read(replay_t *replay, replay_sample_t *sample);
+
+/**
+ * @brief The trace as a source of the model, see {@see sim_mma8451q_source_t}; the context is the replay_t
+ */
+void Replay_Source(void *context, uint64_t timeUs, int32_t ug[3]);
+
+/**
+ * @brief Writes the header of a binary trace
+ * @return false on a write error
+ */
+bool Replay_WriteHeader(FILE *file, replay_unit_t unit);
+
+/**
+ * @brief Writes a sample of a binary trace
+ * @return false on a write error or a value out of the unit's range
+ */
+bool Replay_WriteSample(FILE *file, replay_unit_t unit, const replay_sample_t *sample);
+
+/**
+ * @brief Micro-g of counts of the 2 g range, rounded
+ */
+static inline int32_t Replay_CountsToUg(int32_t counts)
+{
+	const int64_t scaled = (int64_t)counts * 1000000;
+	return (int32_t)((scaled + ((scaled < 0) ? -2048 : 2048)) / 4096);
+}
+
+/**
+ * @brief Counts of the 2 g range of micro-g, rounded
+ */
+static inline int32_t Replay_UgToCounts(int32_t ug)
+{
+	const int64_t scaled = (int64_t)ug * 4096;
+	return (int32_t)((scaled + ((scaled < 0) ? -500000 : 500000)) / 1000000);
+}
+
+#endif /* REPLAY_H_ */
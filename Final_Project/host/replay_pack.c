@@ -0,0 +1,55 @@
+/*
+ * replay_pack.c
+ *
+ *  Created on: Dec 24, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Packs a trace into the binary format of replay.h.
+ *
+ *   		replay_pack trace.csv trace.bin
+ *
+ *   		Reads a CSV or binary trace and writes it as binary in the unit it came in, 10
+ *   		bytes a sample. The sample count is reported on stderr; the exit status is 1 if
+ *   		the trace is malformed or a sample does not fit the format.
+ */
+
+#include <stdio.h>
+
+#include "replay.h"
+
+int main(int argc, char **argv)
+{
+	replay_t replay;
+	replay_sample_t sample;
+	FILE *packed;
+
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s trace packed\n", argv[0]);
+		return 2;
+	}
+	if (!Replay_Open(&replay, argv[1])) {
+		fprintf(stderr, "%s: %s\n", argv[1], replay.error);
+		return 2;
+	}
+	if (!(packed = fopen(argv[2], "wb"))) {
+		perror(argv[2]);
+		return 2;
+	}
+
+	bool written = Replay_WriteHeader(packed, replay.unit);
+	while (written && Replay_Read(&replay, &sample)) {
+		written = Replay_WriteSample(packed, replay.unit, &sample);
+	}
+
+	fprintf(stderr, "%lu samples\n", (unsigned long)replay.stats.samples);
+	if (replay.error[0] != '\0') {
+		fprintf(stderr, "%s: %s\n", argv[1], replay.error);
+	}
+	if (!written) {
+		fprintf(stderr, "%s: sample %lu does not fit\n", argv[2], (unsigned long)replay.stats.samples);
+	}
+
+	Replay_Close(&replay);
+	fclose(packed);
+	return (written && (replay.error[0] == '\0')) ? 0 : 1;
+}
@@ -0,0 +1,221 @@
+/*
+ * sim_i2c.c
+ *
+ *  Created on: Dec 14, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Simulated I2C module register block with a single register-file slave behind it.
+ */
+
+#include <string.h>
+#include "sim_i2c.h"
+#include "i2c_bus.h"
+
+/**
+ * @brief Resets the module and the slave
+ */
+void SimI2C_Init(sim_i2c_t *sim, uint8_t slaveId)
+{
+	memset(sim, 0, sizeof(*sim));
+	sim->slaveId = slaveId;
+	sim->regs.C1 = I2C_C1_IICEN_MASK;
+	sim->regs.S = I2C_S_TCF_MASK;
+	sim->scl = true;
+	sim->sda = true;
+}
+
+/**
+ * @brief Lets the slave hold SDA low
+ */
+void SimI2C_Hold(sim_i2c_t *sim, uint8_t clocks)
+{
+	sim->stuck = clocks;
+	sim->regs.S |= I2C_S_BUSY_MASK;
+}
+
+/**
+ * @brief Raises IICIF after a byte went over the wire
+ * @param[inout] sim The simulation
+ * @param[in] acknowledged Whether the receiving side acknowledged
+ */
+static void SimI2C_Complete(sim_i2c_t *sim, bool acknowledged)
+{
+	sim->bytes++;
+	sim->interrupts++;
+	host_cycles += SIM_I2C_CYCLES_PER_BYTE;
+	sim->regs.S = I2C_S_TCF_MASK | I2C_S_BUSY_MASK | I2C_S_IICIF_MASK
+			| (acknowledged ? 0 : I2C_S_RXAK_MASK);
+}
+
+/**
+ * @brief Lets the module react to the last driver step
+ */
+bool SimI2C_Clock(sim_i2c_t *sim)
+{
+	const uint8_t c1 = sim->regs.C1;
+	const uint8_t previous = sim->lastC1;
+	sim->lastC1 = c1 & ~I2C_C1_RSTA_MASK;
+
+	/* SCL held low by the slave: nothing on the wire completes */
+	if (sim->stall) {
+		return false;
+	}
+
+	/* SDA held low by the slave: a START loses arbitration and the module falls back to slave mode */
+	if (sim->stuck) {
+		if (!(c1 & I2C_C1_MST_MASK) || (previous & I2C_C1_MST_MASK)) {
+			return false;
+		}
+		sim->regs.C1 = c1 & ~(I2C_C1_MST_MASK | I2C_C1_TX_MASK | I2C_C1_RSTA_MASK);
+		sim->lastC1 = sim->regs.C1;
+		sim->interrupts++;
+		sim->regs.S = I2C_S_TCF_MASK | I2C_S_BUSY_MASK | I2C_S_IICIF_MASK | I2C_S_ARBL_MASK;
+		return true;
+	}
+
+	/* master mode left: STOP */
+	if (!(c1 & I2C_C1_MST_MASK)) {
+		if (previous & I2C_C1_MST_MASK) {
+			sim->stops++;
+			sim->phase = SIM_I2C_IDLE;
+			sim->regs.S = I2C_S_TCF_MASK;
+		}
+		return false;
+	}
+
+	/* A master that was receiving can only be back in TX mode through a new START.
+	 * Without RSTA that means it issued STOP and START within one step, which is
+	 * what a completion callback chaining the next transfer does. */
+	const bool restarted = (c1 & I2C_C1_TX_MASK) && !(c1 & I2C_C1_RSTA_MASK)
+			&& (previous & I2C_C1_MST_MASK) && !(previous & I2C_C1_TX_MASK);
+	if (restarted) {
+		sim->stops++;
+	}
+
+	/* START or repeated START: the address is in D. RSTA reads back as zero. */
+	if (!(previous & I2C_C1_MST_MASK) || (c1 & I2C_C1_RSTA_MASK) || restarted) {
+		const uint8_t address = sim->regs.D;
+		sim->regs.C1 = c1 & ~I2C_C1_RSTA_MASK;
+		sim->starts++;
+
+		if ((address >> 1) != sim->slaveId) {
+			sim->phase = SIM_I2C_IGNORED;
+			SimI2C_Complete(sim, false);
+		}
+		else {
+			sim->phase = (address & 1) ? SIM_I2C_READ : SIM_I2C_WRITE;
+			sim->pointerPending = true;
+			if (address & 1) {
+				sim->reads++;
+			}
+			SimI2C_Complete(sim, true);
+		}
+		return true;
+	}
+
+	/* TX mode: the driver wrote D */
+	if (c1 & I2C_C1_TX_MASK) {
+		if (sim->phase == SIM_I2C_WRITE) {
+			if (sim->pointerPending) {
+				sim->pointer = sim->regs.D;
+				sim->pointerPending = false;
+			}
+			else if (sim->write) {
+				sim->write(sim, sim->regs.D);
+			}
+			else {
+				sim->memory[sim->pointer++] = sim->regs.D;
+			}
+		}
+		SimI2C_Complete(sim, sim->phase == SIM_I2C_WRITE);
+		return true;
+	}
+
+	/* RX mode: the driver read D, which clocks in the next byte */
+	if (sim->phase != SIM_I2C_READ) {
+		sim->regs.D = 0xFF;
+	}
+	else {
+		sim->regs.D = sim->read ? sim->read(sim) : sim->memory[sim->pointer++];
+	}
+	SimI2C_Complete(sim, !(c1 & I2C_C1_TXAK_MASK));
+	return true;
+}
+
+/*
+ * Pin access of the bus recovery (i2c_bus.h): the pins of the simulated module, with the slave behind them
+ */
+
+/**
+ * @brief Half a recovery clock passes on the simulated core clock
+ */
+static void SimI2C_HalfClock(void)
+{
+	host_cycles += I2C_BUS_US_TO_CYCLES(I2C_BUS_RECOVERY_HALF_US);
+}
+
+/**
+ * @brief Disables the module and hands SCL and SDA to GPIO, both released
+ */
+void I2C_PinsTakeover(I2C_Type *base)
+{
+	sim_i2c_t *sim = (sim_i2c_t *)base;
+
+	sim->regs.C1 &= ~I2C_C1_IICEN_MASK;
+	sim->scl = true;
+	sim->sda = true;
+}
+
+/**
+ * @brief Hands SCL and SDA back to the module and re-enables it; a STOP seen by a released slave reset it
+ */
+void I2C_PinsRelease(I2C_Type *base)
+{
+	sim_i2c_t *sim = (sim_i2c_t *)base;
+
+	if (sim->stuck == 0) {
+		sim->phase = SIM_I2C_IDLE;
+		sim->stall = false;
+		sim->regs.S = I2C_S_TCF_MASK;
+	}
+	else {
+		sim->regs.S = I2C_S_TCF_MASK | I2C_S_BUSY_MASK;
+	}
+	sim->regs.C1 = I2C_C1_IICEN_MASK;
+	sim->lastC1 = sim->regs.C1;
+}
+
+/**
+ * @brief Pulls SCL low or releases it; every rising edge moves a holding slave one bit on
+ */
+void I2C_PinScl(I2C_Type *base, bool high)
+{
+	sim_i2c_t *sim = (sim_i2c_t *)base;
+
+	if (high && !sim->scl && (sim->stuck != 0)) {
+		sim->stuck--;
+	}
+	sim->scl = high;
+	SimI2C_HalfClock();
+}
+
+/**
+ * @brief Pulls SDA low or releases it
+ */
+void I2C_PinSda(I2C_Type *base, bool high)
+{
+	sim_i2c_t *sim = (sim_i2c_t *)base;
+
+	sim->sda = high;
+	SimI2C_HalfClock();
+}
+
+/**
+ * @brief Samples SDA, low if either side pulls it
+ */
+bool I2C_PinSdaHigh(I2C_Type *base)
+{
+	const sim_i2c_t *sim = (const sim_i2c_t *)base;
+
+	return sim->sda && (sim->stuck == 0);
+}
@@ -0,0 +1,129 @@
+/*
+ * sim_i2c.h
+ *
+ *  Created on: Dec 14, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Simulated I2C module register block with a single register-file slave behind it.
+ *
+ *      		The driver under test operates on {@see sim_i2c_t.regs} exactly as it would on
+ *      		I2C0. Since plain memory cannot trap accesses, {@see SimI2C_Clock} is called after
+ *      		every driver step and infers what the driver did from the control register the
+ *      		same way the module reacts on silicon: a rising MST or a set RSTA sends the
+ *      		address in D, any other step in TX mode sends D, and any step in RX mode (the
+ *      		driver read D) clocks in the next byte. A STOP directly followed by a START
+ *      		within one step is only recognised after a read, which is when a master
+ *      		re-enters TX mode without RSTA.
+ *
+ *      		Every byte advances the simulated core clock of systick_host.c by its time on
+ *      		the wire. The slave can be made to hold the bus: {@see SimI2C_Hold} keeps SDA low
+ *      		until enough SCL pulses of a bus recovery, and {@see sim_i2c_t.stall} stretches SCL
+ *      		until a STOP. The pin access of the recovery (i2c_bus.h) is provided here.
+ */
+
+#ifndef SIM_I2C_H_
+#define SIM_I2C_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "MKL25Z4.h"
+#include "systick_host.h"
+
+/**
+ * @brief SCL frequency used to convert wire traffic into bus time
+ */
+#define SIM_I2C_SCL_HZ			(375000u)
+
+/**
+ * @brief SCL clocks per byte on the wire (8 data + ACK)
+ */
+#define SIM_I2C_CLOCKS_PER_BYTE	(9u)
+
+/**
+ * @brief Core clock cycles a byte takes on the wire
+ */
+#define SIM_I2C_CYCLES_PER_BYTE	((SYSTEM_CLOCK_FREQ * SIM_I2C_CLOCKS_PER_BYTE) / SIM_I2C_SCL_HZ)
+
+/**
+ * @brief Phase of the simulated bus
+ */
+typedef enum {
+	SIM_I2C_IDLE = 0,		/*< no master on the bus */
+	SIM_I2C_WRITE,			/*< slave addressed for writing */
+	SIM_I2C_READ,			/*< slave addressed for reading */
+	SIM_I2C_IGNORED			/*< nobody answered the address */
+} sim_i2c_phase_t;
+
+typedef struct sim_i2c sim_i2c_t;
+
+/**
+ * @brief Device model hook: supplies the byte read at the slave's register pointer and advances the pointer
+ * @param[inout] sim The simulation
+ * @return The byte put on the wire
+ */
+typedef uint8_t (*sim_i2c_read_t)(sim_i2c_t *sim);
+
+/**
+ * @brief Device model hook: takes a data byte written at the slave's register pointer and advances the pointer
+ * @param[inout] sim The simulation
+ * @param[in] value The byte from the wire
+ */
+typedef void (*sim_i2c_write_t)(sim_i2c_t *sim, uint8_t value);
+
+/**
+ * @brief Simulated I2C module and slave
+ */
+struct sim_i2c {
+	I2C_Type regs;				/*< register block handed to the driver; first, the pin access finds the simulation from it */
+	uint8_t slaveId;			/*< 7-bit address the slave answers to */
+	uint8_t memory[256];		/*< slave register file */
+	uint8_t pointer;			/*< slave register pointer, auto-incremented */
+	bool pointerPending;		/*< next written byte is the register pointer */
+	sim_i2c_phase_t phase;		/*< bus phase */
+	uint8_t lastC1;				/*< C1 as seen after the previous step */
+	uint32_t bytes;				/*< bytes moved over the wire, including addresses */
+	uint32_t starts;			/*< START and repeated START conditions */
+	uint32_t reads;				/*< of those, the ones addressing the slave for reading */
+	uint32_t stops;				/*< STOP conditions */
+	uint32_t interrupts;		/*< IICIF events raised */
+	sim_i2c_read_t read;		/*< device model for reads, NULL reads the register file */
+	sim_i2c_write_t write;		/*< device model for writes, NULL writes the register file */
+	void *context;				/*< device model state, for the hooks */
+	uint8_t stuck;				/*< SCL pulses the slave still needs before it releases SDA; a START meanwhile loses arbitration */
+	bool stall;					/*< the slave stretches SCL, nothing completes until a STOP of a bus recovery */
+	bool scl;					/*< SCL as driven by the recovery, true is released */
+	bool sda;					/*< SDA as driven by the recovery, true is released */
+};
+
+/**
+ * @brief Resets the module and the slave
+ * @param[out] sim The simulation
+ * @param[in] slaveId The 7-bit slave address
+ */
+void SimI2C_Init(sim_i2c_t *sim, uint8_t slaveId);
+
+/**
+ * @brief Lets the slave hold SDA low, as after a reset of the master in the middle of a read
+ * @param[inout] sim The simulation
+ * @param[in] clocks SCL pulses until the slave releases SDA
+ */
+void SimI2C_Hold(sim_i2c_t *sim, uint8_t clocks);
+
+/**
+ * @brief Lets the module react to the last driver step
+ * @param[inout] sim The simulation
+ * @return true if the step completed a byte and IICIF was raised
+ */
+bool SimI2C_Clock(sim_i2c_t *sim);
+
+/**
+ * @brief Bus time spent on the wire so far
+ * @param[in] sim The simulation
+ * @return Microseconds at {@see SIM_I2C_SCL_HZ}
+ */
+static inline uint32_t SimI2C_BusTimeUs(const sim_i2c_t *sim)
+{
+	return (uint32_t)(((uint64_t)sim->bytes * SIM_I2C_CLOCKS_PER_BYTE * 1000000u) / SIM_I2C_SCL_HZ);
+}
+
+#endif /* SIM_I2C_H_ */
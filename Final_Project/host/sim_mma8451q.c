@@ -0,0 +1,633 @@
+/*
+ * sim_mma8451q.c
+ *
+ *  Created on: Dec 23, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Behavioural model of the MMA8451Q behind the simulated I2C slave of sim_i2c.h.
+ *
+ *    Sources of Reference :
+ * 		1) https://www.nxp.com/docs/en/data-sheet/MMA8451Q.pdf, chapter 6 (Register Descriptions)
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim_mma8451q.h"
+
+/* strict C99 builds (the board) leave it out of math.h */
+#ifndef M_PI
+#define M_PI	(3.14159265358979323846)
+#endif
+
+/* the registers the model acts on, data sheet table 11 */
+#define REG_STATUS			(0x00)
+#define REG_OUT_X_MSB		(0x01)
+#define REG_OUT_Z_LSB		(0x06)
+#define REG_F_SETUP			(0x09)
+#define REG_SYSMOD			(0x0B)
+#define REG_INT_SOURCE		(0x0C)
+#define REG_WHOAMI			(0x0D)
+#define REG_XYZ_DATA_CFG	(0x0E)
+#define REG_PL_STATUS		(0x10)
+#define REG_PL_CFG			(0x11)
+#define REG_PL_BF_ZCOMP		(0x13)
+#define REG_P_L_THS			(0x14)
+#define REG_FF_MT_CFG		(0x15)
+#define REG_FF_MT_SRC		(0x16)
+#define REG_FF_MT_THS		(0x17)
+#define REG_FF_MT_COUNT		(0x18)
+#define REG_TRANSIENT_CFG	(0x1D)
+#define REG_TRANSIENT_SRC	(0x1E)
+#define REG_TRANSIENT_THS	(0x1F)
+#define REG_TRANSIENT_COUNT	(0x20)
+#define REG_PULSE_SRC		(0x22)
+#define REG_CTRL_REG1		(0x2A)
+#define REG_CTRL_REG2		(0x2B)
+#define REG_CTRL_REG3		(0x2C)
+#define REG_CTRL_REG4		(0x2D)
+#define REG_CTRL_REG5		(0x2E)
+#define REG_OFF_X			(0x2F)
+
+#define WHOAMI_VALUE		(0x1A)
+
+#define CTRL_REG1_ACTIVE	(0x01)
+#define CTRL_REG1_F_READ	(0x02)
+#define CTRL_REG2_RST		(0x40)
+#define CTRL_REG3_IPOL		(0x02)
+
+#define F_SETUP_MODE(value)		((value) >> 6)
+#define F_SETUP_WMRK(value)		((value) & 0x3F)
+#define F_MODE_FILL				(2)
+
+#define SRC_FIFO			(0x40)
+#define SRC_TRANS			(0x20)
+#define SRC_FF_MT			(0x04)
+#define SRC_DRDY			(0x01)
+
+#define FF_MT_CFG_ELE		(0x80)
+#define FF_MT_CFG_OAE		(0x40)
+#define FF_MT_SRC_EA		(0x80)
+#define TRANSIENT_CFG_ELE	(0x10)
+#define TRANSIENT_CFG_BYP	(0x01)
+#define TRANSIENT_SRC_EA	(0x40)
+#define THS_DBCNTM			(0x80)
+
+/**
+ * @brief Threshold resolution of the freefall/motion and transient detectors, micro-g per count
+ */
+#define THS_UG_PER_COUNT	(63000)
+
+/**
+ * @brief Resolution of OFF_X/Y/Z, micro-g per count
+ */
+#define OFFSET_UG_PER_COUNT	(2000)
+
+/**
+ * @brief Micro-g per g
+ */
+#define UG_PER_G			(1000000)
+
+/**
+ * @brief Shift of the transient detector's gravity estimate, a first order low-pass of 1/2^shift
+ */
+#define TRANSIENT_LOWPASS_SHIFT	(3)
+
+/**
+ * @brief The output data rates of CTRL_REG1 DR, in milli-Hz
+ */
+static const uint32_t odr_millihz[8] = { 800000, 400000, 200000, 100000, 50000, 12500, 6250, 1563 };
+
+/**
+ * @brief The model behind a simulated slave
+ */
+static inline sim_mma8451q_t *SimMma8451q_Of(sim_i2c_t *sim)
+{
+	return sim->context;
+}
+
+static inline bool SimMma8451q_Active(const sim_mma8451q_t *model)
+{
+	return model->sim->memory[REG_CTRL_REG1] & CTRL_REG1_ACTIVE;
+}
+
+static inline bool SimMma8451q_FifoEnabled(const sim_mma8451q_t *model)
+{
+	return F_SETUP_MODE(model->sim->memory[REG_F_SETUP]) != 0;
+}
+
+/**
+ * @brief F_STATUS as computed from the FIFO
+ */
+static uint8_t SimMma8451q_FifoStatus(const sim_mma8451q_t *model)
+{
+	const uint8_t watermark = F_SETUP_WMRK(model->sim->memory[REG_F_SETUP]);
+	const bool reached = (watermark != 0) && (model->fifoCount >= watermark);
+
+	return (model->fifoOverflow ? 0x80 : 0) | (reached ? 0x40 : 0) | model->fifoCount;
+}
+
+/**
+ * @brief INT_SOURCE as computed from the functional blocks
+ */
+static uint8_t SimMma8451q_Sources(const sim_mma8451q_t *model)
+{
+	const uint8_t *memory = model->sim->memory;
+	uint8_t sources = 0;
+
+	if (SimMma8451q_FifoEnabled(model)) {
+		sources |= (SimMma8451q_FifoStatus(model) & 0xC0) ? SRC_FIFO : 0;
+	}
+	else {
+		sources |= (memory[REG_STATUS] & 0x08) ? SRC_DRDY : 0;
+	}
+	sources |= (memory[REG_FF_MT_SRC] & FF_MT_SRC_EA) ? SRC_FF_MT : 0;
+	sources |= (memory[REG_TRANSIENT_SRC] & TRANSIENT_SRC_EA) ? SRC_TRANS : 0;
+
+	return sources;
+}
+
+/**
+ * @brief Puts a sample into the output data registers, 14 bit left-justified
+ */
+static void SimMma8451q_Latch(sim_mma8451q_t *model, const int16_t counts[3])
+{
+	for (int axis = 0; axis < 3; ++axis) {
+		const uint16_t justified = (uint16_t)counts[axis] << 2;
+		model->sim->memory[REG_OUT_X_MSB + 2 * axis] = justified >> 8;
+		model->sim->memory[REG_OUT_X_MSB + 2 * axis + 1] = justified & 0xFF;
+	}
+}
+
+/**
+ * @brief Reads a register: the FIFO port, the clear-on-read sources and the computed ones
+ */
+static uint8_t SimMma8451q_Read(sim_i2c_t *sim)
+{
+	sim_mma8451q_t *model = SimMma8451q_Of(sim);
+	uint8_t *memory = sim->memory;
+	const uint8_t address = sim->pointer;
+	const bool fastRead = memory[REG_CTRL_REG1] & CTRL_REG1_F_READ;
+	const uint8_t lastData = fastRead ? REG_OUT_Z_LSB - 1 : REG_OUT_Z_LSB;
+	uint8_t value;
+
+	sim->pointer = address + 1;
+
+	if (address == REG_STATUS) {
+		if (SimMma8451q_FifoEnabled(model)) {
+			value = SimMma8451q_FifoStatus(model);
+			model->fifoOverflow = false;
+		}
+		else {
+			value = memory[REG_STATUS];
+		}
+	}
+	else if ((address >= REG_OUT_X_MSB) && (address <= lastData)) {
+		if (fastRead) {
+			sim->pointer = address + 2;
+		}
+
+		/* the FIFO port hands out the oldest sample and is popped with its last byte */
+		if (SimMma8451q_FifoEnabled(model)) {
+			if (model->fifoCount == 0) {
+				value = 0;
+			}
+			else {
+				const int axis = (address - REG_OUT_X_MSB) / 2;
+				const uint16_t justified = (uint16_t)model->fifo[model->fifoHead][axis] << 2;
+				value = ((address - REG_OUT_X_MSB) & 1) ? (justified & 0xFF) : (justified >> 8);
+				if (address == lastData) {
+					model->fifoHead = (model->fifoHead + 1) % SIM_MMA8451Q_FIFO_DEPTH;
+					model->fifoCount--;
+				}
+			}
+			if (address == lastData) {
+				sim->pointer = REG_OUT_X_MSB;
+			}
+		}
+		else {
+			value = memory[address];
+			if (address == lastData) {
+				memory[REG_STATUS] = 0;
+			}
+		}
+	}
+	else if (address == REG_INT_SOURCE) {
+		value = SimMma8451q_Sources(model);
+	}
+	else if (address == REG_FF_MT_SRC) {
+		value = memory[REG_FF_MT_SRC];
+		memory[REG_FF_MT_SRC] = 0;
+	}
+	else if (address == REG_TRANSIENT_SRC) {
+		value = memory[REG_TRANSIENT_SRC];
+		memory[REG_TRANSIENT_SRC] = 0;
+	}
+	else {
+		value = memory[address];
+	}
+
+	return value;
+}
+
+/**
+ * @brief Writes a register; read-only ones ignore it, CTRL_REG1/2 and F_SETUP act on it
+ */
+static void SimMma8451q_Write(sim_i2c_t *sim, uint8_t value)
+{
+	sim_mma8451q_t *model = SimMma8451q_Of(sim);
+	uint8_t *memory = sim->memory;
+	const uint8_t address = sim->pointer++;
+
+	switch (address) {
+	case REG_STATUS ... REG_OUT_Z_LSB:
+	case REG_SYSMOD:
+	case REG_INT_SOURCE:
+	case REG_WHOAMI:
+	case REG_PL_STATUS:
+	case REG_FF_MT_SRC:
+	case REG_TRANSIENT_SRC:
+	case REG_PULSE_SRC:
+		return;
+
+	case REG_CTRL_REG1:
+		memory[REG_CTRL_REG1] = value;
+		memory[REG_SYSMOD] = (value & CTRL_REG1_ACTIVE) ? 1 : 0;
+		return;
+
+	case REG_CTRL_REG2:
+		if (value & CTRL_REG2_RST) {
+			SimMma8451q_Reset(model);
+			model->stats.resets++;
+			return;
+		}
+		memory[REG_CTRL_REG2] = value;
+		return;
+
+	case REG_F_SETUP:
+		memory[REG_F_SETUP] = value;
+		if (F_SETUP_MODE(value) == 0) {
+			model->fifoCount = 0;
+			model->fifoOverflow = false;
+		}
+		return;
+
+	default:
+		memory[address] = value;
+		return;
+	}
+}
+
+/**
+ * @brief Attaches the model to a simulated slave and resets it
+ */
+void SimMma8451q_Init(sim_mma8451q_t *model, sim_i2c_t *sim)
+{
+	memset(model, 0, sizeof(*model));
+	model->sim = sim;
+	model->waveform.seed = 1;
+	model->source = SimMma8451q_WaveformSource;
+	model->context = &model->waveform;
+
+	sim->context = model;
+	sim->read = SimMma8451q_Read;
+	sim->write = SimMma8451q_Write;
+
+	SimMma8451q_Reset(model);
+}
+
+/**
+ * @brief Returns every register to its reset value and empties the FIFO
+ */
+void SimMma8451q_Reset(sim_mma8451q_t *model)
+{
+	uint8_t *memory = model->sim->memory;
+
+	memset(memory, 0, sizeof(model->sim->memory));
+	memory[REG_WHOAMI] = WHOAMI_VALUE;
+	memory[REG_PL_CFG] = 0x80;
+	memory[REG_PL_BF_ZCOMP] = 0x44;
+	memory[REG_P_L_THS] = 0x84;
+
+	model->fifoHead = 0;
+	model->fifoCount = 0;
+	model->fifoOverflow = false;
+	model->motionCount = 0;
+	model->transientCount = 0;
+	memset(model->lowPass, 0, sizeof(model->lowPass));
+}
+
+/**
+ * @brief Replaces the source of samples
+ */
+void SimMma8451q_SetSource(sim_mma8451q_t *model, sim_mma8451q_source_t source, void *context)
+{
+	model->source = source;
+	model->context = context;
+}
+
+/**
+ * @brief Time between two samples at the output data rate of CTRL_REG1
+ */
+uint32_t SimMma8451q_PeriodUs(const sim_mma8451q_t *model)
+{
+	if (!SimMma8451q_Active(model)) {
+		return 0;
+	}
+	const uint32_t millihz = odr_millihz[(model->sim->memory[REG_CTRL_REG1] >> 3) & 0x07];
+	return (uint32_t)((1000000000ull + millihz / 2) / millihz);
+}
+
+/**
+ * @brief Takes one sample from the source
+ */
+void SimMma8451q_Acquire(sim_mma8451q_t *model, uint64_t timeUs)
+{
+	int32_t ug[3];
+
+	if (!SimMma8451q_Active(model)) {
+		return;
+	}
+	model->source(model->context, timeUs, ug);
+	SimMma8451q_Sample(model, ug);
+}
+
+/**
+ * @brief Debounces a detector's condition, see data sheet 6.6 FF_MT_COUNT
+ * @return true once the condition held for count samples
+ */
+static bool SimMma8451q_Debounce(uint8_t *counter, bool condition, uint8_t count, bool clearOnMiss)
+{
+	if (condition) {
+		if (*counter < 0xFF) {
+			(*counter)++;
+		}
+	}
+	else if (clearOnMiss) {
+		*counter = 0;
+	}
+	else if (*counter != 0) {
+		(*counter)--;
+	}
+	return condition && (*counter >= count);
+}
+
+/**
+ * @brief The freefall/motion detector, data sheet 6.6
+ */
+static void SimMma8451q_Motion(sim_mma8451q_t *model, const int32_t ug[3])
+{
+	uint8_t *memory = model->sim->memory;
+	const uint8_t config = memory[REG_FF_MT_CFG];
+	const int32_t threshold = (memory[REG_FF_MT_THS] & 0x7F) * THS_UG_PER_COUNT;
+	const bool motion = config & FF_MT_CFG_OAE;
+	uint8_t axes = 0, polarity = 0, enabled = 0;
+
+	for (int axis = 0; axis < 3; ++axis) {
+		if (!(config & (0x08 << axis))) {
+			continue;
+		}
+		enabled++;
+		if (abs(ug[axis]) > threshold) {
+			axes |= 0x02 << (2 * axis);
+			polarity |= (ug[axis] < 0) ? (0x01 << (2 * axis)) : 0;
+		}
+	}
+	if (enabled == 0) {
+		return;
+	}
+
+	/* motion: any enabled axis above the threshold; freefall: all of them below it */
+	const bool condition = motion ? (axes != 0) : (axes == 0);
+	const bool event = SimMma8451q_Debounce(&model->motionCount, condition, memory[REG_FF_MT_COUNT],
+			memory[REG_FF_MT_THS] & THS_DBCNTM);
+	const uint8_t source = event ? (FF_MT_SRC_EA | (motion ? (axes | polarity) : 0)) : 0;
+
+	if (event && !(memory[REG_FF_MT_SRC] & FF_MT_SRC_EA)) {
+		model->stats.motionEvents++;
+	}
+	if (config & FF_MT_CFG_ELE) {
+		memory[REG_FF_MT_SRC] |= source;
+	}
+	else {
+		memory[REG_FF_MT_SRC] = source;
+	}
+}
+
+/**
+ * @brief The transient detector, data sheet 6.7, on a fixed first order high-pass
+ */
+static void SimMma8451q_Transient(sim_mma8451q_t *model, const int32_t ug[3])
+{
+	uint8_t *memory = model->sim->memory;
+	const uint8_t config = memory[REG_TRANSIENT_CFG];
+	const int32_t threshold = (memory[REG_TRANSIENT_THS] & 0x7F) * THS_UG_PER_COUNT;
+	uint8_t axes = 0;
+
+	for (int axis = 0; axis < 3; ++axis) {
+		const int32_t filtered = (config & TRANSIENT_CFG_BYP) ? ug[axis] : ug[axis] - model->lowPass[axis];
+		model->lowPass[axis] += (ug[axis] - model->lowPass[axis]) / (1 << TRANSIENT_LOWPASS_SHIFT);
+
+		if ((config & (0x02 << axis)) && (abs(filtered) > threshold)) {
+			axes |= (0x02 << (2 * axis)) | ((filtered < 0) ? (0x01 << (2 * axis)) : 0);
+		}
+	}
+	if ((config & 0x0E) == 0) {
+		return;
+	}
+
+	const bool event = SimMma8451q_Debounce(&model->transientCount, axes != 0, memory[REG_TRANSIENT_COUNT],
+			memory[REG_TRANSIENT_THS] & THS_DBCNTM);
+	const uint8_t source = event ? (TRANSIENT_SRC_EA | axes) : 0;
+
+	if (event && !(memory[REG_TRANSIENT_SRC] & TRANSIENT_SRC_EA)) {
+		model->stats.transientEvents++;
+	}
+	if (config & TRANSIENT_CFG_ELE) {
+		memory[REG_TRANSIENT_SRC] |= source;
+	}
+	else {
+		memory[REG_TRANSIENT_SRC] = source;
+	}
+}
+
+/**
+ * @brief Takes one given sample through data registers, FIFO and detectors
+ */
+void SimMma8451q_Sample(sim_mma8451q_t *model, const int32_t ug[3])
+{
+	uint8_t *memory = model->sim->memory;
+	int32_t corrected[3];
+	int16_t counts[3];
+
+	if (!SimMma8451q_Active(model)) {
+		return;
+	}
+	model->stats.samples++;
+
+	/* 4096, 2048 or 1024 counts per g, rounded; the offsets are in 2 mg whatever the range */
+	const int32_t countsPerG = 4096 >> (memory[REG_XYZ_DATA_CFG] & 0x03);
+	for (int axis = 0; axis < 3; ++axis) {
+		corrected[axis] = ug[axis] + (int8_t)memory[REG_OFF_X + axis] * OFFSET_UG_PER_COUNT;
+		const int64_t scaled = (int64_t)corrected[axis] * countsPerG;
+		int32_t value = (int32_t)((scaled + ((scaled < 0) ? -UG_PER_G / 2 : UG_PER_G / 2)) / UG_PER_G);
+		value = (value > 8191) ? 8191 : ((value < -8192) ? -8192 : value);
+		counts[axis] = (int16_t)value;
+	}
+
+	if (SimMma8451q_FifoEnabled(model)) {
+		if (model->fifoCount == SIM_MMA8451Q_FIFO_DEPTH) {
+			model->fifoOverflow = true;
+			model->stats.overflows++;
+			if (F_SETUP_MODE(memory[REG_F_SETUP]) == F_MODE_FILL) {
+				goto detectors;
+			}
+			model->fifoHead = (model->fifoHead + 1) % SIM_MMA8451Q_FIFO_DEPTH;
+			model->fifoCount--;
+		}
+		const uint8_t tail = (model->fifoHead + model->fifoCount) % SIM_MMA8451Q_FIFO_DEPTH;
+		memcpy(model->fifo[tail], counts, sizeof(counts));
+		model->fifoCount++;
+	}
+	else {
+		/* data not read before the next sample is overwritten */
+		memory[REG_STATUS] = (memory[REG_STATUS] & 0x08) ? 0xFF : 0x0F;
+	}
+	SimMma8451q_Latch(model, counts);
+
+detectors:
+	SimMma8451q_Motion(model, corrected);
+	SimMma8451q_Transient(model, corrected);
+}
+
+/**
+ * @brief The interrupt sources enabled and active, routed onto the pins
+ */
+uint8_t SimMma8451q_Lines(const sim_mma8451q_t *model)
+{
+	const uint8_t *memory = model->sim->memory;
+	const uint8_t enabled = SimMma8451q_Sources(model) & memory[REG_CTRL_REG4];
+
+	return ((enabled & memory[REG_CTRL_REG5]) ? SIM_MMA8451Q_INT1 : 0)
+			| ((enabled & ~memory[REG_CTRL_REG5]) ? SIM_MMA8451Q_INT2 : 0);
+}
+
+/**
+ * @brief Electrical level of an interrupt pin
+ */
+bool SimMma8451q_PinHigh(const sim_mma8451q_t *model, uint8_t line)
+{
+	const bool asserted = SimMma8451q_Lines(model) & line;
+	const bool activeHigh = model->sim->memory[REG_CTRL_REG3] & CTRL_REG3_IPOL;
+
+	return asserted == activeHigh;
+}
+
+/**
+ * @brief Parses a waveform from a comma separated list of key=value
+ */
+bool SimMma8451q_WaveformParse(sim_mma8451q_waveform_t *waveform, const char *spec)
+{
+	const char *cursor = spec;
+
+	while (*cursor != '\0') {
+		const char *equals = strchr(cursor, '=');
+		if (equals == NULL) {
+			return false;
+		}
+		const size_t keyLength = (size_t)(equals - cursor);
+		char *end;
+
+#define KEY(name)	((keyLength == sizeof(name) - 1) && (strncmp(cursor, name, keyLength) == 0))
+		if (KEY("roll")) {
+			waveform->rollDegrees = strtof(equals + 1, &end);
+		}
+		else if (KEY("pitch")) {
+			waveform->pitchDegrees = strtof(equals + 1, &end);
+		}
+		else if (KEY("sweep")) {
+			waveform->sweepDegrees = strtof(equals + 1, &end);
+			if (*end != '/') {
+				return false;
+			}
+			waveform->sweepPeriodMs = strtoul(end + 1, &end, 10);
+		}
+		else if (KEY("noise")) {
+			waveform->noiseMg = strtol(equals + 1, &end, 10);
+		}
+		else if (KEY("seed")) {
+			waveform->seed = strtoul(equals + 1, &end, 10);
+		}
+		else if (KEY("shake")) {
+			if (waveform->shakeCount == SIM_MMA8451Q_SHAKES) {
+				return false;
+			}
+			sim_mma8451q_shake_t *shake = &waveform->shakes[waveform->shakeCount];
+			shake->startMs = strtoul(equals + 1, &end, 10);
+			if (*end != '/') {
+				return false;
+			}
+			shake->durationMs = strtoul(end + 1, &end, 10);
+			if (*end != '/') {
+				return false;
+			}
+			shake->peakMg = strtol(end + 1, &end, 10);
+			waveform->shakeCount++;
+		}
+		else {
+			return false;
+		}
+#undef KEY
+
+		if ((end == equals + 1) || ((*end != ',') && (*end != '\0'))) {
+			return false;
+		}
+		cursor = (*end == ',') ? end + 1 : end;
+	}
+	return true;
+}
+
+/**
+ * @brief The waveform as a source
+ */
+void SimMma8451q_WaveformSource(void *context, uint64_t timeUs, int32_t ug[3])
+{
+	sim_mma8451q_waveform_t *waveform = context;
+	const double seconds = (double)timeUs / 1e6;
+	double roll = waveform->rollDegrees, pitch = waveform->pitchDegrees;
+
+	if (waveform->sweepPeriodMs != 0) {
+		const double phase = 2.0 * M_PI * seconds * 1000.0 / waveform->sweepPeriodMs;
+		roll += waveform->sweepDegrees * sin(phase);
+		pitch += waveform->sweepDegrees * cos(phase);
+	}
+	roll *= M_PI / 180.0;
+	pitch *= M_PI / 180.0;
+
+	/* gravity as tilt.c reads it back: roll = atan2(y, z), pitch = atan2(x, sqrt(y^2 + z^2)) */
+	double x = 1000.0 * sin(pitch);
+	double y = 1000.0 * sin(roll) * cos(pitch);
+	const double z = 1000.0 * cos(roll) * cos(pitch);
+
+	for (uint8_t i = 0; i < waveform->shakeCount; ++i) {
+		const sim_mma8451q_shake_t *shake = &waveform->shakes[i];
+		const uint64_t startUs = (uint64_t)shake->startMs * 1000;
+		if ((timeUs >= startUs) && (timeUs < startUs + (uint64_t)shake->durationMs * 1000)) {
+			const double phase = 2.0 * M_PI * SIM_MMA8451Q_SHAKE_HZ * (double)(timeUs - startUs) / 1e6;
+			x += shake->peakMg * sin(phase);
+			y += shake->peakMg * cos(phase);
+		}
+	}
+
+	ug[0] = (int32_t)lround(x * 1000.0);
+	ug[1] = (int32_t)lround(y * 1000.0);
+	ug[2] = (int32_t)lround(z * 1000.0);
+
+	/* deterministic uniform noise: a linear congruential generator per axis */
+	if (waveform->noiseMg > 0) {
+		for (int axis = 0; axis < 3; ++axis) {
+			waveform->seed = waveform->seed * 1103515245u + 12345u;
+			ug[axis] += ((int32_t)((waveform->seed >> 16) % (2 * waveform->noiseMg + 1)) - waveform->noiseMg) * 1000;
+		}
+	}
+}
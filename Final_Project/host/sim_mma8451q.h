@@ -0,0 +1,196 @@
+/*
+ * sim_mma8451q.h
+ *
+ *  Created on: Dec 23, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Behavioural model of the MMA8451Q behind the simulated I2C slave of sim_i2c.h.
+ *
+ *      		The register file is {@see sim_i2c_t.memory}; the model installs the read and
+ *      		write hooks of the simulation and adds what the silicon does behind the
+ *      		registers: the software reset of CTRL_REG2, SYSMOD following ACTIVE, the
+ *      		output data rate of CTRL_REG1, the 32 sample FIFO with its read port wrapping
+ *      		over OUT_X_MSB .. OUT_Z_LSB, data-ready, the freefall/motion and the transient
+ *      		detectors with their debounce counters and latches, INT_SOURCE and the routing
+ *      		of CTRL_REG4/5 onto INT1 and INT2 with the polarity of CTRL_REG3.
+ *
+ *      		Time is not kept here: whoever owns the clock calls {@see SimMma8451q_Acquire}
+ *      		once per {@see SimMma8451q_PeriodUs}, and the model asks its source for the
+ *      		acceleration at that instant. The default source is a waveform of a board held
+ *      		at a tilt, optionally swept, with noise and shakes, see {@see SimMma8451q_WaveformParse}.
+ *
+ *      		Not modelled: orientation, pulse and auto-sleep detection, the high-pass output
+ *      		data (HPF_OUT), the cut-off of HP_FILTER_CUTOFF (the transient detector uses a
+ *      		fixed first order high-pass) and the FIFO trigger mode, which behaves as circular.
+ *
+ *    Sources of Reference :
+ * 		1) https://www.nxp.com/docs/en/data-sheet/MMA8451Q.pdf
+ * 		2) https://www.nxp.com/docs/en/application-note/AN4070.pdf (Motion and Freefall Detection)
+ * 		3) https://www.nxp.com/docs/en/application-note/AN4071.pdf (High-Pass Filtered Data and Transient Detection)
+ */
+
+#ifndef SIM_MMA8451Q_H_
+#define SIM_MMA8451Q_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sim_i2c.h"
+
+/**
+ * @brief Depth of the FIFO
+ */
+#define SIM_MMA8451Q_FIFO_DEPTH		(32)
+
+/**
+ * @brief Shakes a waveform may hold
+ */
+#define SIM_MMA8451Q_SHAKES			(8)
+
+/**
+ * @brief Frequency of the shake oscillation
+ */
+#define SIM_MMA8451Q_SHAKE_HZ		(25)
+
+/**
+ * @brief The interrupt pins, bits of {@see SimMma8451q_Lines}
+ */
+#define SIM_MMA8451Q_INT1			(1u << 0)
+#define SIM_MMA8451Q_INT2			(1u << 1)
+
+/**
+ * @brief Supplies the acceleration at an instant
+ * @param[in] context The source's context
+ * @param[in] timeUs The instant, microseconds since power on
+ * @param[out] ug The acceleration of X, Y and Z in micro-g, fine enough to carry captured counts exactly
+ */
+typedef void (*sim_mma8451q_source_t)(void *context, uint64_t timeUs, int32_t ug[3]);
+
+/**
+ * @brief A shake: both horizontal axes oscillate at {@see SIM_MMA8451Q_SHAKE_HZ} on top of gravity
+ */
+typedef struct {
+	uint32_t startMs;			/*< when it begins */
+	uint32_t durationMs;		/*< how long it lasts */
+	int32_t peakMg;				/*< amplitude */
+} sim_mma8451q_shake_t;
+
+/**
+ * @brief A board held at a tilt: gravity seen under roll and pitch, optionally swept
+ * 		  sinusoidally, plus noise and shakes
+ */
+typedef struct {
+	float rollDegrees;			/*< roll, atan2(y, z) */
+	float pitchDegrees;			/*< pitch, atan2(x, sqrt(y^2 + z^2)) */
+	float sweepDegrees;			/*< amplitude of the sweep, roll and pitch a quarter period apart */
+	uint32_t sweepPeriodMs;		/*< period of the sweep, 0 for none */
+	int32_t noiseMg;			/*< peak of the uniform noise on every axis */
+	uint32_t seed;				/*< state of the noise generator */
+	sim_mma8451q_shake_t shakes[SIM_MMA8451Q_SHAKES];
+	uint8_t shakeCount;
+} sim_mma8451q_waveform_t;
+
+/**
+ * @brief What happened inside the model
+ */
+typedef struct {
+	uint32_t samples;			/*< samples acquired in active mode */
+	uint32_t overflows;			/*< samples lost to a full FIFO */
+	uint32_t motionEvents;		/*< freefall/motion events raised */
+	uint32_t transientEvents;	/*< transient events raised */
+	uint32_t resets;			/*< software resets */
+} sim_mma8451q_stats_t;
+
+/**
+ * @brief The device model
+ */
+typedef struct {
+	sim_i2c_t *sim;				/*< the slave it answers as, its memory is the register file */
+	sim_mma8451q_source_t source;	/*< where samples come from */
+	void *context;				/*< the source's context */
+	sim_mma8451q_waveform_t waveform;	/*< the default source's waveform */
+	int16_t fifo[SIM_MMA8451Q_FIFO_DEPTH][3];	/*< queued samples, 14 bit */
+	uint8_t fifoHead;			/*< oldest queued sample */
+	uint8_t fifoCount;			/*< queued samples */
+	bool fifoOverflow;			/*< F_OVF, cleared by reading F_STATUS */
+	uint8_t motionCount;		/*< debounce counter of the freefall/motion detector */
+	uint8_t transientCount;		/*< debounce counter of the transient detector */
+	int32_t lowPass[3];			/*< the transient detector's estimate of gravity, micro-g */
+	sim_mma8451q_stats_t stats;
+} sim_mma8451q_t;
+
+/**
+ * @brief Attaches the model to a simulated slave and resets it; the source is the waveform, at rest
+ * @param[out] model The model
+ * @param[inout] sim The simulation, addressed as the MMA8451Q
+ */
+void SimMma8451q_Init(sim_mma8451q_t *model, sim_i2c_t *sim);
+
+/**
+ * @brief Returns every register to its reset value and empties the FIFO, as CTRL_REG2 RST does
+ * @param[inout] model The model
+ */
+void SimMma8451q_Reset(sim_mma8451q_t *model);
+
+/**
+ * @brief Replaces the source of samples
+ * @param[inout] model The model
+ * @param[in] source The source
+ * @param[in] context Handed to the source
+ */
+void SimMma8451q_SetSource(sim_mma8451q_t *model, sim_mma8451q_source_t source, void *context);
+
+/**
+ * @brief Time between two samples at the output data rate of CTRL_REG1
+ * @param[in] model The model
+ * @return The period in microseconds, rounded; 0 in standby, when nothing is sampled
+ */
+uint32_t SimMma8451q_PeriodUs(const sim_mma8451q_t *model);
+
+/**
+ * @brief Takes one sample from the source through data registers, FIFO and detectors; nothing in standby
+ * @param[inout] model The model
+ * @param[in] timeUs The instant of the sample
+ */
+void SimMma8451q_Acquire(sim_mma8451q_t *model, uint64_t timeUs);
+
+/**
+ * @brief Takes one given sample through data registers, FIFO and detectors; nothing in standby
+ * @param[inout] model The model
+ * @param[in] ug The acceleration of X, Y and Z in micro-g
+ */
+void SimMma8451q_Sample(sim_mma8451q_t *model, const int32_t ug[3]);
+
+/**
+ * @brief The interrupt sources enabled in CTRL_REG4 and active, routed by CTRL_REG5
+ * @param[in] model The model
+ * @return {@see SIM_MMA8451Q_INT1} and {@see SIM_MMA8451Q_INT2} for the pins asserted
+ */
+uint8_t SimMma8451q_Lines(const sim_mma8451q_t *model);
+
+/**
+ * @brief Electrical level of an interrupt pin, after the polarity of CTRL_REG3
+ * @param[in] model The model
+ * @param[in] line {@see SIM_MMA8451Q_INT1} or {@see SIM_MMA8451Q_INT2}
+ * @return true for high
+ */
+bool SimMma8451q_PinHigh(const sim_mma8451q_t *model, uint8_t line);
+
+/**
+ * @brief Parses a waveform from a comma separated list of key=value; unlisted keys keep their values
+ * 		  roll=<deg>, pitch=<deg>, sweep=<deg>/<period ms>, noise=<mg>, shake=<start ms>/<duration ms>/<peak mg>
+ * 		  (repeatable), seed=<n>
+ * @param[inout] waveform The waveform
+ * @param[in] spec The list, e.g. "roll=20,pitch=-10,shake=3000/100/2500"
+ * @return false on a malformed list
+ */
+bool SimMma8451q_WaveformParse(sim_mma8451q_waveform_t *waveform, const char *spec);
+
+/**
+ * @brief The waveform as a source, see {@see sim_mma8451q_source_t}
+ * @param[inout] context The {@see sim_mma8451q_waveform_t}
+ * @param[in] timeUs The instant
+ * @param[out] ug The acceleration in micro-g
+ */
+void SimMma8451q_WaveformSource(void *context, uint64_t timeUs, int32_t ug[3]);
+
+#endif /* SIM_MMA8451Q_H_ */
@@ -0,0 +1,40 @@
+/*
+ * systick_host.c
+ *
+ *  Created on: Dec 21, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Host (Linux) stand-in for the SysTick based cycle counter of systick.c.
+ */
+
+#include "systick_host.h"
+
+volatile uint32_t host_cycles = 0;
+
+/**
+ * @brief Returns the simulated core clock, which a read advances by a cycle
+ */
+uint32_t cycle_count()
+{
+	return host_cycles++;
+}
+
+/**
+ * @brief Returns the simulated core clock unwrapped to 64 bit, for reads less than 2^32 cycles apart
+ */
+uint64_t timestamp_cycles()
+{
+	static uint64_t unwrapped = 0;
+	const uint32_t now = cycle_count();
+
+	unwrapped += (uint32_t)(now - (uint32_t)unwrapped);
+	return unwrapped;
+}
+
+/**
+ * @brief Returns {@see timestamp_cycles} in microseconds
+ */
+uint64_t timestamp_us()
+{
+	return timestamp_cycles() / (SYSTEM_CLOCK_FREQ / 1000000u);
+}
@@ -0,0 +1,32 @@
+/*
+ * systick_host.h
+ *
+ *  Created on: Dec 21, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Host (Linux) stand-in for the SysTick based cycle counter of systick.c.
+ *
+ *      		{@see cycle_count} returns {@see host_cycles}, which the tests set and the
+ *      		simulation advances with the time spent on the wire. Every read of the
+ *      		counter also advances it by a cycle, as reading it does on silicon, so a
+ *      		loop polling it for a deadline terminates. {@see timestamp_cycles} and
+ *      		{@see timestamp_us} unwrap it to 64 bit across its 32 bit wrap.
+ */
+
+#ifndef SYSTICK_HOST_H_
+#define SYSTICK_HOST_H_
+
+#include <stdint.h>
+#include "systick.h"
+
+/**
+ * @brief Core clock cycles of one SysTick period, the longest a WFI can sleep
+ */
+#define HOST_CYCLES_PER_TICK	(SYSTICK_TMR_RELOAD_VAL + 1)
+
+/**
+ * @brief The simulated core clock
+ */
+extern volatile uint32_t host_cycles;
+
+#endif /* SYSTICK_HOST_H_ */
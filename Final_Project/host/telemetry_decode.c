@@ -0,0 +1,71 @@
+/*
+ * telemetry_decode.c
+ *
+ *  Created on: Dec 18, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Turns a captured telemetry stream into CSV.
+ *
+ *   		telemetry_decode [capture] [csv]
+ *
+ *   		Reads the raw bytes captured from the UART (stdin if no file is named) and writes
+ *   		sequence,time_us,x,y,z with one line per sample (stdout if no file is named). The
+ *   		frame, sample, dropped and corrupt counts are reported on stderr; the exit status
+ *   		is 1 if samples were dropped or frames were corrupt.
+ *
+ *   		e.g. stty -F /dev/ttyACM0 115200 raw && cat /dev/ttyACM0 > capture.bin
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+
+#include "telemetry_stream.h"
+
+static void write_record(void *context, const telemetry_record_t *record)
+{
+	FILE *csv = (FILE *)context;
+
+	/* cycles to microseconds, with the fraction */
+	fprintf(csv, "%" PRIu32 ",%" PRIu64 ".%02" PRIu64 ",%d,%d,%d\n", record->sequence,
+			record->cycles / (TELEMETRY_STREAM_CLOCK_HZ / 1000000u),
+			(record->cycles % (TELEMETRY_STREAM_CLOCK_HZ / 1000000u)) * 100 / (TELEMETRY_STREAM_CLOCK_HZ / 1000000u),
+			record->x, record->y, record->z);
+}
+
+int main(int argc, char **argv)
+{
+	FILE *capture = stdin;
+	FILE *csv = stdout;
+
+	if ((argc > 1) && !(capture = fopen(argv[1], "rb"))) {
+		perror(argv[1]);
+		return 2;
+	}
+	if ((argc > 2) && !(csv = fopen(argv[2], "w"))) {
+		perror(argv[2]);
+		return 2;
+	}
+
+	telemetry_stream_t stream;
+	TelemetryStream_Init(&stream, write_record, csv);
+
+	fprintf(csv, "sequence,time_us,x,y,z\n");
+
+	uint8_t buffer[4096];
+	size_t got;
+	while ((got = fread(buffer, 1, sizeof(buffer), capture)) > 0) {
+		TelemetryStream_Feed(&stream, buffer, got);
+	}
+
+	fprintf(stderr, "%" PRIu64 " bytes, %" PRIu32 " frames, %" PRIu32 " samples, %" PRIu32 " dropped, %" PRIu32
+			" corrupt frames, %" PRIu32 " blocks skipped before the first frame\n",
+			stream.bytes, stream.frames, stream.samples, stream.dropped, stream.corrupt, stream.skipped);
+	if (stream.length > 0) {
+		fprintf(stderr, "%zu bytes of an unterminated frame at the end\n", stream.length);
+	}
+
+	if (csv != stdout) {
+		fclose(csv);
+	}
+	return (stream.dropped || stream.corrupt) ? 1 : 0;
+}
@@ -0,0 +1,120 @@
+/*
+ * telemetry_stream.c
+ *
+ *  Created on: Dec 18, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host side decoder of the telemetry stream of source/telemetry.h
+ */
+
+#include <string.h>
+
+#include "telemetry_stream.h"
+#include "cobs.h"
+#include "crc16.h"
+
+static uint16_t get16(const uint8_t *at)
+{
+	return (uint16_t)(at[0] | (at[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *at)
+{
+	return get16(at) | ((uint32_t)get16(at + 2) << 16);
+}
+
+void TelemetryStream_Init(telemetry_stream_t *stream, telemetry_record_cb callback, void *context)
+{
+	memset(stream, 0, sizeof(*stream));
+	stream->callback = callback;
+	stream->context = context;
+}
+
+/*
+ * @brief Checks and hands out one frame; false if it is not a good frame
+ */
+static bool TelemetryStream_Frame(telemetry_stream_t *stream)
+{
+	uint8_t frame[sizeof(stream->block)];
+
+	if (stream->length > sizeof(stream->block)) {
+		return false;
+	}
+	const int length = Cobs_Decode(stream->block, stream->length, frame, sizeof(frame));
+	if (length < TELEMETRY_HEADER_SIZE + TELEMETRY_SAMPLE_SIZE + TELEMETRY_CRC_SIZE) {
+		return false;
+	}
+
+	const uint8_t count = frame[9];
+	if ((frame[0] != TELEMETRY_FRAME_SAMPLES) || (count == 0) || (count > TELEMETRY_BATCH)
+			|| (length != TELEMETRY_HEADER_SIZE + count * TELEMETRY_SAMPLE_SIZE + TELEMETRY_CRC_SIZE)) {
+		return false;
+	}
+	if (CRC16_Compute(frame, length - TELEMETRY_CRC_SIZE) != get16(&frame[length - TELEMETRY_CRC_SIZE])) {
+		return false;
+	}
+
+	const uint32_t sequence = get32(&frame[1]);
+	const uint32_t timestamp = get32(&frame[5]);
+
+	/* unwrap the 32 bit cycle counter, it laps every 89 s at 48 MHz */
+	if (stream->synced) {
+		stream->cycles += (uint32_t)(timestamp - stream->lastTimestamp);
+
+		/* a sequence going backwards is a target reset, not a gap */
+		if ((int32_t)(sequence - stream->nextSequence) > 0) {
+			stream->dropped += sequence - stream->nextSequence;
+		}
+	}
+	stream->lastTimestamp = timestamp;
+	stream->nextSequence = sequence + count;
+	stream->synced = true;
+
+	for (uint8_t i = 0; i < count; ++i) {
+		const uint8_t *at = &frame[TELEMETRY_HEADER_SIZE + i * TELEMETRY_SAMPLE_SIZE];
+		const telemetry_record_t record = {
+			.sequence = sequence + i,
+			.cycles = stream->cycles + ((uint64_t)get16(at) << TELEMETRY_TICK_SHIFT),
+			.x = (int16_t)get16(at + 2),
+			.y = (int16_t)get16(at + 4),
+			.z = (int16_t)get16(at + 6),
+		};
+		if (stream->callback) {
+			stream->callback(stream->context, &record);
+		}
+	}
+
+	stream->frames++;
+	stream->samples += count;
+	return true;
+}
+
+void TelemetryStream_Feed(telemetry_stream_t *stream, const uint8_t *data, size_t length)
+{
+	for (size_t i = 0; i < length; ++i) {
+		const uint8_t byte = data[i];
+		stream->bytes++;
+
+		if (byte != COBS_DELIMITER) {
+			if (stream->length < sizeof(stream->block)) {
+				stream->block[stream->length] = byte;
+			}
+			/* keeps counting past the end to mark the block overlong */
+			if (stream->length <= sizeof(stream->block)) {
+				stream->length++;
+			}
+			continue;
+		}
+
+		/* empty blocks are just back-to-back delimiters */
+		if ((stream->length > 0) && !TelemetryStream_Frame(stream)) {
+			if (stream->synced) {
+				stream->corrupt++;
+			}
+			else {
+				stream->skipped++;
+			}
+		}
+		stream->length = 0;
+	}
+}
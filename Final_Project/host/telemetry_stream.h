@@ -0,0 +1,80 @@
+/*
+ * telemetry_stream.h
+ *
+ *  Created on: Dec 18, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host side decoder of the telemetry stream of source/telemetry.h.
+ *
+ *   		Bytes are fed as they were captured. Every zero closes a frame, which is COBS
+ *   		decoded and CRC checked; the samples of a good frame are handed to a callback with
+ *   		a timestamp unwrapped to 64 bit. Gaps in the sample sequence count as dropped
+ *   		samples, frames failing a check as corrupt. Whatever precedes the first good
+ *   		frame (the boot log) is skipped, not counted as corrupt.
+ */
+
+#ifndef TELEMETRY_STREAM_H_
+#define TELEMETRY_STREAM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "telemetry.h"
+
+/**
+ * @brief Core clock of the cycle_count() timestamps
+ */
+#define TELEMETRY_STREAM_CLOCK_HZ	(48000000u)
+
+/**
+ * @brief A decoded sample
+ */
+typedef struct {
+	uint32_t sequence;			/*< sample number */
+	uint64_t cycles;			/*< timestamp in core cycles since the first frame's time base */
+	int16_t x, y, z;			/*< acceleration, 14 bit counts */
+} telemetry_record_t;
+
+typedef void (*telemetry_record_cb)(void *context, const telemetry_record_t *record);
+
+/**
+ * @brief Decoder state and counters
+ */
+typedef struct {
+	uint8_t block[2 * TELEMETRY_FRAME_SIZE];	/*< encoded bytes since the last delimiter */
+	size_t length;								/*< bytes in block; more than its size marks an overlong block */
+
+	bool synced;								/*< a good frame was seen */
+	uint32_t nextSequence;						/*< sequence number expected next */
+	uint32_t lastTimestamp;						/*< 32 bit timestamp of the last frame */
+	uint64_t cycles;							/*< that timestamp, unwrapped */
+
+	telemetry_record_cb callback;
+	void *context;
+
+	uint64_t bytes;								/*< bytes fed */
+	uint32_t frames;							/*< good frames */
+	uint32_t samples;							/*< samples in good frames */
+	uint32_t corrupt;							/*< frames failing COBS, length or CRC checks after sync */
+	uint32_t dropped;							/*< samples missing from the sequence */
+	uint32_t skipped;							/*< blocks before the first good frame */
+} telemetry_stream_t;
+
+/**
+ * @brief Prepares a decoder
+ * @param[out] stream The decoder
+ * @param[in] callback Receives every decoded sample
+ * @param[in] context Passed to the callback
+ */
+void TelemetryStream_Init(telemetry_stream_t *stream, telemetry_record_cb callback, void *context);
+
+/**
+ * @brief Feeds captured bytes
+ * @param[inout] stream The decoder
+ * @param[in] data The bytes
+ * @param[in] length Their number
+ */
+void TelemetryStream_Feed(telemetry_stream_t *stream, const uint8_t *data, size_t length);
+
+#endif /* TELEMETRY_STREAM_H_ */
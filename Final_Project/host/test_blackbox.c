@@ -0,0 +1,414 @@
+/*
+ * test_blackbox.c
+ *
+ *  Created on: Dec 30, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host test cases for the black box: the window around a trigger, a short history
+ *   		after the previous window, jerks missed while busy, the header written last,
+ *   		records found again after a reset, the slots worn evenly, a failed program and the
+ *   		flash stalls the acquisition does not ride out.
+ *   		The flash of nvm.h is an array with the rules of NOR flash.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "blackbox.h"
+#include "nvm.h"
+#include "crc16.h"
+#include "systick.h"
+#include "test_host.h"
+
+static int g_tests_passed = 0;
+static int g_tests_total = 0;
+static int g_skip_tests = 0;
+
+/*
+ * The flash of nvm.h
+ */
+
+#define SECTORS		(NVM_SIZE / NVM_SECTOR_SIZE)
+
+nvm_stats_t nvm_stats;
+static uint64_t words[NVM_SIZE / sizeof(uint64_t)];
+static uint8_t *const flash = (uint8_t *)words;
+static uint32_t erases[SECTORS];
+static int fail_program;
+
+/* how long the commands stall the core */
+static uint64_t erase_us, program_us;
+
+/* the clock of systick.c */
+static uint64_t now_us;
+
+bool Nvm_Init()
+{
+	return true;
+}
+
+bool Nvm_Erase(uint32_t address)
+{
+	memset(&flash[address - NVM_BASE], 0xFF, NVM_SECTOR_SIZE);
+	erases[(address - NVM_BASE) / NVM_SECTOR_SIZE]++;
+	nvm_stats.erases++;
+	now_us += erase_us;
+	return true;
+}
+
+bool Nvm_Program(uint32_t address, const uint32_t *data, uint32_t length)
+{
+	const uint8_t *bytes = (const uint8_t *)data;
+	uint8_t *at = &flash[address - NVM_BASE];
+	bool ok = (fail_program == 0) && (address % NVM_WRITE_SIZE == 0) && (length % NVM_WRITE_SIZE == 0);
+
+	for (uint32_t i = 0; ok && (i < length); ++i) {
+		ok = (bytes[i] & ~at[i]) == 0;
+		at[i] &= bytes[i];
+	}
+	if (!ok) {
+		nvm_stats.errors++;
+		return false;
+	}
+	nvm_stats.programs++;
+	nvm_stats.bytes += length;
+	now_us += program_us;
+	return true;
+}
+
+const uint8_t *Nvm_Map(uint32_t address)
+{
+	return &flash[address - NVM_BASE];
+}
+
+uint64_t timestamp_us()
+{
+	return now_us;
+}
+
+/*
+ * Helpers
+ */
+
+/* samples handed in so far, each one telling its number */
+static uint32_t fed;
+
+static void feed(uint32_t count)
+{
+	int16_t batch[16][3];
+
+	while (count > 0) {
+		const uint8_t n = (count < 16) ? count : 16;
+		for (uint8_t i = 0; i < n; ++i) {
+			batch[i][0] = (int16_t)fed;
+			batch[i][1] = (int16_t)(fed >> 16);
+			batch[i][2] = (int16_t)~fed;
+			fed++;
+		}
+		BlackBox_Record((const int16_t (*)[3])batch, n);
+		count -= n;
+	}
+}
+
+/* polls until the write and the erase after it are done */
+static int drain(void)
+{
+	int steps = 0;
+
+	while (BlackBox_Busy() && (steps < 1000)) {
+		BlackBox_Poll();
+		steps++;
+	}
+	return steps;
+}
+
+static const blackbox_header_t *slot_header(int slot)
+{
+	return (const blackbox_header_t *)&flash[slot * NVM_SECTOR_SIZE];
+}
+
+/* the record in a slot is whole and its samples tell their numbers */
+static int record_ok(int slot)
+{
+	const blackbox_header_t *header = slot_header(slot);
+	const uint8_t *record = (const uint8_t *)header;
+	const uint32_t count = header->pre + header->post;
+
+	if ((header->magic != BLACKBOX_MAGIC) || (header->version != BLACKBOX_VERSION) || (count > BLACKBOX_MAX_SAMPLES)) {
+		return 0;
+	}
+	uint16_t crc = CRC16_Compute(record, BLACKBOX_CRC_OFFSET);
+	crc = CRC16_Update(crc, record + BLACKBOX_HEADER_SIZE, count * BLACKBOX_SAMPLE_SIZE);
+	if (crc != header->crc) {
+		return 0;
+	}
+	for (uint32_t k = 0; k < count; ++k) {
+		int16_t xyz[3];
+		memcpy(xyz, record + BLACKBOX_HEADER_SIZE + k * BLACKBOX_SAMPLE_SIZE, sizeof(xyz));
+		const uint32_t number = header->first + k;
+		if ((xyz[0] != (int16_t)number) || (xyz[1] != (int16_t)(number >> 16)) || (xyz[2] != (int16_t)~number)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static void power_on(int erase_flash)
+{
+	if (erase_flash) {
+		memset(flash, 0xFF, NVM_SIZE);
+		memset(erases, 0, sizeof(erases));
+	}
+	memset(&nvm_stats, 0, sizeof(nvm_stats));
+	fail_program = 0;
+	erase_us = program_us = 0;
+	fed = 0;
+	BlackBox_Init(BLACKBOX_STALL_ANY);
+}
+
+/*
+ * Tests
+ */
+
+static void test_window(void)
+{
+	power_on(1);
+	test_equal(erases[0], 0);
+	test_assert(!BlackBox_Busy());
+
+	feed(200);
+	now_us = 123456789012ull;
+	test_assert(BlackBox_Trigger());
+	test_assert(BlackBox_Busy());
+
+	/* the window ends with the 64th sample from the trigger on, the ring then holds */
+	feed(BLACKBOX_POST_SAMPLES - 1);
+	BlackBox_Poll();
+	test_equal(nvm_stats.programs, 0);
+	feed(1 + 20);
+	test_equal(blackbox_stats.held, 20);
+
+	/* copied on the next poll: the ring goes on, nothing is programmed yet */
+	BlackBox_Poll();
+	test_equal(nvm_stats.programs, 0);
+	feed(10);
+	test_equal(blackbox_stats.held, 20);
+
+	/* the samples in chunks, then the header, then the next slot is checked */
+	const uint32_t bytes = BLACKBOX_HEADER_SIZE + (BLACKBOX_PRE_SAMPLES + BLACKBOX_POST_SAMPLES) * BLACKBOX_SAMPLE_SIZE;
+	const uint32_t chunks = (bytes - BLACKBOX_HEADER_SIZE + BLACKBOX_CHUNK - 1) / BLACKBOX_CHUNK;
+	for (uint32_t i = 0; i < chunks; ++i) {
+		BlackBox_Poll();
+		test_equal(slot_header(0)->magic, 0xFFFFFFFF);
+	}
+	test_equal(nvm_stats.programs, chunks);
+	BlackBox_Poll();
+	test_equal(nvm_stats.programs, chunks + 1);
+	test_assert(record_ok(0));
+	test_assert(BlackBox_Busy());
+	BlackBox_Poll();
+	test_assert(!BlackBox_Busy());
+
+	const blackbox_header_t *header = slot_header(0);
+	test_equal(header->sequence, 1);
+	test_assert(header->timestamp == 123456789012ull);
+	test_equal(header->first, 200 - BLACKBOX_PRE_SAMPLES);
+	test_equal(header->pre, BLACKBOX_PRE_SAMPLES);
+	test_equal(header->post, BLACKBOX_POST_SAMPLES);
+	test_equal(header->rate, BLACKBOX_RATE_HZ);
+	test_equal(nvm_stats.bytes, bytes);
+	test_equal(blackbox_stats.records, 1);
+	test_equal(blackbox_stats.triggers, 1);
+
+	/* the slot after it was blank, nothing was erased */
+	test_equal(nvm_stats.erases, 0);
+}
+
+static void test_short_history(void)
+{
+	power_on(1);
+
+	/* fewer samples than the window before the trigger */
+	feed(10);
+	test_assert(BlackBox_Trigger());
+	feed(BLACKBOX_POST_SAMPLES);
+	drain();
+	test_assert(record_ok(0));
+	test_equal(slot_header(0)->pre, 10);
+	test_equal(slot_header(0)->first, 0);
+
+	/* the samples held off cut the history: only those since count */
+	feed(30);
+	test_assert(BlackBox_Trigger());
+	feed(BLACKBOX_POST_SAMPLES + 5);
+	drain();
+	test_assert(record_ok(1));
+	test_equal(slot_header(1)->pre, 30);
+	test_equal(slot_header(1)->sequence, 2);
+}
+
+static void test_missed(void)
+{
+	power_on(1);
+
+	feed(100);
+	test_assert(BlackBox_Trigger());
+	test_assert(!BlackBox_Trigger());
+	feed(BLACKBOX_POST_SAMPLES);
+	BlackBox_Poll();
+	BlackBox_Poll();
+	test_assert(!BlackBox_Trigger());
+	test_equal(blackbox_stats.missed, 2);
+
+	drain();
+	test_assert(BlackBox_Trigger());
+	test_equal(blackbox_stats.triggers, 2);
+}
+
+static void test_wear(void)
+{
+	power_on(1);
+
+	const int events = 3 * BLACKBOX_SLOTS + 5;
+	for (int event = 0; event < events; ++event) {
+		feed(BLACKBOX_PRE_SAMPLES + 7);
+		test_assert(BlackBox_Trigger());
+		feed(BLACKBOX_POST_SAMPLES);
+		drain();
+	}
+	test_equal(blackbox_stats.records, events);
+	test_equal(blackbox_stats.errors, 0);
+
+	/* every slot erased as often as the others, give or take the one in turn */
+	uint32_t least = UINT32_MAX, most = 0;
+	for (int sector = 0; sector < BLACKBOX_SLOTS; ++sector) {
+		least = (erases[sector] < least) ? erases[sector] : least;
+		most = (erases[sector] > most) ? erases[sector] : most;
+	}
+	test_assert(most - least <= 1);
+	test_equal(most, 3);
+
+	/* the sectors past the black box are left alone */
+	for (int sector = BLACKBOX_SLOTS; sector < SECTORS; ++sector) {
+		test_equal(erases[sector], 0);
+	}
+
+	/* the last slots - 1 events are kept, the slot after the newest is erased */
+	const int next = events % BLACKBOX_SLOTS;
+	test_equal(slot_header(next)->magic, 0xFFFFFFFF);
+	for (int back = 1; back < BLACKBOX_SLOTS; ++back) {
+		const int slot = (next - back + BLACKBOX_SLOTS) % BLACKBOX_SLOTS;
+		test_assert(record_ok(slot));
+		test_equal(slot_header(slot)->sequence, events + 1 - back);
+	}
+
+	/* after a reset the numbering and the slots carry on */
+	power_on(0);
+	feed(BLACKBOX_PRE_SAMPLES);
+	test_assert(BlackBox_Trigger());
+	feed(BLACKBOX_POST_SAMPLES);
+	drain();
+	test_assert(record_ok(next));
+	test_equal(slot_header(next)->sequence, events + 1);
+}
+
+static void test_torn(void)
+{
+	power_on(1);
+
+	feed(100);
+	test_assert(BlackBox_Trigger());
+	feed(BLACKBOX_POST_SAMPLES);
+	drain();
+
+	/* reset half way through the second record: samples in, no header */
+	feed(100);
+	test_assert(BlackBox_Trigger());
+	feed(BLACKBOX_POST_SAMPLES);
+	for (int i = 0; i < 4; ++i) {
+		BlackBox_Poll();
+	}
+	test_equal(slot_header(1)->magic, 0xFFFFFFFF);
+	test_assert(flash[NVM_SECTOR_SIZE + BLACKBOX_HEADER_SIZE] != 0xFF);
+
+	/* not taken for a record: slot 1 comes next again and is erased at start-up */
+	const uint32_t before = erases[1];
+	power_on(0);
+	test_equal(erases[1], before + 1);
+	feed(100);
+	test_assert(BlackBox_Trigger());
+	feed(BLACKBOX_POST_SAMPLES);
+	drain();
+	test_assert(record_ok(1));
+	test_equal(slot_header(1)->sequence, 2);
+}
+
+static void test_program_error(void)
+{
+	power_on(1);
+
+	feed(100);
+	test_assert(BlackBox_Trigger());
+	feed(BLACKBOX_POST_SAMPLES);
+	BlackBox_Poll();
+	BlackBox_Poll();
+	fail_program = 1;
+	drain();
+	fail_program = 0;
+	test_equal(blackbox_stats.errors, 1);
+	test_equal(blackbox_stats.records, 0);
+
+	/* the slot is erased again and the event number kept for the next one */
+	test_equal(slot_header(0)->magic, 0xFFFFFFFF);
+	test_equal(erases[0], 1);
+	feed(100);
+	test_assert(BlackBox_Trigger());
+	feed(BLACKBOX_POST_SAMPLES);
+	drain();
+	test_assert(record_ok(0));
+	test_equal(slot_header(0)->sequence, 1);
+}
+
+static void test_stall_limit(void)
+{
+	/* the FIFO rides out 20 ms: the chunks fit, the erase of the worst case does not */
+	power_on(1);
+	flash[NVM_SECTOR_SIZE] = 0;
+	BlackBox_Init(20000);
+	program_us = (BLACKBOX_CHUNK / NVM_WRITE_SIZE) * 65;
+	erase_us = NVM_ERASE_MAX_US;
+
+	feed(100);
+	test_assert(BlackBox_Trigger());
+	feed(BLACKBOX_POST_SAMPLES);
+	drain();
+	test_assert(record_ok(0));
+	test_equal(erases[1], 1);
+	test_equal(blackbox_stats.overruns, 1);
+	test_equal(blackbox_stats.stalledSamples, (NVM_ERASE_MAX_US - 20000) * BLACKBOX_RATE_HZ / 1000000);
+
+	/* a sample period is less than a chunk may take: the black box stays off and keeps out of the flash */
+	power_on(1);
+	BlackBox_Init(1000000 / BLACKBOX_RATE_HZ);
+	feed(100);
+	test_assert(!BlackBox_Trigger());
+	test_equal(blackbox_stats.missed, 0);
+	feed(BLACKBOX_POST_SAMPLES);
+	test_equal(drain(), 0);
+	test_equal(nvm_stats.programs, 0);
+	test_equal(nvm_stats.erases, 0);
+}
+
+int main(void)
+{
+	test_window();
+	test_short_history();
+	test_missed();
+	test_wear();
+	test_torn();
+	test_program_error();
+	test_stall_limit();
+
+	printf("%s: passed %d/%d test cases\n", __FILE__, g_tests_passed, g_tests_total);
+	return (g_tests_passed == g_tests_total) ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+/*
+ * test_host.h
+ *
+ *  Created on: Dec 14, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Assertion macros for the host test runners, same as the on-target ones of test_queue.h.
+ *      		Every runner provides g_tests_passed, g_tests_total and g_skip_tests.
+ */
+
+#ifndef TEST_HOST_H_
+#define TEST_HOST_H_
+
+#include <stdio.h>
+
+#define test_assert(value) {                                            \
+  g_tests_total++;                                                      \
+  if (!g_skip_tests) {                                                  \
+    if (value) {                                                        \
+      g_tests_passed++;                                                 \
+    } else {                                                            \
+      printf("ERROR: test failure at line %d\n", __LINE__);             \
+      g_skip_tests = 1;                                                 \
+    }                                                                   \
+  }                                                                     \
+}
+
+#define test_equal(value1, value2) {                                    \
+  g_tests_total++;                                                      \
+  if (!g_skip_tests) {                                                  \
+    long res1 = (long)(value1);                                         \
+    long res2 = (long)(value2);                                         \
+    if (res1 == res2) {                                                 \
+      g_tests_passed++;                                                 \
+    } else {                                                            \
+      printf("ERROR: test failure at line %d: %ld != %ld\n", __LINE__, res1, res2); \
+      g_skip_tests = 1;                                                 \
+    }                                                                   \
+  }                                                                     \
+}
+
+#endif /* TEST_HOST_H_ */
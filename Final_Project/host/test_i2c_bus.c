@@ -0,0 +1,259 @@
+/*
+ * test_i2c_bus.c
+ *
+ *  Created on: Dec 21, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host test cases for the I2C bus health: time budgets, bus recovery only when the
+ *   		bus is held, its bounded cost, and the outcome counters and latency histograms,
+ *   		run through the simulated I2C backend on the register block of sim_i2c.c
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "i2c_hal_sim.h"
+#include "i2c_bus.h"
+#include "test_host.h"
+
+#define SIM_SLAVE	(0x1D)
+
+static int g_tests_passed = 0;
+static int g_tests_total = 0;
+static int g_skip_tests = 0;
+
+static sim_i2c_t sim;
+
+static void setup(void)
+{
+	SimI2C_Init(&sim, SIM_SLAVE);
+	for (int i = 0; i < 256; ++i) {
+		sim.memory[i] = (uint8_t)(i ^ 0x5A);
+	}
+	I2C_HalSimAttach(&sim);
+	I2C_BusReset();
+}
+
+/*
+ * @brief Device model that stretches SCL for good after the first data byte of a read
+ */
+static uint8_t stall_read(sim_i2c_t *s)
+{
+	s->stall = true;
+	return s->memory[s->pointer++];
+}
+
+static int callbacks = 0;
+static uint32_t callback_primask = 0;
+
+static void count_callback(i2c_transfer_t *transfer)
+{
+	callbacks++;
+	callback_primask = host_primask;
+}
+
+static void test_latency_bins(void)
+{
+	I2C_BusReset();
+
+	I2C_BusRecord(I2C_DIRECTION_READ, I2C_STATUS_OK, 0);
+	I2C_BusRecord(I2C_DIRECTION_READ, I2C_STATUS_OK, I2C_BUS_US_TO_CYCLES(1));
+	I2C_BusRecord(I2C_DIRECTION_READ, I2C_STATUS_OK, I2C_BUS_US_TO_CYCLES(127));
+	I2C_BusRecord(I2C_DIRECTION_READ, I2C_STATUS_OK, I2C_BUS_US_TO_CYCLES(128));
+	I2C_BusRecord(I2C_DIRECTION_WRITE, I2C_STATUS_NACK, 0xFFFFFFFFu);
+
+	test_equal(i2c_bus_stats.transfers, 5);
+	test_equal(i2c_bus_stats.nacks, 1);
+	test_equal(i2c_bus_stats.latency[I2C_DIRECTION_READ][0], 1);
+	test_equal(i2c_bus_stats.latency[I2C_DIRECTION_READ][1], 1);
+	test_equal(i2c_bus_stats.latency[I2C_DIRECTION_READ][7], 1);
+	test_equal(i2c_bus_stats.latency[I2C_DIRECTION_READ][8], 1);
+	test_equal(i2c_bus_stats.latency[I2C_DIRECTION_WRITE][I2C_BUS_LATENCY_BINS - 1], 1);
+	test_equal(i2c_bus_stats.worstUs[I2C_DIRECTION_READ], 128);
+}
+
+static void test_healthy(void)
+{
+	setup();
+
+	/* a healthy bus never pays for recovery, whatever the outcome */
+	int matches = 0;
+	for (int i = 0; i < 100; ++i) {
+		matches += (I2C_HalReadRegister(SIM_SLAVE, 0x0D) == (0x0D ^ 0x5A));
+	}
+	for (int i = 0; i < 10; ++i) {
+		I2C_HalWriteRegister(SIM_SLAVE, 0x20, (uint8_t)i);
+	}
+	const uint8_t absent = I2C_HalReadRegister(0x00, 0x0D);
+	test_equal(matches, 100);
+	test_equal(absent, 0xFF);
+
+	test_equal(i2c_bus_stats.transfers, 111);
+	test_equal(i2c_bus_stats.nacks, 1);
+	test_equal(i2c_bus_stats.timeouts, 0);
+	test_equal(i2c_bus_stats.busyWaits, 0);
+	test_equal(i2c_bus_stats.recoveries, 0);
+	test_equal(sim.bytes, 100 * 4 + 10 * 3 + 1);
+
+	/* four bytes of a register read and three of a write take 96 and 72 us at 375 kHz */
+	test_equal(i2c_bus_stats.latency[I2C_DIRECTION_READ][7], 100);
+	test_equal(i2c_bus_stats.latency[I2C_DIRECTION_WRITE][7], 10);
+	test_assert(i2c_bus_stats.worstUs[I2C_DIRECTION_READ] < 128);
+	const bool free = I2C_BusAcquire(&sim.regs);
+	test_assert(free);
+	test_equal(i2c_bus_stats.busyWaits, 0);
+}
+
+static void test_held(void)
+{
+	setup();
+
+	/* a slave left in the middle of a read: the START loses arbitration and five pulses free the bus */
+	SimI2C_Hold(&sim, 5);
+	uint8_t value = 0;
+	uint32_t start = host_cycles;
+	i2c_status_t status = I2C_HalTransfer(SIM_SLAVE, 0x0D, I2C_DIRECTION_READ, &value, 1);
+	uint32_t elapsed = host_cycles - start;
+	test_equal(status, I2C_STATUS_ARBITRATION_LOST);
+	test_assert(elapsed <= I2C_BUS_US_TO_CYCLES(I2C_BUS_RECOVERY_MAX_US + 10));
+
+	test_equal(i2c_bus_stats.arbitrationLost, 1);
+	test_equal(i2c_bus_stats.recoveries, 1);
+	test_equal(i2c_bus_stats.recoveryClocks, 5);
+	test_equal(i2c_bus_stats.recoveryFailures, 0);
+	test_equal(sim.stuck, 0);
+	test_assert(I2C_IrqIdle(&i2c0_engine));
+
+	/* and the next transaction goes through */
+	value = I2C_HalReadRegister(SIM_SLAVE, 0x0D);
+	test_equal(value, 0x0D ^ 0x5A);
+	test_equal(i2c_bus_stats.recoveries, 1);
+
+	/* a slave that never lets go: nine pulses, a STOP, and the bounded time is all it costs */
+	SimI2C_Hold(&sim, 20);
+	start = host_cycles;
+	status = I2C_HalTransfer(SIM_SLAVE, 0x0D, I2C_DIRECTION_READ, &value, 1);
+	elapsed = host_cycles - start;
+	test_equal(status, I2C_STATUS_ARBITRATION_LOST);
+	test_assert(elapsed <= I2C_BUS_US_TO_CYCLES(I2C_BUS_RECOVERY_MAX_US + 10));
+	test_equal(i2c_bus_stats.recoveries, 2);
+	test_equal(i2c_bus_stats.recoveryClocks, 5 + I2C_BUS_RECOVERY_CLOCKS);
+	test_equal(i2c_bus_stats.recoveryFailures, 1);
+	/* the pulses, and the one ahead of the STOP */
+	test_equal(sim.stuck, 20 - I2C_BUS_RECOVERY_CLOCKS - 1);
+	test_assert(I2C_IrqIdle(&i2c0_engine));
+}
+
+static void test_timeout(void)
+{
+	uint8_t buffer[6];
+
+	setup();
+
+	/* the slave stretches SCL in the middle of a read: the waiter aborts it once out of time */
+	sim.read = stall_read;
+	const uint32_t budget = I2C_BUS_US_TO_CYCLES(I2C_BUS_TIMEOUT_US(sizeof(buffer) + I2C_BUS_OVERHEAD_BYTES));
+	const uint32_t start = host_cycles;
+	const i2c_status_t status = I2C_HalTransfer(SIM_SLAVE, 0x00, I2C_DIRECTION_READ, buffer, sizeof(buffer));
+	const uint32_t elapsed = host_cycles - start;
+	test_equal(status, I2C_STATUS_TIMEOUT);
+
+	test_assert(elapsed >= budget);
+	test_assert(elapsed <= budget + HOST_CYCLES_PER_TICK + I2C_BUS_US_TO_CYCLES(I2C_BUS_RECOVERY_MAX_US));
+	test_equal(i2c_bus_stats.timeouts, 1);
+	test_equal(i2c_bus_stats.recoveries, 1);
+	test_equal(i2c_bus_stats.recoveryClocks, 0);
+	test_assert(i2c_bus_stats.worstUs[I2C_DIRECTION_READ] >= budget / I2C_BUS_CYCLES_PER_US);
+	test_assert(!sim.stall);
+	test_assert(I2C_IrqIdle(&i2c0_engine));
+
+	/* the STOP of the recovery reset the slave */
+	sim.read = 0;
+	const uint8_t value = I2C_HalReadRegister(SIM_SLAVE, 0x0D);
+	test_equal(value, 0x0D ^ 0x5A);
+}
+
+static void test_expire_on_submit(void)
+{
+	uint8_t stalled = 0, next = 0;
+	i2c_transfer_t first = {
+		.slaveId = SIM_SLAVE, .registerAddress = 0x0D, .direction = I2C_DIRECTION_READ,
+		.buffer = &stalled, .length = 1, .callback = count_callback
+	};
+	i2c_transfer_t second = first;
+	second.buffer = &next;
+
+	setup();
+	callbacks = 0;
+
+	/* submitted from "interrupt" context, nobody waits for it */
+	sim.stall = true;
+	i2c_status_t accepted = I2C_HalSubmit(&first);
+	I2C_HalSimRun();
+	i2c_status_t refused = I2C_HalSubmit(&second);
+	test_equal(accepted, I2C_STATUS_PENDING);
+	test_equal(refused, I2C_STATUS_BUSY);
+	test_equal(first.status, I2C_STATUS_PENDING);
+
+	/* out of time: the next submission aborts it and the one after gets the engine; the abort
+	 * recovers the bus and reports with interrupts as the submitter had them, here unmasked */
+	host_cycles += I2C_BUS_US_TO_CYCLES(I2C_BUS_TIMEOUT_US(1 + I2C_BUS_OVERHEAD_BYTES));
+	callback_primask = 1;
+	refused = I2C_HalSubmit(&second);
+	test_equal(refused, I2C_STATUS_BUSY);
+	test_equal(first.status, I2C_STATUS_TIMEOUT);
+	test_equal(callbacks, 1);
+	test_equal(callback_primask, 0);
+	test_equal(host_primask, 0);
+
+	accepted = I2C_HalSubmit(&second);
+	const i2c_status_t status = I2C_HalWait(&second);
+	test_equal(accepted, I2C_STATUS_PENDING);
+	test_equal(status, I2C_STATUS_OK);
+	test_equal(next, 0x0D ^ 0x5A);
+	test_equal(callbacks, 2);
+	test_equal(i2c_bus_stats.timeouts, 1);
+}
+
+static void test_acquire(void)
+{
+	setup();
+
+	/* BUSY with a slave holding SDA: three pulses */
+	SimI2C_Hold(&sim, 3);
+	bool free = I2C_BusAcquire(&sim.regs);
+	test_assert(free);
+	test_equal(i2c_bus_stats.busyWaits, 1);
+	test_equal(i2c_bus_stats.recoveries, 1);
+	test_equal(i2c_bus_stats.recoveryClocks, 3);
+	test_assert(!(sim.regs.S & I2C_S_BUSY_MASK));
+
+	/* BUSY that does not clear within the grace period, the lines high: just the STOP */
+	sim.regs.S |= I2C_S_BUSY_MASK;
+	const uint32_t start = host_cycles;
+	free = I2C_BusAcquire(&sim.regs);
+	const uint32_t elapsed = host_cycles - start;
+	test_assert(free);
+	test_assert(elapsed >= I2C_BUS_US_TO_CYCLES(I2C_BUS_BUSY_GRACE_US));
+	test_equal(i2c_bus_stats.recoveries, 2);
+	test_equal(i2c_bus_stats.recoveryClocks, 3);
+
+	/* held for good */
+	SimI2C_Hold(&sim, 100);
+	free = I2C_BusAcquire(&sim.regs);
+	test_assert(!free);
+	test_equal(i2c_bus_stats.recoveryFailures, 1);
+}
+
+int main(void)
+{
+	test_latency_bins();
+	test_healthy();
+	test_held();
+	test_timeout();
+	test_expire_on_submit();
+	test_acquire();
+
+	printf("%s: passed %d/%d test cases\n", __FILE__, g_tests_passed, g_tests_total);
+	return (g_tests_passed == g_tests_total) ? 0 : 1;
+}
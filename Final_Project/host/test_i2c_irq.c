@@ -0,0 +1,326 @@
+/*
+ * test_i2c_irq.c
+ *
+ *  Created on: Dec 14, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host test cases for the interrupt driven I2C engine, run against the
+ *   		simulated register block of sim_i2c.c
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "i2c_irq.h"
+#include "i2c_dma.h"
+#include "sim_i2c.h"
+#include "test_host.h"
+
+#define SIM_SLAVE	(0x1D)
+
+static int g_tests_passed = 0;
+static int g_tests_total = 0;
+static int g_skip_tests = 0;
+
+static sim_i2c_t sim;
+static i2c_irq_engine_t engine;
+
+/*
+ * @brief Plays the role of the NVIC: runs the handler for as long as the module raises IICIF with IICIE set
+ */
+static void run_bus(void)
+{
+	int guard = 1000;
+	while (SimI2C_Clock(&sim) && (sim.regs.C1 & I2C_C1_IICIE_MASK) && --guard) {
+		I2C_IrqHandler(&engine);
+	}
+}
+
+static int callbacks = 0;
+static i2c_transfer_t chained;
+
+static void count_callback(i2c_transfer_t *transfer)
+{
+	callbacks++;
+}
+
+static void chain_callback(i2c_transfer_t *transfer)
+{
+	callbacks++;
+	I2C_IrqSubmit(&engine, &chained);
+}
+
+static void test_read(void)
+{
+	uint8_t buffer[7];
+	i2c_transfer_t transfer = {
+		.slaveId = SIM_SLAVE, .registerAddress = 0x00, .direction = I2C_DIRECTION_READ,
+		.buffer = buffer, .length = sizeof(buffer), .callback = count_callback
+	};
+
+	SimI2C_Init(&sim, SIM_SLAVE);
+	I2C_IrqInit(&engine, &sim.regs);
+	for (int i = 0; i < 7; ++i) {
+		sim.memory[i] = 0xA0 + i;
+	}
+	callbacks = 0;
+
+	/* submission returns right after the address was queued */
+	test_equal(I2C_IrqSubmit(&engine, &transfer), I2C_STATUS_PENDING);
+	test_equal(transfer.status, I2C_STATUS_PENDING);
+	test_assert(!I2C_IrqIdle(&engine));
+	test_equal(sim.bytes, 0);
+
+	/* a second descriptor is refused while the first one is in flight */
+	i2c_transfer_t other = transfer;
+	test_equal(I2C_IrqSubmit(&engine, &other), I2C_STATUS_BUSY);
+
+	run_bus();
+
+	test_equal(transfer.status, I2C_STATUS_OK);
+	test_assert(I2C_IrqIdle(&engine));
+	test_equal(callbacks, 1);
+	for (int i = 0; i < 7; ++i) {
+		test_equal(buffer[i], 0xA0 + i);
+	}
+
+	/* W-address, register, R-address, 7 data bytes */
+	test_equal(sim.bytes, 10);
+	test_equal(sim.starts, 2);
+	test_equal(sim.stops, 1);
+	test_assert(!(sim.regs.C1 & (I2C_C1_MST_MASK | I2C_C1_IICIE_MASK)));
+}
+
+static void test_single_byte_read(void)
+{
+	uint8_t value = 0;
+	i2c_transfer_t transfer = {
+		.slaveId = SIM_SLAVE, .registerAddress = 0x0D, .direction = I2C_DIRECTION_READ,
+		.buffer = &value, .length = 1
+	};
+
+	SimI2C_Init(&sim, SIM_SLAVE);
+	I2C_IrqInit(&engine, &sim.regs);
+	sim.memory[0x0D] = 0x1A;
+
+	test_equal(I2C_IrqSubmit(&engine, &transfer), I2C_STATUS_PENDING);
+	run_bus();
+	test_equal(transfer.status, I2C_STATUS_OK);
+	test_equal(value, 0x1A);
+	test_equal(sim.bytes, 4);
+}
+
+static void test_write(void)
+{
+	uint8_t data[3] = { 0xD8, 0x1E, 0x0A };
+	i2c_transfer_t transfer = {
+		.slaveId = SIM_SLAVE, .registerAddress = 0x15, .direction = I2C_DIRECTION_WRITE,
+		.buffer = data, .length = sizeof(data)
+	};
+
+	SimI2C_Init(&sim, SIM_SLAVE);
+	I2C_IrqInit(&engine, &sim.regs);
+
+	test_equal(I2C_IrqSubmit(&engine, &transfer), I2C_STATUS_PENDING);
+	run_bus();
+	test_equal(transfer.status, I2C_STATUS_OK);
+	test_equal(sim.memory[0x15], 0xD8);
+	test_equal(sim.memory[0x16], 0x1E);
+	test_equal(sim.memory[0x17], 0x0A);
+	test_equal(sim.starts, 1);
+	test_equal(sim.stops, 1);
+}
+
+static void test_nack(void)
+{
+	uint8_t value = 0;
+	i2c_transfer_t transfer = {
+		.slaveId = 0x00, .registerAddress = 0x00, .direction = I2C_DIRECTION_READ,
+		.buffer = &value, .length = 1
+	};
+
+	SimI2C_Init(&sim, SIM_SLAVE);
+	I2C_IrqInit(&engine, &sim.regs);
+
+	test_equal(I2C_IrqSubmit(&engine, &transfer), I2C_STATUS_PENDING);
+	run_bus();
+	test_equal(transfer.status, I2C_STATUS_NACK);
+	test_assert(I2C_IrqIdle(&engine));
+	test_equal(sim.stops, 1);
+}
+
+static const i2c_transfer_t *waited;
+static int sleeps = 0;
+static uint32_t sleep_primask = 0;
+
+/*
+ * @brief The core sleeps: the bus interrupt wakes it and is taken once PRIMASK is cleared
+ */
+void Host_WaitForInterrupt(void)
+{
+	sleeps++;
+	sleep_primask = host_primask;
+	test_equal(waited->status, I2C_STATUS_PENDING);
+	if (host_primask) {
+		host_pending = 1;
+	}
+	else {
+		run_bus();
+	}
+}
+
+void Host_InterruptsUnmasked(void)
+{
+	host_pending = 0;
+	run_bus();
+}
+
+static void test_wait(void)
+{
+	uint8_t value = 0;
+	i2c_transfer_t transfer = {
+		.slaveId = SIM_SLAVE, .registerAddress = 0x0D, .direction = I2C_DIRECTION_READ,
+		.buffer = &value, .length = 1
+	};
+
+	SimI2C_Init(&sim, SIM_SLAVE);
+	I2C_IrqInit(&engine, &sim.regs);
+	sim.memory[0x0D] = 0x1A;
+	sleeps = 0;
+
+	/* the status is checked and slept on under the mask, so a completion in between cannot be missed */
+	waited = &transfer;
+	test_equal(I2C_IrqSubmit(&engine, &transfer), I2C_STATUS_PENDING);
+	test_equal(I2C_IrqWait(&engine, &transfer), I2C_STATUS_OK);
+	test_equal(sleeps, 1);
+	test_equal(sleep_primask, 1);
+	test_equal(host_primask, 0);
+	test_equal(value, 0x1A);
+
+	/* done before the wait, it does not sleep at all */
+	test_equal(I2C_IrqSubmit(&engine, &transfer), I2C_STATUS_PENDING);
+	run_bus();
+	test_equal(I2C_IrqWait(&engine, &transfer), I2C_STATUS_OK);
+	test_equal(sleeps, 1);
+}
+
+static void test_chaining(void)
+{
+	uint8_t first[2], second[2];
+	i2c_transfer_t transfer = {
+		.slaveId = SIM_SLAVE, .registerAddress = 0x01, .direction = I2C_DIRECTION_READ,
+		.buffer = first, .length = 2, .callback = chain_callback
+	};
+	chained = (i2c_transfer_t) {
+		.slaveId = SIM_SLAVE, .registerAddress = 0x03, .direction = I2C_DIRECTION_READ,
+		.buffer = second, .length = 2, .callback = count_callback
+	};
+
+	SimI2C_Init(&sim, SIM_SLAVE);
+	I2C_IrqInit(&engine, &sim.regs);
+	for (int i = 0; i < 8; ++i) {
+		sim.memory[i] = i;
+	}
+	callbacks = 0;
+
+	/* the completion callback submits the next transfer from interrupt context */
+	test_equal(I2C_IrqSubmit(&engine, &transfer), I2C_STATUS_PENDING);
+	run_bus();
+	test_equal(callbacks, 2);
+	test_equal(transfer.status, I2C_STATUS_OK);
+	test_equal(chained.status, I2C_STATUS_OK);
+	test_equal(first[0], 1);
+	test_equal(first[1], 2);
+	test_equal(second[0], 3);
+	test_equal(second[1], 4);
+	test_equal(sim.stops, 2);
+}
+
+static void test_dma_read(void)
+{
+	uint8_t buffer[7];
+	DMA_Type controller;
+	i2c_dma_t dma = { .base = &controller, .channel = 2 };
+	i2c_transfer_t transfer = {
+		.slaveId = SIM_SLAVE, .registerAddress = 0x00, .direction = I2C_DIRECTION_READ,
+		.buffer = buffer, .length = sizeof(buffer), .callback = count_callback
+	};
+
+	SimI2C_Init(&sim, SIM_SLAVE);
+	I2C_IrqInit(&engine, &sim.regs);
+	test_assert(engine.dma == 0);
+	engine.dma = &dma;
+	memset(&controller, 0, sizeof(controller));
+	memset(buffer, 0, sizeof(buffer));
+	for (int i = 0; i < 7; ++i) {
+		sim.memory[i] = 0xB0 + i;
+	}
+	callbacks = 0;
+
+	/* address phase on interrupts, then the handler arms the channel and goes quiet */
+	test_equal(I2C_IrqSubmit(&engine, &transfer), I2C_STATUS_PENDING);
+	test_assert(engine.viaDma);
+	run_bus();
+	test_equal(engine.state, I2C_IRQ_READ_DMA);
+	test_equal(sim.interrupts, 4);
+	test_assert(sim.regs.C1 & I2C_C1_DMAEN_MASK);
+	test_assert(!(sim.regs.C1 & (I2C_C1_IICIE_MASK | I2C_C1_TX_MASK | I2C_C1_TXAK_MASK)));
+	test_equal(controller.DMA[2].DSR_BCR & DMA_DSR_BCR_BCR_MASK, sizeof(buffer) - 1);
+	test_assert(controller.DMA[2].DCR & DMA_DCR_ERQ_MASK);
+	test_assert(controller.DMA[2].DCR & DMA_DCR_EINT_MASK);
+	test_equal(controller.DMA[0].DCR, 0);
+
+	/* play the channel: every read of D clocks in the next byte */
+	for (int i = 0; i < sizeof(buffer) - 1; ++i) {
+		buffer[i] = sim.regs.D;
+		if (i < sizeof(buffer) - 2) {
+			SimI2C_Clock(&sim);
+		}
+	}
+	test_equal(transfer.status, I2C_STATUS_PENDING);
+
+	/* the channel interrupt hands back to the engine while the last byte is still on the wire */
+	I2C_IrqDmaDone(&engine, true);
+	test_assert(sim.regs.C1 & I2C_C1_TXAK_MASK);
+	test_assert(sim.regs.C1 & I2C_C1_IICIE_MASK);
+	run_bus();
+	test_equal(transfer.status, I2C_STATUS_OK);
+	test_equal(callbacks, 1);
+	test_assert(I2C_IrqIdle(&engine));
+	for (int i = 0; i < 7; ++i) {
+		test_equal(buffer[i], 0xB0 + i);
+	}
+	test_equal(sim.bytes, 10);
+	test_equal(sim.stops, 1);
+	test_assert(!(sim.regs.C1 & (I2C_C1_MST_MASK | I2C_C1_IICIE_MASK | I2C_C1_DMAEN_MASK)));
+
+	/* short reads stay on the per-byte interrupts */
+	transfer.length = I2C_DMA_MIN_LENGTH - 1;
+	test_equal(I2C_IrqSubmit(&engine, &transfer), I2C_STATUS_PENDING);
+	test_assert(!engine.viaDma);
+	run_bus();
+	test_equal(transfer.status, I2C_STATUS_OK);
+
+	/* a channel error ends the transfer with a STOP */
+	transfer.length = sizeof(buffer);
+	test_equal(I2C_IrqSubmit(&engine, &transfer), I2C_STATUS_PENDING);
+	run_bus();
+	I2C_IrqDmaDone(&engine, false);
+	test_equal(transfer.status, I2C_STATUS_DMA_ERROR);
+	test_assert(I2C_IrqIdle(&engine));
+	test_assert(!(sim.regs.C1 & (I2C_C1_MST_MASK | I2C_C1_DMAEN_MASK)));
+}
+
+int main(void)
+{
+	test_read();
+	test_single_byte_read();
+	test_write();
+	test_nack();
+	test_wait();
+	test_chaining();
+	test_dma_read();
+
+	printf("%s: passed %d/%d test cases\n", __FILE__, g_tests_passed, g_tests_total);
+	return (g_tests_passed == g_tests_total) ? 0 : 1;
+}
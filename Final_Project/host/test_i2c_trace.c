@@ -0,0 +1,173 @@
+/*
+ * test_i2c_trace.c
+ *
+ *  Created on: Dec 22, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host test cases for the I2C transaction trace: the fields of a record, the context
+ *   		and contention of a transfer submitted from "interrupt" context while the thread
+ *   		owns the engine, and the ring keeping the newest records, run through the
+ *   		simulated I2C backend with the trace compiled in
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "i2c_hal_sim.h"
+#include "i2c_trace.h"
+#include "test_host.h"
+
+#define SIM_SLAVE	(0x1D)
+
+/* PORTA_IRQn is 30, its exception number 16 higher */
+#define PORTA_EXCEPTION	(16 + 30)
+
+static int g_tests_passed = 0;
+static int g_tests_total = 0;
+static int g_skip_tests = 0;
+
+static sim_i2c_t sim;
+
+static void setup(void)
+{
+	SimI2C_Init(&sim, SIM_SLAVE);
+	for (int i = 0; i < 256; ++i) {
+		sim.memory[i] = (uint8_t)(i ^ 0x5A);
+	}
+	I2C_HalSimAttach(&sim);
+	I2C_TraceReset();
+	host_ipsr = 0;
+}
+
+static void test_record(void)
+{
+	uint8_t buffer[6];
+	i2c_trace_record_t record;
+
+	setup();
+
+	const uint32_t before = host_cycles;
+	const i2c_status_t status = I2C_HalTransfer(SIM_SLAVE, 0x01, I2C_DIRECTION_READ, buffer, sizeof(buffer));
+	const uint32_t after = host_cycles;
+	test_equal(status, I2C_STATUS_OK);
+	test_equal(I2C_TraceCount(), 1);
+
+	const bool found = I2C_TraceGet(0, &record);
+	test_assert(found);
+	test_equal(record.sequence, 0);
+	test_equal(record.slaveId, SIM_SLAVE);
+	test_equal(record.registerAddress, 0x01);
+	test_equal(record.length, sizeof(buffer));
+	test_equal(record.exception, I2C_TRACE_THREAD);
+	test_equal(record.status, I2C_STATUS_OK);
+	test_equal(record.flags, I2C_TRACE_READ);
+
+	/* nine bytes on the wire lie between start and end */
+	test_assert((record.start >= before) && (record.end <= after));
+	test_assert(record.end - record.start >= 9 * SIM_I2C_CYCLES_PER_BYTE);
+
+	/* a write to an absent slave */
+	uint8_t value = 0x42;
+	const i2c_status_t nack = I2C_HalTransfer(0x00, 0x2A, I2C_DIRECTION_WRITE, &value, 1);
+	const bool written = I2C_TraceGet(1, &record);
+	test_equal(nack, I2C_STATUS_NACK);
+	test_assert(written);
+	test_equal(record.status, I2C_STATUS_NACK);
+	test_equal(record.flags, 0);
+
+	/* nothing recorded past the last one */
+	const bool beyond = I2C_TraceGet(2, &record);
+	test_assert(!beyond);
+}
+
+static void test_contention(void)
+{
+	uint8_t sample[6], source = 0;
+	i2c_transfer_t thread = {
+		.slaveId = SIM_SLAVE, .registerAddress = 0x01, .direction = I2C_DIRECTION_READ,
+		.buffer = sample, .length = sizeof(sample)
+	};
+	i2c_transfer_t handler = {
+		.slaveId = SIM_SLAVE, .registerAddress = 0x16, .direction = I2C_DIRECTION_READ,
+		.buffer = &source, .length = 1
+	};
+	i2c_trace_record_t first, second;
+
+	setup();
+
+	/* the main loop owns the engine when the PORTA interrupt wants its source register */
+	const i2c_status_t accepted = I2C_HalSubmit(&thread);
+	host_ipsr = PORTA_EXCEPTION;
+	const i2c_status_t refused = I2C_HalSubmit(&handler);
+	host_ipsr = 0;
+	test_equal(accepted, I2C_STATUS_PENDING);
+	test_equal(refused, I2C_STATUS_BUSY);
+
+	const i2c_status_t done = I2C_HalWait(&thread);
+	test_equal(done, I2C_STATUS_OK);
+
+	/* the handler's retry, once the engine is free */
+	host_ipsr = PORTA_EXCEPTION;
+	const i2c_status_t retried = I2C_HalSubmit(&handler);
+	host_ipsr = 0;
+	const i2c_status_t handled = I2C_HalWait(&handler);
+	test_equal(retried, I2C_STATUS_PENDING);
+	test_equal(handled, I2C_STATUS_OK);
+	test_equal(source, 0x16 ^ 0x5A);
+
+	const bool found = I2C_TraceGet(0, &first) && I2C_TraceGet(1, &second);
+	test_assert(found);
+	test_equal(first.exception, I2C_TRACE_THREAD);
+	test_equal(first.flags, I2C_TRACE_READ | I2C_TRACE_CONTENDED);
+	test_equal(second.exception, PORTA_EXCEPTION);
+	test_equal(second.registerAddress, 0x16);
+	test_equal(second.flags, I2C_TRACE_READ);
+	test_assert(second.start >= first.end);
+
+	/* what the UART shows of it */
+	I2C_TraceDump();
+	printf("\n");
+}
+
+static void test_ring(void)
+{
+	i2c_trace_record_t record;
+	const uint32_t total = I2C_TRACE_LENGTH + 36;
+
+	setup();
+
+	for (uint32_t i = 0; i < total; ++i) {
+		I2C_HalWriteRegister(SIM_SLAVE, (uint8_t)i, (uint8_t)i);
+	}
+	test_equal(I2C_TraceCount(), total);
+
+	/* the oldest are gone, the newest are kept in order */
+	int kept = 0, ordered = 0;
+	for (uint32_t sequence = 0; sequence < total; ++sequence) {
+		if (I2C_TraceGet(sequence, &record)) {
+			kept++;
+			ordered += (record.sequence == sequence) && (record.registerAddress == (uint8_t)sequence);
+		}
+	}
+	const bool oldest = I2C_TraceGet(total - I2C_TRACE_LENGTH - 1, &record);
+	const bool newest = I2C_TraceGet(total - I2C_TRACE_LENGTH, &record);
+	test_equal(kept, I2C_TRACE_LENGTH);
+	test_equal(ordered, I2C_TRACE_LENGTH);
+	test_assert(!oldest);
+	test_assert(newest);
+
+	I2C_TraceReset();
+	const bool cleared = I2C_TraceGet(total - 1, &record);
+	test_equal(I2C_TraceCount(), 0);
+	test_assert(!cleared);
+}
+
+int main(void)
+{
+	test_record();
+	test_contention();
+	test_ring();
+
+	printf("%s: passed %d/%d test cases\n", __FILE__, g_tests_passed, g_tests_total);
+	return (g_tests_passed == g_tests_total) ? 0 : 1;
+}
@@ -0,0 +1,232 @@
+/*
+ * test_mma8451q_drdy.c
+ *
+ *  Created on: Dec 16, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host test cases for the MMA8451Q data-ready acquisition, run through the
+ *   		simulated I2C backend on the register block of sim_i2c.c
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "mma8451q_drdy.h"
+#include "i2c_hal_sim.h"
+#include "i2c_bus.h"
+#include "test_host.h"
+
+static int g_tests_passed = 0;
+static int g_tests_total = 0;
+static int g_skip_tests = 0;
+
+static sim_i2c_t sim;
+
+/*
+ * @brief Puts a sample into the STATUS and OUT registers, 14bit left-justified and big-endian
+ */
+static void sensor_sample(uint8_t status, int16_t x, int16_t y, int16_t z)
+{
+	const int16_t xyz[3] = { x, y, z };
+
+	sim.memory[MMA8451Q_REG_STATUS] = status;
+	for (int axis = 0; axis < 3; ++axis) {
+		const uint16_t raw = (uint16_t)((uint16_t)xyz[axis] << 2);
+		sim.memory[1 + 2 * axis] = raw >> 8;
+		sim.memory[2 + 2 * axis] = raw & 0xFF;
+	}
+}
+
+static void setup(uint8_t slaveId)
+{
+	SimI2C_Init(&sim, slaveId);
+	I2C_HalSimAttach(&sim);
+	MMA8451Q_DrdyStart();
+}
+
+static void test_sample(void)
+{
+	mma8451q_sample_t sample;
+
+	setup(MMA8451Q_I2CADDR);
+	test_assert(!MMA8451Q_DrdyTake(&sample));
+	test_equal(mma8451q_drdy_stats.duplicatesAvoided, 1);
+
+	/* data-ready edge: one read, stamped with the time of the edge */
+	sensor_sample(0x0F, 1024, -2048, 4095);
+	host_cycles = 48000;
+	MMA8451Q_DrdyRead();
+	host_cycles = 50000;
+	I2C_HalSimRun();
+
+	test_assert(MMA8451Q_DrdyTake(&sample));
+	test_equal(sample.sequence, 1);
+	test_equal(sample.timestamp, 48000);
+	test_equal(sample.acc.status, 0x0F);
+	test_equal(sample.acc.x, 1024);
+	test_equal(sample.acc.y, -2048);
+	test_equal(sample.acc.z, 4095);
+	test_equal(sim.bytes, 10);
+	test_equal(sim.stops, 1);
+
+	/* asking again before the next edge does not touch the bus */
+	test_assert(!MMA8451Q_DrdyTake(&sample));
+	test_assert(!MMA8451Q_DrdyTake(&sample));
+	test_equal(mma8451q_drdy_stats.duplicatesAvoided, 3);
+	test_equal(sim.bytes, 10);
+
+	test_equal(mma8451q_drdy_stats.samples, 1);
+	test_equal(mma8451q_drdy_stats.overruns, 0);
+	test_equal(mma8451q_drdy_stats.unconsumed, 0);
+}
+
+static void test_overrun(void)
+{
+	mma8451q_sample_t sample;
+
+	setup(MMA8451Q_I2CADDR);
+
+	/* the sensor overwrote a sample before it was read */
+	sensor_sample(0x8F, 1, 2, 3);
+	MMA8451Q_DrdyRead();
+	I2C_HalSimRun();
+	test_equal(mma8451q_drdy_stats.overruns, 1);
+
+	/* a second sample replaces the first before anyone took it */
+	sensor_sample(0x0F, 4, 5, 6);
+	MMA8451Q_DrdyRead();
+	I2C_HalSimRun();
+	test_equal(mma8451q_drdy_stats.samples, 2);
+	test_equal(mma8451q_drdy_stats.overruns, 1);
+	test_equal(mma8451q_drdy_stats.unconsumed, 1);
+
+	test_assert(MMA8451Q_DrdyTake(&sample));
+	test_equal(sample.sequence, 2);
+	test_equal(sample.acc.x, 4);
+}
+
+static void test_queue(void)
+{
+	mma8451q_sample_t sample;
+
+	setup(MMA8451Q_I2CADDR);
+
+	/* the newest is taken, yet every sample stays queued in order */
+	for (int i = 1; i <= 3; ++i) {
+		sensor_sample(0x0F, i, -i, 10 * i);
+		host_cycles = 1000 * i;
+		MMA8451Q_DrdyRead();
+		I2C_HalSimRun();
+	}
+	test_assert(MMA8451Q_DrdyTake(&sample));
+	test_equal(sample.sequence, 3);
+
+	for (int i = 1; i <= 3; ++i) {
+		test_assert(MMA8451Q_DrdyPop(&sample));
+		test_equal(sample.sequence, i);
+		test_equal(sample.timestamp, 1000 * i);
+		test_equal(sample.acc.x, i);
+		test_equal(sample.acc.z, 10 * i);
+	}
+	test_assert(!MMA8451Q_DrdyPop(&sample));
+
+	/* nobody pops: the queue fills and the newest samples are dropped */
+	for (int i = 0; i < MMA8451Q_DRDY_QUEUE_LENGTH + 2; ++i) {
+		MMA8451Q_DrdyRead();
+		I2C_HalSimRun();
+	}
+	test_equal(mma8451q_drdy_stats.dropped, 2);
+	test_assert(MMA8451Q_DrdyPop(&sample));
+	test_equal(sample.sequence, 4);
+}
+
+static void test_error(void)
+{
+	mma8451q_sample_t sample;
+
+	setup(0x00);
+	MMA8451Q_DrdyRead();
+	I2C_HalSimRun();
+
+	/* nobody answers: the read is re-issued a bounded number of times, then given up on */
+	test_equal(mma8451q_drdy_stats.errors, 1 + MMA8451Q_DRDY_RETRIES);
+	test_equal(mma8451q_drdy_stats.retries, MMA8451Q_DRDY_RETRIES);
+	test_equal(mma8451q_drdy_stats.abandoned, 1);
+	test_equal(mma8451q_drdy_stats.samples, 0);
+	test_assert(!MMA8451Q_DrdyTake(&sample));
+	test_assert(I2C_IrqIdle(&i2c0_engine));
+}
+
+static void test_retry(void)
+{
+	mma8451q_sample_t sample;
+
+	setup(MMA8451Q_I2CADDR);
+
+	/* a slave holding SDA loses the read its arbitration; the unread sample keeps INT2 low and
+	 * raises no further edge, so the retry alone keeps the sampling going */
+	sensor_sample(0x0F, 10, 20, 30);
+	sim.stuck = 3;
+	host_cycles = 48000;
+	MMA8451Q_DrdyRead();
+	host_cycles = 50000;
+	I2C_HalSimRun();
+
+	test_equal(mma8451q_drdy_stats.errors, 1);
+	test_equal(mma8451q_drdy_stats.retries, 1);
+	test_equal(mma8451q_drdy_stats.abandoned, 0);
+	test_equal(mma8451q_drdy_stats.samples, 1);
+	test_assert(MMA8451Q_DrdyTake(&sample));
+	test_equal(sample.acc.x, 10);
+	test_equal(sample.timestamp, 48000);
+
+	/* and the next edge is served as ever */
+	sensor_sample(0x0F, 11, 21, 31);
+	MMA8451Q_DrdyRead();
+	I2C_HalSimRun();
+	test_equal(mma8451q_drdy_stats.samples, 2);
+	test_equal(mma8451q_drdy_stats.errors, 1);
+	test_assert(MMA8451Q_DrdyTake(&sample));
+	test_equal(sample.acc.x, 11);
+}
+
+static void test_stuck(void)
+{
+	mma8451q_sample_t sample;
+
+	setup(MMA8451Q_I2CADDR);
+	sensor_sample(0x0F, 1, 2, 3);
+
+	/* a slave stretching SCL for good: the read never raises another interrupt */
+	sim.stall = true;
+	MMA8451Q_DrdyRead();
+	I2C_HalSimRun();
+	test_assert(!I2C_IrqIdle(&i2c0_engine));
+
+	/* the next edge does not spin on it forever: out of its budget it is aborted and the bus
+	 * recovered, the retry reads the sample, then the edge its own */
+	host_cycles += I2C_BUS_US_TO_CYCLES(I2C_BUS_TIMEOUT_US(7 + I2C_BUS_OVERHEAD_BYTES));
+	MMA8451Q_DrdyRead();
+	test_equal(mma8451q_drdy_stats.errors, 1);
+	test_equal(mma8451q_drdy_stats.retries, 1);
+	test_equal(i2c_bus_stats.timeouts, 1);
+	test_equal(mma8451q_drdy_stats.samples, 1);
+
+	I2C_HalSimRun();
+	test_equal(mma8451q_drdy_stats.samples, 2);
+	test_assert(MMA8451Q_DrdyTake(&sample));
+	test_equal(sample.acc.z, 3);
+}
+
+int main(void)
+{
+	test_sample();
+	test_overrun();
+	test_queue();
+	test_error();
+	test_retry();
+	test_stuck();
+
+	printf("%s: passed %d/%d test cases\n", __FILE__, g_tests_passed, g_tests_total);
+	return (g_tests_passed == g_tests_total) ? 0 : 1;
+}
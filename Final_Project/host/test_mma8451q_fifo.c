@@ -0,0 +1,232 @@
+/*
+ * test_mma8451q_fifo.c
+ *
+ *  Created on: Dec 16, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host test cases for the MMA8451Q FIFO batch acquisition, run against a model of
+ *   		the FIFO read port behind the simulated I2C register block of sim_i2c.c
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "mma8451q_fifo.h"
+#include "i2c_hal_sim.h"
+#include "i2c_bus.h"
+#include "systick_host.h"
+#include "test_host.h"
+
+static int g_tests_passed = 0;
+static int g_tests_total = 0;
+static int g_skip_tests = 0;
+
+static sim_i2c_t sim;
+
+/*
+ * @brief FIFO model: queued samples, oldest first
+ */
+static struct {
+	int16_t samples[64][3];
+	int head;
+	int count;
+	bool overflow;
+	uint8_t watermark;
+} fifo;
+
+/*
+ * @brief Reads F_STATUS at 0x00 and pops samples through OUT_X_MSB .. OUT_Z_LSB, wrapping back to 0x01
+ */
+static uint8_t fifo_read(sim_i2c_t *sim)
+{
+	if (sim->pointer == MMA8451Q_REG_F_STATUS) {
+		sim->pointer = MMA8451Q_REG_OUT_X_MSB;
+		return (fifo.overflow ? 0x80 : 0) | ((fifo.count >= fifo.watermark) ? 0x40 : 0) | fifo.count;
+	}
+
+	const int offset = sim->pointer - MMA8451Q_REG_OUT_X_MSB;
+	const uint16_t raw = (uint16_t)((uint16_t)fifo.samples[fifo.head][offset / 2] << 2);
+	const uint8_t value = (offset & 1) ? (raw & 0xFF) : (raw >> 8);
+
+	if (++sim->pointer > MMA8451Q_REG_OUT_X_MSB + 5) {
+		sim->pointer = MMA8451Q_REG_OUT_X_MSB;
+		fifo.head++;
+		fifo.count--;
+	}
+	return value;
+}
+
+static void fifo_fill(int count, uint8_t watermark)
+{
+	memset(&fifo, 0, sizeof(fifo));
+	fifo.count = count;
+	fifo.watermark = watermark;
+	for (int i = 0; i < count; ++i) {
+		fifo.samples[i][0] = 100 * i;
+		fifo.samples[i][1] = -100 * i - 1;
+		fifo.samples[i][2] = 4096 - i;
+	}
+}
+
+static void setup(uint8_t slaveId, uint8_t watermark)
+{
+	SimI2C_Init(&sim, slaveId);
+	sim.read = fifo_read;
+	I2C_HalSimAttach(&sim);
+	MMA8451Q_FifoStart(watermark);
+}
+
+static void test_batch(void)
+{
+	setup(MMA8451Q_I2CADDR, 4);
+	fifo_fill(5, 4);
+	test_assert(MMA8451Q_FifoTake() == 0);
+
+	/* one watermark interrupt: one transaction for four samples, stamped when queued */
+	host_cycles = 1000 * 48;
+	MMA8451Q_FifoDrain();
+	I2C_HalSimRun();
+
+	const mma8451q_fifo_batch_t *batch = MMA8451Q_FifoTake();
+	test_assert(batch != 0);
+	test_equal(batch->count, 4);
+	test_equal(batch->sequence, 1);
+	test_equal(batch->timestamp, 1000);
+	test_equal(MMA8451Q_F_STATUS_CNT(batch->status), 5);
+	test_assert(MMA8451Q_F_STATUS_WMRK(batch->status));
+	for (int i = 0; i < 4; ++i) {
+		test_equal(batch->samples[i][0], 100 * i);
+		test_equal(batch->samples[i][1], -100 * i - 1);
+		test_equal(batch->samples[i][2], 4096 - i);
+	}
+	test_assert(MMA8451Q_FifoTake() == 0);
+
+	/* W-address, register, R-address, F_STATUS and 4 x 6 data bytes */
+	test_equal(sim.starts, 2);
+	test_equal(sim.stops, 1);
+	test_equal(sim.bytes, 3 + 1 + 4 * MMA8451Q_FIFO_SAMPLE_SIZE);
+	test_equal(fifo.count, 1);
+
+	test_equal(mma8451q_fifo_stats.batches, 1);
+	test_equal(mma8451q_fifo_stats.samples, 4);
+	test_equal(mma8451q_fifo_stats.overflows, 0);
+	test_equal(mma8451q_fifo_stats.errors, 0);
+
+	/* the next batch goes to the other buffer */
+	fifo_fill(4, 4);
+	host_cycles = 5000 * 48;
+	MMA8451Q_FifoDrain();
+	I2C_HalSimRun();
+	const mma8451q_fifo_batch_t *next = MMA8451Q_FifoTake();
+	test_assert(next != 0);
+	test_assert(next != batch);
+	test_equal(next->sequence, 2);
+	test_equal(next->timestamp, 5000);
+	test_equal(batch->timestamp, 1000);
+}
+
+static void test_backlog(void)
+{
+	setup(MMA8451Q_I2CADDR, 4);
+	fifo_fill(9, 4);
+	fifo.overflow = true;
+
+	/* two batches were waiting behind a single edge: both are fetched */
+	MMA8451Q_FifoDrain();
+	I2C_HalSimRun();
+
+	test_equal(mma8451q_fifo_stats.batches, 2);
+	test_equal(mma8451q_fifo_stats.overflows, 2);
+	test_equal(sim.stops, 2);
+	test_equal(fifo.count, 1);
+
+	const mma8451q_fifo_batch_t *batch = MMA8451Q_FifoTake();
+	test_assert(batch != 0);
+	test_equal(batch->sequence, 2);
+	test_equal(batch->samples[0][0], 400);
+	test_equal(batch->samples[3][2], 4096 - 7);
+}
+
+static void test_error(void)
+{
+	setup(0x00, 4);
+	fifo_fill(4, 4);
+
+	MMA8451Q_FifoDrain();
+	I2C_HalSimRun();
+
+	/* nobody answers: the burst is re-issued a bounded number of times, then given up on */
+	test_equal(mma8451q_fifo_stats.errors, 1 + MMA8451Q_FIFO_RETRIES);
+	test_equal(mma8451q_fifo_stats.retries, MMA8451Q_FIFO_RETRIES);
+	test_equal(mma8451q_fifo_stats.abandoned, 1);
+	test_equal(mma8451q_fifo_stats.batches, 0);
+	test_assert(MMA8451Q_FifoTake() == 0);
+	test_assert(I2C_IrqIdle(&i2c0_engine));
+}
+
+static void test_retry(void)
+{
+	setup(MMA8451Q_I2CADDR, 4);
+	fifo_fill(4, 4);
+
+	/* a slave holding SDA loses the burst its arbitration; INT2 stays asserted and raises no
+	 * further edge, so the retry alone keeps the acquisition going */
+	sim.stuck = 3;
+	MMA8451Q_FifoDrain();
+	I2C_HalSimRun();
+
+	test_equal(mma8451q_fifo_stats.errors, 1);
+	test_equal(mma8451q_fifo_stats.retries, 1);
+	test_equal(mma8451q_fifo_stats.abandoned, 0);
+	test_equal(mma8451q_fifo_stats.batches, 1);
+	const mma8451q_fifo_batch_t *batch = MMA8451Q_FifoTake();
+	test_assert(batch != 0);
+	test_equal(batch->samples[3][2], 4096 - 3);
+	test_equal(fifo.count, 0);
+
+	/* and the next edge is served as ever */
+	fifo_fill(4, 4);
+	MMA8451Q_FifoDrain();
+	I2C_HalSimRun();
+	test_equal(mma8451q_fifo_stats.batches, 2);
+	test_equal(mma8451q_fifo_stats.errors, 1);
+}
+
+static void test_stuck(void)
+{
+	setup(MMA8451Q_I2CADDR, 4);
+	fifo_fill(7, 4);
+
+	/* a slave stretching SCL for good: the burst never raises another interrupt */
+	sim.stall = true;
+	MMA8451Q_FifoDrain();
+	I2C_HalSimRun();
+	test_assert(!I2C_IrqIdle(&i2c0_engine));
+
+	/* the next edge does not spin on it forever: out of its budget it is aborted and the bus
+	 * recovered, the retry fetches the batch, then the edge its own */
+	host_cycles += I2C_BUS_US_TO_CYCLES(I2C_BUS_TIMEOUT_US(1 + 4 * MMA8451Q_FIFO_SAMPLE_SIZE + I2C_BUS_OVERHEAD_BYTES));
+	MMA8451Q_FifoDrain();
+	test_equal(mma8451q_fifo_stats.errors, 1);
+	test_equal(mma8451q_fifo_stats.retries, 1);
+	test_equal(i2c_bus_stats.timeouts, 1);
+
+	I2C_HalSimRun();
+	test_equal(mma8451q_fifo_stats.batches, 2);
+	const mma8451q_fifo_batch_t *batch = MMA8451Q_FifoTake();
+	test_assert(batch != 0);
+	test_equal(batch->sequence, 2);
+	test_equal(batch->samples[0][0], 400);
+}
+
+int main(void)
+{
+	test_batch();
+	test_backlog();
+	test_error();
+	test_retry();
+	test_stuck();
+
+	printf("%s: passed %d/%d test cases\n", __FILE__, g_tests_passed, g_tests_total);
+	return (g_tests_passed == g_tests_total) ? 0 : 1;
+}
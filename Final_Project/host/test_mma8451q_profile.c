@@ -0,0 +1,381 @@
+/*
+ * test_mma8451q_profile.c
+ *
+ *  Created on: Dec 31, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host test cases for the MMA8451Q profile: records saved and found again, the
+ *   		sectors worn in turn, corrupt, torn and foreign records passed over, a profile
+ *   		applied after a reset without reading the device, and the offset calibration
+ *   		against the model of sim_mma8451q.c with a biased part, still, moving and
+ *   		upside down. The flash of nvm.h is an array with the rules of NOR flash.
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "mma8451q_profile.h"
+#include "nvm.h"
+#include "crc16.h"
+#include "sim_mma8451q.h"
+#include "i2c_hal_sim.h"
+#include "test_host.h"
+
+static int g_tests_passed = 0;
+static int g_tests_total = 0;
+static int g_skip_tests = 0;
+
+/*
+ * The flash of nvm.h
+ */
+
+#define SECTORS		(NVM_SIZE / NVM_SECTOR_SIZE)
+#define FIRST		((NVM_PROFILE_BASE - NVM_BASE) / NVM_SECTOR_SIZE)
+
+nvm_stats_t nvm_stats;
+static uint64_t words[NVM_SIZE / sizeof(uint64_t)];
+static uint8_t *const flash = (uint8_t *)words;
+static uint32_t erases[SECTORS];
+
+bool Nvm_Init()
+{
+	return true;
+}
+
+bool Nvm_Erase(uint32_t address)
+{
+	memset(&flash[address - NVM_BASE], 0xFF, NVM_SECTOR_SIZE);
+	erases[(address - NVM_BASE) / NVM_SECTOR_SIZE]++;
+	nvm_stats.erases++;
+	return true;
+}
+
+bool Nvm_Program(uint32_t address, const uint32_t *data, uint32_t length)
+{
+	const uint8_t *bytes = (const uint8_t *)data;
+	uint8_t *at = &flash[address - NVM_BASE];
+	bool ok = (address % NVM_WRITE_SIZE == 0) && (length % NVM_WRITE_SIZE == 0);
+
+	for (uint32_t i = 0; ok && (i < length); ++i) {
+		ok = (bytes[i] & ~at[i]) == 0;
+		at[i] &= bytes[i];
+	}
+	if (!ok) {
+		nvm_stats.errors++;
+		return false;
+	}
+	nvm_stats.programs++;
+	nvm_stats.bytes += length;
+	return true;
+}
+
+const uint8_t *Nvm_Map(uint32_t address)
+{
+	return &flash[address - NVM_BASE];
+}
+
+/*
+ * Helpers
+ */
+
+static sim_i2c_t sim;
+static sim_mma8451q_t model;
+
+static void power_on(int erase_flash)
+{
+	if (erase_flash) {
+		memset(flash, 0xFF, NVM_SIZE);
+		memset(erases, 0, sizeof(erases));
+	}
+	memset(&nvm_stats, 0, sizeof(nvm_stats));
+	memset(&mma8451q_profile_stats, 0, sizeof(mma8451q_profile_stats));
+
+	SimI2C_Init(&sim, MMA8451Q_I2CADDR);
+	SimMma8451q_Init(&model, &sim);
+	I2C_HalSimAttach(&sim);
+	MMA8451Q_ShadowInvalidate();
+}
+
+static const mma8451q_profile_header_t *slot_header(int slot)
+{
+	return (const mma8451q_profile_header_t *)&flash[(NVM_PROFILE_BASE - NVM_BASE) + slot * MMA8451Q_PROFILE_RECORD_SIZE];
+}
+
+/* a configuration telling its number in the offsets */
+static mma8451q_confreg_t numbered(uint8_t number)
+{
+	mma8451q_confreg_t configuration;
+
+	memset(&configuration, 0, sizeof(configuration));
+	configuration.CTRL_REG1 = 0x05;
+	configuration.CTRL_REG4 = 0x44;
+	configuration.OFF_X = number;
+	configuration.OFF_Y = (uint8_t)~number;
+	return configuration;
+}
+
+/* the configuration of the firmware at 800 Hz with motion detection, active */
+static void configure(void)
+{
+	MMA8451Q_Reset();
+	MMA8451Q_ShadowReset();
+	MMA8451Q_WriteRegister(MMA8451Q_REG_FF_MT_CFG, 0xD8);
+	MMA8451Q_WriteRegister(MMA8451Q_REG_FF_MT_THS, 0x20);
+	MMA8451Q_WriteRegister(MMA8451Q_REG_CTRL_REG1, 0x05);
+	MMA8451Q_Flush();
+}
+
+/* n samples of the model in milli-g, read back as the acquisition would and handed to the calibration */
+static void calibrate_on(int n, int32_t x, int32_t y, int32_t z, int32_t wobble)
+{
+	for (int k = 0; k < n; ++k) {
+		const int32_t swing = (k & 1) ? wobble : -wobble;
+		const int32_t ug[3] = { 1000 * (x + swing), 1000 * y, 1000 * z };
+		mma8451q_acc_t acc;
+
+		SimMma8451q_Sample(&model, ug);
+		MMA8451Q_ReadAcceleration14bitNoFifo(&acc);
+		const int16_t xyz[1][3] = { { acc.x, acc.y, acc.z } };
+		MMA8451Q_CalibrateRecord(xyz, 1);
+	}
+}
+
+static int16_t read_axis(int axis, int32_t x, int32_t y, int32_t z)
+{
+	const int32_t ug[3] = { 1000 * x, 1000 * y, 1000 * z };
+	mma8451q_acc_t acc;
+
+	SimMma8451q_Sample(&model, ug);
+	MMA8451Q_ReadAcceleration14bitNoFifo(&acc);
+	return acc.xyz[axis];
+}
+
+/*
+ * Tests
+ */
+
+static void test_save_load(void)
+{
+	mma8451q_confreg_t loaded;
+
+	power_on(1);
+
+	/* nothing in erased flash */
+	memset(&loaded, 0x5A, sizeof(loaded));
+	test_assert(!MMA8451Q_ProfileLoad(&loaded));
+	test_equal(loaded.OFF_X, 0x5A);
+	test_equal(mma8451q_profile_stats.rejected, 0);
+
+	/* a profile comes back as saved, ACTIVE clear */
+	mma8451q_confreg_t first = numbered(1);
+	test_assert(MMA8451Q_ProfileSave(&first));
+	test_equal(nvm_stats.programs, 1);
+	test_equal(nvm_stats.erases, 0);
+	test_equal(slot_header(0)->magic, MMA8451Q_PROFILE_MAGIC);
+	test_equal(slot_header(0)->sequence, 1);
+	test_equal(slot_header(0)->version, MMA8451Q_PROFILE_VERSION);
+	test_equal(slot_header(0)->size, sizeof(mma8451q_confreg_t));
+	test_assert(MMA8451Q_ProfileLoad(&loaded));
+	first.CTRL_REG1 &= ~0x01;
+	test_assert(memcmp(&loaded, &first, sizeof(loaded)) == 0);
+	test_equal(loaded.CTRL_REG1, 0x04);
+
+	/* the next goes into the next slot and is the one found */
+	mma8451q_confreg_t second = numbered(2);
+	test_assert(MMA8451Q_ProfileSave(&second));
+	test_equal(slot_header(1)->sequence, 2);
+	test_assert(MMA8451Q_ProfileLoad(&loaded));
+	test_equal(loaded.OFF_X, 2);
+	test_equal(mma8451q_profile_stats.loads, 2);
+	test_equal(mma8451q_profile_stats.saves, 2);
+
+	/* the records cover the header and the configuration with the CRC */
+	const uint8_t *record = (const uint8_t *)slot_header(1);
+	uint16_t crc = CRC16_Compute(record, MMA8451Q_PROFILE_CRC_OFFSET);
+	crc = CRC16_Update(crc, record + MMA8451Q_PROFILE_HEADER_SIZE, sizeof(mma8451q_confreg_t));
+	test_equal(crc, slot_header(1)->crc);
+}
+
+static void test_wear(void)
+{
+	mma8451q_confreg_t loaded;
+
+	power_on(1);
+
+	/* three rounds through every slot: a sector is erased as the records enter it again */
+	for (int n = 1; n <= 3 * MMA8451Q_PROFILE_SLOTS; ++n) {
+		mma8451q_confreg_t configuration = numbered((uint8_t)n);
+		test_assert(MMA8451Q_ProfileSave(&configuration));
+		test_assert(MMA8451Q_ProfileLoad(&loaded));
+		test_equal(loaded.OFF_X, (uint8_t)n);
+	}
+	for (int sector = FIRST; sector < FIRST + NVM_PROFILE_SECTORS; ++sector) {
+		test_equal(erases[sector], 2);
+	}
+	test_equal(erases[FIRST - 1], 0);
+	test_equal(nvm_stats.programs, 3 * MMA8451Q_PROFILE_SLOTS);
+
+	/* a restart carries on after the newest */
+	power_on(0);
+	test_assert(MMA8451Q_ProfileLoad(&loaded));
+	test_equal(loaded.OFF_X, (uint8_t)(3 * MMA8451Q_PROFILE_SLOTS));
+	mma8451q_confreg_t configuration = numbered(7);
+	test_assert(MMA8451Q_ProfileSave(&configuration));
+	test_equal(slot_header(0)->sequence, 3 * MMA8451Q_PROFILE_SLOTS + 1);
+}
+
+static void test_rejected(void)
+{
+	mma8451q_confreg_t loaded;
+
+	power_on(1);
+	for (uint8_t n = 1; n <= 3; ++n) {
+		mma8451q_confreg_t configuration = numbered(n);
+		test_assert(MMA8451Q_ProfileSave(&configuration));
+	}
+
+	/* a bit flipped in the newest: the one before is applied */
+	flash[(NVM_PROFILE_BASE - NVM_BASE) + 2 * MMA8451Q_PROFILE_RECORD_SIZE + MMA8451Q_PROFILE_HEADER_SIZE + 3] ^= 0x01;
+	test_assert(MMA8451Q_ProfileLoad(&loaded));
+	test_equal(loaded.OFF_X, 2);
+	test_equal(mma8451q_profile_stats.rejected, 1);
+
+	/* a newer record of another acquisition is not applied either */
+	uint32_t image[MMA8451Q_PROFILE_RECORD_SIZE / sizeof(uint32_t)];
+	memcpy(image, slot_header(1), sizeof(image));
+	mma8451q_profile_header_t *header = (mma8451q_profile_header_t *)image;
+	header->sequence = 9;
+	header->build ^= 0x0100;
+	header->crc = CRC16_Update(CRC16_Compute((const uint8_t *)image, MMA8451Q_PROFILE_CRC_OFFSET),
+			(const uint8_t *)image + MMA8451Q_PROFILE_HEADER_SIZE, sizeof(mma8451q_confreg_t));
+	test_assert(Nvm_Program(NVM_PROFILE_BASE + 3 * MMA8451Q_PROFILE_RECORD_SIZE, image, sizeof(image)));
+	mma8451q_profile_stats.rejected = 0;
+	test_assert(MMA8451Q_ProfileLoad(&loaded));
+	test_equal(loaded.OFF_X, 2);
+	test_equal(mma8451q_profile_stats.rejected, 2);
+
+	/* a torn write in the slot ahead is passed over */
+	memset(&flash[(NVM_PROFILE_BASE - NVM_BASE) + 4 * MMA8451Q_PROFILE_RECORD_SIZE], 0x00, 8);
+	mma8451q_confreg_t configuration = numbered(4);
+	test_assert(MMA8451Q_ProfileSave(&configuration));
+	test_equal(slot_header(2)->sequence, 3);
+	test_equal(slot_header(5)->sequence, 3);
+	test_assert(MMA8451Q_ProfileLoad(&loaded));
+	test_equal(loaded.OFF_X, 4);
+	test_equal(nvm_stats.erases, 0);
+}
+
+static void test_apply(void)
+{
+	mma8451q_confreg_t profile;
+
+	power_on(1);
+	configure();
+	MMA8451Q_WriteRegister(MMA8451Q_REG_OFF_X, 0xF6);
+	MMA8451Q_WriteRegister(MMA8451Q_REG_OFF_X + 2, 0x05);
+	MMA8451Q_Flush();
+	MMA8451Q_FetchConfiguration(&profile);
+	test_assert(MMA8451Q_ProfileSave(&profile));
+
+	/* start-up: reset, and the profile stored over the reset values without reading them */
+	power_on(0);
+	test_assert(MMA8451Q_ProfileLoad(&profile));
+	MMA8451Q_Reset();
+	MMA8451Q_ShadowReset();
+	const uint32_t reads = sim.reads;
+	const uint32_t transactions = mma8451q_store_stats.transactions;
+	MMA8451Q_StoreConfiguration(&profile);
+	MMA8451Q_EnterActiveMode();
+	test_equal(sim.reads, reads);
+
+	/* FF_MT_CFG; FF_MT_THS; CTRL_REG1 in standby; OFF_X to OFF_Z in one burst; then active */
+	test_equal(mma8451q_store_stats.transactions - transactions, 5);
+	test_equal(sim.memory[MMA8451Q_REG_FF_MT_CFG], 0xD8);
+	test_equal(sim.memory[MMA8451Q_REG_FF_MT_THS], 0x20);
+	test_equal(sim.memory[MMA8451Q_REG_CTRL_REG1], 0x05);
+	test_equal(sim.memory[MMA8451Q_REG_OFF_X], 0xF6);
+	test_equal(sim.memory[MMA8451Q_REG_OFF_X + 1], 0x00);
+	test_equal(sim.memory[MMA8451Q_REG_OFF_X + 2], 0x05);
+	test_equal(sim.memory[MMA8451Q_REG_PL_CFG], 0x80);
+	test_equal(MMA8451Q_ShadowDirty(), 0);
+}
+
+static void test_calibrate(void)
+{
+	mma8451q_confreg_t loaded;
+
+	power_on(1);
+	configure();
+
+	/* nothing happens before the samples are in */
+	MMA8451Q_CalibrateStart();
+	calibrate_on(MMA8451Q_CALIBRATE_SAMPLES - 1, 40, -30, 1020, 2);
+	MMA8451Q_CalibratePoll();
+	test_equal(sim.memory[MMA8451Q_REG_OFF_X], 0);
+	test_equal(mma8451q_profile_stats.saves, 0);
+
+	/* a part off by 40, -30 and 20 mg: offsets of 2 mg against it, and samples at 0 g, 0 g and 1 g after */
+	calibrate_on(1, 40, -30, 1020, 2);
+	calibrate_on(10, 500, 500, 0, 0);
+	MMA8451Q_CalibratePoll();
+	test_equal((int8_t)sim.memory[MMA8451Q_REG_OFF_X], -20);
+	test_equal((int8_t)sim.memory[MMA8451Q_REG_OFF_X + 1], 15);
+	test_equal((int8_t)sim.memory[MMA8451Q_REG_OFF_X + 2], -10);
+	test_equal(mma8451q_profile_stats.calibrations, 1);
+	test_equal(read_axis(0, 40, -30, 1020), 0);
+	test_equal(read_axis(1, 40, -30, 1020), 0);
+	test_equal(read_axis(2, 40, -30, 1020), 4096);
+
+	/* the device is active again and the profile holds the offsets */
+	test_equal(sim.memory[MMA8451Q_REG_CTRL_REG1], 0x05);
+	test_equal(mma8451q_profile_stats.saves, 1);
+	test_assert(MMA8451Q_ProfileLoad(&loaded));
+	test_equal((int8_t)loaded.OFF_X, -20);
+	test_equal((int8_t)loaded.OFF_Z, -10);
+	test_equal(loaded.FF_MT_CFG, 0xD8);
+
+	/* a second one finds the offsets right and keeps them */
+	MMA8451Q_CalibrateStart();
+	calibrate_on(MMA8451Q_CALIBRATE_SAMPLES, 40, -30, 1020, 2);
+	MMA8451Q_CalibratePoll();
+	test_equal((int8_t)sim.memory[MMA8451Q_REG_OFF_X], -20);
+	test_equal((int8_t)sim.memory[MMA8451Q_REG_OFF_X + 1], 15);
+	test_equal(mma8451q_profile_stats.saves, 2);
+}
+
+static void test_moved(void)
+{
+	power_on(1);
+	configure();
+
+	/* a board shaking by 20 mg is given up */
+	MMA8451Q_CalibrateStart();
+	calibrate_on(MMA8451Q_CALIBRATE_SAMPLES, 40, -30, 1020, 20);
+	MMA8451Q_CalibratePoll();
+	test_equal(mma8451q_profile_stats.moved, 1);
+	test_equal(sim.memory[MMA8451Q_REG_OFF_X], 0);
+	test_equal(mma8451q_profile_stats.saves, 0);
+
+	/* upside down the offsets would be out of range */
+	MMA8451Q_CalibrateStart();
+	calibrate_on(MMA8451Q_CALIBRATE_SAMPLES, 0, 0, -1000, 0);
+	MMA8451Q_CalibratePoll();
+	test_equal(mma8451q_profile_stats.moved, 2);
+	test_equal(sim.memory[MMA8451Q_REG_OFF_X + 2], 0);
+	test_equal(mma8451q_profile_stats.calibrations, 0);
+	test_equal(nvm_stats.programs, 0);
+}
+
+int main(void)
+{
+	test_save_load();
+	test_wear();
+	test_rejected();
+	test_apply();
+	test_calibrate();
+	test_moved();
+
+	printf("%s: passed %d/%d test cases\n", __FILE__, g_tests_passed, g_tests_total);
+	return (g_tests_passed == g_tests_total) ? 0 : 1;
+}
@@ -0,0 +1,332 @@
+/*
+ * test_mma8451q_shadow.c
+ *
+ *  Created on: Dec 19, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host test cases for the MMA8451Q register shadow of mma8451q.c: configuration
+ *   		reads served from RAM, changes as single writes, the shadow following
+ *   		resets, and configuration commits written as bursts of the changed registers.
+ *   		The driver runs through the simulated I2C backend; the register file of
+ *   		sim_i2c.c plays the device and the transactions and bytes on the bus are counted.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "mma8451q.h"
+#include "i2c_hal_sim.h"
+#include "test_host.h"
+
+static int g_tests_passed = 0;
+static int g_tests_total = 0;
+static int g_skip_tests = 0;
+
+static sim_i2c_t sim;
+
+/*
+ * @brief The device registers, and the data bytes written to them
+ */
+static uint8_t *const device = sim.memory;
+static int written;
+
+/*
+ * @brief Register file writes, with the software reset of CTRL_REG2
+ */
+static void device_write(sim_i2c_t *sim, uint8_t value)
+{
+	written++;
+	sim->memory[sim->pointer++] = value;
+	if ((sim->pointer - 1 == MMA8451Q_REG_CTRL_REG2) && (value & 0x40)) {
+		memset(sim->memory, 0, sizeof(sim->memory));
+		sim->memory[MMA8451Q_REG_WHOAMI] = 0x1A;
+	}
+}
+
+/*
+ * @brief Read and write transactions so far, and the bytes of the writes with slave and register address
+ */
+static int reads(void)
+{
+	return sim.reads;
+}
+
+static int writes(void)
+{
+	return sim.stops - sim.reads;
+}
+
+static int bytes(void)
+{
+	return written + 2 * writes();
+}
+
+static void setup(void)
+{
+	SimI2C_Init(&sim, MMA8451Q_I2CADDR);
+	sim.write = device_write;
+	I2C_HalSimAttach(&sim);
+	device[MMA8451Q_REG_WHOAMI] = 0x1A;
+	device[MMA8451Q_REG_CTRL_REG1] = 0x01;
+	MMA8451Q_ShadowInvalidate();
+	memset(&mma8451q_store_stats, 0, sizeof(mma8451q_store_stats));
+	written = 0;
+}
+
+static void test_reads(void)
+{
+	setup();
+
+	/* the first read of a register goes to the bus, the others do not */
+	test_equal(MMA8451Q_WhoAmI(), 0x1A);
+	test_equal(MMA8451Q_WhoAmI(), 0x1A);
+	test_equal(MMA8451Q_LandscapePortraitConfig(), 0);
+	test_equal(MMA8451Q_LandscapePortraitConfig(), 0);
+	test_equal(reads(), 2);
+
+	/* status keeps coming from the device */
+	device[MMA8451Q_REG_SYSMOD] = 1;
+	test_equal(MMA8451Q_ReadRegister(MMA8451Q_REG_SYSMOD), 1);
+	device[MMA8451Q_REG_SYSMOD] = 2;
+	test_equal(MMA8451Q_ReadRegister(MMA8451Q_REG_SYSMOD), 2);
+	test_equal(MMA8451Q_ReadRegister(MMA8451Q_REG_TRANSIENT_SCR), 0);
+	test_equal(MMA8451Q_ReadRegister(MMA8451Q_REG_INT_SOURCE), 0);
+	test_equal(reads(), 6);
+}
+
+static void test_modify(void)
+{
+	setup();
+	device[MMA8451Q_REG_CTRL_REG1] = 0x00;
+
+	/* a register never seen costs one read, from then on every change is a single write */
+	MMA8451Q_SetDataRate(MMA8451Q_CONFIGURE_DIRECT, MMA8451Q_DATARATE_800Hz, MMA8451Q_LOWNOISE_ENABLED);
+	test_equal(reads(), 1);
+	test_equal(writes(), 1);
+	test_equal(device[MMA8451Q_REG_CTRL_REG1], 0x04);
+
+	MMA8451Q_SetDataRate(MMA8451Q_CONFIGURE_DIRECT, MMA8451Q_DATARATE_100Hz, MMA8451Q_LOWNOISE_ENABLED);
+	test_equal(reads(), 1);
+	test_equal(writes(), 2);
+	test_equal(device[MMA8451Q_REG_CTRL_REG1], (MMA8451Q_DATARATE_100Hz << 3) | 0x04);
+
+	/* no change, no write */
+	MMA8451Q_SetDataRate(MMA8451Q_CONFIGURE_DIRECT, MMA8451Q_DATARATE_100Hz, MMA8451Q_LOWNOISE_ENABLED);
+	MMA8451Q_EnterPassiveMode();
+	test_equal(writes(), 2);
+
+	/* two adjacent registers: one burst, after reading each once */
+	MMA8451Q_ConfigureInterrupt(MMA8451Q_CONFIGURE_DIRECT, MMA8451Q_INT_DRDY, MMA8451Q_INTPIN_INT1);
+	test_equal(reads(), 3);
+	test_equal(writes(), 3);
+	test_equal(bytes(), 3 + 3 + 4);
+	test_equal(device[MMA8451Q_REG_CTRL_REG4], 1 << MMA8451Q_INT_DRDY);
+	test_equal(device[MMA8451Q_REG_CTRL_REG5], 1 << MMA8451Q_INT_DRDY);
+
+	/* to INT2: only CTRL_REG5 changes */
+	MMA8451Q_ConfigureInterrupt(MMA8451Q_CONFIGURE_DIRECT, MMA8451Q_INT_DRDY, MMA8451Q_INTPIN_INT2);
+	test_equal(reads(), 3);
+	test_equal(writes(), 4);
+	test_equal(device[MMA8451Q_REG_CTRL_REG5], 0);
+
+	MMA8451Q_SetInterruptMode(MMA8451Q_CONFIGURE_DIRECT, MMA8451Q_INTMODE_OPENDRAIN, MMA8451Q_INTPOL_ACTIVELOW);
+	MMA8451Q_SetOversampling(MMA8451Q_CONFIGURE_DIRECT, MMA8451Q_OVERSAMPLING_HIGHRESOLUTION);
+	MMA8451Q_SetFifo(MMA8451Q_CONFIGURE_DIRECT, MMA8451Q_FIFOMODE_CIRCULAR, 16);
+
+	/* nothing left over */
+	test_equal(MMA8451Q_ShadowDirty(), 0);
+	test_equal(reads(), 5);
+	test_equal(writes(), 7);
+}
+
+static void test_standby(void)
+{
+	setup();
+
+	/* the ACTIVE bit alone is a single write either way */
+	MMA8451Q_EnterActiveMode();
+	test_equal(writes(), 0);
+	MMA8451Q_EnterPassiveMode();
+	test_equal(device[MMA8451Q_REG_CTRL_REG1], 0x00);
+	MMA8451Q_EnterActiveMode();
+	test_equal(device[MMA8451Q_REG_CTRL_REG1], 0x01);
+	test_equal(writes(), 2);
+
+	/* anything else while active: standby, the bursts 0x15, 0x17 .. 0x18 and 0x2D .. 0x2E, active again */
+	MMA8451Q_SetMotion(MMA8451Q_CONFIGURE_DIRECT);
+	test_equal(writes(), 2 + 5);
+	test_equal(bytes(), 2 * 3 + 3 + 3 + 4 + 4 + 3);
+	test_equal(device[MMA8451Q_REG_CTRL_REG1], 0x01);
+	test_equal(device[MMA8451Q_REG_FF_MT_CFG], 0xD8);
+	test_equal(device[MMA8451Q_REG_FF_MT_THS], 0x1E);
+	test_equal(device[MMA8451Q_REG_FF_MT_COUNT], 0x0A);
+	test_equal(device[MMA8451Q_REG_CTRL_REG4], 0x04);
+	test_equal(device[MMA8451Q_REG_CTRL_REG5], 0x04);
+	test_equal(reads(), 1);
+
+	/* the same configuration again costs nothing */
+	MMA8451Q_SetMotion(MMA8451Q_CONFIGURE_DIRECT);
+	test_equal(writes(), 7);
+}
+
+static void test_store(void)
+{
+	mma8451q_confreg_t configuration;
+
+	setup();
+	memset(&configuration, 0, sizeof(configuration));
+	configuration.CTRL_REG1 = 0x01;
+	MMA8451Q_SetMotion(&configuration);
+	test_equal(writes(), 0);
+
+	/* nothing is known: every writable register, as the full rewrite did */
+	MMA8451Q_StoreConfiguration(&configuration);
+	test_equal(writes(), MMA8451Q_STORE_FULL_TRANSACTIONS);
+	test_equal(bytes(), MMA8451Q_STORE_FULL_BYTES);
+	test_equal(mma8451q_store_stats.transactions, MMA8451Q_STORE_FULL_TRANSACTIONS);
+	test_equal(mma8451q_store_stats.bytes, MMA8451Q_STORE_FULL_BYTES);
+	test_equal(mma8451q_store_stats.transactionsSaved, 0);
+	test_equal(mma8451q_store_stats.bytesSaved, 0);
+	test_equal(device[MMA8451Q_REG_FF_MT_THS], 0x1E);
+	test_equal(device[MMA8451Q_REG_CTRL_REG1], 0x01);
+	test_equal(reads(), 0);
+
+	/* unchanged: not a byte */
+	MMA8451Q_StoreConfiguration(&configuration);
+	test_equal(writes(), 9);
+	test_equal(mma8451q_store_stats.transactionsSaved, 9);
+	test_equal(mma8451q_store_stats.bytesSaved, 50);
+
+	/* two clean registers apart: one burst through them, within standby */
+	configuration.PULSE_THSX = 1;
+	configuration.PULSE_TMLT = 2;
+	MMA8451Q_StoreConfiguration(&configuration);
+	test_equal(writes(), 9 + 3);
+	test_equal(bytes(), 50 + 3 + (2 + 4) + 3);
+	test_equal(device[MMA8451Q_REG_CTRL_REG1], 0x01);
+	test_equal(device[0x26], 2);
+
+	/* three apart: two bursts */
+	configuration.PULSE_THSX = 3;
+	configuration.PULSE_LTCY = 4;
+	MMA8451Q_StoreConfiguration(&configuration);
+	test_equal(writes(), 12 + 4);
+	test_equal(device[0x23], 3);
+	test_equal(device[0x27], 4);
+
+	/* read-only registers split bursts: 0x0A and 0x0E are two */
+	configuration.TRIG_CFG = 0x04;
+	configuration.XYZ_DATA_CFG = 0x01;
+	MMA8451Q_StoreConfiguration(&configuration);
+	test_equal(writes(), 16 + 4);
+	test_equal(device[MMA8451Q_REG_SYSMOD], 0);
+
+	/* the mode alone needs no standby around it */
+	const int before = writes();
+	configuration.CTRL_REG1 = 0x00;
+	MMA8451Q_StoreConfiguration(&configuration);
+	test_equal(writes(), before + 1);
+	test_equal(device[MMA8451Q_REG_CTRL_REG1], 0x00);
+
+	/* in standby, other registers do not need a transition either */
+	configuration.CTRL_REG1 = 0x08;
+	configuration.OFF_X = 5;
+	MMA8451Q_StoreConfiguration(&configuration);
+	test_equal(writes(), before + 1 + 2);
+	test_equal(device[MMA8451Q_REG_CTRL_REG1], 0x08);
+	test_equal(device[0x2F], 5);
+	test_equal(mma8451q_store_stats.stores, 7);
+	test_equal(mma8451q_store_stats.transactions, writes());
+	test_equal(mma8451q_store_stats.bytes, bytes());
+	test_equal(mma8451q_store_stats.transactionsSaved, 7 * MMA8451Q_STORE_FULL_TRANSACTIONS - writes());
+	test_equal(mma8451q_store_stats.bytesSaved, 7 * MMA8451Q_STORE_FULL_BYTES - bytes());
+}
+
+static void test_deferred(void)
+{
+	setup();
+
+	/* changes wait in the shadow until flushed, reads() see them already */
+	MMA8451Q_WriteRegister(MMA8451Q_REG_FF_MT_THS, 0x1E);
+	MMA8451Q_ModifyRegister(MMA8451Q_REG_CTRL_REG4, 0xFF, 0x04);
+	test_equal(MMA8451Q_ShadowDirty(), MMA8451Q_SHADOW_BIT(MMA8451Q_REG_FF_MT_THS) | MMA8451Q_SHADOW_BIT(MMA8451Q_REG_CTRL_REG4));
+	test_equal(MMA8451Q_ReadRegister(MMA8451Q_REG_FF_MT_THS), 0x1E);
+	test_equal(device[MMA8451Q_REG_FF_MT_THS], 0);
+	test_equal(writes(), 0);
+
+	/* standby, 0x17, 0x2D, active; the mode to return to is read first */
+	MMA8451Q_Flush();
+	test_equal(writes(), 4);
+	test_equal(reads(), 2);
+	test_equal(device[MMA8451Q_REG_FF_MT_THS], 0x1E);
+	test_equal(device[MMA8451Q_REG_CTRL_REG4], 0x04);
+	test_equal(MMA8451Q_ShadowDirty(), 0);
+
+	/* a change and its undo cancel out */
+	MMA8451Q_WriteRegister(MMA8451Q_REG_FF_MT_THS, 0x30);
+	test_equal(MMA8451Q_ShadowDirty(), MMA8451Q_SHADOW_BIT(MMA8451Q_REG_FF_MT_THS));
+	MMA8451Q_WriteRegister(MMA8451Q_REG_FF_MT_THS, 0x1E);
+	test_equal(MMA8451Q_ShadowDirty(), 0);
+	MMA8451Q_Flush();
+	test_equal(writes(), 4);
+}
+
+static void test_fetch(void)
+{
+	mma8451q_confreg_t configuration;
+
+	setup();
+	device[MMA8451Q_REG_F_SETUP] = 0x41;
+	device[MMA8451Q_REG_FF_MT_COUNT] = 0x0A;
+	device[0x19] = 0xEE;
+	device[MMA8451Q_TRANSIENT_CFG] = 0x16;
+	device[MMA8451Q_REG_OFF_Z] = 0x7F;
+
+	/* two bursts around the undefined registers 0x19 .. 0x1C */
+	MMA8451Q_FetchConfiguration(&configuration);
+	test_equal(reads(), 2);
+	test_equal(sim.bytes, 2 * 3 + (0x18 - 0x09 + 1) + (0x31 - 0x1D + 1));
+	test_equal(configuration.F_SETUP, 0x41);
+	test_equal(configuration.WHO_AM_I, 0x1A);
+	test_equal(configuration.FF_MT_COUNT, 0x0A);
+	test_equal(configuration.TRANSIENT_CFG, 0x16);
+	test_equal(configuration.CTRL_REG1, 0x01);
+	test_equal(configuration.OFF_Z, 0x7F);
+
+	/* from then on everything is known */
+	MMA8451Q_FetchConfiguration(&configuration);
+	test_equal(MMA8451Q_ReadRegister(MMA8451Q_REG_CTRL_REG1), 0x01);
+	test_equal(reads(), 2);
+
+	/* a change not flushed yet is handed out */
+	MMA8451Q_WriteRegister(MMA8451Q_REG_OFF_Z, 0x10);
+	MMA8451Q_FetchConfiguration(&configuration);
+	test_equal(configuration.OFF_Z, 0x10);
+	test_equal(writes(), 0);
+}
+
+static void test_reset(void)
+{
+	setup();
+
+	test_equal(MMA8451Q_ReadRegister(MMA8451Q_REG_CTRL_REG1), 0x01);
+	MMA8451Q_Reset();
+
+	/* the shadow forgot the old value and reads() the default */
+	test_equal(MMA8451Q_ReadRegister(MMA8451Q_REG_CTRL_REG1), 0x00);
+	test_equal(reads(), 2);
+}
+
+int main(void)
+{
+	test_reads();
+	test_modify();
+	test_standby();
+	test_store();
+	test_deferred();
+	test_fetch();
+	test_reset();
+
+	printf("%s: passed %d/%d test cases\n", __FILE__, g_tests_passed, g_tests_total);
+	return (g_tests_passed == g_tests_total) ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+/*
+ * test_profile.c
+ *
+ *  Created on: Dec 28, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host test cases for the cycle profiler: count, minimum, maximum and total of a region,
+ *   		regions timed by the CLOCK_MONOTONIC clock of profile_host.c, nesting, reset and the dump
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "profile.h"
+#include "test_host.h"
+
+static int g_tests_passed = 0;
+static int g_tests_total = 0;
+static int g_skip_tests = 0;
+
+static void sleep_us(long us)
+{
+	const struct timespec duration = { 0, us * 1000 };
+	nanosleep(&duration, 0);
+}
+
+static void test_record(void)
+{
+	Profile_Reset();
+
+	Profile_Record(PROFILE_PWM, 30);
+	Profile_Record(PROFILE_PWM, 10);
+	Profile_Record(PROFILE_PWM, 50);
+
+	const profile_stats_t *stats = &profile_stats[PROFILE_PWM];
+	test_equal(stats->count, 3);
+	test_equal(stats->min, 10);
+	test_equal(stats->max, 50);
+	test_equal(stats->total, 90);
+	test_equal(profile_stats[PROFILE_TILT].count, 0);
+
+	/* a first run of zero length is the minimum, not a cleared one */
+	Profile_Record(PROFILE_LOG, 0);
+	Profile_Record(PROFILE_LOG, 7);
+	test_equal(profile_stats[PROFILE_LOG].min, 0);
+	test_equal(profile_stats[PROFILE_LOG].max, 7);
+
+	/* totals past 32 bit */
+	for (int i = 0; i < 4; ++i) {
+		Profile_Record(PROFILE_READ_XYZ, 0x7FFFFFFFu);
+	}
+	test_equal(profile_stats[PROFILE_READ_XYZ].total, 4 * (uint64_t)0x7FFFFFFFu);
+
+	Profile_Reset();
+	test_equal(stats->count, 0);
+	test_equal(stats->max, 0);
+	test_equal(profile_stats[PROFILE_READ_XYZ].total, 0);
+}
+
+static void test_regions(void)
+{
+	Profile_Reset();
+
+	/* nested regions, the inner one twice */
+	PROFILE_BEGIN(PROFILE_READ_XYZ);
+	for (int i = 0; i < 2; ++i) {
+		PROFILE_BEGIN(PROFILE_TILT);
+		sleep_us(2000);
+		PROFILE_END(PROFILE_TILT);
+	}
+	PROFILE_END(PROFILE_READ_XYZ);
+
+	const profile_stats_t *outer = &profile_stats[PROFILE_READ_XYZ];
+	const profile_stats_t *inner = &profile_stats[PROFILE_TILT];
+	test_equal(outer->count, 1);
+	test_equal(inner->count, 2);
+	test_assert(inner->min >= 2000 * PROFILE_CLOCK_HZ / 1000000u);
+	test_assert(inner->max < PROFILE_CLOCK_HZ);
+	test_assert(inner->min <= inner->max);
+	test_assert(outer->total >= inner->total);
+
+	Profile_Dump();
+	printf("\n");
+}
+
+int main(void)
+{
+	test_record();
+	test_regions();
+
+	printf("%s: passed %d/%d test cases\n", __FILE__, g_tests_passed, g_tests_total);
+	return (g_tests_passed == g_tests_total) ? 0 : 1;
+}
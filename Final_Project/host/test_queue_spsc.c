@@ -0,0 +1,363 @@
+/*
+ * test_queue_spsc.c
+ *
+ *  Created on: Dec 17, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host test cases for the single-producer/single-consumer queue of queue.c.
+ *   		Besides the sequential cases, a stress test runs the producer and the consumer
+ *   		on two Linux threads, the way the main loop and the UART interrupt share TxQ/RxQ,
+ *   		once copying and once reading in place through Q_Peek/Q_Release. A producer
+ *   		interrupt taken inside Q_Dequeue is replayed at a fixed point.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "MKL25Z4.h"
+#include "queue.h"
+#include "mma8451q.h"
+#include "test_host.h"
+
+static int g_tests_passed = 0;
+static int g_tests_total = 0;
+static int g_skip_tests = 0;
+
+#define QUEUE_SIZE	(1024)
+
+static uint8_t storage[QUEUE_SIZE];
+static Q_T q = Q_INITIALIZER(storage);
+
+/*
+ * @brief The producer's interrupt, taken at the next barrier of queue.c once armed
+ */
+static const char *interrupt_bytes;
+
+void Q_HostBarrier(void)
+{
+	__DMB();
+	const char *bytes = interrupt_bytes;
+	if (bytes != 0) {
+		interrupt_bytes = 0;
+		Q_Enqueue(&q, bytes, strlen(bytes));
+	}
+}
+
+/*
+ * @brief The n-th byte of the stress stream; not periodic in QUEUE_SIZE, so a misplaced wrap shows
+ */
+static uint8_t pattern(uint32_t n)
+{
+	return (uint8_t)(n ^ (n >> 8) ^ (n >> 16));
+}
+
+/*
+ * @brief xorshift32, each thread keeps its own state
+ */
+static uint32_t next_random(uint32_t *state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+static void test_sequential(void)
+{
+	uint8_t in[QUEUE_SIZE + 16];
+	uint8_t out[QUEUE_SIZE + 16];
+
+	for (int i = 0; i < sizeof(in); ++i) {
+		in[i] = pattern(i);
+	}
+
+	Q_Init(&q);
+	test_assert(Q_Empty(&q));
+	test_equal(Q_Capacity(&q), QUEUE_SIZE);
+	test_equal(Q_Dequeue(&q, out, 1), 0);
+
+	test_equal(Q_Enqueue(&q, in, 10), 10);
+	test_equal(Q_Length(&q), 10);
+	test_equal(Q_Dequeue(&q, out, 4), 4);
+	test_equal(Q_Size(&q), 6);
+	test_equal(memcmp(out, in, 4), 0);
+
+	/* fill up, the write position wraps around the end of the storage */
+	test_equal(Q_Enqueue(&q, in + 10, sizeof(in)), QUEUE_SIZE - 6);
+	test_assert(Q_Full(&q));
+	test_equal(Q_Enqueue(&q, in, 1), 0);
+	test_equal(Q_Dequeue(&q, out, sizeof(out)), QUEUE_SIZE);
+	test_equal(memcmp(out, in + 4, QUEUE_SIZE), 0);
+	test_assert(Q_Empty(&q));
+	test_equal(Q_Enqueue(&q, in, 0), 0);
+}
+
+static void test_counter_wrap(void)
+{
+	uint8_t in[300];
+	uint8_t out[300];
+
+	for (int i = 0; i < sizeof(in); ++i) {
+		in[i] = pattern(i);
+	}
+
+	/* free-running counters just below 2^32 */
+	Q_Init(&q);
+	q.write = q.read = 0xFFFFFF00u;
+
+	test_equal(Q_Enqueue(&q, in, sizeof(in)), sizeof(in));
+	test_assert(q.write < q.read);
+	test_equal(Q_Length(&q), sizeof(in));
+	test_assert(!Q_Full(&q));
+	test_equal(Q_Dequeue(&q, out, sizeof(out)), sizeof(out));
+	test_equal(memcmp(out, in, sizeof(in)), 0);
+	test_assert(Q_Empty(&q));
+
+	/* full across the wrap */
+	q.write = q.read = 0xFFFFFFF0u;
+	for (int i = 0; i < QUEUE_SIZE / 256; ++i) {
+		test_equal(Q_Enqueue(&q, in, 256), 256);
+	}
+	test_assert(Q_Full(&q));
+	test_equal(Q_Enqueue(&q, in, 1), 0);
+}
+
+static void test_zero_copy(void)
+{
+	Q_Span_T span[2];
+
+	Q_Init(&q);
+	q.write = q.read = QUEUE_SIZE - 3;
+
+	/* the free room wraps: 3 bytes at the end, the rest from the start */
+	test_equal(Q_Reserve(&q, 8, span), 8);
+	test_assert(span[0].data == q.data + QUEUE_SIZE - 3);
+	test_equal(span[0].length, 3);
+	test_assert(span[1].data == q.data);
+	test_equal(span[1].length, 5);
+
+	/* nothing is visible before the commit, and only the committed part after it */
+	memcpy(span[0].data, "abc", 3);
+	memcpy(span[1].data, "defgh", 5);
+	test_equal(Q_Length(&q), 0);
+	test_equal(Q_Peek(&q, span), 0);
+	test_equal(span[0].length + span[1].length, 0);
+	Q_Commit(&q, 6);
+	test_equal(Q_Length(&q), 6);
+
+	/* read in place, in two pieces */
+	test_equal(Q_Peek(&q, span), 6);
+	test_equal(span[0].length, 3);
+	test_equal(memcmp(span[0].data, "abc", 3), 0);
+	test_equal(span[1].length, 3);
+	test_equal(memcmp(span[1].data, "def", 3), 0);
+
+	/* peeking does not consume, releasing does */
+	test_equal(Q_Peek(&q, span), 6);
+	Q_Release(&q, 4);
+	test_equal(Q_Length(&q), 2);
+	test_equal(Q_Peek(&q, span), 2);
+	test_assert(span[0].data == q.data + 1);
+	test_equal(span[1].length, 0);
+
+	/* the reservation is limited by the free room */
+	test_equal(Q_Reserve(&q, 2 * QUEUE_SIZE, span), QUEUE_SIZE - 2);
+	test_equal(span[0].length + span[1].length, QUEUE_SIZE - 2);
+	Q_Commit(&q, QUEUE_SIZE - 2);
+	test_assert(Q_Full(&q));
+	test_equal(Q_Reserve(&q, 1, span), 0);
+}
+
+static void test_dequeue_interrupted(void)
+{
+	char out[16];
+
+	Q_Init(&q);
+	test_equal(Q_Enqueue(&q, "abc", 3), 3);
+
+	/* the producer commits while Q_Dequeue looks: it copies what it saw, never more than asked */
+	memset(out, '#', sizeof(out));
+	interrupt_bytes = "defghijklm";
+	test_equal(Q_Dequeue(&q, out, 4), 3);
+	test_assert(interrupt_bytes == 0);
+	test_equal(memcmp(out, "abc#", 4), 0);
+	test_equal(out[sizeof(out) - 1], '#');
+	test_equal(Q_Length(&q), 10);
+
+	test_equal(Q_Dequeue(&q, out, sizeof(out)), 10);
+	test_equal(memcmp(out, "defghijklm", 10), 0);
+}
+
+static void test_records(void)
+{
+	/* 8 byte packed records, a capacity that is not the storage size in bytes */
+	static mma8451q_acc_t records[8];
+	static Q_T rq = Q_INITIALIZER(records);
+	mma8451q_acc_t in[10], out[10];
+
+	memset(in, 0, sizeof(in));
+	for (int i = 0; i < 10; ++i) {
+		in[i].status = i;
+		in[i].x = 100 * i;
+		in[i].y = -100 * i;
+		in[i].z = 4096 - i;
+	}
+
+	test_equal(sizeof(mma8451q_acc_t), 8);
+	test_equal(rq.elementSize, sizeof(mma8451q_acc_t));
+	test_equal(Q_Capacity(&rq), 8);
+	Q_Init(&rq);
+	test_assert(!Q_Pop(&rq, &out[0]));
+
+	/* push/pop whole records, three in flight, wrapping the storage several times */
+	int pushed = 0, popped = 0;
+	for (int i = 0; i < 30; ++i) {
+		test_assert(Q_Push(&rq, &in[pushed++ % 10]));
+		if (i >= 2) {
+			test_assert(Q_Pop(&rq, &out[0]));
+			test_equal(memcmp(&out[0], &in[popped++ % 10], sizeof(mma8451q_acc_t)), 0);
+		}
+	}
+	test_equal(Q_Length(&rq), 2);
+
+	Q_Init(&rq);
+	for (int i = 0; i < 8; ++i) {
+		test_assert(Q_Push(&rq, &in[i]));
+	}
+	test_assert(Q_Full(&rq));
+	test_assert(!Q_Push(&rq, &in[8]));
+	for (int i = 0; i < 8; ++i) {
+		test_assert(Q_Pop(&rq, &out[0]));
+		test_equal(memcmp(&out[0], &in[i], sizeof(mma8451q_acc_t)), 0);
+	}
+
+	/* counts of the bulk calls are in records, also across the end of the storage */
+	rq.write = rq.read = 6;
+	test_equal(Q_Enqueue(&rq, in, 10), 8);
+	test_equal(Q_Length(&rq), 8);
+	test_equal(Q_Dequeue(&rq, out, 10), 8);
+	test_equal(memcmp(out, in, 8 * sizeof(mma8451q_acc_t)), 0);
+}
+
+/*
+ * @brief Two-thread stress test
+ */
+#define STRESS_BYTES	(16u * 1024u * 1024u)
+#define STRESS_CHUNK	(97u)
+
+static struct {
+	bool zeroCopy;			/* consumer reads in place with Q_Peek/Q_Release */
+	uint32_t errors;		/* bytes out of sequence */
+	uint32_t overlength;	/* Q_Length observed above the capacity */
+} stress;
+
+static void *stress_producer(void *unused)
+{
+	uint8_t chunk[STRESS_CHUNK];
+	uint32_t random = 0x12345678u;
+	uint32_t produced = 0;
+
+	while (produced < STRESS_BYTES) {
+		uint32_t n = 1 + next_random(&random) % STRESS_CHUNK;
+		n = min(n, STRESS_BYTES - produced);
+		for (uint32_t i = 0; i < n; ++i) {
+			chunk[i] = pattern(produced + i);
+		}
+
+		/* like __sys_write: retry the rest until it fits */
+		uint32_t sent = 0;
+		while (sent < n) {
+			if (Q_Length(&q) > QUEUE_SIZE) {
+				stress.overlength++;
+			}
+			const size_t accepted = Q_Enqueue(&q, chunk + sent, n - sent);
+			sent += accepted;
+			if (accepted == 0) {
+				sched_yield();
+			}
+		}
+		produced += n;
+	}
+	return 0;
+}
+
+static void *stress_consumer(void *unused)
+{
+	uint8_t chunk[STRESS_CHUNK];
+	uint32_t random = 0x9E3779B9u;
+	uint32_t consumed = 0;
+
+	while (consumed < STRESS_BYTES) {
+		const uint32_t n = 1 + next_random(&random) % STRESS_CHUNK;
+		size_t got;
+
+		if (stress.zeroCopy) {
+			Q_Span_T span[2];
+			const size_t readable = Q_Peek(&q, span);
+			got = min(n, readable);
+			for (size_t i = 0; i < got; ++i) {
+				const uint8_t byte = (i < span[0].length) ? span[0].data[i] : span[1].data[i - span[0].length];
+				if (byte != pattern(consumed + i)) {
+					stress.errors++;
+				}
+			}
+			Q_Release(&q, got);
+		}
+		else {
+			got = Q_Dequeue(&q, chunk, n);
+			for (size_t i = 0; i < got; ++i) {
+				if (chunk[i] != pattern(consumed + i)) {
+					stress.errors++;
+				}
+			}
+		}
+
+		if (got == 0) {
+			sched_yield();
+		}
+		consumed += got;
+	}
+	return 0;
+}
+
+static void test_two_threads(bool zeroCopy)
+{
+	pthread_t producer, consumer;
+
+	Q_Init(&q);
+	/* cross the 2^32 wrap of the counters half way through */
+	q.write = q.read = 0u - STRESS_BYTES / 2;
+	memset(&stress, 0, sizeof(stress));
+	stress.zeroCopy = zeroCopy;
+
+	/* not inside test_equal, which skips evaluating its arguments after a failure */
+	if (pthread_create(&consumer, 0, stress_consumer, 0) || pthread_create(&producer, 0, stress_producer, 0)) {
+		printf("ERROR: no threads\n");
+		exit(1);
+	}
+	pthread_join(producer, 0);
+	pthread_join(consumer, 0);
+
+	test_equal(stress.errors, 0);
+	test_equal(stress.overlength, 0);
+	test_assert(Q_Empty(&q));
+	test_equal(q.write, STRESS_BYTES / 2);
+}
+
+int main(void)
+{
+	test_sequential();
+	test_counter_wrap();
+	test_zero_copy();
+	test_dequeue_interrupted();
+	test_records();
+	test_two_threads(false);
+	test_two_threads(true);
+
+	printf("%s: passed %d/%d test cases\n", __FILE__, g_tests_passed, g_tests_total);
+	return (g_tests_passed == g_tests_total) ? 0 : 1;
+}
@@ -0,0 +1,259 @@
+/*
+ * test_replay.c
+ *
+ *  Created on: Dec 24, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host test cases for trace replay: the CSV layouts with and without a header, in
+ *   		counts and milli-g, malformed lines, the binary format written and read back,
+ *   		sample-and-hold against the model's output data rate, and every 14 bit count
+ *   		coming out of the model's data registers as it went into the trace
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "replay.h"
+#include "sim_mma8451q.h"
+#include "i2c_hal.h"
+#include "i2c_hal_sim.h"
+#include "mma8451q.h"
+#include "test_host.h"
+
+static int g_tests_passed = 0;
+static int g_tests_total = 0;
+static int g_skip_tests = 0;
+
+static char path[64];
+
+/* writes text to the scratch trace */
+static void trace(const char *text)
+{
+	FILE *file = fopen(path, "w");
+	fputs(text, file);
+	fclose(file);
+}
+
+static void test_csv(void)
+{
+	replay_t replay;
+	replay_sample_t sample;
+
+	/* what telemetry_decode writes: a sequence column, fractional times, counts */
+	trace("# captured at 100 Hz\nsequence,time_us,x,y,z\n0,0.00,0,0,4096\n\n1,10000.40,-2048,1024,4096\n");
+	const bool opened = Replay_Open(&replay, path);
+	test_assert(opened);
+	test_equal(replay.unit, REPLAY_UNIT_COUNTS);
+	bool read = Replay_Read(&replay, &sample);
+	test_assert(read);
+	test_equal(sample.timeUs, 0);
+	test_equal(sample.ug[2], 1000000);
+	read = Replay_Read(&replay, &sample);
+	test_assert(read);
+	test_equal(sample.timeUs, 10000);
+	test_equal(sample.ug[0], -500000);
+	test_equal(sample.ug[1], 250000);
+	read = Replay_Read(&replay, &sample);
+	test_assert(!read);
+	test_equal(replay.error[0], '\0');
+	test_equal(replay.stats.samples, 2);
+	Replay_Close(&replay);
+
+	/* milli-g columns in any order */
+	trace("z_mg, x_mg, time_us, y_mg\n1000, -250, 5, 30\n");
+	const bool mg = Replay_Open(&replay, path);
+	test_assert(mg);
+	test_equal(replay.unit, REPLAY_UNIT_MG);
+	read = Replay_Read(&replay, &sample);
+	test_assert(read);
+	test_equal(sample.timeUs, 5);
+	test_equal(sample.ug[0], -250000);
+	test_equal(sample.ug[1], 30000);
+	test_equal(sample.ug[2], 1000000);
+	Replay_Close(&replay);
+
+	/* no header: time_us,x,y,z in counts */
+	trace("100,1,-1,8191\n");
+	const bool bare = Replay_Open(&replay, path);
+	test_assert(bare);
+	read = Replay_Read(&replay, &sample);
+	test_assert(read);
+	test_equal(sample.timeUs, 100);
+	test_equal(sample.ug[0], 244);
+	test_equal(sample.ug[1], -244);
+	test_equal(sample.ug[2], 1999756);
+	Replay_Close(&replay);
+
+	/* a malformed line stops the trace and names itself */
+	trace("time_us,x,y,z\n0,0,0,4096\n# note\n10,0,zero,4096\n20,0,0,4096\n");
+	Replay_Open(&replay, path);
+	read = Replay_Read(&replay, &sample);
+	test_assert(read);
+	read = Replay_Read(&replay, &sample);
+	test_assert(!read);
+	test_equal(strcmp(replay.error, "line 4: bad sample"), 0);
+	read = Replay_Read(&replay, &sample);
+	test_assert(!read);
+	Replay_Close(&replay);
+
+	trace("time_us,x,y\n0,0,0\n");
+	const bool partial = Replay_Open(&replay, path);
+	test_assert(!partial);
+	test_equal(strcmp(replay.error, "line 1: header lacks time_us, x, y or z"), 0);
+	Replay_Close(&replay);
+
+	trace("time_us,x,y,z,z_mg\n");
+	const bool mixed = Replay_Open(&replay, path);
+	test_assert(!mixed);
+	Replay_Close(&replay);
+
+	trace("# nothing\n");
+	const bool empty = Replay_Open(&replay, path);
+	test_assert(!empty);
+	test_equal(strcmp(replay.error, "line 1: no samples"), 0);
+	Replay_Close(&replay);
+}
+
+static void test_binary(void)
+{
+	replay_t replay;
+	replay_sample_t sample;
+	const replay_sample_t samples[3] = {
+		{ 0, { 0, 0, 1000000 } },
+		{ 1250, { -1999756, 244, 500000 } },
+		{ 4000000000u, { 7000, -12000, 999000 } }
+	};
+
+	/* counts, written and read back */
+	FILE *file = fopen(path, "wb");
+	bool written = Replay_WriteHeader(file, REPLAY_UNIT_COUNTS);
+	for (int i = 0; i < 2; ++i) {
+		written = written && Replay_WriteSample(file, REPLAY_UNIT_COUNTS, &samples[i]);
+	}
+	fclose(file);
+	test_assert(written);
+
+	const bool opened = Replay_Open(&replay, path);
+	test_assert(opened);
+	test_assert(replay.binary);
+	for (int i = 0; i < 2; ++i) {
+		const bool read = Replay_Read(&replay, &sample);
+		test_assert(read);
+		test_equal(sample.timeUs, samples[i].timeUs);
+		test_equal(memcmp(sample.ug, samples[i].ug, sizeof(sample.ug)), 0);
+	}
+	const bool end = Replay_Read(&replay, &sample);
+	test_assert(!end);
+	test_equal(replay.error[0], '\0');
+	Replay_Close(&replay);
+
+	/* milli-g, with a time past 32 bits refused */
+	file = fopen(path, "wb");
+	written = Replay_WriteHeader(file, REPLAY_UNIT_MG) && Replay_WriteSample(file, REPLAY_UNIT_MG, &samples[2]);
+	test_assert(written);
+	sample = samples[2];
+	sample.timeUs = 1ull << 32;
+	const bool late = Replay_WriteSample(file, REPLAY_UNIT_MG, &sample);
+	test_assert(!late);
+	fclose(file);
+
+	Replay_Open(&replay, path);
+	test_equal(replay.unit, REPLAY_UNIT_MG);
+	const bool read = Replay_Read(&replay, &sample);
+	test_assert(read);
+	test_equal(sample.timeUs, 4000000000u);
+	test_equal(memcmp(sample.ug, samples[2].ug, sizeof(sample.ug)), 0);
+	Replay_Close(&replay);
+
+	/* 40 g does not fit 16 bits of milli-g */
+	sample.ug[0] = 40000000;
+	file = fopen(path, "wb");
+	const bool large = Replay_WriteSample(file, REPLAY_UNIT_MG, &sample);
+	test_assert(!large);
+	fclose(file);
+
+	/* a record cut short */
+	file = fopen(path, "wb");
+	Replay_WriteHeader(file, REPLAY_UNIT_COUNTS);
+	fwrite("\0\0\0\0\0", 1, 5, file);
+	fclose(file);
+	Replay_Open(&replay, path);
+	const bool truncated = Replay_Read(&replay, &sample);
+	test_assert(!truncated);
+	test_equal(strcmp(replay.error, "truncated sample"), 0);
+	Replay_Close(&replay);
+
+	/* a version this reader does not know */
+	file = fopen(path, "wb");
+	fwrite("MMAR\x02\0\0\0", 1, REPLAY_HEADER_SIZE, file);
+	fclose(file);
+	const bool version = Replay_Open(&replay, path);
+	test_assert(!version);
+	test_equal(strcmp(replay.error, "unknown version"), 0);
+	Replay_Close(&replay);
+}
+
+static void test_hold(void)
+{
+	replay_t replay;
+	int32_t ug[3];
+
+	/* 100 Hz on a 400 Hz tick, starting anywhere in the trace and on the model's time line */
+	trace("time_us,x,y,z\n500000,1,0,0\n510000,2,0,0\n520000,3,0,0\n523000,4,0,0\n524000,5,0,0\n");
+	Replay_Open(&replay, path);
+
+	static const int32_t expected[] = { 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 5, 5, 5 };
+	for (int tick = 0; tick < 13; ++tick) {
+		Replay_Source(&replay, 3000000 + 2500 * tick, ug);
+		test_equal(Replay_UgToCounts(ug[0]), expected[tick]);
+		test_equal(replay.ended, tick >= 10);
+	}
+	test_equal(replay.stats.samples, 5);
+	test_equal(replay.stats.presented, 4);
+	test_equal(replay.stats.skipped, 1);
+	test_equal(replay.stats.held, 9);
+	Replay_Close(&replay);
+}
+
+static void test_model(void)
+{
+	sim_i2c_t sim;
+	sim_mma8451q_t model;
+	bool exact = true;
+
+	SimI2C_Init(&sim, MMA8451Q_I2CADDR);
+	SimMma8451q_Init(&model, &sim);
+	I2C_HalSimAttach(&sim);
+	I2C_HalWriteRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG1, 0x01);
+
+	/* every count of the 2 g range in and out of the data registers */
+	for (int32_t counts = -8192; counts <= 8191; ++counts) {
+		const int32_t ug[3] = { Replay_CountsToUg(counts), Replay_CountsToUg(-counts - 1), Replay_CountsToUg(counts / 2) };
+		uint8_t data[6];
+
+		SimMma8451q_Sample(&model, ug);
+		I2C_HalReadRegisters(MMA8451Q_I2CADDR, MMA8451Q_REG_OUT_X_MSB, sizeof(data), data);
+		for (int axis = 0; axis < 3; ++axis) {
+			const int16_t value = (int16_t)((data[2 * axis] << 8) | data[2 * axis + 1]) >> 2;
+			exact = exact && (value == Replay_UgToCounts(ug[axis]));
+		}
+		exact = exact && (Replay_UgToCounts(ug[0]) == counts);
+	}
+	test_assert(exact);
+	test_equal(model.stats.samples, 16384);
+}
+
+int main(void)
+{
+	snprintf(path, sizeof(path), "/tmp/test_replay.%d", (int)getpid());
+
+	test_csv();
+	test_binary();
+	test_hold();
+	test_model();
+
+	remove(path);
+	printf("%s: passed %d/%d test cases\n", __FILE__, g_tests_passed, g_tests_total);
+	return (g_tests_passed == g_tests_total) ? 0 : 1;
+}
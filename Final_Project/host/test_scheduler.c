@@ -0,0 +1,223 @@
+/*
+ * test_scheduler.c
+ *
+ *  Created on: Dec 25, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host test cases for the run-to-completion scheduler: order and data of events,
+ *   		types without a handler, coalescing, a full queue, events posted by a handler,
+ *   		PRIMASK around posts and the counters of handlers and queue
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "MKL25Z4.h"
+#include "scheduler.h"
+#include "systick_host.h"
+#include "test_host.h"
+
+static int g_tests_passed = 0;
+static int g_tests_total = 0;
+static int g_skip_tests = 0;
+
+/* what the handlers saw, in order */
+static event_t seen[64];
+static int seen_count;
+
+/* cycles a handler pretends to take */
+static uint32_t handler_cycles;
+
+static void record(const event_t *event)
+{
+	if (seen_count < 64) {
+		seen[seen_count++] = *event;
+	}
+	host_cycles += handler_cycles;
+}
+
+/* posts a tick of its own the first time, as a handler starting a follow-up does */
+static void record_and_post(const event_t *event)
+{
+	record(event);
+	if (event->data == 1) {
+		Scheduler_PostOnce(EVENT_TICK, 2);
+	}
+}
+
+static void setup(void)
+{
+	while (Scheduler_Dispatch()) {}
+	for (int type = 0; type < EVENT_COUNT; ++type) {
+		Scheduler_Register(type, record);
+	}
+	Scheduler_ResetStats();
+	seen_count = 0;
+	handler_cycles = 0;
+}
+
+static void test_order(void)
+{
+	setup();
+
+	const bool posted = Scheduler_Post(EVENT_MOTION, 0x4000) && Scheduler_Post(EVENT_SAMPLES, 7)
+			&& Scheduler_Post(EVENT_MOTION, 0x8000);
+	test_assert(posted);
+	test_equal(Scheduler_Depth(), 3);
+	test_equal(seen_count, 0);
+
+	/* one event per call, oldest first */
+	bool dispatched = Scheduler_Dispatch();
+	test_assert(dispatched);
+	test_equal(seen_count, 1);
+	test_equal(seen[0].type, EVENT_MOTION);
+	test_equal(seen[0].data, 0x4000);
+	while (Scheduler_Dispatch()) {}
+	test_equal(seen_count, 3);
+	test_equal(seen[1].type, EVENT_SAMPLES);
+	test_equal(seen[1].data, 7);
+	test_equal(seen[2].data, 0x8000);
+
+	dispatched = Scheduler_Dispatch();
+	test_assert(!dispatched);
+	test_equal(Scheduler_Depth(), 0);
+
+	/* a type without a handler is taken and counted */
+	Scheduler_Register(EVENT_UART_RX, 0);
+	Scheduler_Post(EVENT_UART_RX, 0);
+	dispatched = Scheduler_Dispatch();
+	test_assert(dispatched);
+	test_equal(seen_count, 3);
+	test_equal(scheduler_stats[EVENT_UART_RX].handled, 1);
+	test_equal(scheduler_stats[EVENT_MOTION].posted, 2);
+	test_equal(scheduler_stats[EVENT_MOTION].handled, 2);
+}
+
+static void test_coalesce(void)
+{
+	setup();
+
+	/* one tick pending is enough, the data of the first stays */
+	Scheduler_PostOnce(EVENT_TICK, 1);
+	Scheduler_PostOnce(EVENT_TICK, 2);
+	Scheduler_PostOnce(EVENT_TICK, 3);
+	Scheduler_Post(EVENT_MOTION, 0);
+	test_equal(Scheduler_Depth(), 2);
+	test_equal(scheduler_stats[EVENT_TICK].posted, 1);
+	test_equal(scheduler_stats[EVENT_TICK].coalesced, 2);
+
+	/* a plain post is never coalesced */
+	Scheduler_Post(EVENT_TICK, 4);
+	test_equal(Scheduler_Depth(), 3);
+
+	while (Scheduler_Dispatch()) {}
+	test_equal(seen_count, 3);
+	test_equal(seen[0].data, 1);
+	test_equal(seen[2].data, 4);
+
+	/* once taken, the next one queues again, also from inside the handler */
+	Scheduler_Register(EVENT_TICK, record_and_post);
+	Scheduler_PostOnce(EVENT_TICK, 1);
+	Scheduler_Dispatch();
+	test_equal(Scheduler_Depth(), 1);
+	Scheduler_Dispatch();
+	test_equal(seen_count, 5);
+	test_equal(seen[4].data, 2);
+	test_equal(Scheduler_Depth(), 0);
+}
+
+static void test_full(void)
+{
+	setup();
+
+	bool posted = true;
+	for (int i = 0; i < SCHEDULER_QUEUE_LENGTH; ++i) {
+		posted = posted && Scheduler_Post(EVENT_SAMPLES, i);
+	}
+	test_assert(posted);
+	test_equal(Scheduler_Depth(), SCHEDULER_QUEUE_LENGTH);
+
+	/* the newest are dropped, what is queued stays */
+	const bool dropped = Scheduler_Post(EVENT_MOTION, 99);
+	const bool once = Scheduler_PostOnce(EVENT_TICK, 99);
+	test_assert(!dropped);
+	test_assert(!once);
+	test_equal(scheduler_stats[EVENT_MOTION].dropped, 1);
+	test_equal(scheduler_stats[EVENT_TICK].dropped, 1);
+	test_equal(scheduler_stats[EVENT_MOTION].posted, 0);
+
+	/* the counters wrap around the ring */
+	for (int i = 0; i < 3 * SCHEDULER_QUEUE_LENGTH; ++i) {
+		Scheduler_Dispatch();
+		Scheduler_Post(EVENT_SAMPLES, SCHEDULER_QUEUE_LENGTH + i);
+	}
+	while (Scheduler_Dispatch()) {}
+	test_equal(seen_count, 64);
+	bool ordered = true;
+	for (int i = 0; i < 64; ++i) {
+		ordered = ordered && (seen[i].data == (uint32_t)i);
+	}
+	test_assert(ordered);
+
+	test_equal(scheduler_queue_stats.maxDepth, SCHEDULER_QUEUE_LENGTH);
+	test_equal(scheduler_queue_stats.dispatched, 4 * SCHEDULER_QUEUE_LENGTH);
+	/* 3 x 16 takes at a full queue, then 16, 15, .. 1 */
+	test_equal(scheduler_queue_stats.depthSum, 3 * 16 * 16 + 16 * 17 / 2);
+}
+
+static void test_primask(void)
+{
+	setup();
+
+	/* a post inside a critical section leaves it masked */
+	__disable_irq();
+	Scheduler_Post(EVENT_MOTION, 0);
+	Scheduler_PostOnce(EVENT_TICK, 0);
+	Scheduler_Dispatch();
+	test_equal(__get_PRIMASK(), 1);
+	__enable_irq();
+
+	Scheduler_Post(EVENT_MOTION, 0);
+	Scheduler_Dispatch();
+	test_equal(__get_PRIMASK(), 0);
+	while (Scheduler_Dispatch()) {}
+}
+
+static void test_stats(void)
+{
+	setup();
+
+	/* handler cycles, mean and longest; cycle_count() itself adds a cycle per read */
+	handler_cycles = 4800;
+	Scheduler_Post(EVENT_SAMPLES, 0);
+	Scheduler_Dispatch();
+	handler_cycles = 48000;
+	Scheduler_Post(EVENT_SAMPLES, 0);
+	Scheduler_Dispatch();
+
+	const scheduler_stats_t *stats = &scheduler_stats[EVENT_SAMPLES];
+	test_equal(stats->handled, 2);
+	test_assert((stats->cycles >= 52800) && (stats->cycles <= 52810));
+	test_assert((stats->maxCycles >= 48000) && (stats->maxCycles <= 48005));
+	test_equal(scheduler_stats[EVENT_MOTION].cycles, 0);
+
+	Scheduler_Dump();
+	printf("\n");
+
+	Scheduler_ResetStats();
+	test_equal(stats->handled, 0);
+	test_equal(stats->maxCycles, 0);
+	test_equal(scheduler_queue_stats.dispatched, 0);
+}
+
+int main(void)
+{
+	test_order();
+	test_coalesce();
+	test_full();
+	test_primask();
+	test_stats();
+
+	printf("%s: passed %d/%d test cases\n", __FILE__, g_tests_passed, g_tests_total);
+	return (g_tests_passed == g_tests_total) ? 0 : 1;
+}
@@ -0,0 +1,325 @@
+/*
+ * test_sim_mma8451q.c
+ *
+ *  Created on: Dec 23, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host test cases for the MMA8451Q model of the board simulation: reset values and
+ *   		modes, the data registers and offsets, the FIFO drained by mma8451q_fifo.c with
+ *   		watermark, overflow and fill mode, the debounced and latched motion and transient
+ *   		detectors on their interrupt pins, and the waveform, run through the simulated I2C
+ *   		backend as the firmware sees the part
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "sim_mma8451q.h"
+#include "i2c_hal.h"
+#include "i2c_hal_sim.h"
+#include "mma8451q_fifo.h"
+#include "test_host.h"
+
+/* the transient registers mma8451q.h leaves out */
+#define REG_TRANSIENT_CFG	(0x1D)
+#define REG_TRANSIENT_THS	(0x1F)
+
+static int g_tests_passed = 0;
+static int g_tests_total = 0;
+static int g_skip_tests = 0;
+
+static sim_i2c_t sim;
+static sim_mma8451q_t model;
+
+static void setup(void)
+{
+	SimI2C_Init(&sim, MMA8451Q_I2CADDR);
+	SimMma8451q_Init(&model, &sim);
+	I2C_HalSimAttach(&sim);
+}
+
+static uint8_t read_register(uint8_t address)
+{
+	return I2C_HalReadRegister(MMA8451Q_I2CADDR, address);
+}
+
+static void write_register(uint8_t address, uint8_t value)
+{
+	I2C_HalWriteRegister(MMA8451Q_I2CADDR, address, value);
+}
+
+/* in milli-g */
+static void sample(int32_t x, int32_t y, int32_t z)
+{
+	const int32_t ug[3] = { 1000 * x, 1000 * y, 1000 * z };
+	SimMma8451q_Sample(&model, ug);
+}
+
+static void test_reset(void)
+{
+	setup();
+
+	const uint8_t id = read_register(MMA8451Q_REG_WHOAMI);
+	test_equal(id, 0x1A);
+	const uint8_t standby = read_register(MMA8451Q_REG_SYSMOD);
+	test_equal(standby, 0);
+	test_equal(SimMma8451q_PeriodUs(&model), 0);
+
+	/* nothing is acquired in standby */
+	SimMma8451q_Acquire(&model, 0);
+	test_equal(model.stats.samples, 0);
+
+	/* active at 800 Hz, then 12.5 Hz */
+	write_register(MMA8451Q_REG_CTRL_REG1, 0x01);
+	const uint8_t active = read_register(MMA8451Q_REG_SYSMOD);
+	test_equal(active, 1);
+	test_equal(SimMma8451q_PeriodUs(&model), 1250);
+	write_register(MMA8451Q_REG_CTRL_REG1, (5 << 3) | 0x01);
+	test_equal(SimMma8451q_PeriodUs(&model), 80000);
+
+	/* read-only registers keep their value */
+	write_register(MMA8451Q_REG_WHOAMI, 0x00);
+	const uint8_t kept = read_register(MMA8451Q_REG_WHOAMI);
+	test_equal(kept, 0x1A);
+
+	/* a software reset returns to standby and the reset values */
+	write_register(MMA8451Q_REG_CTRL_REG4, 0x04);
+	write_register(MMA8451Q_REG_CTRL_REG2, 0x40);
+	test_equal(model.stats.resets, 1);
+	const uint8_t control = read_register(MMA8451Q_REG_CTRL_REG1);
+	const uint8_t enables = read_register(MMA8451Q_REG_CTRL_REG4);
+	const uint8_t portrait = read_register(MMA8451Q_REG_PL_CFG);
+	test_equal(control, 0);
+	test_equal(enables, 0);
+	test_equal(portrait, 0x80);
+}
+
+static void test_data(void)
+{
+	mma8451q_acc_t acc;
+
+	setup();
+	write_register(MMA8451Q_REG_CTRL_REG1, 0x01);
+
+	/* flat at rest: 1 g on Z, 4096 counts in the 2 g range */
+	SimMma8451q_Acquire(&model, 0);
+	const uint8_t ready = read_register(MMA8451Q_REG_STATUS);
+	test_equal(ready, 0x0F);
+	read_full_xyz(&acc);
+	test_equal(acc.xyz[0], 0);
+	test_equal(acc.xyz[1], 0);
+	test_equal(acc.xyz[2], 4096);
+
+	/* the burst through OUT_Z_LSB consumed the sample */
+	const uint8_t consumed = read_register(MMA8451Q_REG_STATUS);
+	test_equal(consumed, 0);
+
+	/* a sample not read before the next is overwritten */
+	sample(-500, 250, 1000);
+	sample(-500, 250, 1000);
+	const uint8_t overwritten = read_register(MMA8451Q_REG_STATUS);
+	test_equal(overwritten, 0xFF);
+	read_full_xyz(&acc);
+	test_equal(acc.xyz[0], -2048);
+	test_equal(acc.xyz[1], 1024);
+
+	/* 8 g range, a 20 mg offset on Z, clamped at 14 bits */
+	write_register(MMA8451Q_REG_XYZ_DATA_CFG, 0x02);
+	write_register(MMA8451Q_REG_OFF_Z, 10);
+	sample(9000, 0, 1000);
+	read_full_xyz(&acc);
+	test_equal(acc.xyz[0], 8191);
+	test_equal(acc.xyz[2], 1044);
+
+	/* roll of 90 degrees puts gravity on Y */
+	memset(&model.waveform, 0, sizeof(model.waveform));
+	const bool parsed = SimMma8451q_WaveformParse(&model.waveform, "roll=90");
+	test_assert(parsed);
+	write_register(MMA8451Q_REG_XYZ_DATA_CFG, 0x00);
+	write_register(MMA8451Q_REG_OFF_Z, 0);
+	SimMma8451q_Acquire(&model, 0);
+	read_full_xyz(&acc);
+	test_equal(acc.xyz[1], 4096);
+	test_equal(acc.xyz[2], 0);
+}
+
+static void test_fifo(void)
+{
+	setup();
+
+	/* circular mode, watermark 4 on INT2 */
+	write_register(MMA8451Q_REG_F_SETUP, (MMA8451Q_FIFOMODE_CIRCULAR << 6) | 4);
+	write_register(MMA8451Q_REG_CTRL_REG4, 0x40);
+	write_register(MMA8451Q_REG_CTRL_REG5, 0x00);
+	write_register(MMA8451Q_REG_CTRL_REG1, 0x01);
+	MMA8451Q_FifoStart(4);
+
+	for (int i = 1; i <= 3; ++i) {
+		sample(100 * i, 0, 1000);
+	}
+	test_equal(SimMma8451q_Lines(&model), 0);
+	test_assert(SimMma8451q_PinHigh(&model, SIM_MMA8451Q_INT2));
+
+	/* the watermark asserts INT2, active low */
+	sample(400, 0, 1000);
+	test_equal(SimMma8451q_Lines(&model), SIM_MMA8451Q_INT2);
+	test_assert(!SimMma8451q_PinHigh(&model, SIM_MMA8451Q_INT2));
+
+	/* one burst of F_STATUS and four samples, oldest first */
+	MMA8451Q_FifoDrain();
+	I2C_HalSimRun();
+	const mma8451q_fifo_batch_t *batch = MMA8451Q_FifoTake();
+	test_assert(batch != NULL);
+	if (batch != NULL) {
+		test_equal(batch->status, 0x40 | 4);
+		test_equal(batch->count, 4);
+		for (int i = 0; i < 4; ++i) {
+			test_equal(batch->samples[i][0], ((100 * (i + 1)) * 4096 + 500) / 1000);
+			test_equal(batch->samples[i][2], 4096);
+		}
+	}
+	test_equal(model.fifoCount, 0);
+	test_equal(SimMma8451q_Lines(&model), 0);
+
+	/* two past full: the oldest two are overwritten, F_OVF stands until F_STATUS is read */
+	for (int i = 0; i < SIM_MMA8451Q_FIFO_DEPTH + 2; ++i) {
+		sample(i, 0, 1000);
+	}
+	test_equal(model.stats.overflows, 2);
+	const uint8_t full = read_register(MMA8451Q_REG_F_STATUS);
+	test_equal(full, 0xC0 | SIM_MMA8451Q_FIFO_DEPTH);
+	const uint8_t read = read_register(MMA8451Q_REG_F_STATUS);
+	test_equal(read, 0x40 | SIM_MMA8451Q_FIFO_DEPTH);
+	test_equal(model.fifo[model.fifoHead][0], 2 * 4096 / 1000);
+
+	/* fill mode keeps the oldest instead */
+	write_register(MMA8451Q_REG_F_SETUP, 0);
+	test_equal(model.fifoCount, 0);
+	write_register(MMA8451Q_REG_F_SETUP, (MMA8451Q_FIFOMODE_FILL << 6) | 4);
+	for (int i = 0; i < SIM_MMA8451Q_FIFO_DEPTH + 2; ++i) {
+		sample(1000 * (i + 1), 0, 1000);
+	}
+	test_equal(model.fifoCount, SIM_MMA8451Q_FIFO_DEPTH);
+	test_equal(model.fifo[model.fifoHead][0], 4096);
+}
+
+static void test_motion(void)
+{
+	setup();
+
+	/* motion above 1008 mg on X, latched, 10 samples debounced and cleared on a miss, on INT1 */
+	write_register(MMA8451Q_REG_FF_MT_CFG, 0xC8);
+	write_register(MMA8451Q_REG_FF_MT_THS, 0x80 | 16);
+	write_register(MMA8451Q_REG_FF_MT_COUNT, 10);
+	write_register(MMA8451Q_REG_CTRL_REG4, 0x04);
+	write_register(MMA8451Q_REG_CTRL_REG5, 0x04);
+	write_register(MMA8451Q_REG_CTRL_REG1, 0x01);
+
+	for (int i = 0; i < 5; ++i) {
+		sample(1500, 0, 1000);
+	}
+	sample(0, 0, 1000);
+	for (int i = 0; i < 9; ++i) {
+		sample(-1500, 0, 1000);
+	}
+	test_equal(model.stats.motionEvents, 0);
+	test_equal(SimMma8451q_Lines(&model), 0);
+
+	sample(-1500, 0, 1000);
+	test_equal(model.stats.motionEvents, 1);
+	test_equal(SimMma8451q_Lines(&model), SIM_MMA8451Q_INT1);
+
+	/* latched past the end of the motion, until FF_MT_SRC is read; the unread data shows as well */
+	sample(0, 0, 1000);
+	const uint8_t source = read_register(MMA8451Q_REG_INT_SOURCE);
+	test_equal(source, 0x04 | 0x01);
+	const uint8_t event = read_register(MMA8451Q_REG_FF_MT_SRC);
+	test_equal(event, 0x80 | 0x03);
+	test_equal(SimMma8451q_Lines(&model), 0);
+	const uint8_t cleared = read_register(MMA8451Q_REG_FF_MT_SRC);
+	test_equal(cleared, 0);
+}
+
+static void test_transient(void)
+{
+	setup();
+
+	/* transient above 504 mg on X, latched, no debounce, on INT2 */
+	write_register(REG_TRANSIENT_CFG, 0x12);
+	write_register(REG_TRANSIENT_THS, 8);
+	write_register(MMA8451Q_REG_TRANSIENT_COUNT, 0);
+	write_register(MMA8451Q_REG_CTRL_REG4, 0x20);
+	write_register(MMA8451Q_REG_CTRL_REG1, 0x01);
+
+	/* the high-pass starts from zero, the first tilted sample is a step; once settled a tilt is gravity */
+	sample(700, 0, 700);
+	test_equal(model.stats.transientEvents, 1);
+	for (int i = 0; i < 40; ++i) {
+		sample(700, 0, 700);
+	}
+	const uint8_t settled = read_register(MMA8451Q_REG_TRANSIENT_SCR);
+	test_equal(settled, 0x40 | 0x02);
+	sample(700, 0, 700);
+	test_equal(SimMma8451q_Lines(&model), 0);
+
+	sample(1400, 0, 700);
+	test_equal(model.stats.transientEvents, 2);
+	test_equal(SimMma8451q_Lines(&model), SIM_MMA8451Q_INT2);
+	const uint8_t event = read_register(MMA8451Q_REG_TRANSIENT_SCR);
+	test_equal(event, 0x40 | 0x02);
+	test_equal(SimMma8451q_Lines(&model), 0);
+}
+
+static void test_waveform(void)
+{
+	sim_mma8451q_waveform_t waveform;
+	int32_t ug[3];
+
+	memset(&waveform, 0, sizeof(waveform));
+	const bool parsed = SimMma8451q_WaveformParse(&waveform, "roll=30,pitch=0,shake=100/40/2000");
+	test_assert(parsed);
+	test_equal(waveform.shakeCount, 1);
+
+	/* in micro-g */
+	SimMma8451q_WaveformSource(&waveform, 0, ug);
+	test_equal(ug[0], 0);
+	test_equal(ug[1], 500000);
+	test_equal(ug[2], 866025);
+
+	/* a quarter period into the shake X peaks, Y crosses gravity */
+	SimMma8451q_WaveformSource(&waveform, 110000, ug);
+	test_equal(ug[0], 2000000);
+	test_equal(ug[1], 500000);
+	SimMma8451q_WaveformSource(&waveform, 140000, ug);
+	test_equal(ug[0], 0);
+
+	/* noise stays within its peak and repeats with its seed */
+	const bool noisy = SimMma8451q_WaveformParse(&waveform, "noise=20,seed=7");
+	test_assert(noisy);
+	int32_t first[3], again[3];
+	SimMma8451q_WaveformSource(&waveform, 0, first);
+	test_assert((first[1] >= 480000) && (first[1] <= 520000));
+	waveform.seed = 7;
+	SimMma8451q_WaveformSource(&waveform, 0, again);
+	test_equal(memcmp(first, again, sizeof(first)), 0);
+
+	const bool unknown = SimMma8451q_WaveformParse(&waveform, "yaw=10");
+	const bool malformed = SimMma8451q_WaveformParse(&waveform, "shake=100/40");
+	const bool empty = SimMma8451q_WaveformParse(&waveform, "roll=");
+	test_assert(!unknown);
+	test_assert(!malformed);
+	test_assert(!empty);
+}
+
+int main(void)
+{
+	test_reset();
+	test_data();
+	test_fifo();
+	test_motion();
+	test_transient();
+	test_waveform();
+
+	printf("%s: passed %d/%d test cases\n", __FILE__, g_tests_passed, g_tests_total);
+	return (g_tests_passed == g_tests_total) ? 0 : 1;
+}
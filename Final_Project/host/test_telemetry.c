@@ -0,0 +1,294 @@
+/*
+ * test_telemetry.c
+ *
+ *  Created on: Dec 18, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host test cases for the telemetry stream: CRC and COBS, the frames telemetry.c
+ *   		writes into the transmit queue, and their decoding by telemetry_stream.c,
+ *   		including dropped samples and corrupt frames.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "telemetry.h"
+#include "telemetry_stream.h"
+#include "mma8451q_drdy.h"
+#include "cobs.h"
+#include "crc16.h"
+#include "queue.h"
+#include "test_host.h"
+
+static int g_tests_passed = 0;
+static int g_tests_total = 0;
+static int g_skip_tests = 0;
+
+/*
+ * @brief Stand-in for the UART transmit queue
+ */
+static uint8_t txStorage[256];
+static Q_T tx = Q_INITIALIZER(txStorage);
+
+size_t Send_Reserve(Q_Span_T span[2], size_t count)
+{
+	return Q_Reserve(&tx, count, span);
+}
+
+void Send_Commit(size_t count)
+{
+	Q_Commit(&tx, count);
+}
+
+/*
+ * @brief Stand-in for the data-ready sample queue
+ */
+static mma8451q_sample_t pending[64];
+static int pendingHead, pendingCount;
+
+bool MMA8451Q_DrdyPop(mma8451q_sample_t *sample)
+{
+	if (pendingHead == pendingCount) {
+		return false;
+	}
+	*sample = pending[pendingHead++];
+	return true;
+}
+
+static void acquire(uint32_t sequence, uint32_t timestamp)
+{
+	mma8451q_sample_t *sample = &pending[pendingCount++];
+	sample->sequence = sequence;
+	sample->timestamp = timestamp;
+	sample->acc.x = (int16_t)(sequence * 3);
+	sample->acc.y = -(int16_t)sequence;
+	sample->acc.z = (int16_t)(8191 - sequence);
+}
+
+/*
+ * @brief What the receiver got
+ */
+static telemetry_record_t records[64];
+static int recordCount;
+
+static void collect(void *context, const telemetry_record_t *record)
+{
+	records[recordCount++] = *record;
+}
+
+/*
+ * @brief Moves everything queued for transmission into the byte stream
+ */
+static uint8_t wire[4096];
+static size_t wireLength;
+
+static void transmit(void)
+{
+	wireLength += Q_Dequeue(&tx, wire + wireLength, sizeof(wire) - wireLength);
+}
+
+static void setup(void)
+{
+	Q_Init(&tx);
+	Telemetry_Init();
+	pendingHead = pendingCount = 0;
+	recordCount = 0;
+	wireLength = 0;
+}
+
+static void test_crc(void)
+{
+	test_equal(CRC16_Compute("123456789", 9), 0x29B1);
+	test_equal(CRC16_Update(CRC16_Update(CRC16_INIT, "1234", 4), "56789", 5), 0x29B1);
+	test_equal(CRC16_Compute("", 0), 0xFFFF);
+}
+
+static void test_cobs(void)
+{
+	uint8_t block[600], encoded[COBS_MAX_ENCODED(600)], decoded[600];
+	uint8_t first[7], second[COBS_MAX_ENCODED(600)];
+
+	/* the examples of the paper */
+	const uint8_t zero[] = { 0x00 };
+	test_equal(Cobs_Encode(zero, 1, encoded, sizeof(encoded), 0), 2);
+	test_equal(encoded[0], 0x01);
+	test_equal(encoded[1], 0x01);
+
+	const uint8_t mixed[] = { 0x11, 0x22, 0x00, 0x33 };
+	test_equal(Cobs_Encode(mixed, 4, encoded, sizeof(encoded), 0), 5);
+	test_equal(memcmp(encoded, "\x03\x11\x22\x02\x33", 5), 0);
+
+	/* round trips: no zeros inside, and split across two output buffers */
+	for (int pattern = 0; pattern < 4; ++pattern) {
+		for (int i = 0; i < sizeof(block); ++i) {
+			block[i] = (pattern == 0) ? 0 : (pattern == 1) ? (uint8_t)(i % 255 + 1) : (pattern == 2) ? (uint8_t)(i * 7) : (uint8_t)((i % 300) ? 0x55 : 0);
+		}
+		for (size_t length = 0; length <= sizeof(block); length += (length < 300) ? 1 : 37) {
+			const size_t n = Cobs_Encode(block, length, encoded, sizeof(encoded), 0);
+			test_assert(n <= COBS_MAX_ENCODED(length));
+			test_assert(memchr(encoded, 0, n) == 0);
+			test_equal(Cobs_Decode(encoded, n, decoded, sizeof(decoded)), length);
+			test_equal(memcmp(decoded, block, length), 0);
+
+			const size_t split = Cobs_Encode(block, length, first, sizeof(first), second);
+			test_equal(split, n);
+			test_equal(memcmp(first, encoded, (n < sizeof(first)) ? n : sizeof(first)), 0);
+			if (n > sizeof(first)) {
+				test_equal(memcmp(second, encoded + sizeof(first), n - sizeof(first)), 0);
+			}
+		}
+	}
+
+	/* malformed: a zero inside, a run past the end, no room */
+	test_equal(Cobs_Decode((const uint8_t *)"\x03\x11\x00", 3, decoded, sizeof(decoded)), -1);
+	test_equal(Cobs_Decode((const uint8_t *)"\x05\x11\x22", 3, decoded, sizeof(decoded)), -1);
+	test_equal(Cobs_Decode((const uint8_t *)"\x03\x11\x22\x02\x33", 5, decoded, 3), -1);
+}
+
+static void test_stream(void)
+{
+	telemetry_stream_t stream;
+
+	setup();
+	for (uint32_t i = 0; i < 20; ++i) {
+		acquire(100 + i, 0xFFFFF000u + i * 60000u);		/* 800 Hz, the counter wraps within */
+	}
+	Telemetry_Poll();
+
+	/* two full frames went out, the other four samples wait for more */
+	test_equal(telemetry_stats.frames, 2);
+	test_equal(telemetry_stats.samples, 16);
+	Telemetry_Flush();
+	test_equal(telemetry_stats.frames, 3);
+	test_equal(telemetry_stats.samples, 20);
+
+	/* a delimiter first, then every frame is terminated, 78 bytes for a full one */
+	transmit();
+	test_equal(wireLength, 1 + telemetry_stats.bytes);
+	test_equal(wire[0], 0);
+	test_equal(wire[78], 0);
+	test_equal(wire[156], 0);
+	test_equal(wire[wireLength - 1], 0);
+	test_equal(wireLength, 1 + 2 * 78 + COBS_MAX_ENCODED(TELEMETRY_HEADER_SIZE + 4 * TELEMETRY_SAMPLE_SIZE + TELEMETRY_CRC_SIZE) + 1);
+
+	TelemetryStream_Init(&stream, collect, 0);
+	TelemetryStream_Feed(&stream, wire, wireLength);
+	test_equal(stream.frames, 3);
+	test_equal(stream.samples, 20);
+	test_equal(stream.dropped, 0);
+	test_equal(stream.corrupt, 0);
+	test_equal(recordCount, 20);
+	for (int i = 0; i < 20; ++i) {
+		test_equal(records[i].sequence, 100 + i);
+		test_equal(records[i].x, (100 + i) * 3);
+		test_equal(records[i].y, -(100 + i));
+		test_equal(records[i].z, 8191 - (100 + i));
+		/* per sample offsets are in 64 cycle units, 60000 is not a multiple */
+		test_equal(records[i].cycles, (uint64_t)i * 60000u - ((i % 8) * 60000u) % 64);
+	}
+}
+
+static void test_dropped_and_corrupt(void)
+{
+	telemetry_stream_t stream;
+
+	setup();
+
+	/* the boot log comes first, the receiver joins midway through it */
+	const char *boot = "\r\n Clock Gating and Instantiation for UART0 at 115200 Baud Rate Complete";
+	Q_Init(&tx);
+	Q_Enqueue(&tx, boot, strlen(boot));
+	Telemetry_Init();
+
+	/* 1..5, then 8..10: the gap closes the frame early */
+	for (uint32_t i = 1; i <= 10; ++i) {
+		if ((i != 6) && (i != 7)) {
+			acquire(i, i * 60000u);
+		}
+	}
+	Telemetry_Poll();
+	Telemetry_Flush();
+	test_equal(telemetry_stats.frames, 2);
+	transmit();
+
+	/* a third frame, damaged on the wire */
+	acquire(11, 11 * 60000u);
+	Telemetry_Poll();
+	Telemetry_Flush();
+	const size_t damaged = wireLength + 5;
+	transmit();
+	wire[damaged] ^= 0x10;
+
+	/* and a good one after it */
+	acquire(12, 12 * 60000u);
+	Telemetry_Poll();
+	Telemetry_Flush();
+	transmit();
+
+	TelemetryStream_Init(&stream, collect, 0);
+	TelemetryStream_Feed(&stream, wire, wireLength);
+	test_equal(stream.skipped, 1);
+	test_equal(stream.frames, 3);
+	test_equal(stream.corrupt, 1);
+	test_equal(stream.samples, 9);
+	test_equal(stream.dropped, 2 + 1);
+	test_equal(records[5].sequence, 8);
+	test_equal(records[8].sequence, 12);
+
+	/* a stream cut into arbitrary pieces decodes the same */
+	recordCount = 0;
+	TelemetryStream_Init(&stream, collect, 0);
+	for (size_t i = 0; i < wireLength; i += 3) {
+		TelemetryStream_Feed(&stream, wire + i, (wireLength - i < 3) ? wireLength - i : 3);
+	}
+	test_equal(stream.frames, 3);
+	test_equal(stream.corrupt, 1);
+	test_equal(recordCount, 9);
+}
+
+static void test_queue_full(void)
+{
+	uint8_t filler[200] = { 1 };
+
+	setup();
+
+	/* the transmitter is behind: a frame does not fit and is dropped whole */
+	Q_Init(&tx);
+	Q_Enqueue(&tx, filler, sizeof(filler));
+	for (uint32_t i = 1; i <= 8; ++i) {
+		acquire(i, i * 60000u);
+	}
+	Telemetry_Poll();
+	test_equal(telemetry_stats.framesDropped, 1);
+	test_equal(telemetry_stats.samplesDropped, 8);
+	test_equal(telemetry_stats.frames, 0);
+	test_equal(Q_Length(&tx), sizeof(filler));
+
+	/* once it caught up frames go out again, wrapping the queue storage */
+	Q_Dequeue(&tx, filler, sizeof(filler));
+	for (uint32_t i = 9; i <= 16; ++i) {
+		acquire(i, i * 60000u);
+	}
+	Telemetry_Poll();
+	test_equal(telemetry_stats.frames, 1);
+	transmit();
+
+	telemetry_stream_t stream;
+	TelemetryStream_Init(&stream, collect, 0);
+	TelemetryStream_Feed(&stream, wire, wireLength);
+	test_equal(stream.frames, 1);
+	test_equal(stream.corrupt, 0);
+	test_equal(records[0].sequence, 9);
+}
+
+int main(void)
+{
+	test_crc();
+	test_cobs();
+	test_stream();
+	test_dropped_and_corrupt();
+	test_queue_full();
+
+	printf("%s: passed %d/%d test cases\n", __FILE__, g_tests_passed, g_tests_total);
+	return (g_tests_passed == g_tests_total) ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+/*
+ * test_tilt.c
+ *
+ *  Created on: Dec 19, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host test cases for the integer tilt kernel of tilt.c, with the accuracy sweep
+ *   		against atan2() in double precision. make test sweeps a subset; make sweep builds
+ *   		this with TILT_EXHAUSTIVE for every 14bit (Y, Z) pair for roll and every 14bit X
+ *   		over a 64x64 grid of (Y, Z) for pitch, about half a minute.
+ */
+
+#include <stdio.h>
+#include <math.h>
+
+#include "tilt.h"
+#include "test_host.h"
+
+static int g_tests_passed = 0;
+static int g_tests_total = 0;
+static int g_skip_tests = 0;
+
+#define TILT_MIN		(-8192)
+#define TILT_MAX		(8191)
+
+/*
+ * @brief Strides of the sweeps: over Y and Z for roll, over X, and over the (Y, Z) grid for pitch
+ */
+#ifdef TILT_EXHAUSTIVE
+#define TILT_STEP		(1)
+#define TILT_GRID		(256)
+#else
+#define TILT_STEP		(7)
+#define TILT_GRID		(1024)
+#endif
+
+/*
+ * @brief Worst and mean error, in centi-degrees
+ */
+#define TILT_MAX_ERROR	(1.0)
+#define TILT_RMS_ERROR	(0.4)
+
+static double reference(double y, double x)
+{
+	return atan2(y, x) * 180.0 / M_PI * TILT_CENTIDEGREES;
+}
+
+static void test_points(void)
+{
+	int16_t roll, pitch;
+
+	test_equal(Tilt_Atan2(0, 0), 0);
+	test_equal(Tilt_Atan2(0, 4096), 0);
+	test_equal(Tilt_Atan2(4096, 0), 9000);
+	test_equal(Tilt_Atan2(-4096, 0), -9000);
+	test_equal(Tilt_Atan2(0, -4096), 18000);
+	test_equal(Tilt_Atan2(1, 1), 4500);
+	test_equal(Tilt_Atan2(-8192, -8192), -13500);
+	test_equal(Tilt_Atan2(8191, -8192), 13500);
+	test_equal(Tilt_Atan2(1, 8191), 1);		/* 0.007 degrees */
+
+	/* flat on the table: 1 g on Z */
+	Tilt_RollPitch(0, 0, 4096, &roll, &pitch);
+	test_equal(roll, 0);
+	test_equal(pitch, 0);
+
+	/* on its side, standing on its edge, upside down */
+	Tilt_RollPitch(0, 4096, 0, &roll, &pitch);
+	test_equal(roll, 9000);
+	test_equal(pitch, 0);
+	Tilt_RollPitch(-4096, 0, 0, &roll, &pitch);
+	test_equal(roll, 0);
+	test_equal(pitch, -9000);
+	Tilt_RollPitch(0, 0, -4096, &roll, &pitch);
+	test_equal(roll, 18000);
+	test_equal(pitch, 0);
+
+	/* 30 degrees of pitch, 45 of roll */
+	Tilt_RollPitch(2048, 2508, 2508, &roll, &pitch);
+	test_equal(roll, 4500);
+	test_assert(fabs(pitch - reference(2048, sqrt(2.0 * 2508 * 2508))) <= TILT_MAX_ERROR);
+
+	/* free fall */
+	Tilt_RollPitch(0, 0, 0, &roll, &pitch);
+	test_equal(roll, 0);
+	test_equal(pitch, 0);
+}
+
+static void test_roll_sweep(void)
+{
+	double worst = 0, sum = 0;
+	long count = 0;
+
+	for (int y = TILT_MIN; y <= TILT_MAX; y += TILT_STEP) {
+		for (int z = TILT_MIN; z <= TILT_MAX; z += TILT_STEP) {
+			double error = Tilt_Atan2(y, z) - reference(y, z);
+			/* +-180 degrees are the same angle */
+			if (error > 18000) {
+				error -= 36000;
+			}
+			else if (error < -18000) {
+				error += 36000;
+			}
+			error = fabs(error);
+			worst = (error > worst) ? error : worst;
+			sum += error * error;
+			count++;
+		}
+	}
+
+	printf("roll:  %ld inputs, max error %.3f, rms %.3f centi-degrees\n", count, worst, sqrt(sum / count));
+	test_assert(worst <= TILT_MAX_ERROR);
+	test_assert(sqrt(sum / count) <= TILT_RMS_ERROR);
+}
+
+static void test_pitch_sweep(void)
+{
+	double worst = 0, sum = 0;
+	long count = 0;
+	int16_t roll, pitch;
+
+	for (int y = TILT_MIN; y <= TILT_MAX; y += TILT_GRID) {
+		for (int z = TILT_MIN; z <= TILT_MAX; z += TILT_GRID) {
+			for (int x = TILT_MIN; x <= TILT_MAX; x += TILT_STEP) {
+				Tilt_RollPitch(x, y, z, &roll, &pitch);
+				const double error = fabs(pitch - reference(x, sqrt((double)y * y + (double)z * z)));
+				worst = (error > worst) ? error : worst;
+				sum += error * error;
+				count++;
+			}
+		}
+	}
+
+	printf("pitch: %ld inputs, max error %.3f, rms %.3f centi-degrees\n", count, worst, sqrt(sum / count));
+	test_assert(worst <= TILT_MAX_ERROR);
+	test_assert(sqrt(sum / count) <= TILT_RMS_ERROR);
+}
+
+int main(void)
+{
+	test_points();
+	test_roll_sweep();
+	test_pitch_sweep();
+
+	printf("%s: passed %d/%d test cases\n", __FILE__, g_tests_passed, g_tests_total);
+	return (g_tests_passed == g_tests_total) ? 0 : 1;
+}
@@ -0,0 +1,243 @@
+/*
+ * test_timer_wheel.c
+ *
+ *  Created on: Dec 26, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host test cases for the software timer wheel: one-shot and periodic expiry to the
+ *   		millisecond, delays of several turns, stop and restart, callbacks that stop or
+ *   		re-arm timers of the same slot, a thread that falls behind the tick, and the
+ *   		earliest expiry the idle hook sleeps to
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "timer_wheel.h"
+#include "test_host.h"
+
+static int g_tests_passed = 0;
+static int g_tests_total = 0;
+static int g_skip_tests = 0;
+
+/* the millisecond counter of systick.c, read through systemTime() */
+volatile uint32_t SystemMilliseconds;
+
+/* expiries seen, as (timer index, time) */
+static struct {
+	int index;
+	uint32_t at;
+} fired[64];
+static int fired_count;
+
+static sw_timer_t timers[4];
+
+static void record(sw_timer_t *timer)
+{
+	if (fired_count < 64) {
+		fired[fired_count].index = (int)(timer - timers);
+		fired[fired_count].at = SystemMilliseconds;
+		fired_count++;
+	}
+}
+
+/* stops the timer its context points to */
+static void stop_other(sw_timer_t *timer)
+{
+	record(timer);
+	Timer_Stop((sw_timer_t *)timer->context);
+}
+
+/* re-arms itself as a one-shot, twice */
+static void rearm(sw_timer_t *timer)
+{
+	record(timer);
+	if (fired_count < 3) {
+		Timer_Start(timer, 5, 0);
+	}
+}
+
+/* the tick handler, one millisecond at a time */
+static void run_to(uint32_t ms)
+{
+	while (SystemMilliseconds != ms) {
+		SystemMilliseconds++;
+		Timer_Expire(SystemMilliseconds);
+	}
+}
+
+static void setup(void)
+{
+	for (int i = 0; i < 4; ++i) {
+		Timer_Stop(&timers[i]);
+		Timer_Init(&timers[i], record, 0);
+	}
+	memset(&timer_wheel_stats, 0, sizeof(timer_wheel_stats));
+	fired_count = 0;
+}
+
+static void test_oneshot(void)
+{
+	setup();
+	run_to(1000);
+
+	Timer_Start(&timers[0], 10, 0);
+	Timer_Start(&timers[1], 100, 0);
+	test_assert(Timer_Armed(&timers[0]));
+	test_equal(timer_wheel_stats.armed, 2);
+
+	run_to(1009);
+	test_equal(fired_count, 0);
+	run_to(1010);
+	test_equal(fired_count, 1);
+	test_equal(fired[0].index, 0);
+	test_assert(!Timer_Armed(&timers[0]));
+
+	/* 100 ms is three turns and a bit of 32 slots, the passes before leave it alone */
+	run_to(1099);
+	test_equal(fired_count, 1);
+	run_to(1200);
+	test_equal(fired_count, 2);
+	test_equal(fired[1].index, 1);
+	test_equal(fired[1].at, 1100);
+	test_equal(timer_wheel_stats.armed, 0);
+	test_equal(timer_wheel_stats.maxLate, 0);
+
+	/* no delay is the next millisecond */
+	Timer_Start(&timers[2], 0, 0);
+	run_to(1201);
+	test_equal(fired_count, 3);
+	test_equal(fired[2].at, 1201);
+}
+
+static void test_periodic(void)
+{
+	setup();
+	run_to(2000);
+
+	Timer_Start(&timers[0], 7, 20);
+	run_to(2100);
+	test_equal(fired_count, 5);
+	bool spaced = true;
+	for (int i = 0; i < 5; ++i) {
+		spaced = spaced && (fired[i].at == 2007u + 20u * i);
+	}
+	test_assert(spaced);
+	test_assert(Timer_Armed(&timers[0]));
+
+	Timer_Stop(&timers[0]);
+	Timer_Stop(&timers[0]);
+	run_to(2200);
+	test_equal(fired_count, 5);
+	test_equal(timer_wheel_stats.armed, 0);
+
+	/* a restart moves the expiry */
+	Timer_Start(&timers[1], 50, 0);
+	run_to(2230);
+	Timer_Start(&timers[1], 50, 0);
+	run_to(2251);
+	test_equal(fired_count, 5);
+	run_to(2280);
+	test_equal(fired_count, 6);
+	test_equal(fired[5].at, 2280);
+	test_equal(timer_wheel_stats.armed, 0);
+}
+
+static void test_callbacks(void)
+{
+	setup();
+	run_to(3000);
+
+	/* same tick, same slot: timer 1 is linked after timer 0 and stopped by it */
+	Timer_Init(&timers[0], stop_other, &timers[1]);
+	Timer_Start(&timers[1], 32, 0);
+	Timer_Start(&timers[0], 32, 0);
+	Timer_Start(&timers[2], 64, 0);
+	run_to(3100);
+	test_equal(fired_count, 2);
+	test_equal(fired[0].index, 0);
+	test_equal(fired[1].index, 2);
+	test_equal(timer_wheel_stats.armed, 0);
+
+	/* a one-shot re-armed from its own callback */
+	setup();
+	Timer_Init(&timers[3], rearm, 0);
+	Timer_Start(&timers[3], 5, 0);
+	run_to(3200);
+	test_equal(fired_count, 3);
+	test_equal(fired[0].at, 3105);
+	test_equal(fired[1].at, 3110);
+	test_equal(fired[2].at, 3115);
+	test_equal(timer_wheel_stats.fired, 3);
+}
+
+static void test_late(void)
+{
+	setup();
+	run_to(4000);
+
+	Timer_Start(&timers[0], 100, 100);
+	Timer_Start(&timers[1], 120, 0);
+
+	/* the thread was busy for 250 ms: both fire once, in order, the periodic skips what it missed */
+	SystemMilliseconds = 4250;
+	Timer_Expire(SystemMilliseconds);
+	test_equal(fired_count, 2);
+	test_equal(fired[0].index, 0);
+	test_equal(fired[1].index, 1);
+	test_equal(timer_wheel_stats.maxLate, 150);
+
+	run_to(4349);
+	test_equal(fired_count, 2);
+	run_to(4350);
+	test_equal(fired_count, 3);
+
+	/* a timer started while the wheel is behind counts from the time now */
+	SystemMilliseconds = 4400;
+	Timer_Start(&timers[2], 10, 0);
+	Timer_Expire(4405);
+	test_equal(fired_count, 3);
+	Timer_Expire(4410);
+	test_equal(fired_count, 4);
+	test_equal(fired[3].index, 2);
+	Timer_Stop(&timers[0]);
+}
+
+static void test_next_expiry(void)
+{
+	uint32_t expires = 0;
+
+	setup();
+	run_to(5000);
+	test_assert(!Timer_NextExpiry(&expires));
+
+	/* the earliest, whichever slot and turn it is in */
+	Timer_Start(&timers[0], 100, 0);
+	Timer_Start(&timers[1], 40, 0);
+	Timer_Start(&timers[2], 33, 50);
+	test_assert(Timer_NextExpiry(&expires));
+	test_equal(expires, 5033);
+
+	run_to(5033);
+	test_assert(Timer_NextExpiry(&expires));
+	test_equal(expires, 5040);
+	run_to(5040);
+	test_assert(Timer_NextExpiry(&expires));
+	test_equal(expires, 5083);
+
+	Timer_Stop(&timers[0]);
+	Timer_Stop(&timers[2]);
+	test_assert(!Timer_NextExpiry(&expires));
+}
+
+int main(void)
+{
+	test_oneshot();
+	test_periodic();
+	test_callbacks();
+	test_late();
+	test_next_expiry();
+
+	printf("%s: passed %d/%d test cases\n", __FILE__, g_tests_passed, g_tests_total);
+	return (g_tests_passed == g_tests_total) ? 0 : 1;
+}
@@ -0,0 +1,475 @@
+/*
+ * test_timestamp.c
+ *
+ *  Created on: Dec 27, 2020
+ *      Author: Arpit Savarkar
+ *
+ *   @brief Host test cases for the 64 bit timestamps of systick.c, run on the SysTick and SCB
+ *   		registers of the board remap: cycles and microseconds within a tick and across
+ *   		reloads, a reload pending while the handler is masked, the 32 bit wrap of the
+ *   		cycle count, reads interrupted by the SysTick handler at random points, reads
+ *   		interrupting the handler before it counted its reload, and the
+ *   		tickless sleep: stretched to a deadline, woken early anywhere in it, and skipped
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#include "MKL25Z4.h"
+#include "systick.h"
+#include "delay.h"
+#include "test_host.h"
+
+static int g_tests_passed = 0;
+static int g_tests_total = 0;
+static int g_skip_tests = 0;
+
+/* the registers systick.c reads, plain memory here */
+SysTick_Type board_systick;
+SCB_Type board_scb;
+
+void *Board_Poll(void *peripheral) { return peripheral; }
+void Board_NvicEnableIRQ(IRQn_Type irq) {}
+void Board_NvicClearPendingIRQ(IRQn_Type irq) {}
+void Board_NvicSetPriority(IRQn_Type irq, uint32_t priority) {}
+
+extern void SysTick_Handler(void);
+
+#define CYCLES_PER_TICK		(SYSTICK_TMR_RELOAD_VAL + 1)
+
+/* cycles into the running tick, as the down-counter shows them */
+static void set_elapsed(uint32_t cycles)
+{
+	SysTick->VAL = SYSTICK_TMR_RELOAD_VAL - cycles;
+}
+
+static void setup(void)
+{
+	memset(&board_scb, 0, sizeof(board_scb));
+	InitSysTick();
+	set_elapsed(0);
+}
+
+static void test_tick(void)
+{
+	setup();
+
+	uint64_t cycles = timestamp_cycles();
+	uint64_t us = timestamp_us();
+	test_equal(cycles, 0);
+	test_equal(us, 0);
+
+	set_elapsed(480);
+	cycles = timestamp_cycles();
+	us = timestamp_us();
+	test_equal(cycles, 480);
+	test_equal(us, 10);
+
+	/* 47 cycles is still the first microsecond */
+	set_elapsed(SYSTICK_TMR_RELOAD_VAL);
+	us = timestamp_us();
+	test_equal(us, 249);
+
+	/* three reloads */
+	for (int i = 0; i < 3; ++i) {
+		SysTick_Handler();
+	}
+	set_elapsed(96);
+	cycles = timestamp_cycles();
+	us = timestamp_us();
+	test_equal(cycles, 3 * CYCLES_PER_TICK + 96);
+	test_equal(us, 3 * 250 + 2);
+	test_equal(cycle_count(), 3 * CYCLES_PER_TICK + 96);
+	test_equal(now(), 3);
+}
+
+static void test_pending(void)
+{
+	setup();
+	SysTick_Handler();
+
+	/* the counter reloaded, the handler is held back by the caller's priority */
+	SCB->ICSR |= SCB_ICSR_PENDSTSET_Msk;
+	set_elapsed(10);
+	uint64_t cycles = timestamp_cycles();
+	uint64_t us = timestamp_us();
+	test_equal(cycles, 2 * CYCLES_PER_TICK + 10);
+	test_equal(us, 500);
+
+	/* the handler runs: same time, now from the sums */
+	SCB->ICSR &= ~SCB_ICSR_PENDSTSET_Msk;
+	SysTick_Handler();
+	cycles = timestamp_cycles();
+	test_equal(cycles, 2 * CYCLES_PER_TICK + 10);
+}
+
+static void test_scaling(void)
+{
+	setup();
+	SysTick_Handler();
+
+	/* every count of the down-counter, with and without a pending reload */
+	bool exact = true;
+	for (uint32_t elapsed = 0; elapsed < CYCLES_PER_TICK; ++elapsed) {
+		set_elapsed(elapsed);
+		SCB->ICSR = 0;
+		exact = exact && (timestamp_us() == 250 + elapsed / 48);
+		SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
+		exact = exact && (timestamp_us() == 500 + elapsed / 48);
+	}
+	SCB->ICSR = 0;
+	test_assert(exact);
+}
+
+static void test_wrap(void)
+{
+	setup();
+
+	/* past 2^32 cycles: the 64 bit count goes on, cycle_count() is its low word */
+	const uint32_t ticks = (uint32_t)((1ull << 32) / CYCLES_PER_TICK) + 2;
+	bool monotonic = true;
+	uint64_t last = 0;
+	for (uint32_t i = 0; i < ticks; ++i) {
+		SysTick_Handler();
+		const uint64_t cycles = timestamp_cycles();
+		monotonic = monotonic && (cycles > last);
+		last = cycles;
+	}
+	test_assert(monotonic);
+	test_equal(last, (uint64_t)ticks * CYCLES_PER_TICK);
+	test_assert(last > (1ull << 32));
+	test_equal(cycle_count(), (uint32_t)last);
+	const uint64_t us = timestamp_us();
+	test_equal(us, (uint64_t)ticks * 250);
+}
+
+/* a more urgent ISR taken inside SysTick_Handler(), when it unmasks with host_pending set;
+ * it reads the time, after one more reload if asked */
+static bool urgent_reloads;
+static uint32_t urgent_reads;
+static uint64_t urgent_cycles;
+static uint64_t urgent_us;
+
+void Host_InterruptsUnmasked(void)
+{
+	host_pending = 0;
+	if (urgent_reloads) {
+		SCB->ICSR |= SCB_ICSR_PENDSTSET_Msk;
+		set_elapsed(7);
+	}
+	urgent_cycles = timestamp_cycles();
+	urgent_us = timestamp_us();
+	urgent_reads++;
+}
+
+static void test_handler_preempted(void)
+{
+	setup();
+	for (int i = 0; i < 3; ++i) {
+		SysTick_Handler();
+	}
+	set_elapsed(SYSTICK_TMR_RELOAD_VAL);
+	const uint64_t before = timestamp_cycles();
+
+	/* the fourth reload: the entry clears the pending bit, the ISR lands before the sums moved */
+	set_elapsed(5);
+	SCB->ICSR &= ~SCB_ICSR_PENDSTSET_Msk;
+	urgent_reads = 0;
+	urgent_reloads = false;
+	host_pending = 1;
+	SysTick_Handler();
+	test_equal(urgent_reads, 1);
+	test_assert(urgent_cycles > before);
+	test_equal(urgent_cycles, 4 * CYCLES_PER_TICK + 5);
+	test_equal(urgent_us, 4 * 250);
+	test_equal(timestamp_cycles(), 4 * CYCLES_PER_TICK + 5);
+
+	/* held there past the next reload: both periods count, and the pending handler adds nothing */
+	for (int i = 0; i < 3; ++i) {
+		SysTick_Handler();
+	}
+	set_elapsed(5);
+	urgent_reloads = true;
+	host_pending = 1;
+	SysTick_Handler();
+	test_equal(urgent_reads, 2);
+	test_equal(urgent_cycles, 9 * CYCLES_PER_TICK + 7);
+	test_equal(urgent_us, 9 * 250);
+	test_equal(timestamp_cycles(), 9 * CYCLES_PER_TICK + 7);
+	SCB->ICSR &= ~SCB_ICSR_PENDSTSET_Msk;
+	SysTick_Handler();
+	test_equal(timestamp_cycles(), 9 * CYCLES_PER_TICK + 7);
+	test_equal(now(), 9);
+}
+
+/* the SysTick of the preemption test: counts down, reloads, sometimes with the handler held back a while */
+static volatile uint32_t interrupts;
+static volatile uint32_t reloads;
+
+static void on_alarm(int signal)
+{
+	interrupts++;
+	if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+		SCB->ICSR &= ~SCB_ICSR_PENDSTSET_Msk;
+		SysTick_Handler();
+		return;
+	}
+
+	const uint32_t step = 1 + (interrupts * 2654435761u) % 4000;
+	if (SysTick->VAL >= step) {
+		SysTick->VAL -= step;
+		return;
+	}
+	SysTick->VAL = SYSTICK_TMR_RELOAD_VAL - (step - SysTick->VAL - 1);
+	reloads++;
+	if (interrupts & 1) {
+		SCB->ICSR |= SCB_ICSR_PENDSTSET_Msk;
+	}
+	else {
+		SysTick_Handler();
+	}
+}
+
+static void test_preemption(void)
+{
+	setup();
+	interrupts = reloads = 0;
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = on_alarm;
+	sigaction(SIGALRM, &action, 0);
+
+	const struct itimerval period = { { 0, 20 }, { 0, 20 } };
+	setitimer(ITIMER_REAL, &period, 0);
+
+	/* the handler lands between any two loads of a read; a torn one goes backwards */
+	bool monotonic = true;
+	uint64_t lastCycles = 0;
+	uint64_t lastUs = 0;
+	while (reloads < 200) {
+		const uint64_t cycles = timestamp_cycles();
+		const uint64_t us = timestamp_us();
+		monotonic = monotonic && (cycles >= lastCycles) && (us >= lastUs);
+		lastCycles = cycles;
+		lastUs = us;
+	}
+
+	const struct itimerval stop = { { 0, 0 }, { 0, 0 } };
+	setitimer(ITIMER_REAL, &stop, 0);
+	signal(SIGALRM, SIG_DFL);
+
+	test_assert(monotonic);
+	test_assert(lastCycles >= 199ull * CYCLES_PER_TICK);
+	test_assert(lastUs >= 199ull * 250);
+}
+
+/* the SysTick of the sleep tests: LOAD taken at each reload, a write to VAL starts over,
+ * WFI returns at a reload or at another interrupt */
+#define NEVER	(UINT64_MAX)
+
+static uint64_t hw_now;			/* true core clock */
+static uint64_t hw_epoch;		/* the last reload */
+static uint32_t hw_period;		/* LOAD + 1 taken then */
+static uint32_t hw_shown;		/* VAL as last shown */
+static uint64_t hw_wake;		/* another interrupt comes */
+static bool hw_irq;				/* it is pending */
+static uint32_t hw_sleeps;
+static uint32_t hw_ms;			/* systemTime() at hw_now 0 */
+
+static void hw_sync(void)
+{
+	if (SCB->ICSR & SCB_ICSR_PENDSTCLR_Msk) {
+		SCB->ICSR &= ~(SCB_ICSR_PENDSTCLR_Msk | SCB_ICSR_PENDSTSET_Msk);
+	}
+	if (SysTick->VAL != hw_shown) {
+		hw_epoch = hw_now;
+		hw_period = SysTick->LOAD + 1;
+	}
+}
+
+static void hw_run(uint64_t until)
+{
+	hw_sync();
+	while (hw_epoch + hw_period <= until) {
+		hw_epoch += hw_period;
+		hw_period = SysTick->LOAD + 1;
+		SCB->ICSR |= SCB_ICSR_PENDSTSET_Msk;
+	}
+	if (hw_wake <= until) {
+		hw_wake = NEVER;
+		hw_irq = true;
+	}
+	hw_now = until;
+	SysTick->VAL = hw_period - 1 - (uint32_t)(hw_now - hw_epoch);
+	hw_shown = SysTick->VAL;
+}
+
+static void hw_sleep(void)
+{
+	hw_sleeps++;
+	hw_sync();
+	if (hw_irq || (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)) {
+		return;
+	}
+	const uint64_t reload = hw_epoch + hw_period;
+	hw_run((hw_wake < reload) ? hw_wake : reload);
+}
+
+/* PRIMASK cleared: the pending interrupts run */
+static void hw_unmask(void)
+{
+	hw_run(hw_now);
+	if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+		SCB->ICSR &= ~SCB_ICSR_PENDSTSET_Msk;
+		SysTick_Handler();
+	}
+	hw_irq = false;
+}
+
+/* runs to a time, taking the ticks on the way */
+static void hw_run_to(uint64_t until)
+{
+	while (hw_epoch + hw_period <= until) {
+		hw_run(hw_epoch + hw_period);
+		hw_unmask();
+	}
+	hw_run(until);
+}
+
+static void sleep_setup(uint32_t start)
+{
+	setup();
+	hw_ms = systemTime();
+	hw_now = 0;
+	hw_wake = NEVER;
+	hw_irq = false;
+	hw_shown = ~0u;
+	hw_run(0);
+	hw_run_to(start);
+}
+
+static void test_sleep_deadline(void)
+{
+	/* from 1.3 ticks into a millisecond to 40 ms on: one stretched period, one tick handler */
+	sleep_setup(5 * CYCLES_PER_TICK + 3600);
+	const uint32_t ms = systemTime() + 40;
+	hw_sleeps = 0;
+	const uint32_t suppressed = SysTick_SleepUntil(ms, hw_sleep);
+	test_equal(hw_sleeps, 2);
+	test_equal(hw_now, (uint64_t)(ms - hw_ms) * 4 * CYCLES_PER_TICK);
+	test_equal(timestamp_cycles(), hw_now);
+	test_equal(suppressed, 40 * 4 - 1 - 1);
+	hw_unmask();
+	test_equal(systemTime(), ms);
+	test_equal(now(), (ms - hw_ms) * 4);
+	test_equal(SysTick->LOAD, SYSTICK_TMR_RELOAD_VAL);
+
+	/* the ticks go on as before */
+	hw_run_to(hw_now + 10 * CYCLES_PER_TICK + 5);
+	test_equal(timestamp_cycles(), hw_now);
+	test_equal(now(), (ms - hw_ms) * 4 + 10);
+
+	/* two ticks ahead is too near, so is a millisecond in the past */
+	hw_sleeps = 0;
+	test_equal(SysTick_SleepUntil(systemTime() + 1, hw_sleep), 0);
+	test_equal(SysTick->LOAD, SYSTICK_TMR_RELOAD_VAL);
+	test_equal(SysTick_SleepUntil(systemTime() - 1, hw_sleep), 0);
+	test_equal(hw_sleeps, 2);
+
+	/* far ahead: at most the 24 bit LOAD */
+	hw_unmask();
+	const uint64_t from = hw_now;
+	SysTick_SleepUntil(systemTime() + 10000, hw_sleep);
+	hw_unmask();
+	test_assert(hw_now - from <= (uint64_t)(SYSTICK_SLEEP_MAX_TICKS + 1) * CYCLES_PER_TICK);
+	test_assert(hw_now - from > (uint64_t)SYSTICK_SLEEP_MAX_TICKS * CYCLES_PER_TICK);
+	test_equal(timestamp_cycles(), hw_now);
+}
+
+static void test_sleep_early(void)
+{
+	/* woken at every point of a 20 ms sleep: the time is exact and monotonic throughout,
+	 * the counter is back on the tick grid three ticks later */
+	bool exact = true, monotonic = true, grid = true, restored = true;
+
+	for (uint32_t wake = 1; wake < 20 * 4 * CYCLES_PER_TICK; wake += 40009) {
+		sleep_setup(7 * CYCLES_PER_TICK + 1000);
+		const uint32_t ms = systemTime() + 20;
+		const uint64_t before = timestamp_cycles();
+		hw_wake = hw_now + wake;
+		SysTick_SleepUntil(ms, hw_sleep);
+		hw_run(hw_now);
+
+		const uint64_t woken = timestamp_cycles();
+		exact = exact && (woken == hw_now);
+		monotonic = monotonic && (woken >= before);
+		hw_unmask();
+		exact = exact && (timestamp_cycles() == hw_now);
+
+		/* through the restart periods, reading at odd points */
+		uint64_t last = woken;
+		for (int step = 0; step < 14; ++step) {
+			hw_run_to(hw_now + 3001);
+			const uint64_t cycles = timestamp_cycles();
+			exact = exact && (cycles == hw_now);
+			/* the microseconds round down the sums and the counter apart, a microsecond at most */
+			const uint64_t us = timestamp_us();
+			exact = exact && (us <= cycles / 48) && (us + 1 >= cycles / 48);
+			monotonic = monotonic && (cycles >= last);
+			last = cycles;
+		}
+		grid = grid && ((hw_epoch % CYCLES_PER_TICK) == 0) && (now() == hw_epoch / CYCLES_PER_TICK);
+		restored = restored && (SysTick->LOAD == SYSTICK_TMR_RELOAD_VAL);
+	}
+	test_assert(exact);
+	test_assert(monotonic);
+	test_assert(grid);
+	test_assert(restored);
+
+	/* woken just short of the deadline: the millisecond is not counted yet, and is within
+	 * half a tick late, when the first of the periods back to the grid ends */
+	sleep_setup(3 * CYCLES_PER_TICK);
+	const uint32_t ms = systemTime() + 12;
+	hw_wake = (uint64_t)(ms - hw_ms) * 4 * CYCLES_PER_TICK - 10;
+	SysTick_SleepUntil(ms, hw_sleep);
+	hw_unmask();
+	test_equal(systemTime(), ms - 1);
+	hw_run_to(hw_now + CYCLES_PER_TICK / 2);
+	test_equal(systemTime(), ms - 1);
+	hw_run_to(hw_now + 20);
+	test_equal(systemTime(), ms);
+	test_equal(timestamp_cycles(), hw_now);
+}
+
+static void test_skip(void)
+{
+	sleep_setup(2 * CYCLES_PER_TICK + 100);
+	const uint64_t before = timestamp_cycles();
+	SysTick_Skip(4001);
+	test_equal(timestamp_cycles(), before + 4001ull * CYCLES_PER_TICK);
+	test_equal(now(), 4003);
+	test_equal(systemTime(), hw_ms + 1000);
+	const uint64_t us = timestamp_us();
+	test_equal(us, 4003ull * 250 + 2);
+}
+
+int main(void)
+{
+	test_tick();
+	test_pending();
+	test_scaling();
+	test_wrap();
+	test_preemption();
+	test_handler_preempted();
+	test_sleep_deadline();
+	test_sleep_early();
+	test_skip();
+	printf("\n");
+
+	printf("%s: passed %d/%d test cases\n", __FILE__, g_tests_passed, g_tests_total);
+	return (g_tests_passed == g_tests_total) ? 0 : 1;
+}
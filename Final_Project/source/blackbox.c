@@ -0,0 +1,426 @@
+/*
+ * blackbox.c
+ *
+ *  Created on: Dec 30, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: The black box: the samples around every jerk, kept in flash.
+ *
+ *    Sources of Reference :
+ * 		KL25 Sub-Family Reference Manual, Chapter 27 (Flash Memory Module)
+ */
+
+#include <string.h>
+#include "MKL25Z4.h"
+#include "blackbox.h"
+#include "nvm.h"
+#include "crc16.h"
+#include "systick.h"
+#include "global_defs.h"
+
+#define RING_MASK		(BLACKBOX_RING_SAMPLES - 1)
+
+#if (BLACKBOX_RING_SAMPLES & RING_MASK) != 0
+#error "BLACKBOX_RING_SAMPLES must be a power of two"
+#endif
+
+/**
+ * @brief Bytes of a hex line of {@see BlackBox_Dump}
+ */
+#define DUMP_LINE		(32)
+
+/**
+ * @brief Where a capture stands
+ */
+typedef enum {
+	BLACKBOX_OFF = 0,		/*< the flash is not usable */
+	BLACKBOX_IDLE,			/*< the ring follows the samples */
+	BLACKBOX_ARMED,			/*< triggered, the samples after the trigger are awaited */
+	BLACKBOX_HELD,			/*< the ring holds the window until it is copied */
+	BLACKBOX_WRITING,		/*< the record is programmed piece by piece */
+	BLACKBOX_ERASING		/*< the next slot waits to be erased */
+} blackbox_state_t;
+
+/**
+ * @brief The counters
+ */
+blackbox_stats_t blackbox_stats;
+
+/**
+ * @brief Where the capture stands; the tap moves it from armed to held only
+ */
+static volatile blackbox_state_t state = BLACKBOX_OFF;
+
+/**
+ * @brief The last samples, indexed by their number
+ */
+static int16_t ring[BLACKBOX_RING_SAMPLES][3];
+
+/**
+ * @brief Samples handed in since start-up, the number of the next one
+ */
+static volatile uint32_t seen;
+
+/**
+ * @brief Samples kept since the ring last held a window; those before are cut off by the gap
+ */
+static volatile uint32_t contiguous;
+
+/**
+ * @brief Samples of the window still to come
+ */
+static volatile uint32_t remaining;
+
+/**
+ * @brief Number of the first sample from the trigger on, and the time of the trigger
+ */
+static uint32_t triggerSample;
+static uint64_t triggerTime;
+
+/**
+ * @brief The record being written, as it goes into the slot
+ */
+static uint32_t image[BLACKBOX_SLOT_SIZE / sizeof(uint32_t)];
+
+/**
+ * @brief Bytes of the image to program, and of them programmed; the header goes last
+ */
+static uint32_t length;
+static uint32_t written;
+
+/**
+ * @brief The longest flash stall the acquisition rides out
+ */
+static uint32_t stallLimit;
+
+/**
+ * @brief The slot written next and the event number it gets
+ */
+static uint8_t slot;
+static uint32_t sequence;
+
+/**
+ * @brief Flash address of a slot
+ */
+static inline uint32_t slot_address(uint8_t index)
+{
+	return NVM_BLACKBOX_BASE + (uint32_t)index * BLACKBOX_SLOT_SIZE;
+}
+
+/**
+ * @brief Bytes of a record from its header
+ */
+static inline uint32_t record_length(const blackbox_header_t *header)
+{
+	return BLACKBOX_HEADER_SIZE + (uint32_t)(header->pre + header->post) * BLACKBOX_SAMPLE_SIZE;
+}
+
+/**
+ * @brief The slot holds a whole record
+ * @return Its header, or NULL
+ */
+static const blackbox_header_t *BlackBox_Read(uint8_t index)
+{
+	const uint8_t *record = Nvm_Map(slot_address(index));
+	const blackbox_header_t *header = (const blackbox_header_t *)record;
+
+	if ((header->magic != BLACKBOX_MAGIC) || (header->version != BLACKBOX_VERSION)
+			|| (header->pre + header->post > BLACKBOX_MAX_SAMPLES)) {
+		return 0;
+	}
+
+	uint16_t crc = CRC16_Compute(record, BLACKBOX_CRC_OFFSET);
+	crc = CRC16_Update(crc, record + BLACKBOX_HEADER_SIZE, record_length(header) - BLACKBOX_HEADER_SIZE);
+	return (crc == header->crc) ? header : 0;
+}
+
+/**
+ * @brief The slot is erased
+ */
+static bool BlackBox_Blank(uint8_t index)
+{
+	const uint32_t *words = (const uint32_t *)Nvm_Map(slot_address(index));
+
+	for (uint32_t i = 0; i < BLACKBOX_SLOT_SIZE / sizeof(uint32_t); ++i) {
+		if (words[i] != 0xFFFFFFFFu) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Counts a flash command that stalled longer than the acquisition rides out
+ * @param[in] start {@see timestamp_us} before the command, the stall included after it
+ */
+static void BlackBox_Stalled(uint64_t start)
+{
+	const uint64_t stalled = timestamp_us() - start;
+
+	if (stalled > stallLimit) {
+		blackbox_stats.overruns++;
+		blackbox_stats.stalledSamples += (uint32_t)(((stalled - stallLimit) * BLACKBOX_RATE_HZ) / 1000000u);
+	}
+}
+
+/**
+ * @brief Erases a slot unless it is blank already
+ * @return false if the erase failed
+ */
+static bool BlackBox_Erase(uint8_t index)
+{
+	if (BlackBox_Blank(index)) {
+		return true;
+	}
+
+	const uint64_t start = timestamp_us();
+	const bool erased = Nvm_Erase(slot_address(index));
+	BlackBox_Stalled(start);
+	return erased;
+}
+
+/**
+ * @brief Programs a piece of the current slot
+ * @return false if the program failed
+ */
+static bool BlackBox_Program(uint32_t offset, const uint32_t *data, uint32_t bytes)
+{
+	const uint64_t start = timestamp_us();
+	const bool programmed = Nvm_Program(slot_address(slot) + offset, data, bytes);
+	BlackBox_Stalled(start);
+	return programmed;
+}
+
+/**
+ * @brief Sets up the flash and carries on after the newest record
+ */
+void BlackBox_Init(uint32_t stallLimitUs)
+{
+	memset(&blackbox_stats, 0, sizeof(blackbox_stats));
+	memset(ring, 0, sizeof(ring));
+	seen = contiguous = remaining = 0;
+	state = BLACKBOX_OFF;
+	stallLimit = stallLimitUs;
+
+	if (stallLimitUs < BLACKBOX_CHUNK_MAX_US) {
+		LOG("\r\n Black box off, the acquisition cannot ride out a flash stall of %lu us", (unsigned long)BLACKBOX_CHUNK_MAX_US);
+		return;
+	}
+	if (!Nvm_Init()) {
+		LOG("\r\n Black box off, the flash driver did not start");
+		return;
+	}
+
+	const blackbox_header_t *newest = 0;
+	slot = 0;
+	for (uint8_t index = 0; index < BLACKBOX_SLOTS; ++index) {
+		const blackbox_header_t *header = BlackBox_Read(index);
+		if ((header != 0) && ((newest == 0) || ((int32_t)(header->sequence - newest->sequence) > 0))) {
+			newest = header;
+			slot = (index + 1) % BLACKBOX_SLOTS;
+		}
+	}
+	sequence = (newest != 0) ? newest->sequence + 1 : 1;
+
+	/* the acquisition is not tapped yet, the erase only takes FIFO slack */
+	if (!BlackBox_Blank(slot) && !Nvm_Erase(slot_address(slot))) {
+		blackbox_stats.errors++;
+	}
+	state = BLACKBOX_IDLE;
+	LOG("\r\n Black box ready, next event %lu in slot %u", (unsigned long)sequence, (unsigned)slot);
+}
+
+/**
+ * @brief Keeps samples in the ring
+ */
+void BlackBox_Record(const int16_t (*samples)[3], uint8_t count)
+{
+	for (uint8_t i = 0; i < count; ++i) {
+		if (state == BLACKBOX_HELD) {
+			blackbox_stats.held += count - i;
+			return;
+		}
+
+		int16_t *at = ring[seen & RING_MASK];
+		at[0] = samples[i][0];
+		at[1] = samples[i][1];
+		at[2] = samples[i][2];
+		seen++;
+		contiguous++;
+
+		if ((state == BLACKBOX_ARMED) && (--remaining == 0)) {
+			state = BLACKBOX_HELD;
+		}
+	}
+}
+
+/**
+ * @brief Starts the capture of a window around the newest sample
+ */
+bool BlackBox_Trigger()
+{
+	bool started = false;
+
+	uint32_t masking_state = __get_PRIMASK();
+	__disable_irq();
+	if (state == BLACKBOX_IDLE) {
+		triggerSample = seen;
+		remaining = BLACKBOX_POST_SAMPLES;
+		state = BLACKBOX_ARMED;
+		started = true;
+	}
+	__set_PRIMASK(masking_state);
+
+	if (started) {
+		triggerTime = timestamp_us();
+		blackbox_stats.triggers++;
+	}
+	else if (state != BLACKBOX_OFF) {
+		blackbox_stats.missed++;
+	}
+	return started;
+}
+
+/**
+ * @brief Copies the held window into the image and lets the ring go on
+ */
+static void BlackBox_Capture(void)
+{
+	/* the ring holds, nothing moves seen or contiguous meanwhile */
+	const uint32_t available = (contiguous < BLACKBOX_RING_SAMPLES) ? contiguous : BLACKBOX_RING_SAMPLES;
+	const uint32_t pre = (available - BLACKBOX_POST_SAMPLES < BLACKBOX_PRE_SAMPLES)
+			? available - BLACKBOX_POST_SAMPLES : BLACKBOX_PRE_SAMPLES;
+	const uint32_t first = triggerSample - pre;
+	const uint32_t count = pre + BLACKBOX_POST_SAMPLES;
+
+	uint8_t *bytes = (uint8_t *)image;
+	memset(image, 0xFF, sizeof(image));
+	for (uint32_t k = 0; k < count; ++k) {
+		memcpy(&bytes[BLACKBOX_HEADER_SIZE + k * BLACKBOX_SAMPLE_SIZE], ring[(first + k) & RING_MASK], BLACKBOX_SAMPLE_SIZE);
+	}
+
+	/* the window is in the image */
+	contiguous = 0;
+	state = BLACKBOX_WRITING;
+
+	blackbox_header_t header = {
+		.magic = BLACKBOX_MAGIC,
+		.sequence = sequence,
+		.timestamp = triggerTime,
+		.first = first,
+		.pre = (uint16_t)pre,
+		.post = BLACKBOX_POST_SAMPLES,
+		.rate = BLACKBOX_RATE_HZ,
+		.version = BLACKBOX_VERSION,
+		.reserved = 0
+	};
+	memcpy(bytes, &header, sizeof(header));
+	header.crc = CRC16_Compute(bytes, BLACKBOX_CRC_OFFSET);
+	header.crc = CRC16_Update(header.crc, &bytes[BLACKBOX_HEADER_SIZE], count * BLACKBOX_SAMPLE_SIZE);
+	memcpy(bytes, &header, sizeof(header));
+
+	length = BLACKBOX_HEADER_SIZE + count * BLACKBOX_SAMPLE_SIZE;
+	length = (length + NVM_WRITE_SIZE - 1) & ~(uint32_t)(NVM_WRITE_SIZE - 1);
+	written = BLACKBOX_HEADER_SIZE;
+}
+
+/**
+ * @brief Programs the next chunk of samples, or the header once they are in
+ */
+static void BlackBox_WriteStep(void)
+{
+	if (written < length) {
+		const uint32_t chunk = (length - written < BLACKBOX_CHUNK) ? length - written : BLACKBOX_CHUNK;
+		if (BlackBox_Program(written, &image[written / sizeof(uint32_t)], chunk)) {
+			written += chunk;
+			return;
+		}
+	}
+	else if (BlackBox_Program(0, image, BLACKBOX_HEADER_SIZE)) {
+		blackbox_stats.records++;
+		slot = (slot + 1) % BLACKBOX_SLOTS;
+		sequence++;
+		state = BLACKBOX_ERASING;
+		return;
+	}
+
+	/* given up; the slot is erased again for the next event */
+	blackbox_stats.errors++;
+	state = BLACKBOX_ERASING;
+}
+
+/**
+ * @brief Takes the next step of a capture
+ */
+void BlackBox_Poll()
+{
+	switch (state) {
+	case BLACKBOX_HELD:
+		BlackBox_Capture();
+		break;
+	case BLACKBOX_WRITING:
+		BlackBox_WriteStep();
+		break;
+	case BLACKBOX_ERASING:
+		if (!BlackBox_Erase(slot)) {
+			blackbox_stats.errors++;
+		}
+		state = BLACKBOX_IDLE;
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * @brief A capture or its write is under way
+ */
+bool BlackBox_Busy()
+{
+	return (state != BLACKBOX_IDLE) && (state != BLACKBOX_OFF);
+}
+
+/**
+ * @brief Prints the counters and the records, oldest first
+ */
+void BlackBox_Dump()
+{
+	static const char digits[] = "0123456789abcdef";
+	char line[2 * DUMP_LINE + 1];
+	unsigned stored = 0;
+
+	LOG("\r\n Black box: %lu triggers, %lu missed, %lu records written, %lu samples held off, %lu errors",
+			(unsigned long)blackbox_stats.triggers, (unsigned long)blackbox_stats.missed,
+			(unsigned long)blackbox_stats.records, (unsigned long)blackbox_stats.held,
+			(unsigned long)blackbox_stats.errors);
+	LOG("\r\n   %lu flash stalls overran the acquisition by %lu samples", (unsigned long)blackbox_stats.overruns,
+			(unsigned long)blackbox_stats.stalledSamples);
+	LOG("\r\n   flash: %lu erases, %lu programs of %lu bytes, %lu errors", (unsigned long)nvm_stats.erases,
+			(unsigned long)nvm_stats.programs, (unsigned long)nvm_stats.bytes, (unsigned long)nvm_stats.errors);
+	if (state == BLACKBOX_OFF) {
+		return;
+	}
+
+	/* the slot after the newest is the oldest */
+	for (uint8_t i = 1; i <= BLACKBOX_SLOTS; ++i) {
+		const uint8_t index = (slot + i) % BLACKBOX_SLOTS;
+		const blackbox_header_t *header = BlackBox_Read(index);
+		if (header == 0) {
+			continue;
+		}
+
+		const uint8_t *record = (const uint8_t *)header;
+		const uint32_t bytes = record_length(header);
+		for (uint32_t offset = 0; offset < bytes; offset += DUMP_LINE) {
+			const uint32_t count = (bytes - offset < DUMP_LINE) ? bytes - offset : DUMP_LINE;
+			for (uint32_t k = 0; k < count; ++k) {
+				line[2 * k] = digits[record[offset + k] >> 4];
+				line[2 * k + 1] = digits[record[offset + k] & 0x0F];
+			}
+			line[2 * count] = '\0';
+			LOG("\r\n bbx %03lx %s", (unsigned long)offset, line);
+		}
+		stored++;
+	}
+	LOG("\r\n   %u events stored", stored);
+}
@@ -0,0 +1,203 @@
+/*
+ * blackbox.h
+ *
+ *  Created on: Dec 30, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Header file for the black box: the samples around every jerk, kept in flash.
+ *
+ *      		The acquisition hands every sample to {@see BlackBox_Record}, which keeps the
+ *      		last {@see BLACKBOX_RING_SAMPLES} in a RAM ring. A jerk calls {@see BlackBox_Trigger};
+ *      		once {@see BLACKBOX_POST_SAMPLES} more samples landed, the ring holds still and
+ *      		{@see BlackBox_Poll} copies the window, up to {@see BLACKBOX_PRE_SAMPLES} before the
+ *      		trigger and the rest after it, into a record image and lets the ring go on.
+ *
+ *      		The record is then written by {@see BlackBox_Poll}, one step per call from the
+ *      		main loop: {@see BLACKBOX_CHUNK} bytes of samples at a time, about a millisecond
+ *      		each, and the header last, so a record cut short by a reset has none and is
+ *      		not taken for one. A step stalls the core with the interrupts masked, see nvm.h;
+ *      		between steps every pending interrupt runs.
+ *
+ *      		The acquisition must ride out those stalls, so {@see BlackBox_Init} is told how
+ *      		long a stall it takes without losing samples. The FIFO acquisition takes the room
+ *      		beyond a waiting batch, 20 ms: a chunk (1 ms, 2.3 ms at most) and the typical
+ *      		erase (14 ms) fit, a worst case erase (114 ms) does not. Every command stalling
+ *      		longer is counted in {@see blackbox_stats_t.overruns}, with the samples it cost.
+ *      		The data-ready acquisition keeps nothing: at 800 Hz even a chunk may overrun
+ *      		a sample and an erase drops a dozen, so the black box stays off under it.
+ *
+ *      		Each record takes a sector of the region of nvm.h, the slots used in turn, so
+ *      		every sector is erased once per {@see BLACKBOX_SLOTS} events. The slot after
+ *      		the newest record is erased right after it is written, the 14 ms of the erase
+ *      		thus never falling on a capture; the oldest record goes with it, so the last
+ *      		{@see BLACKBOX_SLOTS} - 1 events are kept. At start-up {@see BlackBox_Init} finds
+ *      		the newest record by its sequence number and carries on after it.
+ *
+ *      		A record, all fields little-endian:
+ *
+ *      			offset	size	field
+ *      			0		4		{@see BLACKBOX_MAGIC}
+ *      			4		4		event number, counting up across resets from 1
+ *      			8		8		{@see timestamp_us} of the trigger, since that start-up
+ *      			16		4		number of the first sample, counted since that start-up
+ *      			20		2		samples before the trigger p
+ *      			22		2		samples from the trigger on q
+ *      			24		2		output data rate in Hz
+ *      			26		2		{@see BLACKBOX_VERSION}
+ *      			28		2		CRC-16/CCITT-FALSE of bytes 0 - 27 and the samples
+ *      			30		2		zero
+ *      			32		6(p+q)	per sample x, y, z (int16), oldest first
+ *
+ *      		{@see BlackBox_Dump} prints the records as hex lines on the console, oldest first;
+ *      		host/blackbox_decode turns a capture of them into CSV.
+ *
+ *    Sources of Reference :
+ * 		KL25 Sub-Family Reference Manual, Chapter 27 (Flash Memory Module)
+ */
+
+#ifndef BLACKBOX_H_
+#define BLACKBOX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "nvm.h"
+
+/**
+ * @brief Samples kept in RAM, a power of two; 160 ms at 800 Hz
+ */
+#define BLACKBOX_RING_SAMPLES		(128)
+
+/**
+ * @brief The window of a record: samples before the trigger and from it on
+ */
+#define BLACKBOX_PRE_SAMPLES		(64)
+#define BLACKBOX_POST_SAMPLES		(64)
+
+/**
+ * @brief Output data rate of the samples, as InitMMA8451Q sets it
+ */
+#define BLACKBOX_RATE_HZ			(800)
+
+/**
+ * @brief Records kept, one per sector
+ */
+#define BLACKBOX_SLOTS				(NVM_BLACKBOX_SECTORS)
+#define BLACKBOX_SLOT_SIZE			(NVM_SECTOR_SIZE)
+
+/**
+ * @brief Bytes programmed per step of the writer, about a millisecond
+ */
+#define BLACKBOX_CHUNK				(64)
+
+/**
+ * @brief Worst case stall of a chunk
+ */
+#define BLACKBOX_CHUNK_MAX_US		((BLACKBOX_CHUNK / NVM_WRITE_SIZE) * NVM_PROGRAM_MAX_US)
+
+/**
+ * @brief Stall limit of an acquisition that only gets delayed by a stall, not robbed
+ */
+#define BLACKBOX_STALL_ANY			(UINT32_MAX)
+
+#define BLACKBOX_MAGIC				(0x31584242)	/*< "BBX1" */
+#define BLACKBOX_VERSION			(1)
+#define BLACKBOX_HEADER_SIZE		(32)
+#define BLACKBOX_CRC_OFFSET			(28)
+#define BLACKBOX_SAMPLE_SIZE		(6)
+
+/**
+ * @brief Samples a record has room for
+ */
+#define BLACKBOX_MAX_SAMPLES		((BLACKBOX_SLOT_SIZE - BLACKBOX_HEADER_SIZE) / BLACKBOX_SAMPLE_SIZE)
+
+#if (BLACKBOX_PRE_SAMPLES + BLACKBOX_POST_SAMPLES > BLACKBOX_RING_SAMPLES) \
+		|| (BLACKBOX_PRE_SAMPLES + BLACKBOX_POST_SAMPLES > BLACKBOX_MAX_SAMPLES) || (BLACKBOX_POST_SAMPLES < 1)
+#error "The window of the black box must fit the ring and a slot, and take the trigger"
+#endif
+
+/**
+ * @brief The header of a record, see the layout above
+ */
+typedef struct {
+	uint32_t magic;
+	uint32_t sequence;
+	uint64_t timestamp;
+	uint32_t first;
+	uint16_t pre;
+	uint16_t post;
+	uint16_t rate;
+	uint16_t version;
+	uint16_t crc;
+	uint16_t reserved;
+} blackbox_header_t;
+
+/**
+ * @brief Counters
+ */
+typedef struct {
+	uint32_t triggers;			/*< jerks that started a capture */
+	uint32_t missed;			/*< jerks while a capture or its write was under way */
+	uint32_t records;			/*< records written */
+	uint32_t held;				/*< samples not kept while the ring held a window */
+	uint32_t errors;			/*< records given up on a failed flash command */
+	uint32_t overruns;			/*< flash commands stalling longer than the acquisition rides out */
+	uint32_t stalledSamples;	/*< samples those overruns lasted beyond it, lost to the acquisition */
+} blackbox_stats_t;
+
+/**
+ * @brief The counters
+ */
+extern blackbox_stats_t blackbox_stats;
+
+/**
+ * @brief Sets up the flash, finds the newest record and makes sure the slot after it is erased.
+ * 		  Call before the acquisition is tapped; may stall for an erase.
+ * @param[in] stallLimitUs The longest flash stall the acquisition rides out without losing samples,
+ * 		  {@see BLACKBOX_STALL_ANY} if a stall only delays it; below {@see BLACKBOX_CHUNK_MAX_US} the
+ * 		  black box stays off
+ */
+void BlackBox_Init(uint32_t stallLimitUs);
+
+/**
+ * @brief Keeps samples in the ring; the tap of the acquisition, runs in its interrupt
+ * @param[in] samples X/Y/Z samples, oldest first
+ * @param[in] count Their number
+ */
+void BlackBox_Record(const int16_t (*samples)[3], uint8_t count);
+
+/**
+ * @brief Starts the capture of a window around the newest sample
+ *
+ * @param: None
+ * @return: false if a capture or its write is still under way, the jerk is missed
+ */
+bool BlackBox_Trigger();
+
+/**
+ * @brief Takes the next step of a capture: copies a held window or programs the next piece of
+ * 		  flash. Call from the main loop whenever samples landed; each call stalls at most one
+ * 		  flash command.
+ *
+ * @param: None
+ * @return: None
+ */
+void BlackBox_Poll();
+
+/**
+ * @brief A capture or its write is under way
+ *
+ * @param: None
+ * @return: true until the record is written and the next slot erased
+ */
+bool BlackBox_Busy();
+
+/**
+ * @brief Prints the counters and every record as hex lines "bbx <offset> <bytes>", oldest first
+ *
+ * @param: None
+ * @return: None
+ */
+void BlackBox_Dump();
+
+#endif /* BLACKBOX_H_ */
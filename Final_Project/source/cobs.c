@@ -0,0 +1,84 @@
+/*
+ * cobs.c
+ *
+ *  Created on: Dec 18, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Consistent Overhead Byte Stuffing.
+ *
+ *    Sources of Reference :
+ * 		1) S. Cheshire, M. Baker, "Consistent Overhead Byte Stuffing", IEEE/ACM Transactions on Networking, 1999
+ */
+
+#include "cobs.h"
+
+/**
+ * @brief Locates an output byte over the two buffers
+ */
+static inline uint8_t *Cobs_At(size_t index, uint8_t *first, size_t firstLength, uint8_t *second)
+{
+	return (index < firstLength) ? &first[index] : &second[index - firstLength];
+}
+
+/**
+ * @brief Encodes a block, possibly into two output buffers
+ */
+size_t Cobs_Encode(const uint8_t *source, size_t length, uint8_t *first, size_t firstLength, uint8_t *second)
+{
+	size_t out = 1;			/* output position, behind the first code byte */
+	size_t code_at = 0;		/* position of the code byte of the current run */
+	uint8_t code = 1;		/* code byte value: run length + 1 */
+
+	for (size_t i = 0; i < length; ++i) {
+		if (source[i] != 0) {
+			*Cobs_At(out++, first, firstLength, second) = source[i];
+			++code;
+		}
+
+		/* a zero, or a run of 254 nonzero bytes, closes the run */
+		if ((source[i] == 0) || (code == 0xFF)) {
+			*Cobs_At(code_at, first, firstLength, second) = code;
+			code_at = out++;
+			code = 1;
+		}
+	}
+	*Cobs_At(code_at, first, firstLength, second) = code;
+
+	return out;
+}
+
+/**
+ * @brief Decodes a block
+ */
+int Cobs_Decode(const uint8_t *source, size_t length, uint8_t *destination, size_t capacity)
+{
+	size_t in = 0;
+	size_t out = 0;
+
+	while (in < length) {
+		const uint8_t code = source[in++];
+
+		if ((code == 0) || (in + code - 1 > length)) {
+			return -1;
+		}
+		if (out + code - 1 > capacity) {
+			return -1;
+		}
+		for (uint8_t i = 1; i < code; ++i) {
+			if (source[in] == 0) {
+				return -1;
+			}
+			destination[out++] = source[in++];
+		}
+
+		/* a short run stood for a zero, unless it ended the block */
+		if ((code != 0xFF) && (in < length)) {
+			if (out >= capacity) {
+				return -1;
+			}
+			destination[out++] = 0;
+		}
+	}
+
+	return (int)out;
+}
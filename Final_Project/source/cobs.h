@@ -0,0 +1,55 @@
+/*
+ * cobs.h
+ *
+ *  Created on: Dec 18, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Header file for Consistent Overhead Byte Stuffing.
+ *
+ *      		COBS removes every zero byte from a block at the cost of one byte per 254
+ *      		(plus one), so a zero can delimit frames on a byte stream: a receiver that
+ *      		joins midway or loses bytes resynchronizes at the next zero.
+ *
+ *    Sources of Reference :
+ * 		1) S. Cheshire, M. Baker, "Consistent Overhead Byte Stuffing", IEEE/ACM Transactions on Networking, 1999
+ */
+
+#ifndef COBS_H_
+#define COBS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief The frame delimiter, never part of an encoded block
+ */
+#define COBS_DELIMITER			(0x00)
+
+/**
+ * @brief Longest encoding of a block of n bytes, the delimiter not included
+ */
+#define COBS_MAX_ENCODED(n)		((n) + ((n) / 254) + 1)
+
+/**
+ * @brief Encodes a block. The output may be split over two buffers, as {@see Q_Reserve} hands
+ * 		  them out: it continues at the start of the second once the first is full.
+ * @param[in] source The block
+ * @param[in] length The length of the block
+ * @param[out] first The first output buffer
+ * @param[in] firstLength The size of the first output buffer
+ * @param[out] second The second output buffer; {@see COBS_MAX_ENCODED} bytes in both together
+ * @return The encoded length, the delimiter not included
+ */
+size_t Cobs_Encode(const uint8_t *source, size_t length, uint8_t *first, size_t firstLength, uint8_t *second);
+
+/**
+ * @brief Decodes a block, the delimiter not included
+ * @param[in] source The encoded block
+ * @param[in] length Its length
+ * @param[out] destination Receives the block; may be the same as source
+ * @param[in] capacity The size of the destination
+ * @return The decoded length, or -1 if the block is malformed or too long
+ */
+int Cobs_Decode(const uint8_t *source, size_t length, uint8_t *destination, size_t capacity);
+
+#endif /* COBS_H_ */
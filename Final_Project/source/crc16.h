@@ -0,0 +1,46 @@
+/*
+ * crc16.h
+ *
+ *  Created on: Dec 18, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Header file for the CRC-16/CCITT-FALSE checksum (polynomial 0x1021, initial
+ *      		value 0xFFFF, no reflection, no final XOR), table driven at about 10 cycles per
+ *      		byte on the M0+. "123456789" yields 0x29B1.
+ *
+ *    Sources of Reference :
+ * 		1) https://reveng.sourceforge.io/crc-catalogue/16.htm (CRC-16/IBM-3740, a.k.a. CCITT-FALSE)
+ */
+
+#ifndef CRC16_H_
+#define CRC16_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Initial value of a CRC
+ */
+#define CRC16_INIT		(0xFFFF)
+
+/**
+ * @brief Continues a CRC over a block of bytes
+ * @param[in] crc {@see CRC16_INIT}, or the result over the preceding bytes
+ * @param[in] data The bytes
+ * @param[in] length The number of bytes
+ * @return The CRC including the block
+ */
+uint16_t CRC16_Update(uint16_t crc, const void *data, size_t length);
+
+/**
+ * @brief CRC of a single block of bytes
+ * @param[in] data The bytes
+ * @param[in] length The number of bytes
+ * @return The CRC
+ */
+static inline uint16_t CRC16_Compute(const void *data, size_t length)
+{
+	return CRC16_Update(CRC16_INIT, data, length);
+}
+
+#endif /* CRC16_H_ */
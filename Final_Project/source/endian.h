@@ -54,17 +54,18 @@ static unsigned int test_endian( uint32_t test_var)
 /**
  * @brief Determines if endian correction to machine endianness is required given a source endianness
  *
- * @param[in] None
+ * @param[in] sourceEndianness The endianness of the data
  *
  * @return zero if endianness is same, nonzero otherwise
  */
 
-static inline uint8_t endianCorrectionRequired()
+static inline uint8_t endianCorrectionRequired(const endian_t sourceEndianness)
 {
 	int test_var = 1;
 	unsigned char *test_endian = (unsigned char*)&test_var;
 
-	return (test_endian[0] == 0);
+	/* the first byte is set on a little endian machine */
+	return (test_endian[0] == 1) == (sourceEndianness == FROM_BIG_ENDIAN);
 }
 
 /**
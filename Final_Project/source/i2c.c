@@ -14,12 +14,19 @@
  */
 
 #include "i2c.h"
+#include "i2c_hal.h"
+#include "i2c_dma.h"
+#include "i2c_account.h"
+#include "i2carbiter.h"
 #include "delay.h"
 #include "assert.h"
 #include "global_defs.h"
 
-int lock_detect=0;
-int i2c_lock=0;
+/**
+ * @brief The transaction of the blocking register access
+ */
+i2c_polled_t i2c_polled = { .status = I2C_STATUS_OK };
+
 /**
  * @brief Initialises the I2C interface
  */
@@ -62,7 +69,7 @@ void I2C_Init()
 	 * SCL divider (+/- 4). However the data sheet does not state anything
 	 * useful about that.
 	 */
-	I2C0->F = I2C_F_MULT(0x00) | I2C_F_ICR(0x12); /* divide by 64 instead, so 375 kHz */
+	I2C0->F = I2C_F_375KHZ; /* divide by 64 instead, so 375 kHz */
 
 	/* enable the I2C module */
 	I2C0->C1 = (1 << I2C_C1_IICEN_SHIFT) & I2C_C1_IICEN_MASK;
@@ -70,41 +77,108 @@ void I2C_Init()
 	// Select high drive mode
 	I2C0->C2 |= (I2C_C2_HDRS_MASK);
 
+	/* a reset in the middle of a read leaves the slave driving SDA, which nothing else would clear */
+	if (!I2C_PinSdaHigh(I2C0)) {
+		I2C_BusRecover(I2C0);
+	}
+
+	/* attach the interrupt driven transaction engine, which also serves the asynchronous reads of the polled backend */
+	I2C_IrqEnable();
+#if I2C_HAL_BACKEND == I2C_HAL_DMA
+	I2C_DmaEnable();
+#endif
+
 	LOG("\n\r Clock Gating and Instantiation for I2C0 Complete");
 }
 
-
-void i2c_init(void)
+/**
+ * @brief Starts the clock of a blocking transaction once the engine and the bus are free
+ * @param[in] slaveId The slave id, for the trace
+ * @param[in] registerAddress The first register, for the trace
+ * @param[in] length The number of data bytes
+ * @return true if the bus is free, false if it stayed held and the transaction must not start
+ */
+static bool I2C_PolledBegin(uint8_t slaveId, uint8_t registerAddress, uint8_t length)
 {
-	//clock i2c peripheral and port E
-	SIM->SCGC4 |= SIM_SCGC4_I2C0_MASK;
-	SIM->SCGC5 |= (SIM_SCGC5_PORTE_MASK);
+#if I2C_TRACE_ENABLE
+	/* still pending here means this interrupted a blocking transaction of the thread it preempted */
+	uint8_t flags = (i2c_polled.status == I2C_STATUS_PENDING) ? I2C_TRACE_NESTED : 0;
+	if (!I2C_IrqIdle(&i2c0_engine)) {
+		flags |= I2C_TRACE_WAITED;
+		i2c0_engine.traceFlags |= I2C_TRACE_CONTENDED;
+	}
+#else
+	(void)slaveId;
+	(void)registerAddress;
+#endif
+
+	/* let a transaction of the interrupt engine run to completion first, or abort it once out of time */
+	while (!I2C_IrqIdle(&i2c0_engine)) {
+		I2C_IrqExpire(&i2c0_engine);
+	}
 
-	//set pins to I2C function
-	PORTE->PCR[24] |= PORT_PCR_MUX(5);
-	PORTE->PCR[25] |= PORT_PCR_MUX(5);
+	i2c_polled.started = cycle_count();
+	i2c_polled.budget = I2C_BUS_US_TO_CYCLES(I2C_BUS_TIMEOUT_US(length + I2C_BUS_OVERHEAD_BYTES));
+
+	/* a healthy bus costs a look at BUSY here, a held one is recovered first */
+	i2c_polled.status = I2C_BusAcquire(I2C0) ? I2C_STATUS_PENDING : I2C_STATUS_BUS_ERROR;
+
+#if I2C_TRACE_ENABLE
+	/* the sequence number stands in for the count of records so far until the record is added */
+	i2c_polled.trace.sequence = I2C_TraceCount();
+	i2c_polled.trace.start = i2c_polled.started;
+	i2c_polled.trace.slaveId = slaveId;
+	i2c_polled.trace.registerAddress = registerAddress;
+	i2c_polled.trace.length = length;
+	i2c_polled.trace.exception = I2C_TRACE_EXCEPTION();
+	i2c_polled.trace.flags = flags;
+#endif
+	return i2c_polled.status == I2C_STATUS_PENDING;
+}
 
-	//set to 100k baud
-	//baud = bus freq/(scl_div+mul)
- 	//~400k = 24M/(64); icr=0x12 sets scl_div to 64
+/**
+ * @brief Settles the result of a blocking transaction, after its STOP, and frees a bus it left held
+ * @param[in] direction Read or write, for the latency histogram
+ */
+static void I2C_PolledEnd(i2c_direction_t direction)
+{
+	/* on this single master bus a lost arbitration means a slave drives SDA */
+	if ((i2c_polled.status == I2C_STATUS_PENDING) && (I2C0->S & I2C_S_ARBL_MASK)) {
+		I2C0->S = I2C_S_ARBL_MASK;
+		i2c_polled.status = I2C_STATUS_ARBITRATION_LOST;
+	}
 
- 	I2C0->F = (I2C_F_ICR(0x10) | I2C_F_MULT(0));
+	if (i2c_polled.status == I2C_STATUS_PENDING) {
+		i2c_polled.status = I2C_STATUS_OK;
+	}
+	else if (i2c_polled.status != I2C_STATUS_BUS_ERROR) {
+		I2C_BusRecover(I2C0);
+	}
 
-	//enable i2c and set to master mode
-	I2C0->C1 |= (I2C_C1_IICEN_MASK);
+	I2C_BusRecord(direction, i2c_polled.status, cycle_count() - i2c_polled.started);
 
-	// Select high drive mode
-	I2C0->C2 |= (I2C_C2_HDRS_MASK);
+#if I2C_TRACE_ENABLE
+	/* anything else finished in the meantime ran inside this transaction */
+	if (I2C_TraceCount() != i2c_polled.trace.sequence) {
+		i2c_polled.trace.flags |= I2C_TRACE_CONTENDED;
+	}
+	i2c_polled.trace.end = cycle_count();
+	i2c_polled.trace.status = (uint8_t)i2c_polled.status;
+	i2c_polled.trace.flags |= I2C_TRACE_POLLED | ((direction == I2C_DIRECTION_READ) ? I2C_TRACE_READ : 0);
+	I2C_TRACE_ADD(&i2c_polled.trace);
+#endif
 }
 
-
 /**
  * @brief Reads an 8-bit register from an I2C slave
  */
 uint8_t I2C_ReadRegister(register uint8_t slaveId, register uint8_t registerAddress)
 {
-	/* loop while the bus is still busy */
-	I2C_WaitWhileBusy();
+	/* wait for the bus, what a released bus reads as if it stays held */
+	if (!I2C_PolledBegin(slaveId, registerAddress, 1)) {
+		I2C_PolledEnd(I2C_DIRECTION_READ);
+		return 0xFF;
+	}
 
 	/* send I2C start signal and set write direction, also enables ACK */
 	I2C_SendStart();
@@ -132,6 +206,7 @@ uint8_t I2C_ReadRegister(register uint8_t slaveId, register uint8_t registerAddr
 
 	/* fetch the last received byte */
 	register uint8_t result = I2C0->D;
+	I2C_PolledEnd(I2C_DIRECTION_READ);
 	return result;
 }
 
@@ -146,8 +221,11 @@ static void I2C_ReadRegistersInternal(register uint8_t slaveId, register uint8_t
 {
 	assert(registerCount >= 2);
 
-	/* loop while the bus is still busy */
-	I2C_WaitWhileBusy();
+	/* wait for the bus, leave the buffer alone if it stays held */
+	if (!I2C_PolledBegin(slaveId, startRegisterAddress, registerCount)) {
+		I2C_PolledEnd(I2C_DIRECTION_READ);
+		return;
+	}
 
 	/* send I2C start signal and set write direction, also enables ACK */
 	I2C_SendStart();
@@ -197,6 +275,7 @@ static void I2C_ReadRegistersInternal(register uint8_t slaveId, register uint8_t
 
 	/* fetch the last received byte */
 	buffer[index++] = I2C0->D;
+	I2C_PolledEnd(I2C_DIRECTION_READ);
 }
 
 /**
@@ -210,6 +289,8 @@ void I2C_ReadRegisters(register uint8_t slaveId, register uint8_t startRegisterA
 {
 	assert(registerCount > 0);
 
+	I2C_ACCOUNT_BEGIN();
+
 	if (registerCount >= 2)
 	{
 		I2C_ReadRegistersInternal(slaveId, startRegisterAddress, registerCount, buffer);
@@ -220,6 +301,9 @@ void I2C_ReadRegisters(register uint8_t slaveId, register uint8_t startRegisterA
 		register uint8_t result = I2C_ReadRegister(slaveId, startRegisterAddress);
 		buffer[0] = result;
 	}
+
+	I2C_ACCOUNT_END(I2C_PATH_POLLED);
+	I2C_ACCOUNT_TRANSFER(I2C_PATH_POLLED, registerCount);
 }
 
 /**
@@ -227,8 +311,11 @@ void I2C_ReadRegisters(register uint8_t slaveId, register uint8_t startRegisterA
  */
 void I2C_WriteRegister(register uint8_t slaveId, register uint8_t registerAddress, register uint8_t value)
 {
-	/* loop while the bus is still busy */
-	I2C_WaitWhileBusy();
+	/* wait for the bus, drop the write if it stays held */
+	if (!I2C_PolledBegin(slaveId, registerAddress, 1)) {
+		I2C_PolledEnd(I2C_DIRECTION_WRITE);
+		return;
+	}
 
 	/* send I2C start signal and set write direction*/
 	I2C_SendStart();
@@ -244,6 +331,38 @@ void I2C_WriteRegister(register uint8_t slaveId, register uint8_t registerAddres
 
 	/* issue stop signal by clearing master mode. */
 	I2C_SendStop();
+	I2C_PolledEnd(I2C_DIRECTION_WRITE);
+}
+
+/**
+ * @brief Writes consecutive 8-bit registers of an I2C slave in one auto-increment burst
+ */
+void I2C_WriteRegisters(register uint8_t slaveId, register uint8_t startRegisterAddress, register uint8_t registerCount, const uint8_t *buffer)
+{
+	assert(registerCount > 0);
+
+	/* wait for the bus, drop the write if it stays held */
+	if (!I2C_PolledBegin(slaveId, startRegisterAddress, registerCount)) {
+		I2C_PolledEnd(I2C_DIRECTION_WRITE);
+		return;
+	}
+
+	/* send I2C start signal and set write direction*/
+	I2C_SendStart();
+
+	/* send the slave address and the first register address */
+	I2C_SendBlocking(I2C_WRITE_ADDRESS(slaveId));
+	I2C_SendBlocking(startRegisterAddress);
+
+	/* the slave advances its register pointer after every byte */
+	for (uint8_t index = 0; index < registerCount; ++index)
+	{
+		I2C_SendBlocking(buffer[index]);
+	}
+
+	/* issue stop signal by clearing master mode. */
+	I2C_SendStop();
+	I2C_PolledEnd(I2C_DIRECTION_WRITE);
 }
 
 /**
@@ -256,8 +375,11 @@ void I2C_WriteRegister(register uint8_t slaveId, register uint8_t registerAddres
  */
 uint8_t I2C_ModifyRegister(register uint8_t slaveId, register uint8_t registerAddress, register uint8_t andMask, register uint8_t orMask)
 {
-	/* loop while the bus is still busy */
-	I2C_WaitWhileBusy();
+	/* wait for the bus, one data byte each way; the register reads as 0xFF if it stays held */
+	if (!I2C_PolledBegin(slaveId, registerAddress, 2 + I2C_BUS_OVERHEAD_BYTES)) {
+		I2C_PolledEnd(I2C_DIRECTION_WRITE);
+		return 0xFF;
+	}
 
 	/* send the slave address and register */
 	I2C_SendStart();
@@ -293,6 +415,7 @@ uint8_t I2C_ModifyRegister(register uint8_t slaveId, register uint8_t registerAd
 
 	/* issue stop signal by clearing master mode. */
 	I2C_SendStop();
+	I2C_PolledEnd(I2C_DIRECTION_WRITE);
 	return value;
 }
 
@@ -306,184 +429,129 @@ void I2C_ResetBus()
 }
 
 /**
- * @brief Initiates a register read after the module was brought into TX mode.
- * @param[in] slaveId The slave id
- * @param[in] registerAddress the register to read from
+ * @brief The pins of a bus as the recovery drives them
  */
-void I2C_InitiateRegisterReadAt(const register uint8_t slaveId, const register uint8_t registerAddress)
+typedef struct {
+	PORT_Type *port;		/*< The port control of the pins */
+	GPIO_Type *gpio;		/*< The GPIO of the same port */
+	uint8_t sclPin;			/*< The pin of SCL */
+	uint8_t sclMux;			/*< The mux value routing SCL to the module */
+	uint8_t sdaPin;			/*< The pin of SDA */
+	uint8_t sdaMux;			/*< The mux value routing SDA to the module */
+} i2c_pins_t;
+
+/**
+ * @brief Looks up the pins a bus is routed to
+ * @param[in] base The I2C register block
+ * @return The pins of the arbiter's active route on the bus, the on-board MMA8451Q's before the first select
+ */
+static i2c_pins_t I2C_Pins(const I2C_Type *base)
 {
-	/* send register id */
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(slaveId));
-	I2C_SendBlocking(registerAddress);
+	const i2carbiter_entry_t *entry = I2CArbiter_ActiveEntry(base);
 
-	/* enter read mode */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_READ_ADDRESS(slaveId));
-	I2C_EnterReceiveModeWithAck();
-	I2C_ReceiverModeDriveClock();
+	if (entry == 0) {
+		/* only I2C_Init recovers a bus before the arbiter routed it, and it muxed I2C0 to PTE24/25 */
+		assert(base == I2C0);
+		return (i2c_pins_t) { PORTE, GPIOE, MMA8451_SCL, MMA8451Q_I2C_MUX, MMA8451Q_SDA, MMA8451Q_I2C_MUX };
+	}
+
+	/* ports and their GPIOs are laid out at fixed strides in the same order */
+	const uint32_t port = ((uint32_t)entry->port - PORTA_BASE) / (PORTB_BASE - PORTA_BASE);
+	GPIO_Type *gpio = (GPIO_Type *)(GPIOA_BASE + port * (GPIOB_BASE - GPIOA_BASE));
+	return (i2c_pins_t) { entry->port, gpio, entry->sclPin, entry->sclMux, entry->sdaPin, entry->sdaMux };
 }
 
 /**
- * @brief Processing the I2C bus operation to complete
- *
- * @param: None
- * @param: None
+ * @brief Drives an open-drain line by hand: output low pulls it, input releases it to the pull-up
+ * @param[in] gpio The GPIO of the pin's port
+ * @param[in] pin The pin
+ * @param[in] high false pulls the line low
  */
-void i2c_busy(void){
-	// Start Signal
-	lock_detect=0;
-	I2C0->C1 &= ~I2C_C1_IICEN_MASK;
-	I2C_TRAN;
-	I2C_M_START;
-	I2C0->C1 |=  I2C_C1_IICEN_MASK;
-	// Write to clear line
-	I2C0->C1 |= I2C_C1_MST_MASK; /* set MASTER mode */
-	I2C0->C1 |= I2C_C1_TX_MASK; /* Set transmit (TX) mode */
-	I2C0->D = 0xFF;
-	while ((I2C0->S & I2C_S_IICIF_MASK) == 0U) {
-	} /* wait interrupt */
-	I2C0->S |= I2C_S_IICIF_MASK; /* clear interrupt bit */
-
-
-							/* Clear arbitration error flag*/
-	I2C0->S |= I2C_S_ARBL_MASK;
-
-
-							/* Send start */
-	I2C0->C1 &= ~I2C_C1_IICEN_MASK;
-	I2C0->C1 |= I2C_C1_TX_MASK; /* Set transmit (TX) mode */
-	I2C0->C1 |= I2C_C1_MST_MASK; /* START signal generated */
-
-	I2C0->C1 |= I2C_C1_IICEN_MASK;
-							/*Wait until start is send*/
-
-							/* Send stop */
-	I2C0->C1 &= ~I2C_C1_IICEN_MASK;
-	I2C0->C1 |= I2C_C1_MST_MASK;
-	I2C0->C1 &= ~I2C_C1_MST_MASK; /* set SLAVE mode */
-	I2C0->C1 &= ~I2C_C1_TX_MASK; /* Set Rx */
-	I2C0->C1 |= I2C_C1_IICEN_MASK;
-
-
-								/* wait */
-							/* Clear arbitration error & interrupt flag*/
-	I2C0->S |= I2C_S_IICIF_MASK;
-	I2C0->S |= I2C_S_ARBL_MASK;
-	lock_detect=0;
-	i2c_lock=1;
+static void I2C_PinDrive(GPIO_Type *gpio, uint32_t pin, bool high)
+{
+	if (high) {
+		gpio->PDDR &= ~(1u << pin);
+	}
+	else {
+		gpio->PDDR |= (1u << pin);
+	}
+	I2C_BusDelay(I2C_BUS_US_TO_CYCLES(I2C_BUS_RECOVERY_HALF_US));
 }
 
 /**
- * @brief Waits for an I2C bus operation to complete
- *
- * @param: None
- * @param: None
+ * @brief Disables the module and hands SCL and SDA to GPIO, both released
  */
-void i2c_wait(void) {
-	lock_detect = 0;
-	while(((I2C0->S & I2C_S_IICIF_MASK)==0) & (lock_detect < 200)) {
-		lock_detect++;
-	}
-	if (lock_detect >= 200)
-		i2c_busy();
-	I2C0->S |= I2C_S_IICIF_MASK;
-}
+void I2C_PinsTakeover(I2C_Type *base)
+{
+	const i2c_pins_t pins = I2C_Pins(base);
 
+	base->C1 &= ~I2C_C1_IICEN_MASK;
 
-void i2c_start()
-{
-	I2C_TRAN;							/*set to transmit mode */
-	I2C_M_START;					/*send start	*/
+	/* the output latch stays low, the direction alone pulls or releases a line */
+	pins.gpio->PCOR = (1u << pins.sclPin) | (1u << pins.sdaPin);
+	pins.gpio->PDDR &= ~((1u << pins.sclPin) | (1u << pins.sdaPin));
+	pins.port->PCR[pins.sclPin] = PORT_PCR_MUX(1);
+	pins.port->PCR[pins.sdaPin] = PORT_PCR_MUX(1);
 }
 
-
-void i2c_read_setup(uint8_t dev, uint8_t address)
+/**
+ * @brief Hands SCL and SDA back to the module and re-enables it
+ */
+void I2C_PinsRelease(I2C_Type *base)
 {
-	I2C0->D = dev;			  /*send dev address	*/
-	I2C_WAIT							/*wait for completion */
-
-	I2C0->D =  address;		/*send read address	*/
-	I2C_WAIT							/*wait for completion */
+	const i2c_pins_t pins = I2C_Pins(base);
 
-	I2C_M_RSTART;				   /*repeated start */
-	I2C0->D = (dev|0x1);	 /*send dev address (read)	*/
-	I2C_WAIT							 /*wait for completion */
-
-	I2C_REC;						   /*set to receive mode */
+	pins.port->PCR[pins.sclPin] = PORT_PCR_MUX(pins.sclMux);
+	pins.port->PCR[pins.sdaPin] = PORT_PCR_MUX(pins.sdaMux);
 
+	base->C1 = I2C_C1_IICEN_MASK;
+	base->S = I2C_S_IICIF_MASK | I2C_S_ARBL_MASK;
 }
 
-
-uint8_t i2c_repeated_read(uint8_t isLastRead)
+/**
+ * @brief Pulls SCL low or releases it, then waits half a recovery clock
+ */
+void I2C_PinScl(I2C_Type *base, bool high)
 {
-	uint8_t data;
+	const i2c_pins_t pins = I2C_Pins(base);
 
-	lock_detect = 0;
-
-	if(isLastRead)	{
-		NACK;								/*set NACK after read	*/
-	} else	{
-		ACK;								/*ACK after read	*/
-	}
-
-	data = I2C0->D;				/*dummy read	*/
-	I2C_WAIT							/*wait for completion */
-
-	if(isLastRead)	{
-		I2C_M_STOP;					/*send stop	*/
-	}
-	data = I2C0->D;				/*read data	*/
-
-	return  data;
+	I2C_PinDrive(pins.gpio, pins.sclPin, high);
 }
 
-
-
-uint8_t i2c_read_byte(uint8_t dev, uint8_t address)
+/**
+ * @brief Pulls SDA low or releases it, then waits half a recovery clock
+ */
+void I2C_PinSda(I2C_Type *base, bool high)
 {
-	uint8_t data;
-
-	I2C_TRAN;							/*set to transmit mode */
-	I2C_M_START;					/*send start	*/
-	I2C0->D = dev;			  /*send dev address	*/
-	I2C_WAIT							/*wait for completion */
-
-	I2C0->D =  address;		/*send read address	*/
-	I2C_WAIT							/*wait for completion */
-
-	I2C_M_RSTART;				   /*repeated start */
-	I2C0->D = (dev|0x1);	 /*send dev address (read)	*/
-	I2C_WAIT							 /*wait for completion */
-
-	I2C_REC;						   /*set to recieve mode */
-	NACK;									 /*set NACK after read	*/
-
-	data = I2C0->D;					/*dummy read	*/
-	I2C_WAIT								/*wait for completion */
-
-	I2C_M_STOP;							/*send stop	*/
-	data = I2C0->D;					/*read data	*/
+	const i2c_pins_t pins = I2C_Pins(base);
 
-	return data;
+	I2C_PinDrive(pins.gpio, pins.sdaPin, high);
 }
 
-
-
-void i2c_write_byte(uint8_t dev, uint8_t address, uint8_t data)
+/**
+ * @brief Samples SDA
+ */
+bool I2C_PinSdaHigh(I2C_Type *base)
 {
+	const i2c_pins_t pins = I2C_Pins(base);
 
-	I2C_TRAN;							/*set to transmit mode */
-	I2C_M_START;					/*send start	*/
-	I2C0->D = dev;			  /*send dev address	*/
-	I2C_WAIT						  /*wait for ack */
-
-	I2C0->D =  address;		/*send write address	*/
-	I2C_WAIT
-
-	I2C0->D = data;				/*send data	*/
-	I2C_WAIT
-	I2C_M_STOP;
-
+	return (pins.gpio->PDIR & (1u << pins.sdaPin)) != 0;
 }
 
+/**
+ * @brief Initiates a register read after the module was brought into TX mode.
+ * @param[in] slaveId The slave id
+ * @param[in] registerAddress the register to read from
+ */
+void I2C_InitiateRegisterReadAt(const register uint8_t slaveId, const register uint8_t registerAddress)
+{
+	/* send register id */
+	I2C_SendBlocking(I2C_WRITE_ADDRESS(slaveId));
+	I2C_SendBlocking(registerAddress);
 
+	/* enter read mode */
+	I2C_SendRepeatedStart();
+	I2C_SendBlocking(I2C_READ_ADDRESS(slaveId));
+	I2C_EnterReceiveModeWithAck();
+	I2C_ReceiverModeDriveClock();
+}
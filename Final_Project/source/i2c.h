@@ -19,6 +19,8 @@
 #include "delay.h"
 #include "stdint.h"
 #include "bme.h"
+#include "i2c_irq.h"
+#include "i2c_bus.h"
 
 /**
  * Using Bit Manipulation Engine.
@@ -28,25 +30,17 @@
 #define MMA8451Q_SDA 25
 #define MMA8451Q_I2C_MUX 5
 
+/**
+ * @brief F register value for 375 kHz SCL from the 24 MHz bus clock, the closest to the MMA8451Q's 400 kHz (see I2C_Init)
+ */
+#define I2C_F_375KHZ	(I2C_F_MULT(0x00) | I2C_F_ICR(0x12))
+
 
 /**
  *  @brief According to KINETIS_L_2N97F errata (e6070), repeated start condition can not be sent if prescaler is any other than 1 (0x0).
  *  Setting this define to a nonzero value activates the proposed workaround (temporarily disabling the multiplier).
  */
 #define I2C_ENABLE_E6070_SPEEDHACK 	(1)
-#define I2C_M_START 	I2C0->C1 |= I2C_C1_MST_MASK
-#define I2C_M_STOP  	I2C0->C1 &= ~I2C_C1_MST_MASK
-#define I2C_M_RSTART 	I2C0->C1 |= I2C_C1_RSTA_MASK
-
-#define I2C_TRAN			I2C0->C1 |= I2C_C1_TX_MASK
-#define I2C_REC				I2C0->C1 &= ~I2C_C1_TX_MASK
-
-#define BUSY_ACK 	    while(I2C0->S & 0x01)
-#define TRANS_COMP		while(!(I2C0->S & 0x80))
-#define I2C_WAIT 			i2c_wait();
-
-#define NACK 	        I2C0->C1 |= I2C_C1_TXAK_MASK
-#define ACK           I2C0->C1 &= ~I2C_C1_TXAK_MASK
 
 /**
  * @brief Encodes the read address from the 7-bit slave address
@@ -68,6 +62,23 @@
  */
 #define I2C_MOD_NO_AND_MASK	(~0x0)
 
+/**
+ * @brief State of the transaction of the blocking register access
+ */
+typedef struct {
+	uint32_t started;					/*< {@see cycle_count} at the start of the transaction */
+	uint32_t budget;					/*< cycles the transaction may take, {@see I2C_BUS_TIMEOUT_US} */
+	volatile i2c_status_t status;		/*< {@see I2C_STATUS_PENDING} while running, then the result */
+#if I2C_TRACE_ENABLE
+	i2c_trace_record_t trace;			/*< the record of the transaction, completed at its end */
+#endif
+} i2c_polled_t;
+
+/**
+ * @brief The transaction of the blocking register access
+ */
+extern i2c_polled_t i2c_polled;
+
 /**
  * @brief Initializes the I2C interface
  *
@@ -114,6 +125,17 @@ void I2C_ReadRegisters(register uint8_t slaveId, register uint8_t startRegisterA
  */
 void I2C_WriteRegister(register uint8_t slaveId, register uint8_t registerAddress, register uint8_t value);
 
+/**
+ * @brief Writes consecutive 8-bit registers of an I2C slave in one auto-increment burst
+ * @param[in] slaveId The device's I2C slave id
+ * @param[in] startRegisterAddress The first register address
+ * @param[in] registerCount The number of registers to write; Must be larger than zero.
+ * @param[in] buffer The values, one per register
+ *
+ * @return: None
+ */
+void I2C_WriteRegisters(register uint8_t slaveId, register uint8_t startRegisterAddress, register uint8_t registerCount, const uint8_t *buffer);
+
 /**
  * @brief Reads an 8-bit register from an I2C slave, modifies it by FIRST and-ing with {@see andMask} and THEN or-ing with {@see orMask} and writes it back
  * @param[in] slaveId The slave id
@@ -127,14 +149,22 @@ uint8_t I2C_ModifyRegister(register uint8_t slaveId, uint8_t register registerAd
 
 
 /**
- * @brief Waits for an I2C bus operation to complete
+ * @brief Waits for an I2C bus operation to complete, at most until the transaction ran out of its time budget.
+ * 		  Once out of time, the transaction is marked {@see I2C_STATUS_TIMEOUT} and its remaining waits return at once.
  *
  * @param: None
  * @return: None
  */
 __STATIC_INLINE void I2C_Wait()
 {
-	while((I2C0->S & I2C_S_IICIF_MASK)==0) {}	/* loop until interrupt is detected */
+	while((I2C0->S & I2C_S_IICIF_MASK)==0) {	/* loop until interrupt is detected */
+		if ((i2c_polled.status != I2C_STATUS_PENDING) || I2C_BusExpired(i2c_polled.started, i2c_polled.budget)) {
+			if (i2c_polled.status == I2C_STATUS_PENDING) {
+				i2c_polled.status = I2C_STATUS_TIMEOUT;
+			}
+			return;
+		}
+	}
 
 #if !I2C_USE_BME
 	I2C0->S |= I2C_S_IICIF_MASK; /* clear interrupt flag */
@@ -143,52 +173,6 @@ __STATIC_INLINE void I2C_Wait()
 #endif
 }
 
-/**
- * @brief Waits for an I2C bus operation to complete
- *
- * @param: None
- * @param: None
- */
-__STATIC_INLINE void I2C_WaitWhileBusy()
-{
-//	while((I2C0->S & I2C_S_BUSY_MASK)!=0) {}
-	I2C0->C1 &= ~I2C_C1_IICEN_MASK;
-	I2C_TRAN;
-	I2C_M_START;
-	I2C0->C1 |=  I2C_C1_IICEN_MASK;
-	// Write to clear line
-	I2C0->C1 |= I2C_C1_MST_MASK; /* set MASTER mode */
-	I2C0->C1 |= I2C_C1_TX_MASK; /* Set transmit (TX) mode */
-	I2C0->D = 0xFF;
-	while ((I2C0->S & I2C_S_IICIF_MASK) == 0U) {
-	} /* wait interrupt */
-	I2C0->S |= I2C_S_IICIF_MASK; /* clear interrupt bit */
-
-
-							/* Clear arbitration error flag*/
-	I2C0->S |= I2C_S_ARBL_MASK;
-
-
-							/* Send start */
-	I2C0->C1 &= ~I2C_C1_IICEN_MASK;
-	I2C0->C1 |= I2C_C1_TX_MASK; /* Set transmit (TX) mode */
-	I2C0->C1 |= I2C_C1_MST_MASK; /* START signal generated */
-
-	I2C0->C1 |= I2C_C1_IICEN_MASK;
-							/*Wait until start is send*/
-
-							/* Send stop */
-	I2C0->C1 &= ~I2C_C1_IICEN_MASK;
-	I2C0->C1 |= I2C_C1_MST_MASK;
-	I2C0->C1 &= ~I2C_C1_MST_MASK; /* set SLAVE mode */
-	I2C0->C1 &= ~I2C_C1_TX_MASK; /* Set Rx */
-	I2C0->C1 |= I2C_C1_IICEN_MASK;
-
-	I2C0->S |= I2C_S_IICIF_MASK; /* wait */
-	I2C0->S |= I2C_S_ARBL_MASK; /* Clear arbitration error & interrupt flag*/
-}
-
-
 /**
  * @brief Sends a start condition and enters TX mode.
  *
@@ -476,50 +460,4 @@ __STATIC_INLINE void I2C_ReceiverModeDriveClock()
  */
 void I2C_InitiateRegisterReadAt(const register uint8_t slaveId, const register uint8_t registerAddress);
 
-//void i2c_init(void);
-
-/**
- * @brief send start sequence over the i2c
- *
- * @param: None
- * @return: None
- */
-void i2c_start(void);
-
-/**
- * @brief Read the slave configuration
- *
- * @param: 1) dev: Slave Device Address
- * 		   2) Address: Register Address to Read config from
- * @return: None
- */
-void i2c_read_setup(uint8_t dev, uint8_t address);
-
-/**
- * @brief Read a byte and ack/nack as appropriate
- *
- * @param: uint8_t value: Read multiple Data Generated from register source
- * @return: None
- */
-uint8_t i2c_repeated_read(uint8_t);
-
-/**
- * @brief For reading and writing a single byte
-		  using 7bit addressing reads a byte from dev:address
- *
- * @param: 1) dev: Slave Device Address
- * 		   2) Address: Register Address to Read data from
- * @return: None
- */
-uint8_t i2c_read_byte(uint8_t dev, uint8_t address);
-
-/**
- * @brief using 7bit addressing writes a byte data to dev:address
- *
- * @param: 1) dev: Slave Device Address
- * 		   2) Address: Register Address to Read data from
- * @return: None
- */
-void i2c_write_byte(uint8_t dev, uint8_t address, uint8_t data);
-
 #endif /* I2C_H_ */
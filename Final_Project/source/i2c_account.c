@@ -0,0 +1,54 @@
+/*
+ * i2c_account.c
+ *
+ *  Created on: Dec 15, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Cycle/byte accounting of the I2C read paths.
+ *
+ *    Sources of Reference :
+ * 		ARM Cortex-M0+ Technical Reference Manual (SysTick, exception latency)
+ */
+
+#include <string.h>
+#include "i2c_account.h"
+#include "global_defs.h"
+
+/**
+ * @brief Totals, indexed by {@see i2c_path_t}
+ */
+i2c_account_t i2c_accounts[I2C_PATH_COUNT];
+
+/**
+ * @brief Printable path names, indexed by {@see i2c_path_t}
+ */
+static const char *const path_names[I2C_PATH_COUNT] = { "polled", "irq", "dma" };
+
+/**
+ * @brief Clears all totals
+ */
+void I2C_AccountReset()
+{
+	memset(i2c_accounts, 0, sizeof(i2c_accounts));
+}
+
+/**
+ * @brief Logs the totals of every path
+ */
+void I2C_AccountReport()
+{
+	LOG("\r\n I2C accounting: path, transfers, bytes, cycles/transfer, cycles/byte, entries/transfer");
+
+	for (int path = 0; path < I2C_PATH_COUNT; ++path) {
+		const i2c_account_t *account = &i2c_accounts[path];
+		if (account->transfers == 0) {
+			continue;
+		}
+
+		LOG("\r\n   %-6s %6lu %7lu %8lu %6lu %4lu", path_names[path],
+				(unsigned long)account->transfers, (unsigned long)account->bytes,
+				(unsigned long)(account->cycles / account->transfers),
+				(unsigned long)(account->cycles / account->bytes),
+				(unsigned long)(account->entries / account->transfers));
+	}
+}
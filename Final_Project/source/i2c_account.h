@@ -0,0 +1,123 @@
+/*
+ * i2c_account.h
+ *
+ *  Created on: Dec 15, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Header file for the cycle/byte accounting of the I2C read paths.
+ *
+ *      		With {@see I2C_ACCOUNTING} set, every path adds the core cycles it kept the
+ *      		CPU busy to its {@see i2c_account_t}, together with the number of completed
+ *      		transfers, the data bytes they moved and the CPU entries it took:
+ *      		- polled:	the whole I2C_ReadRegisters call, spinning included
+ *      		- IRQ:		I2C_IrqSubmit and every I2C0 interrupt of a transfer without DMA
+ *      		- DMA:		I2C_IrqSubmit, the I2C0 interrupts and the DMA0 interrupt of a DMA transfer
+ *      		Exception entry and exit (~2 x 15 cycles on the M0+) are not part of the figures.
+ *      		With accounting disabled the hooks compile to nothing.
+ *
+ *    Sources of Reference :
+ * 		ARM Cortex-M0+ Technical Reference Manual (SysTick, exception latency)
+ */
+
+#ifndef I2C_ACCOUNT_H_
+#define I2C_ACCOUNT_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Set to nonzero to account cycles and bytes of every I2C read
+ */
+#define I2C_ACCOUNTING		(0)
+
+/**
+ * @brief The ways a read can be carried out
+ */
+typedef enum {
+	I2C_PATH_POLLED = 0,		/*< blocking, busy-waits on IICIF for every byte */
+	I2C_PATH_IRQ,				/*< interrupt engine, one interrupt per byte */
+	I2C_PATH_DMA,				/*< interrupt engine with the DMA data phase */
+	I2C_PATH_COUNT
+} i2c_path_t;
+
+/**
+ * @brief Totals of one path
+ */
+typedef struct {
+	uint32_t transfers;			/*< completed transfers */
+	uint32_t bytes;				/*< data bytes moved by those transfers */
+	uint32_t cycles;			/*< core cycles spent in driver code */
+	uint32_t entries;			/*< calls and interrupts that made up those cycles */
+} i2c_account_t;
+
+/**
+ * @brief Totals, indexed by {@see i2c_path_t}
+ */
+extern i2c_account_t i2c_accounts[I2C_PATH_COUNT];
+
+#if I2C_ACCOUNTING
+
+#include "MKL25Z4.h"
+#include "systick.h"
+
+/**
+ * @brief Opens a measured section
+ */
+#define I2C_ACCOUNT_BEGIN()				const uint32_t i2c_account_start = cycle_count()
+
+/**
+ * @brief Closes the section opened by {@see I2C_ACCOUNT_BEGIN} and charges it to a path
+ */
+#define I2C_ACCOUNT_END(path)			I2C_AccountCycles((path), cycle_count() - i2c_account_start)
+
+/**
+ * @brief Records a completed transfer
+ */
+#define I2C_ACCOUNT_TRANSFER(path, n)	I2C_AccountTransfer((path), (n))
+
+#else
+
+#define I2C_ACCOUNT_BEGIN()				do {} while (0)
+#define I2C_ACCOUNT_END(path)			do {} while (0)
+#define I2C_ACCOUNT_TRANSFER(path, n)	do {} while (0)
+
+#endif
+
+/**
+ * @brief Charges cycles to a path
+ * @param[in] path The path
+ * @param[in] cycles Core cycles spent
+ */
+static inline void I2C_AccountCycles(i2c_path_t path, uint32_t cycles)
+{
+	i2c_accounts[path].cycles += cycles;
+	i2c_accounts[path].entries++;
+}
+
+/**
+ * @brief Records a completed transfer
+ * @param[in] path The path
+ * @param[in] bytes Data bytes moved
+ */
+static inline void I2C_AccountTransfer(i2c_path_t path, uint32_t bytes)
+{
+	i2c_accounts[path].transfers++;
+	i2c_accounts[path].bytes += bytes;
+}
+
+/**
+ * @brief Clears all totals
+ *
+ * @param: None
+ * @return: None
+ */
+void I2C_AccountReset();
+
+/**
+ * @brief Logs the totals of every path: cycles per transfer, cycles per byte and entries per transfer
+ *
+ * @param: None
+ * @return: None
+ */
+void I2C_AccountReport();
+
+#endif /* I2C_ACCOUNT_H_ */
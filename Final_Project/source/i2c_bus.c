@@ -0,0 +1,168 @@
+/*
+ * i2c_bus.c
+ *
+ *  Created on: Dec 21, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Health of the I2C bus: bus recovery, outcome counters and latency histograms.
+ *
+ *    Sources of Reference :
+ * 		NXP UM10204 I2C-bus specification and user manual, 3.1.16 (Bus clear)
+ * 		KL25 Sub-Family Reference Manual, Chapter 38 (S.BUSY, S.ARBL)
+ */
+
+#include <string.h>
+#include "i2c_bus.h"
+#include "global_defs.h"
+
+/**
+ * @brief The bus counters
+ */
+volatile i2c_bus_stats_t i2c_bus_stats;
+
+/**
+ * @brief Printable direction names, indexed by {@see i2c_direction_t}
+ */
+static const char *const direction_names[2] = { "write", "read" };
+
+/**
+ * @brief Makes sure the bus is free before a driver starts a transaction on it
+ */
+bool I2C_BusAcquire(I2C_Type *base)
+{
+	/* the healthy case: nobody on the bus */
+	if (!(base->S & I2C_S_BUSY_MASK)) {
+		return true;
+	}
+
+	/* our own STOP may still be on the wire, give it a moment */
+	i2c_bus_stats.busyWaits++;
+	const uint32_t start = cycle_count();
+	while (base->S & I2C_S_BUSY_MASK) {
+		if (I2C_BusExpired(start, I2C_BUS_US_TO_CYCLES(I2C_BUS_BUSY_GRACE_US))) {
+			return I2C_BusRecover(base);
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Frees a bus held by a slave
+ */
+bool I2C_BusRecover(I2C_Type *base)
+{
+	uint32_t clocks = 0;
+
+	I2C_PinsTakeover(base);
+
+	/* a slave cut off in the middle of a read drives its next bit; it lets go of SDA
+	 * at the latest when it sees no ACK after the end of its byte */
+	while (!I2C_PinSdaHigh(base) && (clocks < I2C_BUS_RECOVERY_CLOCKS)) {
+		I2C_PinScl(base, false);
+		I2C_PinScl(base, true);
+		clocks++;
+	}
+
+	/* STOP, SDA rising while SCL is high, resets the bus logic of every slave */
+	I2C_PinScl(base, false);
+	I2C_PinSda(base, false);
+	I2C_PinScl(base, true);
+	I2C_PinSda(base, true);
+
+	const bool released = I2C_PinSdaHigh(base);
+	I2C_PinsRelease(base);
+
+	i2c_bus_stats.recoveries++;
+	i2c_bus_stats.recoveryClocks += clocks;
+	if (!released) {
+		i2c_bus_stats.recoveryFailures++;
+	}
+	return released;
+}
+
+/**
+ * @brief Histogram bin of a latency
+ * @param[in] us The latency in microseconds
+ * @return The bin, see {@see I2C_BUS_LATENCY_BINS}
+ */
+static uint32_t I2C_BusLatencyBin(uint32_t us)
+{
+	/* the M0+ has no CLZ, a shift loop of at most 16 rounds is as quick as the library call */
+	uint32_t bin = 0;
+	while ((us != 0) && (bin < I2C_BUS_LATENCY_BINS - 1)) {
+		us >>= 1;
+		bin++;
+	}
+	return bin;
+}
+
+/**
+ * @brief Counts a finished transaction and adds its latency to the histogram of its direction
+ */
+void I2C_BusRecord(i2c_direction_t direction, i2c_status_t status, uint32_t cycles)
+{
+	const uint32_t us = cycles / I2C_BUS_CYCLES_PER_US;
+
+	i2c_bus_stats.transfers++;
+	switch (status) {
+	case I2C_STATUS_NACK:
+		i2c_bus_stats.nacks++;
+		break;
+	case I2C_STATUS_ARBITRATION_LOST:
+		i2c_bus_stats.arbitrationLost++;
+		break;
+	case I2C_STATUS_TIMEOUT:
+		i2c_bus_stats.timeouts++;
+		break;
+	case I2C_STATUS_BUS_ERROR:
+		i2c_bus_stats.busErrors++;
+		break;
+	default:
+		break;
+	}
+
+	i2c_bus_stats.latency[direction][I2C_BusLatencyBin(us)]++;
+	if (us > i2c_bus_stats.worstUs[direction]) {
+		i2c_bus_stats.worstUs[direction] = us;
+	}
+}
+
+/**
+ * @brief Clears all counters and histograms
+ */
+void I2C_BusReset()
+{
+	memset((void *)&i2c_bus_stats, 0, sizeof(i2c_bus_stats));
+}
+
+/**
+ * @brief Logs the counters and the populated histogram bins
+ */
+void I2C_BusReport()
+{
+	LOG("\r\n I2C bus: %lu transfers, %lu nack, %lu arbitration lost, %lu timeouts, %lu bus errors",
+			(unsigned long)i2c_bus_stats.transfers, (unsigned long)i2c_bus_stats.nacks,
+			(unsigned long)i2c_bus_stats.arbitrationLost, (unsigned long)i2c_bus_stats.timeouts,
+			(unsigned long)i2c_bus_stats.busErrors);
+	LOG("\r\n I2C bus: %lu busy waits, %lu recoveries, %lu recovery clocks, %lu failed recoveries",
+			(unsigned long)i2c_bus_stats.busyWaits, (unsigned long)i2c_bus_stats.recoveries,
+			(unsigned long)i2c_bus_stats.recoveryClocks, (unsigned long)i2c_bus_stats.recoveryFailures);
+
+	for (int direction = 0; direction < 2; ++direction) {
+		LOG("\r\n I2C %s latency, worst %lu us:", direction_names[direction],
+				(unsigned long)i2c_bus_stats.worstUs[direction]);
+
+		for (int bin = 0; bin < I2C_BUS_LATENCY_BINS; ++bin) {
+			const uint32_t count = i2c_bus_stats.latency[direction][bin];
+			if (count == 0) {
+				continue;
+			}
+			if (bin == I2C_BUS_LATENCY_BINS - 1) {
+				LOG("\r\n  >= %6lu us %8lu", (unsigned long)(1ul << (bin - 1)), (unsigned long)count);
+			}
+			else {
+				LOG("\r\n   < %6lu us %8lu", (unsigned long)(1ul << bin), (unsigned long)count);
+			}
+		}
+	}
+}
@@ -0,0 +1,216 @@
+/*
+ * i2c_bus.h
+ *
+ *  Created on: Dec 21, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Header file for the health of the I2C bus: timeouts, bus recovery and latency.
+ *
+ *      		Timeouts are wall-clock budgets measured with {@see cycle_count}, so they mean the
+ *      		same at every optimisation level. A transaction of n bytes on the wire may take
+ *      		{@see I2C_BUS_TIMEOUT_US} before it is aborted with {@see I2C_STATUS_TIMEOUT}.
+ *
+ *      		A healthy bus pays nothing but a look at S.BUSY. Recovery only runs when the bus
+ *      		is known to be held: after a timeout, after a lost arbitration (there is no other
+ *      		master on this board, so it means a slave drives SDA low), or when BUSY does not
+ *      		clear within {@see I2C_BUS_BUSY_GRACE_US}. It takes the pins from the module, clocks
+ *      		SCL until the slave lets go of SDA, at most {@see I2C_BUS_RECOVERY_CLOCKS} times, and
+ *      		ends with a STOP; this costs at most {@see I2C_BUS_RECOVERY_MAX_US}.
+ *
+ *      		Every finished transaction is counted by outcome, and its latency, from submission
+ *      		to completion, lands in a log2 histogram per direction.
+ *
+ *    Sources of Reference :
+ * 		NXP UM10204 I2C-bus specification and user manual, 3.1.16 (Bus clear)
+ * 		KL25 Sub-Family Reference Manual, Chapter 38 (S.BUSY, S.ARBL) and Chapter 41 (GPIO)
+ */
+
+#ifndef I2C_BUS_H_
+#define I2C_BUS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "MKL25Z4.h"
+#include "systick.h"
+#include "i2c_irq.h"
+
+/**
+ * @brief Core clock cycles, as counted by {@see cycle_count}, per microsecond
+ */
+#define I2C_BUS_CYCLES_PER_US		(SYSTEM_CLOCK_FREQ / 1000000UL)
+
+/**
+ * @brief Converts microseconds to {@see cycle_count} cycles
+ */
+#define I2C_BUS_US_TO_CYCLES(us)	((uint32_t)(us) * I2C_BUS_CYCLES_PER_US)
+
+/**
+ * @brief Allowance per byte on the wire; a byte takes 9 SCL clocks, 24 us at 375 kHz
+ */
+#define I2C_BUS_BYTE_TIMEOUT_US		(48)
+
+/**
+ * @brief Allowance per transaction for interrupt latency and the SysTick period at which a waiter looks at the clock
+ */
+#define I2C_BUS_TIMEOUT_SLACK_US	(1000)
+
+/**
+ * @brief Time budget of a transaction moving <code>bytes</code> bytes over the wire, addresses included
+ */
+#define I2C_BUS_TIMEOUT_US(bytes)	(I2C_BUS_TIMEOUT_SLACK_US + (uint32_t)(bytes) * I2C_BUS_BYTE_TIMEOUT_US)
+
+/**
+ * @brief Bytes on the wire besides the data of a register access: write address, register and, for reads, read address
+ */
+#define I2C_BUS_OVERHEAD_BYTES		(3)
+
+/**
+ * @brief How long S.BUSY may stay set on an idle driver, e.g. while its own STOP is still on the wire, before the bus counts as held
+ */
+#define I2C_BUS_BUSY_GRACE_US		(50)
+
+/**
+ * @brief SCL clocks that bring any slave to the end of a byte and its ACK, where it releases SDA
+ */
+#define I2C_BUS_RECOVERY_CLOCKS		(9)
+
+/**
+ * @brief Half period of the recovery clock, 100 kHz, slow enough for every slave
+ */
+#define I2C_BUS_RECOVERY_HALF_US	(5)
+
+/**
+ * @brief Longest time a recovery can take: two half clocks per pulse and four for the STOP
+ */
+#define I2C_BUS_RECOVERY_MAX_US		((2 * I2C_BUS_RECOVERY_CLOCKS + 4) * I2C_BUS_RECOVERY_HALF_US)
+
+/**
+ * @brief Bins of a latency histogram: bin 0 counts latencies below 1 us, bin b those in [2^(b-1), 2^b) us,
+ * 		  the last bin everything above
+ */
+#define I2C_BUS_LATENCY_BINS		(16)
+
+/**
+ * @brief Outcomes and latencies of the transactions on the bus
+ */
+typedef struct {
+	uint32_t transfers;					/*< transactions finished, whatever the outcome */
+	uint32_t nacks;						/*< of those, not acknowledged by the slave */
+	uint32_t arbitrationLost;			/*< of those, lost the bus while addressing or sending */
+	uint32_t timeouts;					/*< of those, aborted after their time budget */
+	uint32_t busErrors;					/*< of those, never started because the bus stayed held */
+	uint32_t busyWaits;					/*< times an idle driver found S.BUSY set */
+	uint32_t recoveries;				/*< recovery sequences run */
+	uint32_t recoveryClocks;			/*< SCL pulses issued by them */
+	uint32_t recoveryFailures;			/*< recoveries after which SDA was still low */
+	uint32_t worstUs[2];				/*< longest latency, indexed by {@see i2c_direction_t} */
+	uint32_t latency[2][I2C_BUS_LATENCY_BINS];	/*< latency histograms, indexed by {@see i2c_direction_t} */
+} i2c_bus_stats_t;
+
+/**
+ * @brief The bus counters
+ */
+extern volatile i2c_bus_stats_t i2c_bus_stats;
+
+/**
+ * @brief Determines if a time budget is used up
+ * @param[in] start {@see cycle_count} when the budget started
+ * @param[in] budget The budget in cycles
+ * @return true if at least <code>budget</code> cycles passed since <code>start</code>
+ */
+static inline bool I2C_BusExpired(uint32_t start, uint32_t budget)
+{
+	return (cycle_count() - start) >= budget;
+}
+
+/**
+ * @brief Busy-waits for a number of cycles
+ * @param[in] cycles The time to wait
+ */
+static inline void I2C_BusDelay(uint32_t cycles)
+{
+	const uint32_t start = cycle_count();
+	while (!I2C_BusExpired(start, cycles)) {}
+}
+
+/**
+ * @brief Makes sure the bus is free before a driver starts a transaction on it
+ *
+ * Costs a single register read while S.BUSY is clear. Otherwise waits up to
+ * {@see I2C_BUS_BUSY_GRACE_US} for it to clear, then runs {@see I2C_BusRecover}.
+ * @param[inout] base The I2C register block
+ * @return true if the bus is free, false if it is still held
+ */
+bool I2C_BusAcquire(I2C_Type *base);
+
+/**
+ * @brief Frees a bus held by a slave: up to {@see I2C_BUS_RECOVERY_CLOCKS} SCL pulses until SDA is high, then a STOP.
+ * 		  The module is disabled meanwhile and re-enabled afterwards. Takes at most {@see I2C_BUS_RECOVERY_MAX_US}.
+ * @param[inout] base The I2C register block
+ * @return true if SDA is high afterwards
+ */
+bool I2C_BusRecover(I2C_Type *base);
+
+/**
+ * @brief Counts a finished transaction and adds its latency to the histogram of its direction
+ * @param[in] direction Read or write
+ * @param[in] status The final status
+ * @param[in] cycles Cycles from submission to completion
+ */
+void I2C_BusRecord(i2c_direction_t direction, i2c_status_t status, uint32_t cycles);
+
+/**
+ * @brief Clears all counters and histograms
+ *
+ * @param: None
+ * @return: None
+ */
+void I2C_BusReset();
+
+/**
+ * @brief Logs the counters and the populated histogram bins
+ *
+ * @param: None
+ * @return: None
+ */
+void I2C_BusReport();
+
+/*
+ * Pin access of the recovery, provided by the platform: i2c.c on the target, host/sim_i2c.c on the host.
+ * Driving a pin waits half a recovery clock afterwards.
+ */
+
+/**
+ * @brief Disables the module and hands SCL and SDA to GPIO, both released
+ * @param[inout] base The I2C register block
+ */
+void I2C_PinsTakeover(I2C_Type *base);
+
+/**
+ * @brief Hands SCL and SDA back to the module and re-enables it
+ * @param[inout] base The I2C register block
+ */
+void I2C_PinsRelease(I2C_Type *base);
+
+/**
+ * @brief Pulls SCL low or releases it, then waits half a recovery clock
+ * @param[inout] base The I2C register block
+ * @param[in] high false pulls the line low
+ */
+void I2C_PinScl(I2C_Type *base, bool high);
+
+/**
+ * @brief Pulls SDA low or releases it, then waits half a recovery clock
+ * @param[inout] base The I2C register block
+ * @param[in] high false pulls the line low
+ */
+void I2C_PinSda(I2C_Type *base, bool high);
+
+/**
+ * @brief Samples SDA
+ * @param[in] base The I2C register block
+ * @return true if the line is high
+ */
+bool I2C_PinSdaHigh(I2C_Type *base);
+
+#endif /* I2C_BUS_H_ */
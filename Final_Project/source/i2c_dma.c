@@ -0,0 +1,107 @@
+/*
+ * i2c_dma.c
+ *
+ *  Created on: Dec 15, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: DMA data phase of the interrupt driven I2C engine.
+ *
+ *    Sources of Reference :
+ * 		KL25 Sub-Family Reference Manual, Chapter 23 (DMA Controller Module) and 38.3.3 (I2C DMAEN)
+ * 		MCUXpresso SDK drivers/fsl_i2c_dma.c (I2C_MasterTransferDMA, I2C_MasterTransferCallbackDMA)
+ */
+
+#include "i2c_dma.h"
+#include "i2c_irq.h"
+#include "i2c_account.h"
+#include "bme.h"
+#include "assert.h"
+
+/**
+ * @brief DMAMUX source number of the I2C0 request
+ */
+#define I2C_DMA_SOURCE_I2C0		(22)
+
+/**
+ * @brief Channel errors reported in DSR
+ */
+#define I2C_DMA_ERROR_MASK		(DMA_DSR_BCR_CE_MASK | DMA_DSR_BCR_BES_MASK | DMA_DSR_BCR_BED_MASK)
+
+/**
+ * @brief The channel bound to {@see i2c0_engine}
+ */
+i2c_dma_t i2c0_dma;
+
+/**
+ * @brief Gates the DMA clocks, routes the I2C0 request to {@see I2C_DMA_CHANNEL}, attaches
+ * 		  {@see i2c0_dma} to {@see i2c0_engine} and enables the channel interrupt in the NVIC.
+ */
+void I2C_DmaEnable()
+{
+	BME_OR_W(&SIM->SCGC6, SIM_SCGC6_DMAMUX_MASK);
+	BME_OR_W(&SIM->SCGC7, SIM_SCGC7_DMA_MASK);
+
+	i2c0_dma.base = DMA0;
+	i2c0_dma.channel = I2C_DMA_CHANNEL;
+
+	/* idle channel, no stale status */
+	DMA0->DMA[I2C_DMA_CHANNEL].DCR = 0;
+	DMA0->DMA[I2C_DMA_CHANNEL].DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+
+	DMAMUX0->CHCFG[I2C_DMA_CHANNEL] = 0;
+	DMAMUX0->CHCFG[I2C_DMA_CHANNEL] = DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_SOURCE(I2C_DMA_SOURCE_I2C0);
+
+	/* same urgency as the I2C0 interrupt, so neither handler preempts the other */
+	NVIC_SetPriority(DMA0_IRQn, I2C_IRQ_PRIORITY);
+	NVIC_ClearPendingIRQ(DMA0_IRQn);
+	NVIC_EnableIRQ(DMA0_IRQn);
+
+	i2c0_engine.dma = &i2c0_dma;
+}
+
+/**
+ * @brief Arms the channel to move <code>count</code> bytes from the data register into a buffer
+ */
+void I2C_DmaStartRead(const i2c_dma_t *dma, volatile const uint8_t *source, uint8_t *destination, uint8_t count)
+{
+	assert(count > 0);
+
+	DMA_Type *base = dma->base;
+	const uint8_t channel = dma->channel;
+
+	base->DMA[channel].DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+	base->DMA[channel].SAR = (uint32_t)source;
+	base->DMA[channel].DAR = (uint32_t)destination;
+	base->DMA[channel].DSR_BCR = DMA_DSR_BCR_BCR(count);
+
+	/* one byte per request from a fixed register into an incrementing buffer,
+	 * dropping the request line and interrupting once BCR ran out */
+	base->DMA[channel].DCR = DMA_DCR_EINT_MASK | DMA_DCR_ERQ_MASK | DMA_DCR_CS_MASK
+			| DMA_DCR_SSIZE(1) | DMA_DCR_DSIZE(1) | DMA_DCR_DINC_MASK | DMA_DCR_D_REQ_MASK;
+}
+
+/**
+ * @brief Acknowledges the channel interrupt
+ */
+bool I2C_DmaAcknowledge(const i2c_dma_t *dma)
+{
+	DMA_Type *base = dma->base;
+	const uint8_t channel = dma->channel;
+	register uint32_t status = base->DMA[channel].DSR_BCR;
+
+	/* DONE is write-one-to-clear and also clears the error bits */
+	base->DMA[channel].DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+	base->DMA[channel].DCR = 0;
+
+	return (status & I2C_DMA_ERROR_MASK) == 0;
+}
+
+/**
+ * @brief DMA channel 0 interrupt handler
+ */
+void DMA0_IRQHandler()
+{
+	I2C_ACCOUNT_BEGIN();
+	I2C_IrqDmaDone(&i2c0_engine, I2C_DmaAcknowledge(&i2c0_dma));
+	I2C_ACCOUNT_END(I2C_PATH_DMA);
+}
@@ -0,0 +1,83 @@
+/*
+ * i2c_dma.h
+ *
+ *  Created on: Dec 15, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Header file for the DMA data phase of the interrupt driven I2C engine.
+ *
+ *      		Reads of at least {@see I2C_DMA_MIN_LENGTH} bytes are handed from the engine
+ *      		to a DMA channel once the read address was acknowledged. The channel moves
+ *      		every byte but the last one from I2C0->D into the buffer, cycle stealing on
+ *      		the I2C0 request without any CPU involvement. Its completion interrupt hands
+ *      		the transfer back to the engine, which NACKs and stops the last byte.
+ *
+ *      		A 7 byte status + XYZ read costs 4 interrupts this way instead of 10, and a
+ *      		192 byte FIFO burst still costs 4 instead of 195.
+ *
+ *      		The channel is attached when {@see I2C_HAL_BACKEND} is {@see I2C_HAL_DMA}.
+ *
+ *    Sources of Reference :
+ * 		KL25 Sub-Family Reference Manual, Chapter 23 (DMA Controller Module) and 38.3.3 (I2C DMAEN)
+ * 		MCUXpresso SDK drivers/fsl_i2c_dma.c (I2C_MasterTransferDMA, I2C_MasterTransferCallbackDMA)
+ */
+
+#ifndef I2C_DMA_H_
+#define I2C_DMA_H_
+
+#include "MKL25Z4.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief DMA channel reserved for I2C0; DMA0_IRQHandler belongs to this module
+ */
+#define I2C_DMA_CHANNEL		(0)
+
+/**
+ * @brief Shortest read handed to the DMA channel.
+ *
+ * Below this, programming the channel costs about as much as the per-byte interrupts it saves.
+ */
+#define I2C_DMA_MIN_LENGTH	(3)
+
+/**
+ * @brief DMA channel serving an {@see i2c_irq_engine_t}
+ */
+typedef struct i2c_dma {
+	DMA_Type *base;				/*< DMA controller */
+	uint8_t channel;			/*< channel number, 0 to 3 */
+} i2c_dma_t;
+
+/**
+ * @brief The channel bound to {@see i2c0_engine}
+ */
+extern i2c_dma_t i2c0_dma;
+
+/**
+ * @brief Gates the DMA clocks, routes the I2C0 request to {@see I2C_DMA_CHANNEL}, attaches
+ * 		  {@see i2c0_dma} to {@see i2c0_engine} and enables the channel interrupt in the NVIC.
+ *
+ * @param: None
+ * @return: None
+ */
+void I2C_DmaEnable();
+
+/**
+ * @brief Arms the channel to move <code>count</code> bytes from the data register into a buffer,
+ * 		  one byte per I2C request. The channel raises its interrupt when done.
+ * @param[in] dma The channel
+ * @param[in] source The I2C data register
+ * @param[out] destination The buffer
+ * @param[in] count The number of bytes; Must be larger than zero.
+ */
+void I2C_DmaStartRead(const i2c_dma_t *dma, volatile const uint8_t *source, uint8_t *destination, uint8_t count);
+
+/**
+ * @brief Acknowledges the channel interrupt
+ * @param[in] dma The channel
+ * @return true if the channel finished without a configuration or bus error
+ */
+bool I2C_DmaAcknowledge(const i2c_dma_t *dma);
+
+#endif /* I2C_DMA_H_ */
@@ -0,0 +1,235 @@
+/*
+ * i2c_hal.h
+ *
+ *  Created on: Dec 20, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Header file for the single I2C access layer of the sensor drivers.
+ *
+ *      		Every register access of the drivers goes through the I2C_Hal calls below.
+ *      		The backend carrying them out is chosen at compile time with
+ *      		{@see I2C_HAL_BACKEND}; each call is a static inline that resolves to the
+ *      		backend's code, so there is no function pointer or switch on the hot path.
+ *      		- polled:	the blocking register access of i2c.c, busy-waiting on IICIF
+ *      		- IRQ:		the interrupt driven engine of i2c_irq.c, sleeping until done
+ *      		- DMA:		the engine with the DMA data phase of i2c_dma.c
+ *      		- sim:		the engine on a simulated register block (host/i2c_hal_sim.c),
+ *      					host builds only; waiting runs the simulation instead of sleeping
+ *
+ *      		Blocking calls (I2C_HalRead..., I2C_HalWrite...) return once the transaction is
+ *      		over. {@see I2C_HalSubmit} starts a transaction and returns; with the polled
+ *      		backend it has already completed and run its callback by then.
+ *
+ *    Sources of Reference :
+ * 		Textbooks : Embedded Systems Fundamentals with Arm Cortex-M based MicroControllers
+ * 		KL25 Sub-Family Reference Manual, Chapter 38 (Inter-Integrated Circuit)
+ */
+
+#ifndef I2C_HAL_H_
+#define I2C_HAL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "i2c.h"
+#include "i2c_irq.h"
+
+#define I2C_HAL_POLLED		(0)		/*< blocking register access of i2c.c */
+#define I2C_HAL_IRQ			(1)		/*< interrupt driven engine, one interrupt per byte */
+#define I2C_HAL_DMA			(2)		/*< interrupt driven engine, data phase of long reads by DMA */
+#define I2C_HAL_SIM			(3)		/*< interrupt driven engine on the simulated register block of the host */
+
+/**
+ * @brief The backend of every I2C_Hal call; host builds always use {@see I2C_HAL_SIM}
+ */
+#ifndef I2C_HAL_BACKEND
+#ifdef HOST_BUILD
+#define I2C_HAL_BACKEND		I2C_HAL_SIM
+#else
+#define I2C_HAL_BACKEND		I2C_HAL_DMA
+#endif
+#endif
+
+#if (I2C_HAL_BACKEND == I2C_HAL_SIM) && !defined(HOST_BUILD)
+#error "I2C_HAL_SIM runs on the host only"
+#endif
+
+#if I2C_HAL_BACKEND == I2C_HAL_SIM
+/**
+ * @brief Plays the role of the NVIC for the simulated register block: runs {@see I2C_IrqHandler}
+ * 		  for as long as the module raises IICIF with IICIE set. Provided by host/i2c_hal_sim.c.
+ *
+ * @param: None
+ * @return: None
+ */
+void I2C_HalSimRun();
+#endif
+
+/**
+ * @brief Starts a transaction and returns; the descriptor and its buffer stay owned by the backend
+ * 		  until the status left {@see I2C_STATUS_PENDING}
+ * @param[inout] transfer The descriptor
+ * @return {@see I2C_STATUS_PENDING} if the transaction was accepted, {@see I2C_STATUS_BUSY} otherwise
+ */
+static inline i2c_status_t I2C_HalSubmit(i2c_transfer_t *transfer)
+{
+#if I2C_HAL_BACKEND == I2C_HAL_POLLED
+	/* one transaction at a time, it is done before this returns */
+	if (transfer->direction == I2C_DIRECTION_READ) {
+		I2C_ReadRegisters(transfer->slaveId, transfer->registerAddress, transfer->length, transfer->buffer);
+	}
+	else {
+		I2C_WriteRegisters(transfer->slaveId, transfer->registerAddress, transfer->length, transfer->buffer);
+	}
+	/* the result I2C_PolledEnd settled, a timed out or refused transaction is not reported as done */
+	transfer->status = i2c_polled.status;
+	if (transfer->callback) {
+		transfer->callback(transfer);
+	}
+	return I2C_STATUS_PENDING;
+#else
+	return I2C_IrqSubmit(&i2c0_engine, transfer);
+#endif
+}
+
+/**
+ * @brief Spins until a submitted transaction is over, for a caller in interrupt context that must not sleep.
+ * 		  The I2C interrupt is more urgent than the caller, and a transaction that raises it no more is
+ * 		  aborted once out of its time budget, so this takes at most the budget and a bus recovery.
+ * @param[in] transfer The descriptor
+ */
+static inline void I2C_HalSpin(const i2c_transfer_t *transfer)
+{
+	while (transfer->status == I2C_STATUS_PENDING) {
+#if I2C_HAL_BACKEND == I2C_HAL_SIM
+		/* nothing interrupts a host thread: run the bus here */
+		I2C_HalSimRun();
+#endif
+		I2C_IrqExpire(&i2c0_engine);
+	}
+}
+
+/**
+ * @brief Waits until a submitted transaction is over, at most for its time budget
+ * @param[in] transfer The descriptor
+ * @return The final status
+ */
+static inline i2c_status_t I2C_HalWait(const i2c_transfer_t *transfer)
+{
+#if I2C_HAL_BACKEND == I2C_HAL_SIM
+	/* nothing interrupts a host thread: run the bus here, until done or out of time */
+	while (transfer->status == I2C_STATUS_PENDING) {
+		I2C_HalSimRun();
+		I2C_IrqExpire(&i2c0_engine);
+	}
+	return transfer->status;
+#else
+	return I2C_IrqWait(&i2c0_engine, transfer);
+#endif
+}
+
+/**
+ * @brief Tells whether no transaction is in flight, e.g. before the bus clock is stopped
+ * @return true if idle
+ */
+static inline bool I2C_HalIdle()
+{
+#if I2C_HAL_BACKEND == I2C_HAL_POLLED
+	/* every transaction is over when its call returns */
+	return true;
+#else
+	return I2C_IrqIdle(&i2c0_engine);
+#endif
+}
+
+/**
+ * @brief Runs a transaction on the engine and waits for it; not for the polled backend
+ * @param[in] slaveId The 7-bit slave address
+ * @param[in] registerAddress The first register
+ * @param[in] direction Read or write
+ * @param[inout] buffer The data
+ * @param[in] length The number of registers; Must be larger than zero.
+ * @return The final status
+ */
+static inline i2c_status_t I2C_HalTransfer(uint8_t slaveId, uint8_t registerAddress, i2c_direction_t direction, uint8_t *buffer, uint8_t length)
+{
+	i2c_transfer_t transfer = {
+		.slaveId = slaveId,
+		.registerAddress = registerAddress,
+		.direction = direction,
+		.buffer = buffer,
+		.length = length,
+		.callback = 0
+	};
+
+	/* wait out a transaction of another engine user */
+	while (I2C_HalSubmit(&transfer) == I2C_STATUS_BUSY) {}
+	return I2C_HalWait(&transfer);
+}
+
+/**
+ * @brief Reads consecutive 8-bit registers of an I2C slave in one auto-increment burst
+ * @param[in] slaveId The 7-bit slave address
+ * @param[in] startRegisterAddress The first register
+ * @param[in] registerCount The number of registers; Must be larger than zero.
+ * @param[out] buffer The buffer to read into
+ */
+static inline void I2C_HalReadRegisters(uint8_t slaveId, uint8_t startRegisterAddress, uint8_t registerCount, uint8_t *buffer)
+{
+#if I2C_HAL_BACKEND == I2C_HAL_POLLED
+	I2C_ReadRegisters(slaveId, startRegisterAddress, registerCount, buffer);
+#else
+	I2C_HalTransfer(slaveId, startRegisterAddress, I2C_DIRECTION_READ, buffer, registerCount);
+#endif
+}
+
+/**
+ * @brief Reads an 8-bit register of an I2C slave
+ * @param[in] slaveId The 7-bit slave address
+ * @param[in] registerAddress The register
+ * @return The register value; 0xFF if nobody answered
+ */
+static inline uint8_t I2C_HalReadRegister(uint8_t slaveId, uint8_t registerAddress)
+{
+#if I2C_HAL_BACKEND == I2C_HAL_POLLED
+	return I2C_ReadRegister(slaveId, registerAddress);
+#else
+	/* the polled read returns what the released bus reads as */
+	uint8_t value = 0xFF;
+	I2C_HalTransfer(slaveId, registerAddress, I2C_DIRECTION_READ, &value, 1);
+	return value;
+#endif
+}
+
+/**
+ * @brief Writes consecutive 8-bit registers of an I2C slave in one auto-increment burst
+ * @param[in] slaveId The 7-bit slave address
+ * @param[in] startRegisterAddress The first register
+ * @param[in] registerCount The number of registers; Must be larger than zero.
+ * @param[in] buffer The values, one per register
+ */
+static inline void I2C_HalWriteRegisters(uint8_t slaveId, uint8_t startRegisterAddress, uint8_t registerCount, const uint8_t *buffer)
+{
+#if I2C_HAL_BACKEND == I2C_HAL_POLLED
+	I2C_WriteRegisters(slaveId, startRegisterAddress, registerCount, buffer);
+#else
+	/* the engine only reads the buffer of a write */
+	I2C_HalTransfer(slaveId, startRegisterAddress, I2C_DIRECTION_WRITE, (uint8_t *)buffer, registerCount);
+#endif
+}
+
+/**
+ * @brief Writes an 8-bit register of an I2C slave
+ * @param[in] slaveId The 7-bit slave address
+ * @param[in] registerAddress The register
+ * @param[in] value The value
+ */
+static inline void I2C_HalWriteRegister(uint8_t slaveId, uint8_t registerAddress, uint8_t value)
+{
+#if I2C_HAL_BACKEND == I2C_HAL_POLLED
+	I2C_WriteRegister(slaveId, registerAddress, value);
+#else
+	I2C_HalTransfer(slaveId, registerAddress, I2C_DIRECTION_WRITE, &value, 1);
+#endif
+}
+
+#endif /* I2C_HAL_H_ */
@@ -0,0 +1,389 @@
+/*
+ * i2c_irq.c
+ *
+ *  Created on: Dec 14, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Interrupt driven (non-blocking) I2C transaction engine.
+ *
+ *      		Sequence of a register read as driven by the state machine:
+ *      		START, W-address | register | repeated START, R-address | RX data ... NACK, STOP
+ *      		Each '|' is one IICIF interrupt, as is every received data byte.
+ *      		With a DMA channel attached, reads of {@see I2C_DMA_MIN_LENGTH} bytes or more
+ *      		move all but the last byte by DMA, and the channel interrupt replaces the
+ *      		per-byte ones: ... | DMA done | last byte, NACK, STOP
+ *      		A lost arbitration or a transfer aborted by {@see I2C_IrqExpire} frees the bus
+ *      		with {@see I2C_BusRecover} before the engine takes the next transfer.
+ *
+ *    Sources of Reference :
+ * 		Textbooks : Embedded Systems Fundamentals with Arm Cortex-M based MicroControllers
+ * 		KL25 Sub-Family Reference Manual, Chapter 38.4.1.8 (Typical I2C interrupt routine)
+ */
+
+#include "i2c_irq.h"
+#include "i2c_dma.h"
+#include "i2c_account.h"
+#include "i2c_bus.h"
+#include "i2c.h"
+#include "assert.h"
+
+/**
+ * @brief The engine bound to I2C0
+ */
+i2c_irq_engine_t i2c0_engine;
+
+/**
+ * @brief Binds an engine to a register block
+ * @param[out] engine The engine
+ * @param[in] base The I2C register block
+ */
+void I2C_IrqInit(i2c_irq_engine_t *engine, I2C_Type *base)
+{
+	engine->base = base;
+	engine->dma = 0;
+	engine->active = 0;
+	engine->state = I2C_IRQ_IDLE;
+	engine->index = 0;
+	engine->viaDma = false;
+	engine->started = 0;
+	engine->budget = 0;
+#if I2C_TRACE_ENABLE
+	engine->exception = I2C_TRACE_THREAD;
+	engine->traceFlags = 0;
+#endif
+}
+
+/**
+ * @brief Binds {@see i2c0_engine} to I2C0 and enables the I2C0 interrupt in the NVIC.
+ */
+void I2C_IrqEnable()
+{
+	I2C_IrqInit(&i2c0_engine, I2C0);
+
+	NVIC_SetPriority(I2C0_IRQn, I2C_IRQ_PRIORITY);
+	NVIC_ClearPendingIRQ(I2C0_IRQn);
+	NVIC_EnableIRQ(I2C0_IRQn);
+}
+
+/**
+ * @brief Issues a STOP condition, leaves TX mode and re-enables ACK for the next transaction.
+ * @param[in] base The I2C register block
+ */
+static inline void I2C_IrqSendStop(I2C_Type *base)
+{
+	base->C1 &= ~(I2C_C1_MST_MASK | I2C_C1_TX_MASK | I2C_C1_TXAK_MASK);
+}
+
+/**
+ * @brief Issues a repeated START condition, honouring the e6070 errata workaround of i2c.h
+ * @param[in] base The I2C register block
+ */
+static inline void I2C_IrqSendRepeatedStart(I2C_Type *base)
+{
+#if I2C_ENABLE_E6070_SPEEDHACK
+	register uint8_t reg = base->F;
+	base->F = reg & ~I2C_F_MULT_MASK;
+#endif
+
+	base->C1 |= I2C_C1_RSTA_MASK | I2C_C1_TX_MASK;
+
+#if I2C_ENABLE_E6070_SPEEDHACK
+	base->F = reg;
+#endif
+}
+
+#if I2C_TRACE_ENABLE
+/**
+ * @brief Leaves the record of the active transfer in the trace
+ * @param[in] engine The engine
+ * @param[in] status The final status of the active transfer
+ */
+static void I2C_IrqTrace(const i2c_irq_engine_t *engine, i2c_status_t status)
+{
+	const i2c_transfer_t *transfer = engine->active;
+	i2c_trace_record_t record = {
+		.start = engine->started,
+		.end = cycle_count(),
+		.slaveId = transfer->slaveId,
+		.registerAddress = transfer->registerAddress,
+		.length = transfer->length,
+		.exception = engine->exception,
+		.status = (uint8_t)status,
+		.flags = (uint8_t)(engine->traceFlags
+				| ((transfer->direction == I2C_DIRECTION_READ) ? I2C_TRACE_READ : 0)
+				| (engine->viaDma ? I2C_TRACE_DMA : 0))
+	};
+	I2C_TRACE_ADD(&record);
+}
+#else
+#define I2C_IrqTrace(engine, status)	do {} while (0)
+#endif
+
+/**
+ * @brief Releases the engine and reports the result
+ * @param[inout] engine The engine
+ * @param[in] status The final status of the active transfer
+ */
+static void I2C_IrqFinish(i2c_irq_engine_t *engine, i2c_status_t status)
+{
+	i2c_transfer_t *transfer = engine->active;
+
+	/* stop interrupting until the next submission */
+	engine->base->C1 &= ~I2C_C1_IICIE_MASK;
+
+	/* with no other master on the bus, both mean a slave holds it: free it before anyone retries */
+	if ((status == I2C_STATUS_TIMEOUT) || (status == I2C_STATUS_ARBITRATION_LOST)) {
+		I2C_BusRecover(engine->base);
+	}
+	I2C_BusRecord(transfer->direction, status, cycle_count() - engine->started);
+	I2C_IrqTrace(engine, status);
+
+	engine->state = I2C_IRQ_IDLE;
+	engine->active = 0;
+
+	if (status == I2C_STATUS_OK) {
+		I2C_ACCOUNT_TRANSFER(engine->viaDma ? I2C_PATH_DMA : I2C_PATH_IRQ, transfer->length);
+	}
+
+	/* the engine is free before the callback runs so that it may chain the next transfer */
+	transfer->status = status;
+	if (transfer->callback) {
+		transfer->callback(transfer);
+	}
+}
+
+/**
+ * @brief Starts a transaction and returns immediately.
+ * @param[inout] engine The engine
+ * @param[inout] transfer The descriptor
+ * @return {@see I2C_STATUS_PENDING} if the transaction was started, {@see I2C_STATUS_BUSY} otherwise
+ */
+i2c_status_t I2C_IrqSubmit(i2c_irq_engine_t *engine, i2c_transfer_t *transfer)
+{
+	assert(transfer->length > 0);
+	assert(transfer->buffer != 0);
+
+	I2C_ACCOUNT_BEGIN();
+
+	/* claim the engine; the ISR and other threads may race for it */
+	uint32_t masking_state = __get_PRIMASK();
+	__disable_irq();
+	if (engine->active != 0) {
+#if I2C_TRACE_ENABLE
+		engine->traceFlags |= I2C_TRACE_CONTENDED;
+#endif
+		__set_PRIMASK(masking_state);
+
+		/* a transfer out of time is aborted, the caller's next attempt gets the engine */
+		I2C_IrqExpire(engine);
+		return I2C_STATUS_BUSY;
+	}
+	transfer->status = I2C_STATUS_PENDING;
+	engine->active = transfer;
+#if I2C_TRACE_ENABLE
+	engine->exception = I2C_TRACE_EXCEPTION();
+	engine->traceFlags = 0;
+#endif
+	__set_PRIMASK(masking_state);
+
+	I2C_Type *base = engine->base;
+	engine->started = cycle_count();
+	engine->budget = I2C_BUS_US_TO_CYCLES(I2C_BUS_TIMEOUT_US(transfer->length + I2C_BUS_OVERHEAD_BYTES));
+	engine->index = 0;
+	engine->state = I2C_IRQ_ADDRESS_WRITE;
+	engine->viaDma = (engine->dma != 0) && (transfer->direction == I2C_DIRECTION_READ)
+			&& (transfer->length >= I2C_DMA_MIN_LENGTH);
+
+	/* drop stale flags, then START and send the write address */
+	base->S = I2C_S_IICIF_MASK | I2C_S_ARBL_MASK;
+	base->C1 = (base->C1 & ~I2C_C1_TXAK_MASK) | I2C_C1_IICIE_MASK;
+	base->C1 |= I2C_C1_MST_MASK | I2C_C1_TX_MASK;
+	base->D = I2C_WRITE_ADDRESS(transfer->slaveId);
+
+	I2C_ACCOUNT_END(engine->viaDma ? I2C_PATH_DMA : I2C_PATH_IRQ);
+	return I2C_STATUS_PENDING;
+}
+
+/**
+ * @brief Aborts the active transfer if it ran out of its time budget
+ * @param[inout] engine The engine
+ * @return true if a transfer was aborted
+ */
+bool I2C_IrqExpire(i2c_irq_engine_t *engine)
+{
+	/* claim the transfer so that neither interrupt nor a racing caller finishes it */
+	uint32_t masking_state = __get_PRIMASK();
+	__disable_irq();
+	if ((engine->active == 0) || (engine->state == I2C_IRQ_ABORTING)
+			|| !I2C_BusExpired(engine->started, engine->budget)) {
+		__set_PRIMASK(masking_state);
+		return false;
+	}
+	engine->state = I2C_IRQ_ABORTING;
+
+	/* take the data phase back from the DMA channel, if it has it, silence the module and STOP */
+	engine->base->C1 &= ~(I2C_C1_DMAEN_MASK | I2C_C1_IICIE_MASK);
+	I2C_IrqSendStop(engine->base);
+	__set_PRIMASK(masking_state);
+
+	/* the recovery clocks the bus for up to {@see I2C_BUS_RECOVERY_MAX_US}, too long to hold off interrupts */
+	I2C_IrqFinish(engine, I2C_STATUS_TIMEOUT);
+	return true;
+}
+
+/**
+ * @brief Advances the state machine by one bus event
+ * @param[inout] engine The engine
+ */
+void I2C_IrqHandler(i2c_irq_engine_t *engine)
+{
+	I2C_Type *base = engine->base;
+	i2c_transfer_t *transfer = engine->active;
+	register uint8_t status = base->S;
+
+	/* acknowledge the interrupt */
+	base->S = I2C_S_IICIF_MASK;
+
+	/* spurious interrupt, or one raced by an abort */
+	if ((transfer == 0) || (engine->state == I2C_IRQ_ABORTING)) {
+		return;
+	}
+
+	/* the module has already fallen back to slave mode */
+	if (status & I2C_S_ARBL_MASK) {
+		base->S = I2C_S_ARBL_MASK;
+		I2C_IrqFinish(engine, I2C_STATUS_ARBITRATION_LOST);
+		return;
+	}
+
+	/* every transmitted byte must have been acknowledged */
+	if ((engine->state != I2C_IRQ_READ_DATA) && (status & I2C_S_RXAK_MASK)) {
+		I2C_IrqSendStop(base);
+		I2C_IrqFinish(engine, I2C_STATUS_NACK);
+		return;
+	}
+
+	switch (engine->state) {
+	case I2C_IRQ_ADDRESS_WRITE:
+		engine->state = I2C_IRQ_REGISTER;
+		base->D = transfer->registerAddress;
+		break;
+
+	case I2C_IRQ_REGISTER:
+		if (transfer->direction == I2C_DIRECTION_READ) {
+			engine->state = I2C_IRQ_ADDRESS_READ;
+			I2C_IrqSendRepeatedStart(base);
+			base->D = I2C_READ_ADDRESS(transfer->slaveId);
+		}
+		else {
+			engine->state = I2C_IRQ_WRITE_DATA;
+			base->D = transfer->buffer[engine->index++];
+		}
+		break;
+
+	case I2C_IRQ_WRITE_DATA:
+		if (engine->index < transfer->length) {
+			base->D = transfer->buffer[engine->index++];
+		}
+		else {
+			I2C_IrqSendStop(base);
+			I2C_IrqFinish(engine, I2C_STATUS_OK);
+		}
+		break;
+
+	case I2C_IRQ_ADDRESS_READ:
+		if (engine->viaDma) {
+			/* arm the channel for all bytes but the last, which needs NACK and STOP around it */
+			I2C_DmaStartRead(engine->dma, &base->D, transfer->buffer, transfer->length - 1);
+			engine->state = I2C_IRQ_READ_DMA;
+
+			/* receive with ACK and without IICIF interrupts, the dummy read drives the clock
+			 * for the first byte and every read by the channel the clock for the next one */
+			base->C1 &= ~(I2C_C1_TX_MASK | I2C_C1_TXAK_MASK | I2C_C1_IICIE_MASK);
+			(void)base->D;
+			base->C1 |= I2C_C1_DMAEN_MASK;
+			break;
+		}
+
+		/* enter receive mode, NACK right away if a single byte is expected */
+		if (transfer->length == 1) {
+			base->C1 = (base->C1 & ~I2C_C1_TX_MASK) | I2C_C1_TXAK_MASK;
+		}
+		else {
+			base->C1 &= ~(I2C_C1_TX_MASK | I2C_C1_TXAK_MASK);
+		}
+		engine->state = I2C_IRQ_READ_DATA;
+
+		/* dummy read drives the clock for the first byte */
+		(void)base->D;
+		break;
+
+	case I2C_IRQ_READ_DATA:
+		if (engine->index == transfer->length - 1) {
+			/* STOP before reading D, otherwise another byte would be clocked in */
+			I2C_IrqSendStop(base);
+			transfer->buffer[engine->index++] = base->D;
+			I2C_IrqFinish(engine, I2C_STATUS_OK);
+		}
+		else {
+			/* the byte being clocked in next is the last one: NACK it */
+			if (engine->index == transfer->length - 2) {
+				base->C1 |= I2C_C1_TXAK_MASK;
+			}
+			transfer->buffer[engine->index++] = base->D;
+		}
+		break;
+
+	case I2C_IRQ_READ_DMA:
+	case I2C_IRQ_IDLE:
+	default:
+		break;
+	}
+}
+
+/**
+ * @brief Takes a transfer back from the DMA channel
+ * @param[inout] engine The engine
+ * @param[in] ok false if the channel reported an error
+ */
+void I2C_IrqDmaDone(i2c_irq_engine_t *engine, bool ok)
+{
+	I2C_Type *base = engine->base;
+	i2c_transfer_t *transfer = engine->active;
+
+	if ((transfer == 0) || (engine->state != I2C_IRQ_READ_DMA)) {
+		return;
+	}
+
+	/* the channel's last read started clocking in the final byte: it must be NACKed */
+	base->C1 = (base->C1 & ~I2C_C1_DMAEN_MASK) | I2C_C1_TXAK_MASK;
+
+	if (!ok) {
+		I2C_IrqSendStop(base);
+		I2C_IrqFinish(engine, I2C_STATUS_DMA_ERROR);
+		return;
+	}
+
+	engine->index = transfer->length - 1;
+	engine->state = I2C_IRQ_READ_DATA;
+
+	/* IICIF was raised for each byte the channel moved; drop it, then either the final
+	 * byte is already in (TCF) or its IICIF will raise the interrupt once enabled */
+	base->S = I2C_S_IICIF_MASK;
+	if (base->S & I2C_S_TCF_MASK) {
+		I2C_IrqHandler(engine);
+	}
+	else {
+		base->C1 |= I2C_C1_IICIE_MASK;
+	}
+}
+
+/**
+ * @brief I2C0 interrupt handler
+ */
+void I2C0_IRQHandler()
+{
+	I2C_ACCOUNT_BEGIN();
+	I2C_IrqHandler(&i2c0_engine);
+	I2C_ACCOUNT_END(i2c0_engine.viaDma ? I2C_PATH_DMA : I2C_PATH_IRQ);
+}
@@ -0,0 +1,209 @@
+/*
+ * i2c_irq.h
+ *
+ *  Created on: Dec 14, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Header file for the interrupt driven (non-blocking) I2C transaction engine.
+ *
+ *      		A transaction is described by an {@see i2c_transfer_t} descriptor which is
+ *      		handed to {@see I2C_IrqSubmit}. The call returns immediately after the START
+ *      		condition and the slave address have been issued; everything else
+ *      		(register address, repeated start, data bytes, NACK and STOP) is sequenced
+ *      		by a state machine running in the I2C0 interrupt. Completion is reported
+ *      		through the descriptor's status field and the optional callback.
+ *
+ *      		Long reads can hand their data phase to a DMA channel (see i2c_dma.h).
+ *
+ *      		The engine works on an {@see I2C_Type} register block pointer rather than the
+ *      		I2C0 macro, so the very same state machine can be driven against a simulated
+ *      		register block on a Linux host (see host/sim_i2c.c).
+ *
+ *    Sources of Reference :
+ * 		Textbooks : Embedded Systems Fundamentals with Arm Cortex-M based MicroControllers
+ * 		KL25 Sub-Family Reference Manual, Chapter 38.4.1.8 (Typical I2C interrupt routine)
+ */
+
+#ifndef I2C_IRQ_H_
+#define I2C_IRQ_H_
+
+#include "MKL25Z4.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include "i2c_trace.h"
+
+/**
+ * @brief Priority of the I2C0 interrupt.
+ *
+ * Must be more urgent than every interrupt that may wait for the engine to go idle
+ * (PORTA runs at 2), otherwise the waiting handler would block the engine forever.
+ */
+#define I2C_IRQ_PRIORITY	(1)
+
+/**
+ * @brief Transfer direction of an {@see i2c_transfer_t}
+ */
+typedef enum {
+	I2C_DIRECTION_WRITE = 0,	/*< write <code>length</code> bytes starting at the register address */
+	I2C_DIRECTION_READ = 1		/*< read <code>length</code> bytes starting at the register address */
+} i2c_direction_t;
+
+/**
+ * @brief Result of a transaction
+ */
+typedef enum {
+	I2C_STATUS_OK = 0,			/*< transaction completed */
+	I2C_STATUS_PENDING,			/*< transaction queued on the bus, not yet completed */
+	I2C_STATUS_BUSY,			/*< engine already owns a transaction, descriptor was not accepted */
+	I2C_STATUS_NACK,			/*< slave did not acknowledge its address or a written byte */
+	I2C_STATUS_ARBITRATION_LOST,	/*< another master took the bus */
+	I2C_STATUS_DMA_ERROR,		/*< the DMA channel reported a configuration or bus error */
+	I2C_STATUS_TIMEOUT,			/*< the transaction ran out of its time budget and was aborted */
+	I2C_STATUS_BUS_ERROR		/*< the bus stayed held by a slave, the transaction never started */
+} i2c_status_t;
+
+typedef struct i2c_transfer i2c_transfer_t;
+
+/**
+ * @brief Completion callback, invoked from interrupt context once the STOP was issued
+ * @param[in] transfer The finished transfer
+ */
+typedef void (*i2c_callback_t)(i2c_transfer_t *transfer);
+
+/**
+ * @brief Transaction descriptor.
+ *
+ * The descriptor and the buffer it points to are owned by the engine from
+ * {@see I2C_IrqSubmit} until the status leaves {@see I2C_STATUS_PENDING}.
+ */
+struct i2c_transfer {
+	uint8_t slaveId;					/*< 7-bit slave address */
+	uint8_t registerAddress;			/*< first register to access, auto-incremented by the slave */
+	i2c_direction_t direction;			/*< read or write */
+	uint8_t *buffer;					/*< data source (write) or destination (read) */
+	uint8_t length;						/*< number of data bytes; must be larger than zero */
+	i2c_callback_t callback;			/*< completion callback or NULL */
+	void *context;						/*< free for use by the submitter */
+	volatile i2c_status_t status;		/*< result, written by the engine */
+};
+
+/**
+ * @brief Phases of the interrupt state machine
+ */
+typedef enum {
+	I2C_IRQ_IDLE = 0,			/*< no transaction in flight */
+	I2C_IRQ_ADDRESS_WRITE,		/*< START + write address on the wire */
+	I2C_IRQ_REGISTER,			/*< register address on the wire */
+	I2C_IRQ_WRITE_DATA,			/*< data byte on the wire */
+	I2C_IRQ_ADDRESS_READ,		/*< repeated START + read address on the wire */
+	I2C_IRQ_READ_DATA,			/*< data byte being clocked in */
+	I2C_IRQ_READ_DMA,			/*< data bytes moved by the DMA channel, all but the last */
+	I2C_IRQ_ABORTING			/*< out of time, claimed by {@see I2C_IrqExpire}, which recovers the bus and reports */
+} i2c_irq_state_t;
+
+struct i2c_dma;
+
+/**
+ * @brief Engine instance, one per I2C module
+ */
+typedef struct {
+	I2C_Type *base;						/*< register block driven by this engine */
+	struct i2c_dma *dma;				/*< channel for the data phase of long reads, NULL for none */
+	i2c_transfer_t *volatile active;	/*< transfer in flight, NULL if idle */
+	volatile i2c_irq_state_t state;		/*< current phase */
+	uint8_t index;						/*< next data byte */
+	bool viaDma;						/*< the last read was handed to the DMA channel */
+	uint32_t started;					/*< {@see cycle_count} at submission of the active transfer */
+	uint32_t budget;					/*< cycles the active transfer may take, {@see I2C_BUS_TIMEOUT_US} */
+#if I2C_TRACE_ENABLE
+	uint8_t exception;					/*< context that submitted the active transfer, {@see I2C_TRACE_EXCEPTION} */
+	uint8_t traceFlags;					/*< I2C_TRACE_ bits gathered while the active transfer runs */
+#endif
+} i2c_irq_engine_t;
+
+/**
+ * @brief The engine bound to I2C0 and serviced by I2C0_IRQHandler
+ */
+extern i2c_irq_engine_t i2c0_engine;
+
+/**
+ * @brief Binds an engine to a register block, without a DMA channel. The module itself must already be clocked and configured.
+ * @param[out] engine The engine
+ * @param[in] base The I2C register block
+ */
+void I2C_IrqInit(i2c_irq_engine_t *engine, I2C_Type *base);
+
+/**
+ * @brief Binds {@see i2c0_engine} to I2C0 and enables the I2C0 interrupt in the NVIC.
+ *
+ * @param: None
+ * @return: None
+ */
+void I2C_IrqEnable();
+
+/**
+ * @brief Starts a transaction and returns immediately. A transfer that holds the engine beyond its
+ * 		  time budget is aborted, so that the caller's next attempt gets the engine.
+ * @param[inout] engine The engine
+ * @param[inout] transfer The descriptor; its status is set to {@see I2C_STATUS_PENDING} if accepted
+ * @return {@see I2C_STATUS_PENDING} if the transaction was started, {@see I2C_STATUS_BUSY} otherwise
+ */
+i2c_status_t I2C_IrqSubmit(i2c_irq_engine_t *engine, i2c_transfer_t *transfer);
+
+/**
+ * @brief Advances the state machine; call from the I2C interrupt handler.
+ * @param[inout] engine The engine
+ */
+void I2C_IrqHandler(i2c_irq_engine_t *engine);
+
+/**
+ * @brief Takes a transfer back from the DMA channel; call from the channel interrupt handler.
+ * @param[inout] engine The engine
+ * @param[in] ok false if the channel reported an error
+ */
+void I2C_IrqDmaDone(i2c_irq_engine_t *engine, bool ok);
+
+/**
+ * @brief Aborts the active transfer with {@see I2C_STATUS_TIMEOUT} if it ran out of its time budget,
+ * 		  and frees the bus it left held. Safe to call from any context; the recovery and the callback
+ * 		  run with the interrupt mask as the caller had it.
+ * @param[inout] engine The engine
+ * @return true if a transfer was aborted
+ */
+bool I2C_IrqExpire(i2c_irq_engine_t *engine);
+
+/**
+ * @brief Determines if the engine is free to take a new transaction
+ * @param[in] engine The engine
+ * @return true if idle
+ */
+static inline bool I2C_IrqIdle(const i2c_irq_engine_t *engine)
+{
+	return engine->active == 0;
+}
+
+/**
+ * @brief Sleeps until the transfer has left the pending state, at most until the first interrupt past its time budget.
+ * 		  Call with interrupts unmasked, they are unmasked on return.
+ * @param[inout] engine The engine the transfer was submitted to
+ * @param[in] transfer The transfer
+ * @return The final status
+ */
+static inline i2c_status_t I2C_IrqWait(i2c_irq_engine_t *engine, const i2c_transfer_t *transfer)
+{
+	while (transfer->status == I2C_STATUS_PENDING) {
+		/* a live transfer wakes the core with its own interrupts; a stuck one is aborted at the first
+		 * wake of any source past its budget, not necessarily within a tick: the tickless idle may have
+		 * left a stretched SysTick period running. Checked again under the mask, a completion between
+		 * the check and the WFI stays pending and wakes it at once, it is taken on unmasking. */
+		__disable_irq();
+		if (transfer->status == I2C_STATUS_PENDING) {
+			__WFI();
+		}
+		__enable_irq();
+		I2C_IrqExpire(engine);
+	}
+	return transfer->status;
+}
+
+#endif /* I2C_IRQ_H_ */
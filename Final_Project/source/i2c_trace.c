@@ -0,0 +1,143 @@
+/*
+ * i2c_trace.c
+ *
+ *  Created on: Dec 22, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: I2C transaction trace, a ring of the last finished transactions.
+ *
+ *    Sources of Reference :
+ * 		ARM Cortex-M0+ Devices Generic User Guide, 2.1.3 (IPSR)
+ */
+
+#include "i2c_trace.h"
+
+#if I2C_TRACE_ENABLE
+
+#include "i2c_irq.h"
+#include "i2c_bus.h"
+#include "global_defs.h"
+
+/**
+ * @brief The ring, indexed by sequence number modulo {@see I2C_TRACE_LENGTH}
+ */
+static i2c_trace_record_t ring[I2C_TRACE_LENGTH];
+
+/**
+ * @brief Records added, the sequence number of the next one
+ */
+static volatile uint32_t count;
+
+/**
+ * @brief Sequence number of the first record not dumped yet
+ */
+static uint32_t dumped;
+
+/**
+ * @brief Printable results, indexed by {@see i2c_status_t}
+ */
+static const char *const status_names[] = { "ok", "pending", "busy", "nack", "arblost", "dma", "timeout", "buserr" };
+
+/**
+ * @brief Adds a record to the ring, overwriting the oldest
+ */
+void I2C_TraceAdd(i2c_trace_record_t *record)
+{
+	/* the engine's interrupts and the polled path of the main loop both add records */
+	uint32_t masking_state = __get_PRIMASK();
+	__disable_irq();
+	record->sequence = count;
+	ring[count & (I2C_TRACE_LENGTH - 1)] = *record;
+	count++;
+	__set_PRIMASK(masking_state);
+}
+
+/**
+ * @brief Fetches a record by its sequence number
+ */
+bool I2C_TraceGet(uint32_t sequence, i2c_trace_record_t *record)
+{
+	uint32_t masking_state = __get_PRIMASK();
+	__disable_irq();
+	const bool valid = (uint32_t)(count - sequence - 1) < I2C_TRACE_LENGTH;
+	if (valid) {
+		*record = ring[sequence & (I2C_TRACE_LENGTH - 1)];
+	}
+	__set_PRIMASK(masking_state);
+
+	return valid;
+}
+
+/**
+ * @brief Number of records added since the last reset
+ */
+uint32_t I2C_TraceCount()
+{
+	return count;
+}
+
+/**
+ * @brief Drops every record
+ */
+void I2C_TraceReset()
+{
+	uint32_t masking_state = __get_PRIMASK();
+	__disable_irq();
+	count = 0;
+	dumped = 0;
+	__set_PRIMASK(masking_state);
+}
+
+/**
+ * @brief Logs the records added since the last dump
+ */
+void I2C_TraceDump()
+{
+	const uint32_t last = count;
+	uint32_t sequence = dumped;
+	uint32_t lost = 0;
+	i2c_trace_record_t record;
+
+	if (last - sequence > I2C_TRACE_LENGTH) {
+		lost = last - sequence - I2C_TRACE_LENGTH;
+		sequence = last - I2C_TRACE_LENGTH;
+	}
+
+	LOG("\r\n I2C trace: %lu records", (unsigned long)(last - dumped));
+	LOG("\r\n      seq   start us   dur us  context slave reg len dir path   status  flags");
+
+	for (; sequence != last; ++sequence) {
+		/* overwritten while the lines before went out */
+		if (!I2C_TraceGet(sequence, &record)) {
+			lost++;
+			continue;
+		}
+
+		const char *path = (record.flags & I2C_TRACE_POLLED) ? "polled"
+				: ((record.flags & I2C_TRACE_DMA) ? "dma" : "irq");
+		const char *status = (record.status < sizeof(status_names) / sizeof(status_names[0]))
+				? status_names[record.status] : "?";
+
+		LOG("\r\n %8lu %10lu %8lu ", (unsigned long)record.sequence,
+				(unsigned long)(record.start / I2C_BUS_CYCLES_PER_US),
+				(unsigned long)((record.end - record.start) / I2C_BUS_CYCLES_PER_US));
+		if (record.exception == I2C_TRACE_THREAD) {
+			LOG(" thread ");
+		}
+		else {
+			LOG(" irq %3u", (unsigned)(record.exception - 16));
+		}
+		LOG("  0x%02x 0x%02x %3u %s %-6s %-7s %c%c%c", record.slaveId, record.registerAddress, record.length,
+				(record.flags & I2C_TRACE_READ) ? "rd " : "wr ", path, status,
+				(record.flags & I2C_TRACE_CONTENDED) ? 'C' : '-',
+				(record.flags & I2C_TRACE_WAITED) ? 'W' : '-',
+				(record.flags & I2C_TRACE_NESTED) ? 'N' : '-');
+	}
+
+	if (lost != 0) {
+		LOG("\r\n I2C trace: %lu records overwritten before the dump", (unsigned long)lost);
+	}
+	dumped = last;
+}
+
+#endif
@@ -0,0 +1,129 @@
+/*
+ * i2c_trace.h
+ *
+ *  Created on: Dec 22, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Header file for the I2C transaction trace.
+ *
+ *      		With {@see I2C_TRACE_ENABLE} set, every finished transaction, polled or on the
+ *      		engine, leaves an {@see i2c_trace_record_t} in a ring of the last
+ *      		{@see I2C_TRACE_LENGTH}: slave, register, length, direction and path, the
+ *      		{@see cycle_count} at its start and end, the exception that started it (thread
+ *      		or which interrupt) and its result. Records also say whether somebody else
+ *      		wanted the bus meanwhile, which is how contention between the main loop and
+ *      		the PORTA interrupt shows up. {@see I2C_TraceDump} prints the records added
+ *      		since the last dump over the UART.
+ *
+ *      		With the trace disabled the hooks compile to nothing and no RAM is used.
+ *
+ *    Sources of Reference :
+ * 		ARM Cortex-M0+ Devices Generic User Guide, 2.1.3 (IPSR)
+ */
+
+#ifndef I2C_TRACE_H_
+#define I2C_TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Set to nonzero to record every I2C transaction
+ */
+#ifndef I2C_TRACE_ENABLE
+#define I2C_TRACE_ENABLE		(0)
+#endif
+
+/**
+ * @brief Records kept, power of two; older ones are overwritten
+ */
+#define I2C_TRACE_LENGTH		(64)
+
+/**
+ * @brief Bits of {@see i2c_trace_record_t.flags}
+ */
+#define I2C_TRACE_READ			(1u << 0)	/*< a read, otherwise a write */
+#define I2C_TRACE_POLLED		(1u << 1)	/*< the blocking register access of i2c.c */
+#define I2C_TRACE_DMA			(1u << 2)	/*< the engine with the DMA data phase */
+#define I2C_TRACE_CONTENDED		(1u << 3)	/*< somebody found the bus taken by this transaction */
+#define I2C_TRACE_WAITED		(1u << 4)	/*< this transaction waited for the engine to go idle first */
+#define I2C_TRACE_NESTED		(1u << 5)	/*< started while a preempted polled transaction was mid-way */
+
+/**
+ * @brief {@see i2c_trace_record_t.exception} of the thread (main loop)
+ */
+#define I2C_TRACE_THREAD		(0)
+
+/**
+ * @brief One finished transaction
+ */
+typedef struct {
+	uint32_t sequence;			/*< running record number, starts at 0 */
+	uint32_t start;				/*< {@see cycle_count} at the start */
+	uint32_t end;				/*< {@see cycle_count} at completion */
+	uint8_t slaveId;			/*< 7-bit slave address */
+	uint8_t registerAddress;	/*< first register */
+	uint8_t length;				/*< data bytes */
+	uint8_t exception;			/*< IPSR when started: {@see I2C_TRACE_THREAD}, otherwise 16 + IRQ number */
+	uint8_t status;				/*< the final {@see i2c_status_t} */
+	uint8_t flags;				/*< I2C_TRACE_ bits */
+} i2c_trace_record_t;
+
+#if I2C_TRACE_ENABLE
+
+#include "MKL25Z4.h"
+
+/**
+ * @brief The exception running now, see {@see i2c_trace_record_t.exception}
+ */
+#define I2C_TRACE_EXCEPTION()	((uint8_t)(__get_IPSR() & 0x3Fu))
+
+/**
+ * @brief Adds a record; the sequence number is assigned here
+ */
+#define I2C_TRACE_ADD(record)	I2C_TraceAdd(record)
+
+#else
+
+#define I2C_TRACE_EXCEPTION()	(I2C_TRACE_THREAD)
+#define I2C_TRACE_ADD(record)	do {} while (0)
+
+#endif
+
+/**
+ * @brief Adds a record to the ring, overwriting the oldest; callable from any context
+ * @param[inout] record The record; receives its sequence number
+ */
+void I2C_TraceAdd(i2c_trace_record_t *record);
+
+/**
+ * @brief Fetches a record by its sequence number
+ * @param[in] sequence The sequence number
+ * @param[out] record Receives the record
+ * @return true if the record exists and was not overwritten yet
+ */
+bool I2C_TraceGet(uint32_t sequence, i2c_trace_record_t *record);
+
+/**
+ * @brief Number of records added since the last reset, overwritten ones included
+ * @return The count, which is also the sequence number of the next record
+ */
+uint32_t I2C_TraceCount();
+
+/**
+ * @brief Drops every record
+ *
+ * @param: None
+ * @return: None
+ */
+void I2C_TraceReset();
+
+/**
+ * @brief Logs the records added since the last dump, one per line, and how many were overwritten before they could be
+ *
+ * @param: None
+ * @return: None
+ */
+void I2C_TraceDump();
+
+#endif /* I2C_TRACE_H_ */
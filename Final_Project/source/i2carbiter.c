@@ -11,125 +11,241 @@
  *
  *    Sources of Reference :
  * 		Textbooks : Embedded Systems Fundamentals with Arm Cortex-M based MicroControllers
+ * 		KL25 Sub-Family Reference Manual, Chapter 12.2.9 / 12.2.10 (SIM_SCGC4, SIM_SCGC5)
  */
 
 #include "MKL25Z4.h"
 #include "bme.h"
 #include "i2carbiter.h"
+#include "i2c_irq.h"
+#include "assert.h"
 
+/**
+ * @brief State of one I2C module
+ */
+typedef struct {
+	I2C_Type *base;					/*< The register block */
+	i2c_irq_engine_t *engine;		/*< The engine driving it, NULL for none */
+	uint32_t clockGate;				/*< Its SIM_SCGC4 bit */
+	uint8_t activeRoute;			/*< The route the pins are muxed for, {@see I2CARBITER_NO_ROUTE} before the first */
+	uint8_t activeDivider;			/*< The F register value in place */
+	volatile uint8_t owner;			/*< Handle + 1 of the device that claimed it, 0 if unclaimed */
+} i2carbiter_bus_state_t;
 
 /**
  * @brief Control structure for the I2C arbiter
  */
 typedef struct {
-	uint32_t lastSelectedHash;		/*< The last selected hash */
-	uint8_t lastSelectedSlave;		/*< The last selected slave address */
-	uint8_t lastSelectedSlaveIndex;	/*< The list index of the last selected slave */
-	i2carbiter_entry_t* entries;	/*< The arbiter entries */
-	const uint8_t entryCount;		/*< The number of arbiter entries */
+	i2carbiter_entry_t *entries;					/*< The arbiter entries, indexed by handle */
+	uint8_t entryCount;								/*< The number of arbiter entries */
+	i2carbiter_bus_state_t buses[I2CARBITER_BUS_COUNT];	/*< The modules, indexed by {@see i2carbiter_bus_t} */
 } i2carbiter_t;
 
 /**
  * @brief The port configuration
  */
-static i2carbiter_t configuration;
+static i2carbiter_t configuration = {
+	.buses = {
+		[I2CARBITER_BUS_I2C0] = { .base = I2C0, .engine = &i2c0_engine, .clockGate = SIM_SCGC4_I2C0_MASK,
+				.activeRoute = I2CARBITER_NO_ROUTE },
+		[I2CARBITER_BUS_I2C1] = { .base = I2C1, .engine = 0, .clockGate = SIM_SCGC4_I2C1_MASK,
+				.activeRoute = I2CARBITER_NO_ROUTE }
+	}
+};
 
 /**
- * @brief Configures n I2C arbiter entry
- * @param[inout] entry The entry
- * @param[in] port The port to use
- * @param[in] sdaPin The number of the pin used for SDA
- * @param[in] sclPin The number of the pin used for SCL
+ * @brief Configures an I2C arbiter entry
  */
-void I2CArbiter_PrepareEntry(i2carbiter_entry_t *entry, uint8_t slaveAddress, uint32_t sclPin, uint8_t sclMux, uint32_t sdaPin, uint8_t sdaMux)
+void I2CArbiter_PrepareEntry(i2carbiter_entry_t *entry, uint8_t slaveAddress, i2carbiter_bus_t bus, PORT_Type *port,
+		uint8_t sclPin, uint8_t sclMux, uint8_t sdaPin, uint8_t sdaMux, uint8_t frequencyDivider)
 {
-//	entry->port = port;
-	*(uint8_t*)&entry->slaveAddress = slaveAddress;
-	*(uint32_t*)&entry->sdaPin = sdaPin;
-	*(uint8_t*)&entry->sdaMux = sdaMux;
-	*(uint32_t*)&entry->sclPin = sclPin;
-	*(uint8_t*)&entry->sclMux = sclMux;
-
-	/* hash the unique configuration
-	 * The number 37 and 23 are arbitrary co-primes.
-	 */
-	register uint32_t hash = 37;
-	hash = hash * 23 + (uint32_t)PORTE;
-	hash = hash * 23 + sclPin;
-	hash = hash * 23 + sdaPin;
-
-	*(uint32_t*)&entry->hash = hash;
+	entry->slaveAddress = slaveAddress;
+	entry->bus = bus;
+	entry->port = port;
+	entry->sclPin = sclPin;
+	entry->sclMux = sclMux;
+	entry->sdaPin = sdaPin;
+	entry->sdaMux = sdaMux;
+	entry->frequencyDivider = frequencyDivider;
+	entry->route = I2CARBITER_NO_ROUTE;
+}
+
+/**
+ * @brief Determines if two entries route the same bus over the same pins
+ */
+static bool I2CArbiter_SameRoute(const i2carbiter_entry_t *a, const i2carbiter_entry_t *b)
+{
+	return (a->bus == b->bus) && (a->port == b->port)
+			&& (a->sclPin == b->sclPin) && (a->sclMux == b->sclMux)
+			&& (a->sdaPin == b->sdaPin) && (a->sdaMux == b->sdaMux);
 }
 
 /**
  * @brief Configures the I2C arbiter
- * @param[inout] config The control structure
- * @param[in] entries The entries
+ * @param[inout] entries The entries
  * @param[in] entryCount the number of entries
  */
 void I2CArbiter_Configure(i2carbiter_entry_t *entries, uint8_t entryCount)
 {
-	configuration.lastSelectedSlave = 0;
-	configuration.lastSelectedHash = 0;
+	assert((entryCount > 0) && (entryCount <= I2CARBITER_MAX_DEVICES));
+
 	configuration.entries = entries;
-	*(uint32_t*)&configuration.entryCount = entryCount;
+	configuration.entryCount = entryCount;
+
+	for (uint8_t i = 0; i < entryCount; ++i) {
+		i2carbiter_entry_t *entry = &entries[i];
+
+		/* a route is numbered by the first entry using it, which is also the entry whose pins
+		 * are released when switching away from it; the comparisons are paid for here, once */
+		entry->route = i;
+		for (uint8_t j = 0; j < i; ++j) {
+			if (I2CArbiter_SameRoute(entry, &entries[j])) {
+				entry->route = entries[j].route;
+				break;
+			}
+		}
+
+		/* the pins' port and the module need their clocks before the first select */
+		const uint32_t port = ((uint32_t)entry->port - PORTA_BASE) / (PORTB_BASE - PORTA_BASE);
+		SIM->SCGC5 |= SIM_SCGC5_PORTA_MASK << port;
+		SIM->SCGC4 |= configuration.buses[entry->bus].clockGate;
+	}
+
+	for (int bus = 0; bus < I2CARBITER_BUS_COUNT; ++bus) {
+		configuration.buses[bus].activeRoute = I2CARBITER_NO_ROUTE;
+		configuration.buses[bus].owner = 0;
+	}
 
 	/* assume the first slave will be used first */
-	I2CArbiter_Select(entries[0].slaveAddress);
+	I2CArbiter_Select(0);
 }
 
 /**
  * @brief Selects an I2C slave and prepares the ports.
- * @param[in] slaveAddress The slave address
+ * @param[in] device The device handle
  * @return Zero if successful, nonzero otherwise
  */
-uint8_t I2CArbiter_Select(uint8_t slaveAddress)
+uint8_t I2CArbiter_Select(i2carbiter_handle_t device)
 {
-	register uint32_t lastSelectedSlave = configuration.lastSelectedSlave;
+	if (device >= configuration.entryCount) {
+		return 1;
+	}
 
-	/* early exit */
-	if (lastSelectedSlave == slaveAddress)
-	{
-		return 0;
+	const i2carbiter_entry_t *token = &configuration.entries[device];
+	i2carbiter_bus_state_t *bus = &configuration.buses[token->bus];
+	const uint8_t owner = bus->owner;
+
+	if ((owner != 0) && (owner != device + 1)) {
+		return 1;
 	}
 
-	/* find the current slave */
-	register uint32_t lastSelectedHash = configuration.lastSelectedHash;
-	register int count = configuration.entryCount;
-	for (int i=0; i<count; ++i)
-	{
-		i2carbiter_entry_t* token = &configuration.entries[i];
-		if (token->slaveAddress == slaveAddress)
-		{
-			/* try to avoid switching by comparing the port address / pin hashes */
-			if (token->hash != lastSelectedHash)
-			{
-				/* disable last slave */
-				if (lastSelectedSlave != 0)
-				{
-					/* disable last selected slave */
-					i2carbiter_entry_t* entry = &configuration.entries[configuration.lastSelectedSlaveIndex];
-					PORTE->PCR[entry->sdaPin] &= ~PORT_PCR_MUX_MASK;
-					PORTE->PCR[entry->sclPin] &= ~PORT_PCR_MUX_MASK;
-				}
-
-				/* TODO: candidate for BME */
-
-				/* enable new slave */
-				PORTE->PCR[token->sdaPin] &= ~PORT_PCR_MUX_MASK;
-				PORTE->PCR[token->sdaPin] |= PORT_PCR_MUX(token->sdaMux);
-				PORTE->PCR[token->sclPin] &= ~PORT_PCR_MUX_MASK;
-				PORTE->PCR[token->sclPin] |= PORT_PCR_MUX(token->sclMux);
-			}
+	/* early exit: the bus already runs this route at this speed */
+	if ((token->route == bus->activeRoute) && (token->frequencyDivider == bus->activeDivider)) {
+		return 0;
+	}
 
-			/* set up lookup */
-			configuration.lastSelectedHash = token->hash;
-			configuration.lastSelectedSlave = slaveAddress;
-			configuration.lastSelectedSlaveIndex = i;
+	/* the switch must neither race another select nor pull the pins from under a transfer */
+	uint32_t masking_state = __get_PRIMASK();
+	__disable_irq();
+	if ((bus->engine != 0) && !I2C_IrqIdle(bus->engine)) {
+		__set_PRIMASK(masking_state);
+		return 1;
+	}
 
-			return 0;
+	if (token->route != bus->activeRoute) {
+		/* disable last slave */
+		if (bus->activeRoute != I2CARBITER_NO_ROUTE) {
+			const i2carbiter_entry_t *entry = &configuration.entries[bus->activeRoute];
+			entry->port->PCR[entry->sdaPin] &= ~PORT_PCR_MUX_MASK;
+			entry->port->PCR[entry->sclPin] &= ~PORT_PCR_MUX_MASK;
 		}
+
+		/* enable new slave */
+		token->port->PCR[token->sdaPin] = (token->port->PCR[token->sdaPin] & ~PORT_PCR_MUX_MASK) | PORT_PCR_MUX(token->sdaMux);
+		token->port->PCR[token->sclPin] = (token->port->PCR[token->sclPin] & ~PORT_PCR_MUX_MASK) | PORT_PCR_MUX(token->sclMux);
+		bus->activeRoute = token->route;
+	}
+
+	if (token->frequencyDivider != bus->activeDivider) {
+		bus->base->F = token->frequencyDivider;
+		bus->activeDivider = token->frequencyDivider;
 	}
+	__set_PRIMASK(masking_state);
 
-	return 1;
+	return 0;
+}
+
+/**
+ * @brief Selects the device and keeps its bus to it until released
+ * @param[in] device The device handle
+ * @return Zero if successful, nonzero otherwise
+ */
+uint8_t I2CArbiter_Claim(i2carbiter_handle_t device)
+{
+	if (device >= configuration.entryCount) {
+		return 1;
+	}
+
+	i2carbiter_bus_state_t *bus = &configuration.buses[configuration.entries[device].bus];
+
+	/* a claim is not nested, not even by the same device: that would be a handler interrupting its own thread */
+	uint32_t masking_state = __get_PRIMASK();
+	__disable_irq();
+	if (bus->owner != 0) {
+		__set_PRIMASK(masking_state);
+		return 1;
+	}
+	bus->owner = device + 1;
+	__set_PRIMASK(masking_state);
+
+	if (I2CArbiter_Select(device) != 0) {
+		bus->owner = 0;
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Gives back the bus of a device that claimed it
+ * @param[in] device The device handle
+ */
+void I2CArbiter_Release(i2carbiter_handle_t device)
+{
+	if (device >= configuration.entryCount) {
+		return;
+	}
+
+	i2carbiter_bus_state_t *bus = &configuration.buses[configuration.entries[device].bus];
+	if (bus->owner == device + 1) {
+		bus->owner = 0;
+	}
+}
+
+/**
+ * @brief The register block of the device's bus
+ * @param[in] device The device handle
+ * @return I2C0 or I2C1
+ */
+I2C_Type *I2CArbiter_Base(i2carbiter_handle_t device)
+{
+	assert(device < configuration.entryCount);
+	return configuration.buses[configuration.entries[device].bus].base;
+}
+
+/**
+ * @brief The entry whose route a bus's pins are muxed for
+ * @param[in] base The register block
+ * @return The entry, NULL before the first select on the bus
+ */
+const i2carbiter_entry_t *I2CArbiter_ActiveEntry(const I2C_Type *base)
+{
+	for (int bus = 0; bus < I2CARBITER_BUS_COUNT; ++bus) {
+		const i2carbiter_bus_state_t *state = &configuration.buses[bus];
+
+		/* a route is numbered by the first entry using it */
+		if ((state->base == base) && (state->activeRoute != I2CARBITER_NO_ROUTE)) {
+			return &configuration.entries[state->activeRoute];
+		}
+	}
+	return 0;
 }
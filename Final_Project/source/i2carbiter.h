@@ -7,53 +7,127 @@
  *      @brief: Header file for i2carbiter.h to settle a dispute or has ultimate
  *      		authority in a matter in case multiple sensor update is required.
  *
+ *      		Every device is known by a handle, its index in the table handed to
+ *      		{@see I2CArbiter_Configure}. The table maps it to a bus (I2C0 or I2C1), the
+ *      		port, pins and mux values that route the bus to the device, and the bus speed.
+ *      		Entries that share a route are numbered once at configuration, so selecting
+ *      		a device is an index into the table and a compare with the bus's active
+ *      		route, and pins are only re-muxed when the route actually changes.
+ *
+ *      		A bus is never re-routed under a transaction in flight on its engine, and
+ *      		{@see I2CArbiter_Claim} hands a bus to one device for a sequence of
+ *      		transactions: a claim made from the thread refuses an interrupt handler
+ *      		that wants the same bus meanwhile, instead of letting the two interleave.
+ *
  *    Sources of Reference :
  * 		Textbooks : Embedded Systems Fundamentals with Arm Cortex-M based MicroControllers
+ * 		KL25 Sub-Family Reference Manual, Chapter 10 (Signal Multiplexing), Chapter 38.3.2 (I2C Frequency Divider)
  */
 
 #ifndef I2CARBITER_H_
 #define I2CARBITER_H_
 
 #include "MKL25Z4.h"
+#include <stdint.h>
+
+/**
+ * @brief Most devices the table may hold
+ */
+#define I2CARBITER_MAX_DEVICES	(8)
+
+/**
+ * @brief No route active on a bus yet
+ */
+#define I2CARBITER_NO_ROUTE		(0xFF)
+
+/**
+ * @brief The I2C modules of the KL25Z
+ */
+typedef enum {
+	I2CARBITER_BUS_I2C0 = 0,
+	I2CARBITER_BUS_I2C1 = 1,
+	I2CARBITER_BUS_COUNT
+} i2carbiter_bus_t;
+
+/**
+ * @brief A device, the index of its entry in the table
+ */
+typedef uint8_t i2carbiter_handle_t;
 
 /**
  * @brief Data structure for the I2C arbiter
  */
 typedef struct {
-	const uint8_t slaveAddress;		/*< The 7-bit slave address */
-	const uint32_t hash;			/*< Hash of the fields to aid in switching decisions */
-	PORT_Type * port;			/*< The port for I2C communication */
-	const uint32_t sdaPin;			/*< The pin used to drive SDA */
-	const uint32_t sclPin;			/*< The pin used to drive SCL */
-	const uint8_t sdaMux;			/*< The mux value for the SDA pin */
-	const uint8_t sclMux;			/*< The mux value for the SCL pin */
+	uint8_t slaveAddress;			/*< The 7-bit slave address */
+	i2carbiter_bus_t bus;			/*< The I2C module the device hangs off */
+	PORT_Type *port;				/*< The port for I2C communication */
+	uint8_t sclPin;					/*< The pin used to drive SCL */
+	uint8_t sclMux;					/*< The mux value for the SCL pin */
+	uint8_t sdaPin;					/*< The pin used to drive SDA */
+	uint8_t sdaMux;					/*< The mux value for the SDA pin */
+	uint8_t frequencyDivider;		/*< The bus speed, the I2C F register (MULT and ICR) */
+	uint8_t route;					/*< Entries with the same bus, port, pins and muxes share it; set by {@see I2CArbiter_Configure} */
 } i2carbiter_entry_t;
 
 
 /**
- * @brief Configures n I2C arbiter entry
- * @param[inout] entry The entry
+ * @brief Configures an I2C arbiter entry
+ * @param[out] entry The entry
  * @param[in] slaveAddress The 7-bit slave address
+ * @param[in] bus The I2C module
  * @param[in] port The port to use
- * @param[in] sdaPin The number of the pin used for SDA
  * @param[in] sclPin The number of the pin used for SCL
+ * @param[in] sclMux The mux value routing SCL to the pin
+ * @param[in] sdaPin The number of the pin used for SDA
+ * @param[in] sdaMux The mux value routing SDA to the pin
+ * @param[in] frequencyDivider The I2C F register value for the device's speed
  */
-void I2CArbiter_PrepareEntry(i2carbiter_entry_t *entry, uint8_t slaveAddress, uint32_t sclPin, uint8_t sclMux, uint32_t sdaPin, uint8_t sdaMux);
+void I2CArbiter_PrepareEntry(i2carbiter_entry_t *entry, uint8_t slaveAddress, i2carbiter_bus_t bus, PORT_Type *port,
+		uint8_t sclPin, uint8_t sclMux, uint8_t sdaPin, uint8_t sdaMux, uint8_t frequencyDivider);
 
 /**
- * @brief Configures the I2C arbiter
- * @param[inout] config The control structure
- * @param[in] entries The entries
- * @param[in] entryCount the number of entries
+ * @brief Configures the I2C arbiter: numbers the routes, gates the clocks of the ports and
+ * 		  modules in use and selects the first device
+ * @param[inout] entries The entries, indexed by handle; Must stay valid while in use.
+ * @param[in] entryCount the number of entries; at most {@see I2CARBITER_MAX_DEVICES}
  */
 void I2CArbiter_Configure(i2carbiter_entry_t *entries, uint8_t entryCount);
 
 /**
- * @brief Selects an I2C slave and prepares the ports.
- * @param[in] slaveAddress The slave address
- * @return Zero if successful, nonzero otherwise
+ * @brief Routes the device's bus to it and sets the bus speed, unless both are already in place
+ * @param[in] device The device handle
+ * @return Zero if successful; nonzero for an unknown handle, a bus claimed by another device, or
+ * 		   a transaction in flight on a bus that would have to be re-routed
+ */
+uint8_t I2CArbiter_Select(i2carbiter_handle_t device);
+
+/**
+ * @brief Selects the device and keeps its bus to it until {@see I2CArbiter_Release}. Callable from any context;
+ * 		  an interrupt handler that is refused must not spin, the claim belongs to the code it interrupted.
+ * @param[in] device The device handle
+ * @return Zero if successful, nonzero if the bus is claimed already or cannot be selected
+ */
+uint8_t I2CArbiter_Claim(i2carbiter_handle_t device);
+
+/**
+ * @brief Gives back the bus of a device that claimed it
+ * @param[in] device The device handle
+ */
+void I2CArbiter_Release(i2carbiter_handle_t device);
+
+/**
+ * @brief The register block of the device's bus
+ * @param[in] device The device handle; Must be valid.
+ * @return I2C0 or I2C1
+ */
+I2C_Type *I2CArbiter_Base(i2carbiter_handle_t device);
+
+/**
+ * @brief The entry whose route a bus's pins are muxed for, for the bus recovery that drives them by hand
+ * @param[in] base The register block, I2C0 or I2C1
+ * @return The entry, NULL before the first select on the bus
  */
-uint8_t I2CArbiter_Select(uint8_t slaveAddress);
+const i2carbiter_entry_t *I2CArbiter_ActiveEntry(const I2C_Type *base);
 
 
 #endif /* I2CARBITER_H_ */
@@ -15,6 +15,11 @@
 
 #include "i2c.h"
 #include "mma8451q.h"
+#include "mma8451q_fifo.h"
+#include "mma8451q_drdy.h"
+#include "mma8451q_profile.h"
+#include "nvm.h"
+#include "telemetry.h"
 #include "init_sensors.h"
 #include "assert.h"
 #include "MKL25Z4.h"
@@ -30,6 +35,64 @@ static union {
 } config_buffer;
 
 
+/**
+ * @brief Builds the configuration from the device's, setting by setting
+ * @param[out] configuration The configuration to store
+ */
+static void BuildConfiguration(mma8451q_confreg_t *configuration)
+{
+    /* read configuration and modify */
+    MMA8451Q_FetchConfiguration(configuration);
+
+    // Turn Off LED which can be due to noise
+    Led_Down();
+
+
+    // Following Setups, intantiate the mma8451q config file with appropriate settings,
+    // Some setups have been commeneted out, but are shown for Brevity
+
+    // Set Sensitivity 0 default 8g
+//    MMA8451Q_SetSensitivity(configuration, MMA8451Q_SENSITIVITY_2G, MMA8451Q_HPO_DISABLED);
+
+    // Update Rate and Low Noise Setup Read
+    MMA8451Q_SetDataRate(configuration, MMA8451Q_DATARATE_800Hz, MMA8451Q_LOWNOISE_ENABLED);
+
+#if MMA8451Q_ACQUISITION == MMA8451Q_ACQUIRE_FIFO
+    // Buffer samples in the hardware FIFO, drained in batches on the watermark
+    MMA8451Q_SetFifo(configuration, MMA8451Q_FIFO_MODE, MMA8451Q_FIFO_WATERMARK);
+#endif
+
+    // Resolution Read, default Normal Sampling Rate
+//    MMA8451Q_SetOversampling(configuration, MMA8451Q_OVERSAMPLING_HIGHRESOLUTION);
+
+    // Disable Interrupt for Setup
+    MMA8451Q_ClearInterruptConfiguration(configuration);
+
+    // Configure for Interrupt Mode and Interrupt on Active Low Reads
+    MMA8451Q_SetInterruptMode(configuration, MMA8451Q_INTMODE_OPENDRAIN, MMA8451Q_INTPOL_ACTIVELOW);
+
+////     For Trasient Mode Setup, Acceleratin greater than 2g. Currently Disabled
+//    MMA8451Q_ConfigureInterrupt(configuration, MMA8451Q_INT_TRANS, MMA8451Q_INTPIN_INT2);
+
+//    // For Motion Mode Setup, Interrupt when Acceleration in X, Y Axis
+    MMA8451Q_ConfigureInterrupt(configuration, MMA8451Q_INT_FFMT, MMA8451Q_INTPIN_INT1);
+
+    // Transient Mode, Currently Disabled
+//    MMA8451Q_SetTransient(configuration);
+
+    // Motion Mode
+    MMA8451Q_SetMotion(configuration);
+
+#if MMA8451Q_ACQUISITION == MMA8451Q_ACQUIRE_FIFO
+    // SetMotion rewrote CTRL_REG4/5, add the FIFO watermark interrupt on INT2 (PTA15)
+    MMA8451Q_ConfigureInterrupt(configuration, MMA8451Q_INT_FIFO, MMA8451Q_INTPIN_INT2);
+#elif MMA8451Q_ACQUISITION == MMA8451Q_ACQUIRE_DRDY
+    // SetMotion rewrote CTRL_REG4/5, add the data-ready interrupt on INT2 (PTA15)
+    MMA8451Q_ConfigureInterrupt(configuration, MMA8451Q_INT_DRDY, MMA8451Q_INTPIN_INT2);
+#endif
+}
+
+
 void InitMMA8451Q()
 {
 #if ENABLE_MMA8451Q
@@ -63,7 +126,7 @@ void InitMMA8451Q()
 	Led_Down();
 
     /* switch to the correct port */
-    I2CArbiter_Select(MMA8451Q_I2CADDR);
+    I2CArbiter_Select(MMA8451Q_I2CARBITER_HANDLE);
 
     // Turn Off LED which can be due to noise
     Led_Down();
@@ -90,46 +153,30 @@ void InitMMA8451Q()
     // Turn Off LED which can be due to noise
     Led_Down();
 
-    /* read configuration and modify */
-    MMA8451Q_FetchConfiguration(configuration);
-
-    // Turn Off LED which can be due to noise
-    Led_Down();
-
-
-    // Following Setups, intantiate the mma8451q config file with appropriate settings,
-    // Some setups have been commeneted out, but are shown for Brevity
-
-    // Set Sensitivity 0 default 8g
-//    MMA8451Q_SetSensitivity(configuration, MMA8451Q_SENSITIVITY_2G, MMA8451Q_HPO_DISABLED);
-
-    // Update Rate and Low Noise Setup Read
-    MMA8451Q_SetDataRate(configuration, MMA8451Q_DATARATE_800Hz, MMA8451Q_LOWNOISE_ENABLED);
-
-    // Resolution Read, default Normal Sampling Rate
-//    MMA8451Q_SetOversampling(configuration, MMA8451Q_OVERSAMPLING_HIGHRESOLUTION);
-
-    // Disable Interrupt for Setup
-    MMA8451Q_ClearInterruptConfiguration(configuration);
-
-    // Configure for Interrupt Mode and Interrupt on Active Low Reads
-    MMA8451Q_SetInterruptMode(configuration, MMA8451Q_INTMODE_OPENDRAIN, MMA8451Q_INTPOL_ACTIVELOW);
-
-////     For Trasient Mode Setup, Acceleratin greater than 2g. Currently Disabled
-//    MMA8451Q_ConfigureInterrupt(configuration, MMA8451Q_INT_TRANS, MMA8451Q_INTPIN_INT2);
+    // Samples are taken as the configuration below sets them up
+#if MMA8451Q_ACQUISITION == MMA8451Q_ACQUIRE_FIFO
+    MMA8451Q_FifoStart(MMA8451Q_FIFO_WATERMARK);
+#elif MMA8451Q_ACQUISITION == MMA8451Q_ACQUIRE_DRDY
+    MMA8451Q_DrdyStart();
+#if TELEMETRY_ENABLE
+    Telemetry_Init();
+#endif
+#endif
 
-//    // For Motion Mode Setup, Interrupt when Acceleration in X, Y Axis
-    MMA8451Q_ConfigureInterrupt(configuration, MMA8451Q_INT_FFMT, MMA8451Q_INTPIN_INT1);
+    // The profile saved by the last calibration is the whole configuration, offsets included; the device
+    // holds its reset values, so there is nothing to read first. Without one it is built as ever.
+    if (Nvm_Init() && MMA8451Q_ProfileLoad(configuration)) {
+        MMA8451Q_ShadowReset();
+        LOG("\r\n MMA8451Q: profile loaded, offsets %d %d %d.", (int8_t)configuration->OFF_X,
+                (int8_t)configuration->OFF_Y, (int8_t)configuration->OFF_Z);
+    }
+    else {
+        BuildConfiguration(configuration);
+    }
 
-    // Publish the configuration over I2C
+    // Publish the whole configuration over I2C in one commit: only the registers differing from the reset defaults
     MMA8451Q_StoreConfiguration(configuration);
 
-    // Publish the Transient Mode
-//    MMA8451Q_SetTransient();
-
-    // Publish the Motion Mode
-    MMA8451Q_SetMotion();
-
     // Enter Active Mode
     MMA8451Q_EnterActiveMode();
 
@@ -138,7 +185,9 @@ void InitMMA8451Q()
 
 
     // Debug Messages
-    LOG("\r\n MMA8451Q: configuration done.");
+    LOG("\r\n MMA8451Q: configuration done in %lu transactions, %lu bytes; saved %lu transactions, %lu bytes.",
+            (unsigned long)mma8451q_store_stats.transactions, (unsigned long)mma8451q_store_stats.bytes,
+            (unsigned long)mma8451q_store_stats.transactionsSaved, (unsigned long)mma8451q_store_stats.bytesSaved);
 #endif
     Led_Down();
 }
@@ -18,11 +18,19 @@
 
 #define ENABLE_MMA8451Q 1						/*! Used to enable or disable MMA8451Q fetching */
 
+#define MMA8451Q_ACQUIRE_ON_DEMAND	0			/*! Samples are read whenever the LEDs are updated */
+#define MMA8451Q_ACQUIRE_FIFO		1			/*! Samples are drained from the hardware FIFO in batches on its watermark interrupt (INT2) */
+#define MMA8451Q_ACQUIRE_DRDY		2			/*! Every sample is read once on its data-ready interrupt (INT2) */
+
+#define MMA8451Q_ACQUISITION	MMA8451Q_ACQUIRE_FIFO	/*! Selects how MMA8451Q samples are acquired */
+
 #define MMA8451Q_INT_PORT	PORTA				/*! Port at which the MMA8451Q INT1 and INT2 pins are attached */
 #define MMA8451Q_INT_GPIO	GPIOA				/*! Port at which the MMA8451Q INT1 and INT2 pins are attached */
 #define MMA8451Q_INT1_PIN	14					/*! Pin at which the MMA8451Q INT1 is attached */
 #define MMA8451Q_INT2_PIN	15					/*! Pin at which the MMA8451Q INT2 is attached */
 
+#define MMA8451Q_I2CARBITER_HANDLE	0			/*! Entry of the MMA8451Q in the I2C arbiter table of main.c */
+
 /**
 * @brief Sets up the MMA8451Q communication
 *
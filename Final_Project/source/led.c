@@ -21,6 +21,15 @@
 #include "clock.h"
 #include "global_defs.h"
 #include "systick.h"
+#include "init_sensors.h"
+#include "mma8451q_fifo.h"
+#include "mma8451q_drdy.h"
+#include "telemetry.h"
+#include "tilt.h"
+#include "i2c_trace.h"
+#include "profile.h"
+#include "blackbox.h"
+#include "mma8451q_profile.h"
 
 int flag_log = 0;
 
@@ -123,22 +132,81 @@ void DoubleFlash()
 	delay_ms(50);
 }
 
-void Control_RGB_LEDs(mma8451q_acc_t *acc) {
+bool Control_RGB_LEDs(mma8451q_acc_t *acc) {
 
 	// Initialize few variable
-	float roll = 0.0,  pitch = 0.0;
+	int16_t roll = 0,  pitch = 0;	// centi-degrees
 	int PWM_Green=0, PWM_Blue = 0;
 
+#if TELEMETRY_ENABLE
+	// Stream every sample queued since the last call, before the newest drives the LEDs
+	Telemetry_Poll();
+#endif
+
+	PROFILE_BEGIN(PROFILE_READ_XYZ);
+#if MMA8451Q_ACQUISITION == MMA8451Q_ACQUIRE_FIFO
+	// Samples arrive in batches from the FIFO, the newest one of a batch drives the LEDs
+	const mma8451q_fifo_batch_t *batch = MMA8451Q_FifoTake();
+	if (batch == 0) {
+		// Nothing new yet: the next batch posts EVENT_SAMPLES
+		PROFILE_END(PROFILE_READ_XYZ);
+		return false;
+	}
+	acc->status = batch->status;
+	acc->x = batch->samples[batch->count - 1][0];
+	acc->y = batch->samples[batch->count - 1][1];
+	acc->z = batch->samples[batch->count - 1][2];
+#elif MMA8451Q_ACQUISITION == MMA8451Q_ACQUIRE_DRDY
+	// Every sample is read once on its data-ready interrupt, never re-read here
+	mma8451q_sample_t sample;
+	if (!MMA8451Q_DrdyTake(&sample)) {
+		// Nothing new yet: the next sample posts EVENT_SAMPLES
+		PROFILE_END(PROFILE_READ_XYZ);
+		return false;
+	}
+	acc->status = sample.acc.status;
+	acc->x = sample.acc.x;
+	acc->y = sample.acc.y;
+	acc->z = sample.acc.z;
+#elif LED_PIPELINED_READ
+	static mma8451q_acc_t sample;
+	static i2c_transfer_t transfer = { .status = I2C_STATUS_BUSY };
+
+	// Collect the sample requested during the previous call
+	if (I2C_HalWait(&transfer) == I2C_STATUS_OK) {
+		MMA8451Q_FinishReadAcceleration14bit(&sample);
+		acc->status = sample.status;
+		acc->x = sample.x;
+		acc->y = sample.y;
+		acc->z = sample.z;
+	}
+
+	// Keep the bus busy with the next sample while this one is converted
+	if (MMA8451Q_StartReadAcceleration14bit(&sample, &transfer, 0) != I2C_STATUS_PENDING) {
+		transfer.status = I2C_STATUS_BUSY;
+	}
+#else
 	// Read Accletation Data from MMA8451Q
 	read_full_xyz(acc);
+#endif
+#if MMA8451Q_ACQUISITION == MMA8451Q_ACQUIRE_ON_DEMAND
+	// Nothing taps a read on demand, the black box and a calibration take the samples read here
+	const int16_t xyz[1][3] = { { acc->x, acc->y, acc->z } };
+	BlackBox_Record(xyz, 1);
+	MMA8451Q_CalibrateRecord(xyz, 1);
+#endif
+	PROFILE_END(PROFILE_READ_XYZ);
 
 	// Convert acc to Roll and Pitch
+	PROFILE_BEGIN(PROFILE_TILT);
 	convert_xyz_to_roll_pitch(acc, &roll, &pitch);
+	PROFILE_END(PROFILE_TILT);
 
+	PROFILE_BEGIN(PROFILE_PWM);
 	/* Convert 0-90 degree (Pitch and Roll) to PWM
 	 * Range of (0-48000) */
-	PWM_Green = (((int)roll * NEWRANGE ) / OLDRANGE);
-	PWM_Blue = (((int)pitch * NEWRANGE ) / OLDRANGE);
+	PWM_Green = (((int)roll * NEWRANGE ) / (OLDRANGE * TILT_CENTIDEGREES));
+	PWM_Blue = (((int)pitch * NEWRANGE ) / (OLDRANGE * TILT_CENTIDEGREES));
 
 	/* Orientation can be negative
 	 * That should not concern LED lighting*/
@@ -147,17 +215,24 @@ void Control_RGB_LEDs(mma8451q_acc_t *acc) {
 	}
 
 	// Necessary to prevent loopback in atan2
-	if((int) pitch > 80) {
+	if(pitch / TILT_CENTIDEGREES > 80) {
 		PWM_Green = 0;
 	}
 
 	// Set the PWM to appropriate brightness
 	GREEN_PWM = PWM_Green;
 	BLUE_PWM = PWM_Blue;
-
-//	// Debug Prints of Roll and Pitch
-	if(flag_log == 1) {
-		LOG("\r\n roll: %d , pitch: %d ", (int)roll, (int)pitch);
+	PROFILE_END(PROFILE_PWM);
+
+//	// Debug Prints of Roll and Pitch, not while they would break into the telemetry frames
+	if(!TELEMETRY_ENABLE && (flag_log == 1)) {
+		PROFILE_BEGIN(PROFILE_LOG);
+		LOG("\r\n roll: %d , pitch: %d ", roll / TILT_CENTIDEGREES, pitch / TILT_CENTIDEGREES);
+#if I2C_TRACE_ENABLE
+		I2C_TraceDump();
+#endif
 		flag_log = 0;
+		PROFILE_END(PROFILE_LOG);
 	}
+	return true;
 }
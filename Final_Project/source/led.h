@@ -35,6 +35,15 @@
 
 #define MASK(x) (1UL << (x))
 
+/* Set to 1 by the log timer of statemachine.c, the next LED update then logs roll and pitch */
+extern int flag_log;
+
+/*!
+* \def LED_PIPELINED_READ Set to <code>1</code> to fetch the next sample on the interrupt driven I2C engine
+* while the current one is converted, or to <code>0</code> for the blocking read
+*/
+#define LED_PIPELINED_READ (1)
+
 // Freedom KL25Z LEDs
 #define RED_LED_POS (18)		// on port B
 #define GREEN_LED_POS (19)	// on port B
@@ -95,9 +104,9 @@
  *  @param​ ​ mma8451q_acc_t *acc: Pointer to MMA8451Q based struct,
  *  		instantiated to default params
 ​ *
-​ * ​ ​@return​ ​ none
+​ * ​ ​@return​ ​ false if no new sample had arrived, the LEDs are left as they are
  */
-void Control_RGB_LEDs(mma8451q_acc_t *acc);
+bool Control_RGB_LEDs(mma8451q_acc_t *acc);
 
 /**
  * @brief Sets up the GPIOs for LED driving
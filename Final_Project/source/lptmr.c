@@ -0,0 +1,73 @@
+/*
+ * lptmr.c
+ *
+ *  Created on: Dec 29, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: The low power timer, the wake up of VLPS.
+ *
+ *    Sources of Reference :
+ * 		KL25 Sub-Family Reference Manual, Chapter 33 (Low-Power Timer), 24.4.2 (MCGIRCLK in stop modes)
+ */
+
+#include "MKL25Z4.h"
+#include "lptmr.h"
+
+/**
+ * @brief Gates the clock and selects MCGIRCLK
+ */
+void LPTMR_Init()
+{
+	SIM->SCGC5 |= SIM_SCGC5_LPTMR_MASK;
+
+	// slow IRC (IRCS = 0) out as MCGIRCLK, kept running in stop modes
+	MCG->C2 &= ~MCG_C2_IRCS_MASK;
+	MCG->C1 |= MCG_C1_IRCLKEN_MASK | MCG_C1_IREFSTEN_MASK;
+
+	LPTMR0->CSR = 0;
+	LPTMR0->PSR = LPTMR_PSR_PCS(0) | LPTMR_PSR_PRESCALE(0);	// MCGIRCLK / 2
+
+	NVIC_SetPriority(LPTMR0_IRQn, 3);
+	NVIC_ClearPendingIRQ(LPTMR0_IRQn);
+	NVIC_EnableIRQ(LPTMR0_IRQn);
+}
+
+/**
+ * @brief Starts the counter with the compare interrupt after counts
+ */
+void LPTMR_Start(uint32_t counts)
+{
+	// CMR is written with the counter disabled; the flag sets as the counter leaves it
+	LPTMR0->CSR = 0;
+	LPTMR0->CMR = counts - 1;
+	LPTMR0->CSR = LPTMR_CSR_TIE_MASK | LPTMR_CSR_TEN_MASK;
+}
+
+/**
+ * @brief Stops the counter and tells the counts passed
+ */
+uint32_t LPTMR_Stop()
+{
+	// a write latches the counter into CNR for the read
+	LPTMR0->CNR = 0;
+	uint32_t counts = LPTMR0->CNR;
+
+	if (LPTMR0->CSR & LPTMR_CSR_TCF_MASK) {
+		// the compare matched and the counter started over
+		counts += LPTMR0->CMR + 1;
+	}
+
+	// disabling clears the counter and TCF
+	LPTMR0->CSR = 0;
+	NVIC_ClearPendingIRQ(LPTMR0_IRQn);
+
+	return counts;
+}
+
+/**
+ * @brief The compare interrupt, only there to end VLPS
+ */
+void LPTMR0_IRQHandler()
+{
+	LPTMR0->CSR |= LPTMR_CSR_TCF_MASK;		// write 1 to clear
+}
@@ -0,0 +1,59 @@
+/*
+ * lptmr.h
+ *
+ *  Created on: Dec 29, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Header file for the low power timer, the wake up of VLPS.
+ *
+ *      		SysTick stops with the core clock in VLPS, the LPTMR keeps counting. It runs
+ *      		on MCGIRCLK, the slow internal reference the FLL multiplies up to the core
+ *      		clock in FEI, enabled in stop modes and divided by 2: {@see LPTMR_CLOCK_HZ}
+ *      		counts of about 61 us, as accurate as the core clock itself. The 1 kHz LPO
+ *      		would do as well but is trimmed far worse.
+ *
+ *      		{@see LPTMR_Start} arms the compare interrupt a number of counts on,
+ *      		{@see LPTMR_Stop} stops the counter and tells how many counts passed, whether
+ *      		the compare or another interrupt ended the sleep.
+ *
+ *    Sources of Reference :
+ * 		KL25 Sub-Family Reference Manual, Chapter 33 (Low-Power Timer), 24.4.2 (MCGIRCLK in stop modes)
+ */
+
+#ifndef LPTMR_H_
+#define LPTMR_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Counts per second: the 32.768 kHz slow IRC, prescaler 2
+ */
+#define LPTMR_CLOCK_HZ		(16384u)
+
+/**
+ * @brief Longest {@see LPTMR_Start}, the 16 bit compare (4 s)
+ */
+#define LPTMR_MAX_COUNTS	(0x10000u)
+
+/**
+ * @brief Gates the clock, enables MCGIRCLK in stop modes and selects it, NVIC priority
+ *
+ * @param: None
+ * @return: None
+ */
+void LPTMR_Init();
+
+/**
+ * @brief Starts the counter from 0 with the compare interrupt after counts
+ * @param[in] counts 1 to {@see LPTMR_MAX_COUNTS}
+ * @return: None
+ */
+void LPTMR_Start(uint32_t counts);
+
+/**
+ * @brief Stops the counter, clears the flag and the pending interrupt
+ * @return Counts since {@see LPTMR_Start}
+ */
+uint32_t LPTMR_Stop();
+
+#endif /* LPTMR_H_ */
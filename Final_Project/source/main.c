@@ -79,15 +79,11 @@ i2carbiter_entry_t i2carbiter_entries[I2CARBITER_COUNT]; /*< Structure for the p
 
 void InitI2CArbiter()
 {
-    /* prior to configuring the I2C arbiter, enable the clocks required for
-    * the used pins
-    */
-	SIM->SCGC5 |= SIM_SCGC5_PORTB_MASK | SIM_SCGC5_PORTE_MASK;
-
     /* configure I2C arbiter
-    * The arbiter takes care of pin selection
+    * The arbiter takes care of pin selection, bus speed and the clocks of the used ports
     */
-    I2CArbiter_PrepareEntry(&i2carbiter_entries[0], MMA8451Q_I2CADDR, MMA8451_SCL, MMA8451Q_I2C_MUX, MMA8451Q_SDA, MMA8451Q_I2C_MUX);
+    I2CArbiter_PrepareEntry(&i2carbiter_entries[MMA8451Q_I2CARBITER_HANDLE], MMA8451Q_I2CADDR, I2CARBITER_BUS_I2C0, PORTE,
+    		MMA8451_SCL, MMA8451Q_I2C_MUX, MMA8451Q_SDA, MMA8451Q_I2C_MUX, I2C_F_375KHZ);
     I2CArbiter_Configure(i2carbiter_entries, I2CARBITER_COUNT);
 
     LOG("\r\n Interrupt Enabled for Jolt Detection on PORT A");
@@ -109,6 +105,9 @@ int main(void) {
    	InitSysTick();
    	delay_ms(500);
 
+   	/* CPU load of logging, per transmit path */
+   	test_uart_load();
+
    	/* Initialize PWM on LED Ports*/
    	InitTPM();
    	delay_ms(500);
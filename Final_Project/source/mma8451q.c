@@ -13,12 +13,14 @@
  * 		4) https://github.com/adafruit/Adafruit_MMA8451_Library
  */
 
+#include <stddef.h>
+#include <string.h>
 #include "endian.h"
 #include "mma8451q.h"
 #include "stdint.h"
 #include "assert.h"
 #include "MKL25Z4.h"
-#include "math.h"
+#include "tilt.h"
 
 
 #define CTRL_REG1_ACTIVE_SHIFT 	(0x00U)
@@ -40,12 +42,18 @@
 #define CTRL_REG3_PPOD_MASK 	(0x1u)
 #define CTRL_REG3_PPOD_SHIFT 	(0x00u)
 
+#define F_SETUP_F_MODE_MASK 	(0xC0u)
+#define F_SETUP_F_MODE_SHIFT 	(0x6u)
+#define F_SETUP_F_WMRK_MASK 	(0x3Fu)
+#define F_SETUP_F_WMRK_SHIFT 	(0x0u)
+
+#define TRIG_CFG_MASK 			(0x3Cu)
+
 #define XYZ_DATA_CFG_FS_SHIFT 	(0x0u)
 #define XYZ_DATA_CFG_FS_MASK 	(0x03u)
 #define XYZ_DATA_CFG_HPF_OUT_SHIFT (0x04u)
 #define XYZ_DATA_CFG_HPF_OUT_MASK (0x10u)
 
-#define MMA_ADDR 0x3A
 #define MMA8451Q_INT_PORT	PORTA				/*! Port at which the MMA8451Q INT1 and INT2 pins are attached */
 #define MMA8451Q_INT_GPIO	GPIOA				/*! Port at which the MMA8451Q INT1 and INT2 pins are attached */
 #define MMA8451Q_INT1_PIN	14					/*! Pin at which the MMA8451Q INT1 is attached */
@@ -57,6 +65,277 @@
 #define MPU6050_INT_PIN		13					/*! Pin at which the MPU6050 INT is attached */
 
 
+/**
+ * @brief Position of each shadowed register in {@see mma8451q_confreg_t}, plus one; 0 for the
+ * 		  registers between that it does not hold
+ */
+#define SHADOW_FIELD(address, field)	[(address) - MMA8451Q_SHADOW_FIRST] = offsetof(mma8451q_confreg_t, field) + 1
+
+static const uint8_t shadowFields[MMA8451Q_SHADOW_LAST - MMA8451Q_SHADOW_FIRST + 1] = {
+	SHADOW_FIELD(0x09, F_SETUP),		SHADOW_FIELD(0x0A, TRIG_CFG),		SHADOW_FIELD(0x0B, SYSMOD),
+	SHADOW_FIELD(0x0D, WHO_AM_I),		SHADOW_FIELD(0x0E, XYZ_DATA_CFG),	SHADOW_FIELD(0x0F, HP_FILTER_CUTOFF),
+	SHADOW_FIELD(0x11, PL_CFG),			SHADOW_FIELD(0x12, PL_COUNT),		SHADOW_FIELD(0x13, PL_BF_ZCOMP),
+	SHADOW_FIELD(0x14, P_L_THS_REG),	SHADOW_FIELD(0x15, FF_MT_CFG),		SHADOW_FIELD(0x17, FF_MT_THS),
+	SHADOW_FIELD(0x18, FF_MT_COUNT),	SHADOW_FIELD(0x1D, TRANSIENT_CFG),	SHADOW_FIELD(0x1E, TRANSIENT_SCR),
+	SHADOW_FIELD(0x1F, TRANSIENT_THS),	SHADOW_FIELD(0x20, TRANSIENT_COUNT),SHADOW_FIELD(0x21, PULSE_CFG),
+	SHADOW_FIELD(0x23, PULSE_THSX),		SHADOW_FIELD(0x24, PULSE_THSY),		SHADOW_FIELD(0x25, PULSE_THSZ),
+	SHADOW_FIELD(0x26, PULSE_TMLT),		SHADOW_FIELD(0x27, PULSE_LTCY),		SHADOW_FIELD(0x28, PULSE_WIND),
+	SHADOW_FIELD(0x29, ASLP_COUNT),		SHADOW_FIELD(0x2A, CTRL_REG1),		SHADOW_FIELD(0x2B, CTRL_REG2),
+	SHADOW_FIELD(0x2C, CTRL_REG3),		SHADOW_FIELD(0x2D, CTRL_REG4),		SHADOW_FIELD(0x2E, CTRL_REG5),
+	SHADOW_FIELD(0x2F, OFF_X),			SHADOW_FIELD(0x30, OFF_Y),			SHADOW_FIELD(0x31, OFF_Z),
+};
+
+/**
+ * @brief Registers first .. last in the shadow masks
+ */
+#define SHADOW_RANGE(first, last)	(MMA8451Q_SHADOW_BIT((last) + 1) - MMA8451Q_SHADOW_BIT(first))
+
+/**
+ * @brief Registers changing on their own, never answered from the shadow
+ */
+#define SHADOW_VOLATILE		(MMA8451Q_SHADOW_BIT(MMA8451Q_REG_SYSMOD) | MMA8451Q_SHADOW_BIT(MMA8451Q_REG_TRANSIENT_SCR))
+
+/**
+ * @brief Registers the shadow answers for once known: those {@see mma8451q_confreg_t} holds, but the volatile ones
+ */
+#define SHADOW_CACHED		((SHADOW_RANGE(0x09, 0x0B) | SHADOW_RANGE(0x0D, 0x0F) | SHADOW_RANGE(0x11, 0x15) | SHADOW_RANGE(0x17, 0x18) \
+							| SHADOW_RANGE(0x1D, 0x21) | SHADOW_RANGE(0x23, 0x31)) & ~SHADOW_VOLATILE)
+
+/**
+ * @brief Registers written by {@see MMA8451Q_StoreConfiguration}, all but the read-only ones
+ */
+#define SHADOW_WRITABLE		(SHADOW_CACHED & ~MMA8451Q_SHADOW_BIT(MMA8451Q_REG_WHOAMI))
+
+/**
+ * @brief The configuration the driver wants the device to hold
+ */
+static mma8451q_confreg_t shadow;
+
+/**
+ * @brief The last known contents of the device
+ */
+static mma8451q_confreg_t device;
+
+/**
+ * @brief Registers whose contents on the device are known
+ */
+static uint64_t shadowKnown;
+
+/**
+ * @brief Registers whose wanted value differs from the device, or was set while the device value is unknown
+ */
+static uint64_t shadowDirty;
+
+/**
+ * @brief The write traffic of {@see MMA8451Q_Flush}
+ */
+mma8451q_store_stats_t mma8451q_store_stats;
+
+/**
+ * @brief Locates a register in a register image
+ * @param[in] image The shadow or the device image
+ * @param[in] address The register address
+ * @return The register byte, NULL if the register is not shadowed
+ */
+static uint8_t *MMA8451Q_ImageField(mma8451q_confreg_t *image, uint8_t address)
+{
+	if ((address < MMA8451Q_SHADOW_FIRST) || (address > MMA8451Q_SHADOW_LAST) || !shadowFields[address - MMA8451Q_SHADOW_FIRST]) {
+		return 0;
+	}
+	return (uint8_t *)image + shadowFields[address - MMA8451Q_SHADOW_FIRST] - 1;
+}
+
+/**
+ * @brief Locates a register in the shadow
+ * @param[in] address The register address
+ * @return The shadow byte, NULL if the register is not shadowed
+ */
+static inline uint8_t *MMA8451Q_ShadowField(uint8_t address)
+{
+	return MMA8451Q_ImageField(&shadow, address);
+}
+
+/**
+ * @brief Marks a register dirty if the device does not hold its wanted value, clean otherwise
+ * @param[in] address The register address
+ */
+static void MMA8451Q_ShadowCompare(uint8_t address)
+{
+	const uint64_t bit = MMA8451Q_SHADOW_BIT(address);
+
+	if (!(shadowKnown & bit) || (*MMA8451Q_ShadowField(address) != *MMA8451Q_ImageField(&device, address))) {
+		shadowDirty |= bit;
+	}
+	else {
+		shadowDirty &= ~bit;
+	}
+}
+
+/**
+ * @brief Forgets the shadow
+ */
+void MMA8451Q_ShadowInvalidate()
+{
+	shadowKnown = 0;
+	shadowDirty = 0;
+}
+
+/**
+ * @brief The registers after a reset, as in the register map of the data sheet
+ */
+static const mma8451q_confreg_t resetValues = {
+	.WHO_AM_I = 0x1A, .PL_CFG = 0x80, .PL_BF_ZCOMP = 0x44, .P_L_THS_REG = 0x84,
+};
+
+/**
+ * @brief Takes the reset values as the known device contents
+ */
+void MMA8451Q_ShadowReset()
+{
+	memcpy(&device, &resetValues, sizeof(device));
+	memcpy(&shadow, &resetValues, sizeof(shadow));
+	shadowKnown = SHADOW_CACHED;
+	shadowDirty = 0;
+}
+
+/**
+ * @brief Reads a register, from the shadow if it is known
+ */
+uint8_t MMA8451Q_ReadRegister(uint8_t address)
+{
+	uint8_t *field = MMA8451Q_ShadowField(address);
+	const uint64_t bit = MMA8451Q_SHADOW_BIT(address);
+
+	if ((field == 0) || !(bit & SHADOW_CACHED)) {
+		return I2C_HalReadRegister(MMA8451Q_I2CADDR, address);
+	}
+	if (!((shadowKnown | shadowDirty) & bit)) {
+		*field = I2C_HalReadRegister(MMA8451Q_I2CADDR, address);
+		*MMA8451Q_ImageField(&device, address) = *field;
+		shadowKnown |= bit;
+	}
+	return *field;
+}
+
+/**
+ * @brief Changes a register in the shadow and marks it dirty
+ */
+uint8_t MMA8451Q_ModifyRegister(uint8_t address, uint8_t andMask, uint8_t orMask)
+{
+	uint8_t *field = MMA8451Q_ShadowField(address);
+	assert((field != 0) && (MMA8451Q_SHADOW_BIT(address) & SHADOW_CACHED));
+
+	/* only a register never seen before costs a read */
+	const uint8_t value = (MMA8451Q_ReadRegister(address) & andMask) | orMask;
+	*field = value;
+	MMA8451Q_ShadowCompare(address);
+	return value;
+}
+
+/**
+ * @brief Sets a register in the shadow and marks it dirty
+ */
+void MMA8451Q_WriteRegister(uint8_t address, uint8_t value)
+{
+	uint8_t *field = MMA8451Q_ShadowField(address);
+	assert((field != 0) && (MMA8451Q_SHADOW_BIT(address) & SHADOW_CACHED));
+
+	*field = value;
+	MMA8451Q_ShadowCompare(address);
+}
+
+/**
+ * @brief Writes registers first .. last in one auto-increment burst and takes them over into the device image
+ * @param[in] first The first register address
+ * @param[in] last The last register address
+ */
+static void MMA8451Q_WriteBurst(uint8_t first, uint8_t last)
+{
+	uint8_t buffer[MMA8451Q_SHADOW_LAST - MMA8451Q_SHADOW_FIRST + 1];
+	const uint8_t count = last - first + 1;
+
+	for (uint8_t address = first; address <= last; ++address) {
+		const uint8_t value = *MMA8451Q_ShadowField(address);
+		buffer[address - first] = value;
+		*MMA8451Q_ImageField(&device, address) = value;
+	}
+	I2C_HalWriteRegisters(MMA8451Q_I2CADDR, first, count, buffer);
+
+	shadowKnown |= SHADOW_RANGE(first, last);
+	shadowDirty &= ~SHADOW_RANGE(first, last);
+
+	/* START, slave address and register address, then the data */
+	mma8451q_store_stats.transactions++;
+	mma8451q_store_stats.bytes += 2 + count;
+}
+
+/**
+ * @brief Writes the dirty registers
+ */
+void MMA8451Q_Flush()
+{
+	const uint64_t ctrlReg1 = MMA8451Q_SHADOW_BIT(MMA8451Q_REG_CTRL_REG1);
+
+	if (!shadowDirty) {
+		return;
+	}
+
+	/* the mode to end up in, a read if it was never seen */
+	const uint8_t target = MMA8451Q_ReadRegister(MMA8451Q_REG_CTRL_REG1);
+
+	/* the ACTIVE bit alone changes in active mode, anything else in standby only */
+	const bool standby = (shadowDirty & ~ctrlReg1) || !(shadowKnown & ctrlReg1)
+						|| ((target ^ device.CTRL_REG1) & ~CTRL_REG1_ACTIVE_MASK);
+
+	if (standby) {
+		shadow.CTRL_REG1 = target & ~CTRL_REG1_ACTIVE_MASK;
+
+		/* leave active mode first, unless the device is known to be in standby already */
+		if (!(shadowKnown & ctrlReg1) || (device.CTRL_REG1 & CTRL_REG1_ACTIVE_MASK)) {
+			MMA8451Q_WriteBurst(MMA8451Q_REG_CTRL_REG1, MMA8451Q_REG_CTRL_REG1);
+		}
+		MMA8451Q_ShadowCompare(MMA8451Q_REG_CTRL_REG1);
+	}
+
+	/* coalesce the dirty registers into bursts, through a few clean ones if they are known and writable */
+	for (uint8_t first = MMA8451Q_SHADOW_FIRST; shadowDirty; ++first) {
+		if (!(shadowDirty & MMA8451Q_SHADOW_BIT(first))) {
+			continue;
+		}
+
+		uint8_t last = first;
+		for (uint8_t next = first + 1; (next <= MMA8451Q_SHADOW_LAST) && (next - last <= MMA8451Q_STORE_BRIDGE + 1); ++next) {
+			const uint64_t bit = MMA8451Q_SHADOW_BIT(next);
+			if (!(SHADOW_WRITABLE & bit) || !((shadowKnown | shadowDirty) & bit)) {
+				break;
+			}
+			if (shadowDirty & bit) {
+				last = next;
+			}
+		}
+
+		MMA8451Q_WriteBurst(first, last);
+		first = last;
+	}
+
+	/* back to the wanted mode */
+	if (standby) {
+		shadow.CTRL_REG1 = target;
+		MMA8451Q_ShadowCompare(MMA8451Q_REG_CTRL_REG1);
+		if (shadowDirty) {
+			MMA8451Q_WriteBurst(MMA8451Q_REG_CTRL_REG1, MMA8451Q_REG_CTRL_REG1);
+		}
+	}
+}
+
+/**
+ * @brief Registers changed in the shadow but not written yet
+ */
+uint64_t MMA8451Q_ShadowDirty()
+{
+	return shadowDirty;
+}
+
 /**
  * @brief Reads the accelerometer data in 14bit no-fifo mode
  * @param[out] The accelerometer data; Must not be null.
@@ -71,8 +350,39 @@ void MMA8451Q_ReadAcceleration14bitNoFifo(mma8451q_acc_t *const data)
 	uint8_t *buffer = &data->status;
 
 	/* read the register data */
-	I2C_ReadRegisters(MMA8451Q_I2CADDR, MMA8451Q_REG_STATUS, registerCount, buffer);
+	I2C_HalReadRegisters(MMA8451Q_I2CADDR, MMA8451Q_REG_STATUS, registerCount, buffer);
+
+	MMA8451Q_FinishReadAcceleration14bit(data);
+}
+
+/**
+ * @brief Queues a read of the accelerometer data in 14bit no-fifo mode on the interrupt driven I2C engine
+ * @param[out] data The accelerometer data; Must not be null.
+ * @param[inout] transfer The descriptor to use; Must stay valid until the transfer completed.
+ * @param[in] callback The completion callback or NULL
+ * @return {@see I2C_STATUS_PENDING} if the read was started, {@see I2C_STATUS_BUSY} otherwise
+ */
+i2c_status_t MMA8451Q_StartReadAcceleration14bit(mma8451q_acc_t *const data, i2c_transfer_t *const transfer, i2c_callback_t callback)
+{
+	/* same 7 registers as the blocking read: 1 status + 6 data */
+	transfer->slaveId = MMA8451Q_I2CADDR;
+	transfer->registerAddress = MMA8451Q_REG_STATUS;
+	transfer->direction = I2C_DIRECTION_READ;
+	transfer->buffer = &data->status;
+	transfer->length = 7;
+	transfer->callback = callback;
+	transfer->context = data;
+
+	return I2C_HalSubmit(transfer);
+}
 
+/**
+ * @brief Converts the raw register contents of a 14bit read into machine endianness and 14bit layout
+ * @param[inout] The accelerometer data; Must not be null.
+ * @return : None
+ */
+void MMA8451Q_FinishReadAcceleration14bit(mma8451q_acc_t *const data)
+{
 	/* apply fix for endianness */
 	if (endianCorrectionRequired(FROM_BIG_ENDIAN))
 	{
@@ -99,7 +409,8 @@ void MMA8451Q_SetDataRate(mma8451q_confreg_t *const configuration, mma8451q_data
 	{
 		const register uint8_t value = ((datarate << CTRL_REG1_DR_SHIFT) & CTRL_REG1_DR_MASK) | ((lownoise << CTRL_REG1_LNOISE_SHIFT) & CTRL_REG1_LNOISE_MASK);
 		const register uint8_t mask = (uint8_t)~(CTRL_REG1_DR_MASK | CTRL_REG1_LNOISE_MASK);
-		I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG1, mask, value);
+		MMA8451Q_ModifyRegister(MMA8451Q_REG_CTRL_REG1, mask, value);
+		MMA8451Q_Flush();
 	}
 	else
 	{
@@ -115,7 +426,7 @@ void MMA8451Q_SetDataRate(mma8451q_confreg_t *const configuration, mma8451q_data
  */
 uint8_t MMA8451Q_SystemMode()
 {
-	return I2C_ReadRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_SYSMOD);
+	return I2C_HalReadRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_SYSMOD);
 }
 
 /**
@@ -125,7 +436,7 @@ uint8_t MMA8451Q_SystemMode()
  */
 uint8_t MMA8451Q_LandscapePortraitConfig()
 {
-	return I2C_ReadRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_PL_CFG);
+	return MMA8451Q_ReadRegister(MMA8451Q_REG_PL_CFG);
 }
 
 /**
@@ -139,7 +450,8 @@ void MMA8451Q_SetOversampling(mma8451q_confreg_t *const configuration, mma8451q_
 	{
 		const register uint8_t value = (oversampling << CTRL_REG2_MODS_SHIFT) & CTRL_REG2_MODS_MASK;
 		const register uint8_t mask = (uint8_t)~(CTRL_REG2_MODS_MASK);
-		I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG2, mask, value);
+		MMA8451Q_ModifyRegister(MMA8451Q_REG_CTRL_REG2, mask, value);
+		MMA8451Q_Flush();
 	}
 	else
 	{
@@ -159,7 +471,8 @@ void MMA8451Q_SetSleepOversampling(mma8451q_confreg_t *const configuration, mma8
 	{
 		const register uint8_t value = (oversampling << CTRL_REG2_SMODS_SHIFT) & CTRL_REG2_SMODS_MASK;
 		const register uint8_t mask = (uint8_t)~(CTRL_REG2_SMODS_MASK);
-		I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG2, mask, value);
+		MMA8451Q_ModifyRegister(MMA8451Q_REG_CTRL_REG2, mask, value);
+		MMA8451Q_Flush();
 	}
 	else
 	{
@@ -170,57 +483,113 @@ void MMA8451Q_SetSleepOversampling(mma8451q_confreg_t *const configuration, mma8
 
 
 /**
- * @brief Configures the transient mode
- * @param: None
- * @return : None
+ * @brief Configures the FIFO buffer mode and watermark
+ * @param[in] mode The buffer mode
+ * @param[in] watermark Sample count raising the FIFO interrupt; 0 disables the watermark
+ *
+ * @return: None
  */
-void MMA8451Q_SetTransient()
+void MMA8451Q_SetFifo(mma8451q_confreg_t *const configuration, mma8451q_fifomode_t mode, uint8_t watermark)
 {
-//	I2C_WriteRegister(register uint8_t slaveId, register uint8_t registerAddress, register uint8_t value);
+	assert(watermark <= MMA8451Q_FIFO_DEPTH);
+
+	const register uint8_t value = ((mode << F_SETUP_F_MODE_SHIFT) & F_SETUP_F_MODE_MASK)
+								| ((watermark << F_SETUP_F_WMRK_SHIFT) & F_SETUP_F_WMRK_MASK);
+
+	if (MMA8451Q_CONFIGURE_DIRECT == configuration)
+	{
+		MMA8451Q_WriteRegister(MMA8451Q_REG_F_SETUP, value);
+		MMA8451Q_Flush();
+	}
+	else
+	{
+		configuration->F_SETUP = value;
+	}
+}
 
-	// Enable X and Y Axes and enable the latch: Register 0x1D Configuration Register
-	I2C_WriteRegister(MMA8451Q_I2CADDR, MMA8451Q_TRANSIENT_CFG, 0x16);
+/**
+ * @brief Selects the events that trigger the FIFO trigger mode
+ * @param[in] sources Or-ed {@see mma8451q_fifotrig_t} values
+ *
+ * @return: None
+ */
+void MMA8451Q_SetFifoTrigger(mma8451q_confreg_t *const configuration, uint8_t sources)
+{
+	if (MMA8451Q_CONFIGURE_DIRECT == configuration)
+	{
+		MMA8451Q_WriteRegister(MMA8451Q_REG_TRIG_CFG, sources & TRIG_CFG_MASK);
+		MMA8451Q_Flush();
+	}
+	else
+	{
+		configuration->TRIG_CFG = sources & TRIG_CFG_MASK;
+	}
+}
 
-	// Set the Threshold: Register 0x1F
+/**
+ * @brief Configures the transient mode
+ * @param: configuration: Current Configuration to Update for the intertial Sensor
+ * @return : None
+ */
+void MMA8451Q_SetTransient(mma8451q_confreg_t *const configuration)
+{
 	/*
+	 * Enable X and Y Axes and enable the latch: Register 0x1D Configuration Register
+	 * Set the Threshold: Register 0x1F
 	 * Note: Step count is 0.063g per count
 	 * 0.5g / 0.063g = 7.93. Therefore set the threshold to 8 counts
+	 * Set the Debounce Counter for 50 ms: Register 0x20
 	 */
-	I2C_WriteRegister(MMA8451Q_I2CADDR, MMA8451Q_TRANSIENT_THS, 0x08);
-
-	// Set the Debounce Counter for 50 ms: Register 0x20
-	I2C_WriteRegister(MMA8451Q_I2CADDR, 0x20, 0x05);
-
-
+	if (MMA8451Q_CONFIGURE_DIRECT == configuration)
+	{
+		/* three adjacent registers, a single burst */
+		MMA8451Q_WriteRegister(MMA8451Q_TRANSIENT_CFG, 0x16);
+		MMA8451Q_WriteRegister(MMA8451Q_TRANSIENT_THS, 0x08);
+		MMA8451Q_WriteRegister(MMA8451Q_REG_TRANSIENT_COUNT, 0x05);
+		MMA8451Q_Flush();
+	}
+	else
+	{
+		configuration->TRANSIENT_CFG = 0x16;
+		configuration->TRANSIENT_THS = 0x08;
+		configuration->TRANSIENT_COUNT = 0x05;
+	}
 }
 
 
 
 /**
  * @brief Configures the Motion mode
- * @param: None
+ * @param: configuration: Current Configuration to Update for the intertial Sensor
  * @return: None
  */
-void MMA8451Q_SetMotion()
+void MMA8451Q_SetMotion(mma8451q_confreg_t *const configuration)
 {
-//	I2C_WriteRegister(register uint8_t slaveId, register uint8_t registerAddress, register uint8_t value);
-
-	// Enable X and Y Axes and enable the latch: Register 0x15 Configuration Register
-	I2C_WriteRegister(MMA8451Q_I2CADDR, 0x15, 0xD8);
-
-	// Set the Debounce Counter for 50 ms: Register 0x20
-//	I2C_WriteRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_FF_MT_THS, 0x30);
-	I2C_WriteRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_FF_MT_THS, 0x1E);
-
-	//Set the debounce counter to eliminate false readings for 100 Hz sample rate with a requirement of 100 ms timer.
-	I2C_WriteRegister(MMA8451Q_I2CADDR, 0x18, 0x0A);
-
-	// Enable Motion/Freefall Interrupt Function in the System (CTRL_REG4)
-	I2C_WriteRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG4, 0x04);
-
-	// Route the Motion/Freefall Interrupt Function to INT1 hardware pin (CTRL_REG5)
-	I2C_WriteRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG5, 0x04);
-
+	/*
+	 * Enable X and Y Axes and enable the latch: Register 0x15 Configuration Register
+	 * Set the threshold: Register 0x17
+	 * Set the debounce counter to eliminate false readings for 100 Hz sample rate with a requirement of 100 ms timer: Register 0x18
+	 * Enable Motion/Freefall Interrupt Function in the System (CTRL_REG4)
+	 * Route the Motion/Freefall Interrupt Function to INT1 hardware pin (CTRL_REG5)
+	 */
+	if (MMA8451Q_CONFIGURE_DIRECT == configuration)
+	{
+		/* written as two bursts, 0x15 .. 0x18 and 0x2D .. 0x2E */
+		MMA8451Q_WriteRegister(MMA8451Q_REG_FF_MT_CFG, 0xD8);
+		MMA8451Q_WriteRegister(MMA8451Q_REG_FF_MT_THS, 0x1E);
+		MMA8451Q_WriteRegister(MMA8451Q_REG_FF_MT_COUNT, 0x0A);
+		MMA8451Q_WriteRegister(MMA8451Q_REG_CTRL_REG4, 0x04);
+		MMA8451Q_WriteRegister(MMA8451Q_REG_CTRL_REG5, 0x04);
+		MMA8451Q_Flush();
+	}
+	else
+	{
+		configuration->FF_MT_CFG = 0xD8;
+		configuration->FF_MT_THS = 0x1E;
+		configuration->FF_MT_COUNT = 0x0A;
+		configuration->CTRL_REG4 = 0x04;
+		configuration->CTRL_REG5 = 0x04;
+	}
 }
 
 
@@ -236,7 +605,8 @@ void MMA8451Q_SetSensitivity(mma8451q_confreg_t *const configuration, mma8451q_s
 {
 	if (MMA8451Q_CONFIGURE_DIRECT == configuration)
 	{
-		I2C_WriteRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_XYZ_DATA_CFG, (sensitivity & 0x03) | ((highpassEnabled << 4) & 0x10));
+		MMA8451Q_WriteRegister(MMA8451Q_REG_XYZ_DATA_CFG, (sensitivity & 0x03) | ((highpassEnabled << 4) & 0x10));
+		MMA8451Q_Flush();
 	}
 	else
 	{
@@ -259,7 +629,8 @@ void MMA8451Q_SetInterruptMode(mma8451q_confreg_t *const configuration, mma8451q
 		const uint8_t value = ((mode << CTRL_REG3_PPOD_SHIFT) & CTRL_REG3_PPOD_MASK)
 									| ((polarity << CTRL_REG3_IPOL_SHIFT) & CTRL_REG3_IPOL_MASK);
 		const uint8_t mask = (uint8_t)~(CTRL_REG3_IPOL_MASK | CTRL_REG3_PPOD_MASK);
-		I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG3, mask, value);
+		MMA8451Q_ModifyRegister(MMA8451Q_REG_CTRL_REG3, mask, value);
+		MMA8451Q_Flush();
 	}
 	else
 	{
@@ -291,10 +662,11 @@ void MMA8451Q_ConfigureInterrupt(mma8451q_confreg_t *const configuration, mma845
 
 	if (MMA8451Q_CONFIGURE_DIRECT == configuration)
 	{
-		I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG5, clearMask, setMask);
+		MMA8451Q_ModifyRegister(MMA8451Q_REG_CTRL_REG5, clearMask, setMask);
 
 		/* interrupt enable */
-		I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG4, I2C_MOD_NO_AND_MASK, 1 << irq);
+		MMA8451Q_ModifyRegister(MMA8451Q_REG_CTRL_REG4, I2C_MOD_NO_AND_MASK, 1 << irq);
+		MMA8451Q_Flush();
 	}
 	else
 	{
@@ -313,8 +685,9 @@ void MMA8451Q_ClearInterruptConfiguration(mma8451q_confreg_t *const configuratio
 {
 	if (MMA8451Q_CONFIGURE_DIRECT == configuration)
 	{
-		I2C_WriteRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG4, 0);
-		I2C_WriteRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG5, 0);
+		MMA8451Q_WriteRegister(MMA8451Q_REG_CTRL_REG4, 0);
+		MMA8451Q_WriteRegister(MMA8451Q_REG_CTRL_REG5, 0);
+		MMA8451Q_Flush();
 	}
 	else
 	{
@@ -333,91 +706,36 @@ void MMA8451Q_FetchConfiguration(mma8451q_confreg_t *const configuration)
 {
 	assert(configuration != 0x0);
 
-	/* loop while the bus is still busy */
-	I2C_WaitWhileBusy();
-
-	/* start register addressing */
-	I2C_SendStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_REG_F_SETUP);
-
-	/* start read */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_READ_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_EnterReceiveModeWithAck();
-	I2C_ReceiverModeDriveClock();
-
-	/* read the registers */
-	configuration->F_SETUP = I2C_ReceiveDriving();
-	configuration->TRIG_CFG = I2C_ReceiveDriving();
-	*((uint8_t*)&configuration->SYSMOD) = I2C_ReceiveDriving();
-
-	I2C_ReceiverModeDriveClock(); /* skip 1 register */
-
-	*((uint8_t*)&configuration->WHO_AM_I) = I2C_ReceiveDriving();
-	configuration->XYZ_DATA_CFG = I2C_ReceiveDriving();
-	configuration->HP_FILTER_CUTOFF = I2C_ReceiveDriving();
-
-	I2C_ReceiverModeDriveClock(); /* skip 1 register */
-
-	configuration->PL_CFG = I2C_ReceiveDriving();
-	configuration->PL_COUNT = I2C_ReceiveDriving();
-	configuration->PL_BF_ZCOMP = I2C_ReceiveDriving();
-	configuration->P_L_THS_REG = I2C_ReceiveDriving();
-	configuration->FF_MT_CFG = I2C_ReceiveDriving();
-
-	I2C_ReceiverModeDriveClock(); /* skip 1 register */
+	/* everything is known: no bus traffic */
+	if ((shadowKnown & SHADOW_CACHED) == SHADOW_CACHED) {
+		memcpy(configuration, &shadow, sizeof(shadow));
+		return;
+	}
 
-#if 1
-	/* After FF_MT_THS (0x17) and FF_MT_COUNT (0x18)
-	 * the next 4 registers are undefined, so bulk-reading
-	 * over them may yield in undesired behaviour
-	 */
-	configuration->FF_MT_THS = I2C_ReceiveDrivingWithNack();
-	configuration->FF_MT_COUNT = I2C_ReceiveAndRestart();
-
-	/* restart read at 0x1D */
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_TRANSIENT_CFG);
-
-	/* re-enter read mode */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_READ_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_EnterReceiveModeWithAck();
-	I2C_ReceiverModeDriveClock();
-#else
-	/* bulk-read through the next registers */
-	configuration->FF_MT_THS = I2C_ReceiveDriving();
-	configuration->FF_MT_COUNT = I2C_ReceiveDriving();
-	I2C_ReceiverModeDriveClock(); /* skip 4 registers */
-	I2C_ReceiverModeDriveClock();
-	I2C_ReceiverModeDriveClock();
-	I2C_ReceiverModeDriveClock();
-#endif
-
-	configuration->TRANSIENT_CFG = I2C_ReceiveDriving();
-	configuration->TRANSIENT_SCR = I2C_ReceiveDriving();
-	configuration->TRANSIENT_THS = I2C_ReceiveDriving();
-	configuration->TRANSIENT_COUNT = I2C_ReceiveDriving();
-	configuration->PULSE_CFG = I2C_ReceiveDriving();
-
-	I2C_ReceiverModeDriveClock(); /* skip 1 register */
-
-	configuration->PULSE_THSX = I2C_ReceiveDriving();
-	configuration->PULSE_THSY = I2C_ReceiveDriving();
-	configuration->PULSE_THSZ = I2C_ReceiveDriving();
-	configuration->PULSE_TMLT = I2C_ReceiveDriving();
-	configuration->PULSE_LTCY = I2C_ReceiveDriving();
-	configuration->PULSE_WIND = I2C_ReceiveDriving();
-	configuration->ASLP_COUNT = I2C_ReceiveDriving();
-	configuration->CTRL_REG1 = I2C_ReceiveDriving();
-	configuration->CTRL_REG2 = I2C_ReceiveDriving();
-	configuration->CTRL_REG3 = I2C_ReceiveDriving();
-	configuration->CTRL_REG4 = I2C_ReceiveDriving();
-	configuration->CTRL_REG5 = I2C_ReceiveDriving();
-	configuration->OFF_X = I2C_ReceiveDriving();
-	configuration->OFF_Y = I2C_ReceiveDrivingWithNack();
-	configuration->OFF_Z = I2C_ReceiveAndStop();
+	/* two bursts: 0x09 .. 0x18, then 0x1D .. 0x31; the 4 registers between are undefined,
+	 * so bulk-reading over them may yield in undesired behaviour */
+	uint8_t registers[MMA8451Q_SHADOW_LAST - MMA8451Q_SHADOW_FIRST + 1];
+	I2C_HalReadRegisters(MMA8451Q_I2CADDR, MMA8451Q_SHADOW_FIRST, MMA8451Q_REG_FF_MT_COUNT - MMA8451Q_SHADOW_FIRST + 1, registers);
+	I2C_HalReadRegisters(MMA8451Q_I2CADDR, MMA8451Q_TRANSIENT_CFG, MMA8451Q_SHADOW_LAST - MMA8451Q_TRANSIENT_CFG + 1,
+			&registers[MMA8451Q_TRANSIENT_CFG - MMA8451Q_SHADOW_FIRST]);
+
+	/* the device image takes the device as it is; changes not flushed yet stay in the shadow and are handed out */
+	const uint64_t pending = shadowDirty;
+	shadowKnown = SHADOW_CACHED;
+	for (uint8_t address = MMA8451Q_SHADOW_FIRST; address <= MMA8451Q_SHADOW_LAST; ++address) {
+		uint8_t *field = MMA8451Q_ShadowField(address);
+		if (field == 0) {
+			continue;
+		}
+		*MMA8451Q_ImageField(&device, address) = registers[address - MMA8451Q_SHADOW_FIRST];
+		if (pending & MMA8451Q_SHADOW_BIT(address)) {
+			MMA8451Q_ShadowCompare(address);
+		}
+		else {
+			*field = *MMA8451Q_ImageField(&device, address);
+		}
+	}
+	memcpy(configuration, &shadow, sizeof(shadow));
 }
 
 /**
@@ -430,87 +748,23 @@ void MMA8451Q_StoreConfiguration(const mma8451q_confreg_t *const configuration)
 {
 	assert(configuration != 0x0);
 
-	/* loop while the bus is still busy */
-	I2C_WaitWhileBusy();
-
-	/* start register addressing at 0x2A - enter passive mode */
-	I2C_SendStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_REG_CTRL_REG1);
-	I2C_SendBlocking(configuration->CTRL_REG1 & ~((1 << CTRL_REG1_ACTIVE_SHIFT) & CTRL_REG1_ACTIVE_MASK)); /* 0x2A, clear active mode */
-
-	/* start register addressing at 0x09 */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_REG_F_SETUP);
-	I2C_SendBlocking(configuration->F_SETUP); /* 0x09 */
-	I2C_SendBlocking(configuration->TRIG_CFG); /* 0x0A */
-
-	/* repeat write at 0x0E */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_REG_XYZ_DATA_CFG);
-	I2C_SendBlocking(configuration->XYZ_DATA_CFG); /* 0x0E */
-	I2C_SendBlocking(configuration->HP_FILTER_CUTOFF); /* 0x0F */
-
-	/* repeat write at 0x11 */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_REG_PL_CFG);
-	I2C_SendBlocking(configuration->PL_CFG); /* 0x11 */
-	I2C_SendBlocking(configuration->PL_COUNT); /* 0x12 */
-	I2C_SendBlocking(configuration->PL_BF_ZCOMP); /* 0x13 */
-	I2C_SendBlocking(configuration->P_L_THS_REG); /* 0x14 */
-	I2C_SendBlocking(configuration->FF_MT_CFG); /* 0x15 */
-
-	/* repeat write at 0x17 */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_REG_FF_MT_THS);
-	I2C_SendBlocking(configuration->FF_MT_THS); /* 0x17 */
-	I2C_SendBlocking(configuration->FF_MT_COUNT); /* 0x18 */
-
-	/* repeat write at 0x1D */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_TRANSIENT_CFG);
-	I2C_SendBlocking(configuration->TRANSIENT_CFG); /* 0x1D */
-
-	/* repeat write at 0x1F */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_TRANSIENT_THS);
-	I2C_SendBlocking(configuration->TRANSIENT_THS); /* 0x1F */
-	I2C_SendBlocking(configuration->TRANSIENT_COUNT); /* 0x20 */
-	I2C_SendBlocking(configuration->PULSE_CFG); /* 0x21 */
-
-	/* repeat write at 0x23 */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_PULSE_THSX);
-	I2C_SendBlocking(configuration->PULSE_THSX); /* 0x23 */
-	I2C_SendBlocking(configuration->PULSE_THSY); /* 0x24 */
-	I2C_SendBlocking(configuration->PULSE_THSZ); /* 0x25 */
-	I2C_SendBlocking(configuration->PULSE_TMLT); /* 0x26 */
-	I2C_SendBlocking(configuration->PULSE_LTCY); /* 0x27 */
-	I2C_SendBlocking(configuration->PULSE_WIND); /* 0x28 */
-	I2C_SendBlocking(configuration->ASLP_COUNT); /* 0x29 */
-	I2C_SendBlocking(configuration->CTRL_REG1 & ~((1 << CTRL_REG1_ACTIVE_SHIFT) & CTRL_REG1_ACTIVE_MASK));  /* 0x2A, clear active mode */
-	I2C_SendBlocking(configuration->CTRL_REG2);  /* 0x2B */
-	I2C_SendBlocking(configuration->CTRL_REG3); /* 0x2C */
-	I2C_SendBlocking(configuration->CTRL_REG4); /* 0x2D */
-	I2C_SendBlocking(configuration->CTRL_REG5); /* 0x2E */
-	I2C_SendBlocking(configuration->OFF_X); /* 0x2F */
-	I2C_SendBlocking(configuration->OFF_Y); /* 0x30 */
-	I2C_SendBlocking(configuration->OFF_Z); /* 0x31 */
-
-	/* rewind to 0x2A - enter desired mode */
-	I2C_SendRepeatedStart();
-	I2C_SendBlocking(I2C_WRITE_ADDRESS(MMA8451Q_I2CADDR));
-	I2C_SendBlocking(MMA8451Q_REG_CTRL_REG1);
-	I2C_SendBlocking(configuration->CTRL_REG1); /* 0x2A, write real value */
-
-	I2C_SendStop();
+	const uint32_t transactions = mma8451q_store_stats.transactions;
+	const uint32_t bytes = mma8451q_store_stats.bytes;
+
+	/* the shadow takes the configuration, keeping the read-only registers; only what differs from the device is dirty */
+	for (uint8_t address = MMA8451Q_SHADOW_FIRST; address <= MMA8451Q_SHADOW_LAST; ++address) {
+		if (SHADOW_WRITABLE & MMA8451Q_SHADOW_BIT(address)) {
+			uint8_t *field = MMA8451Q_ShadowField(address);
+			*field = *((const uint8_t *)configuration + (field - (uint8_t *)&shadow));
+			MMA8451Q_ShadowCompare(address);
+		}
+	}
+	MMA8451Q_Flush();
+
+	/* against rewriting every register in standby, as a full store would */
+	mma8451q_store_stats.stores++;
+	mma8451q_store_stats.transactionsSaved += MMA8451Q_STORE_FULL_TRANSACTIONS - (mma8451q_store_stats.transactions - transactions);
+	mma8451q_store_stats.bytesSaved += MMA8451Q_STORE_FULL_BYTES - (mma8451q_store_stats.bytes - bytes);
 }
 
 
@@ -518,17 +772,12 @@ void MMA8451Q_StoreConfiguration(const mma8451q_confreg_t *const configuration)
  * @brief Convert the acceleration data read to roll and pitch
  *
  * @param: 1) configuration: Inertial Sensor Configuration to read from
- * 		   2) roll: float angle tilt calculated in degrees
- * 		   3) pitch: float angle tilt calculated in degrees
+ * 		   2) roll: angle tilt calculated in centi-degrees
+ * 		   3) pitch: angle tilt calculated in centi-degrees
  */
-void convert_xyz_to_roll_pitch(mma8451q_acc_t *acc, float *roll, float *pitch) {
-	float ax = acc->xyz[0]/COUNTS_PER_G,
-				ay = acc->xyz[1]/COUNTS_PER_G,
-				az = acc->xyz[2]/COUNTS_PER_G;
-
-	*roll = atan2(ay, az)*180/M_PI;
-	*pitch = atan2(ax, sqrt(ay*ay + az*az))*180/M_PI;
-
+void convert_xyz_to_roll_pitch(mma8451q_acc_t *acc, int16_t *roll, int16_t *pitch) {
+	/* integer only, the M0+ has no FPU; the angles do not depend on the full scale */
+	Tilt_RollPitch(acc->xyz[0], acc->xyz[1], acc->xyz[2], roll, pitch);
 }
 
 /**
@@ -542,15 +791,8 @@ void read_full_xyz(mma8451q_acc_t *acc)
 	uint8_t data[6];
 	int16_t temp[3];
 
-	i2c_start();
-	i2c_read_setup(MMA_ADDR , REG_XHI);
-
-	// Read five bytes in repeated mode
-	for( i=0; i<5; i++)	{
-		data[i] = i2c_repeated_read(0);
-	}
-	// Read last byte ending repeated mode
-	data[i] = i2c_repeated_read(1);
+	// Read the six output bytes in one burst
+	I2C_HalReadRegisters(MMA8451Q_I2CADDR, MMA8451Q_REG_OUT_X_MSB, sizeof(data), data);
 
 	for ( i=0; i<3; i++ ) {
 		temp[i] = (int16_t) ((data[2*i]<<8) | data[2*i+1]);
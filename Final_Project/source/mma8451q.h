@@ -17,7 +17,7 @@
 #define MMA8451Q_H_
 
 #include "MKL25Z4.h"
-#include "i2c.h"
+#include "i2c_hal.h"
 
 /**
  * @brief I2C slave address of the MMA8451Q accelerometer
@@ -33,22 +33,47 @@
 #define MMA8451Q_STATUS_Y(status)		(status & 0b00000010)	/*< Y data ready */
 #define MMA8451Q_STATUS_ZDR(status)		(status & 0b00000001)	/*< Z data ready */
 
+#define MMA8451Q_F_STATUS_OVF(status)	(status & 0b10000000)	/*< FIFO overflowed, samples were lost (circular) or refused (fill) */
+#define MMA8451Q_F_STATUS_WMRK(status)	(status & 0b01000000)	/*< FIFO sample count reached the watermark */
+#define MMA8451Q_F_STATUS_CNT(status)	(status & 0b00111111)	/*< FIFO sample count */
+
 #define MMA8451Q_REG_STATUS				(0x00)	/*< STATUS register */
+#define MMA8451Q_REG_F_STATUS			(0x00)	/*< F_STATUS register, takes the place of STATUS while the FIFO is enabled */
+#define MMA8451Q_REG_OUT_X_MSB			(0x01)	/*< OUT_X_MSB register, FIFO read port while the FIFO is enabled */
 #define MMA8451Q_REG_F_SETUP			(0x09)	/*< F_SETUP register */
+#define MMA8451Q_REG_TRIG_CFG			(0x0A)	/*< TRIG_CFG register for FIFO trigger sources */
+#define MMA8451Q_REG_INT_SOURCE			(0x0C)	/*< INT_SOURCE register for interrupt source identification */
 #define MMA8451Q_REG_SYSMOD				(0x0B)	/*< SYSMOD register for system mode identification */
 #define MMA8451Q_REG_PL_CFG				(0x11)	/*< PL_CFG register for portrait/landscape detection configuration */
 #define MMA8451Q_REG_WHOAMI				(0x0D)	/*< WHO_AM_I register for device identification */
 #define MMA8451Q_REG_XYZ_DATA_CFG		(0x0E)	/*< XYZ_DATA_CFG sensitivity configuration */
 #define MMA8451Q_REG_PL_CFG				(0x11)	/*< PL_CFG landscape/portrait configuration */
+#define MMA8451Q_REG_FF_MT_CFG			(0x15)	/*< FF_MT_CFG freefall/motion configuration */
+#define MMA8451Q_REG_FF_MT_SRC			(0x16)	/*< FF_MT_SRC freefall/motion event source, reading it clears the event */
 #define MMA8451Q_REG_FF_MT_THS			(0x17)	/*< MT_THS freefall/motion threshold */
+#define MMA8451Q_REG_FF_MT_COUNT		(0x18)	/*< FF_MT_COUNT freefall/motion debounce counter */
 #define MMA8451Q_TRANSIENT_CFG			(0x1D)	/*< TRANSIENT_CFG transient functional block configuration */
+#define MMA8451Q_REG_TRANSIENT_SCR		(0x1E)	/*< TRANSIENT_SCR transient event status */
 #define MMA8451Q_TRANSIENT_THS			(0x1F)	/*< TRANSIENT_THS transient event threshold */
+#define MMA8451Q_REG_TRANSIENT_COUNT	(0x20)	/*< TRANSIENT_COUNT transient debounce counter */
 #define MMA8451Q_PULSE_THSX				(0x23)	/*< PULSE_THSX X pulse threshold */
 #define MMA8451Q_REG_CTRL_REG1			(0x2A)	/*< CTRL_REG1 System Control 1 Register */
 #define MMA8451Q_REG_CTRL_REG2			(0x2B)	/*< CTRL_REG2 System Control 2 Register */
 #define MMA8451Q_REG_CTRL_REG3			(0x2C)	/*< CTRL_REG2 System Control 3 Register */
 #define MMA8451Q_REG_CTRL_REG4			(0x2D)	/*< CTRL_REG2 System Control 4 Register */
 #define MMA8451Q_REG_CTRL_REG5			(0x2E)	/*< CTRL_REG2 System Control 5 Register */
+#define MMA8451Q_REG_OFF_X				(0x2F)	/*< OFF_X X-axis offset, OFF_Y and OFF_Z follow */
+#define MMA8451Q_REG_OFF_Z				(0x31)	/*< OFF_Z, the last configuration register */
+
+/**
+ * @brief Number of X/Y/Z samples the FIFO holds
+ */
+#define MMA8451Q_FIFO_DEPTH		(32)
+
+/**
+ * @brief Bytes of one 14bit X/Y/Z sample in the FIFO
+ */
+#define MMA8451Q_FIFO_SAMPLE_SIZE	(6)
 
 #define COUNTS_PER_G (4096.0)
 #define M_PI (3.14159265)
@@ -134,6 +159,27 @@ typedef enum {
 } mma8451q_interrupt_t;
 
 
+/**
+ * @brief FIFO buffer mode
+ */
+typedef enum {
+	MMA8451Q_FIFOMODE_DISABLED	= (0b00),	/*< FIFO disabled, STATUS and OUT registers hold the latest sample */
+	MMA8451Q_FIFOMODE_CIRCULAR	= (0b01),	/*< the oldest sample is discarded once the FIFO is full */
+	MMA8451Q_FIFOMODE_FILL		= (0b10),	/*< new samples are discarded once the FIFO is full */
+	MMA8451Q_FIFOMODE_TRIGGER	= (0b11)	/*< circular until a trigger event, then filled up to the watermark */
+} mma8451q_fifomode_t;
+
+/**
+ * @brief Events that end the circular phase of {@see MMA8451Q_FIFOMODE_TRIGGER}, may be or-ed
+ */
+typedef enum {
+	MMA8451Q_FIFOTRIG_NONE		= (0x00),	/*< no trigger source */
+	MMA8451Q_FIFOTRIG_FFMT		= (0x04),	/*< Freefall/Motion */
+	MMA8451Q_FIFOTRIG_PULSE		= (0x08),	/*< Pulse Detection */
+	MMA8451Q_FIFOTRIG_LNDPRT	= (0x10),	/*< Landscape/Portrait */
+	MMA8451Q_FIFOTRIG_TRANS		= (0x20)	/*< Transient */
+} mma8451q_fifotrig_t;
+
 /**
  * @brief Interrupt pin routing
  */
@@ -146,7 +192,7 @@ typedef enum {
 /**
  * @brief Accelerometer data
  */
-#pragma pack(1)
+#pragma pack(push, 1)
 typedef struct __attribute__ ((__packed__))
 {
 	uint8_t :8; 		/*< padding byte */
@@ -160,6 +206,14 @@ typedef struct __attribute__ ((__packed__))
 		int16_t xyz[3];
 	};
 } mma8451q_acc_t;
+#pragma pack(pop)
+
+/**
+ * @brief Receives the samples of an acquisition as they land, in the interrupt that completed them
+ * @param[in] samples X/Y/Z samples, oldest first, converted like {@see MMA8451Q_FinishReadAcceleration14bit}
+ * @param[in] count Their number
+ */
+typedef void (*mma8451q_tap_t)(const int16_t (*samples)[3], uint8_t count);
 
 /**
  * @brief The MMA8451Q configuration registers
@@ -211,13 +265,110 @@ typedef struct {
 #define MMA8451Q_CONFIGURE_DIRECT ((mma8451q_confreg_t*)0x0)
 
 /**
- * @brief Fetches the configuration into a {@see mma8451q_confreg_t} data structure
+ * @brief The driver keeps a shadow of the configuration registers 0x09 .. 0x31 of the device.
+ *
+ * A register is known once it was read or written, and from then on reads of it are answered
+ * from RAM. Changes are applied to the shadow, and a register whose wanted value differs from the
+ * last known device contents is dirty; {@see MMA8451Q_Flush} then writes only the dirty registers,
+ * so a bit-field change costs a single write instead of a read and a write, and a change that is
+ * undone costs nothing. SYSMOD and TRANSIENT_SCR change on their own and are always read from the bus.
+ * Whoever writes the device registers past the driver must call {@see MMA8451Q_ShadowInvalidate}.
+ */
+#define MMA8451Q_SHADOW_FIRST	MMA8451Q_REG_F_SETUP	/*< first shadowed register */
+#define MMA8451Q_SHADOW_LAST	MMA8451Q_REG_OFF_Z		/*< last shadowed register */
+
+/**
+ * @brief Bit of a register in the shadow masks
+ */
+#define MMA8451Q_SHADOW_BIT(address)	(1ull << ((address) - MMA8451Q_SHADOW_FIRST))
+
+/**
+ * @brief Forgets the shadow, e.g. after a reset of the device; the next access of each register reads it once
+ */
+void MMA8451Q_ShadowInvalidate();
+
+/**
+ * @brief Takes the device as it is right after {@see MMA8451Q_Reset}: every register at its reset value of
+ * 		  the data sheet, known without a read, so a configuration stored next writes what differs only
+ */
+void MMA8451Q_ShadowReset();
+
+/**
+ * @brief Reads a register, from the shadow if it is known
+ * @param[in] address The register address
+ * @return The register value
+ */
+uint8_t MMA8451Q_ReadRegister(uint8_t address);
+
+/**
+ * @brief Changes a register in the shadow, FIRST and-ing with andMask and THEN or-ing with orMask,
+ * 		  and marks it dirty if the value changed. Nothing is written before {@see MMA8451Q_Flush}.
+ * @param[in] address The register address
+ * @param[in] andMask The mask to AND the register with
+ * @param[in] orMask The mask to OR the register with
+ * @return The register after modification
+ */
+uint8_t MMA8451Q_ModifyRegister(uint8_t address, uint8_t andMask, uint8_t orMask);
+
+/**
+ * @brief Sets a register in the shadow and marks it dirty if the value changed
+ * @param[in] address The register address
+ * @param[in] value The value
+ */
+void MMA8451Q_WriteRegister(uint8_t address, uint8_t value);
+
+/**
+ * @brief Clean registers a burst writes through rather than splitting in two; each costs a byte on the bus,
+ * 		  a new transaction costs the START, the slave address and the register address
+ */
+#define MMA8451Q_STORE_BRIDGE	(2)
+
+/**
+ * @brief Bus cost of writing every register as {@see MMA8451Q_StoreConfiguration} did before it compared:
+ * 		  standby, 7 bursts over the writable registers, then the mode; each with slave and register address
+ */
+#define MMA8451Q_STORE_FULL_TRANSACTIONS	(9)
+#define MMA8451Q_STORE_FULL_BYTES			(50)
+
+/**
+ * @brief Write traffic of the configuration commits
+ */
+typedef struct {
+	uint32_t transactions;			/*< write transactions issued, one per START */
+	uint32_t bytes;					/*< bytes written, slave and register address included */
+	uint32_t stores;				/*< calls of {@see MMA8451Q_StoreConfiguration} */
+	uint32_t transactionsSaved;		/*< transactions the stores did not need against a full rewrite */
+	uint32_t bytesSaved;			/*< bytes the stores did not need against a full rewrite */
+} mma8451q_store_stats_t;
+
+/**
+ * @brief The write traffic of the configuration commits
+ */
+extern mma8451q_store_stats_t mma8451q_store_stats;
+
+/**
+ * @brief Writes the dirty registers to the device. Adjacent dirty registers, and those a few clean known
+ * 		  ones apart ({@see MMA8451Q_STORE_BRIDGE}), go in one auto-increment burst. Standby is entered only
+ * 		  if a register other than the ACTIVE bit changes, and left again only if the shadow wants active mode.
+ */
+void MMA8451Q_Flush();
+
+/**
+ * @brief Registers changed in the shadow but not written yet, {@see MMA8451Q_SHADOW_BIT}
+ * @return The dirty mask
+ */
+uint64_t MMA8451Q_ShadowDirty();
+
+/**
+ * @brief Fetches the configuration into a {@see mma8451q_confreg_t} data structure; from the shadow
+ * 		  once every register is known, SYSMOD and TRANSIENT_SCR are then those of the last bus fetch.
  * @param[inout] The configuration data data; Must not be null.
  */
 void MMA8451Q_FetchConfiguration(mma8451q_confreg_t *const configuration);
 
 /**
- * @brief Stores the configuration from a {@see mma8451q_confreg_t} data structure
+ * @brief Stores the configuration from a {@see mma8451q_confreg_t} data structure; the shadow takes it over
+ * 		  and {@see MMA8451Q_Flush} writes the registers the device does not hold yet
  * @param[in] The configuration data data; Must not be null.
  */
 void MMA8451Q_StoreConfiguration(const mma8451q_confreg_t *const configuration);
@@ -240,13 +391,30 @@ static inline void MMA8451Q_InitializeData(mma8451q_acc_t *const data)
  */
 void MMA8451Q_ReadAcceleration14bitNoFifo(mma8451q_acc_t *const data);
 
+/**
+ * @brief Queues a read of the accelerometer data in 14bit no-fifo mode on the interrupt driven I2C engine.
+ * The call returns immediately; the data is valid once the transfer completed and
+ * {@see MMA8451Q_FinishReadAcceleration14bit} was applied.
+ * @param[out] data The accelerometer data; Must not be null.
+ * @param[inout] transfer The descriptor to use; Must stay valid until the transfer completed.
+ * @param[in] callback The completion callback or NULL
+ * @return {@see I2C_STATUS_PENDING} if the read was started, {@see I2C_STATUS_BUSY} otherwise
+ */
+i2c_status_t MMA8451Q_StartReadAcceleration14bit(mma8451q_acc_t *const data, i2c_transfer_t *const transfer, i2c_callback_t callback);
+
+/**
+ * @brief Converts the raw register contents of a 14bit read into machine endianness and 14bit layout
+ * @param[inout] The accelerometer data; Must not be null.
+ */
+void MMA8451Q_FinishReadAcceleration14bit(mma8451q_acc_t *const data);
+
 /**
  * @brief Reads the STATUS register from the MMA8451Q.
  * @return Status bits, see MMA8451Q_STATUS_XXXX defines.
  */
 static inline uint8_t MMA8451Q_Status()
 {
-	return I2C_ReadRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_STATUS);
+	return I2C_HalReadRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_STATUS);
 }
 
 /**
@@ -266,7 +434,8 @@ uint8_t MMA8451Q_LandscapePortraitConfig();
  */
 static inline void MMA8451Q_EnterPassiveMode()
 {
-	I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG1, ~0b00000001, I2C_MOD_NO_OR_MASK);
+	MMA8451Q_ModifyRegister(MMA8451Q_REG_CTRL_REG1, ~0b00000001, I2C_MOD_NO_OR_MASK);
+	MMA8451Q_Flush();
 }
 
 /**
@@ -274,7 +443,10 @@ static inline void MMA8451Q_EnterPassiveMode()
  */
 static inline void MMA8451Q_Reset()
 {
-	I2C_WriteRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG2, 0b01000000);
+	I2C_HalWriteRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG2, 0b01000000);
+
+	/* every register returns to its default */
+	MMA8451Q_ShadowInvalidate();
 }
 
 /**
@@ -283,7 +455,8 @@ static inline void MMA8451Q_Reset()
  */
 static inline void MMA8451Q_EnterActiveMode()
 {
-	I2C_ModifyRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG1, I2C_MOD_NO_AND_MASK, 0x01);
+	MMA8451Q_ModifyRegister(MMA8451Q_REG_CTRL_REG1, I2C_MOD_NO_AND_MASK, 0x01);
+	MMA8451Q_Flush();
 }
 
 /**
@@ -300,7 +473,7 @@ void MMA8451Q_SetDataRate(mma8451q_confreg_t *const configuration, register mma8
  */
 static inline uint8_t MMA8451Q_WhoAmI()
 {
-	return I2C_ReadRegister(MMA8451Q_I2CADDR, MMA8451Q_REG_WHOAMI);
+	return MMA8451Q_ReadRegister(MMA8451Q_REG_WHOAMI);
 }
 
 /**
@@ -342,23 +515,40 @@ void MMA8451Q_SetOversampling(mma8451q_confreg_t *const configuration, mma8451q_
 
 
 /**
- * @brief Configures the transient mode
+ * @brief Configures the FIFO; the mode can only be changed in standby.
+ * @param[inout] configuration The configuration structure or {@see MMA8451Q_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
+ * @param[in] mode The buffer mode
+ * @param[in] watermark Sample count raising the FIFO interrupt, 1 to {@see MMA8451Q_FIFO_DEPTH}; 0 disables the watermark
  */
-void MMA8451Q_SetTransient();
+void MMA8451Q_SetFifo(mma8451q_confreg_t *const configuration, mma8451q_fifomode_t mode, uint8_t watermark);
 
 /**
- * @brief Configures the motion mode
+ * @brief Selects the events that trigger {@see MMA8451Q_FIFOMODE_TRIGGER}
+ * @param[inout] configuration The configuration structure or {@see MMA8451Q_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
+ * @param[in] sources Or-ed {@see mma8451q_fifotrig_t} values
+ */
+void MMA8451Q_SetFifoTrigger(mma8451q_confreg_t *const configuration, uint8_t sources);
+
+/**
+ * @brief Configures the transient mode: X and Y axes latched, 0.5g threshold, 50 ms debounce
+ * @param[inout] configuration The configuration structure or {@see MMA8451Q_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
+ */
+void MMA8451Q_SetTransient(mma8451q_confreg_t *const configuration);
+
+/**
+ * @brief Configures the motion mode on X and Y and routes its interrupt to INT1; replaces CTRL_REG4 and CTRL_REG5
+ * @param[inout] configuration The configuration structure or {@see MMA8451Q_CONFIGURE_DIRECT} if changes should be sent directly over the wire.
  */
-void MMA8451Q_SetMotion();
+void MMA8451Q_SetMotion(mma8451q_confreg_t *const configuration);
 
 /**
  * @brief Convert the acceleration data read to roll and pitch
  *
  * @param: 1) configuration: Inertial Sensor Configuration to read from
- * 		   2) roll: float angle tilt calculated in degrees
- * 		   3) pitch: float angle tilt calculated in degrees
+ * 		   2) roll: angle tilt calculated in centi-degrees, -18000 .. 18000 {@see Tilt_RollPitch}
+ * 		   3) pitch: angle tilt calculated in centi-degrees, -9000 .. 9000
  */
-void convert_xyz_to_roll_pitch(mma8451q_acc_t *acc, float *roll, float *pitch);
+void convert_xyz_to_roll_pitch(mma8451q_acc_t *acc, int16_t *roll, int16_t *pitch);
 
 /**
  * @brief Read acceleration data from inerital sensor and updat
@@ -0,0 +1,184 @@
+/*
+ * mma8451q_drdy.c
+ *
+ *  Created on: Dec 16, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Data-ready interrupt driven acquisition from the MMA8451Q.
+ *
+ *    Sources of Reference :
+ * 		1) https://www.nxp.com/docs/en/data-sheet/MMA8451Q.pdf (STATUS, CTRL_REG4 INT_EN_DRDY)
+ * 		2) https://www.nxp.com/docs/en/application-note/AN4076.pdf (Data Manipulation and Basic Settings of the MMA8451Q)
+ */
+
+#include <string.h>
+#include "mma8451q_drdy.h"
+#include "systick.h"
+#include "scheduler.h"
+
+/**
+ * @brief The acquisition counters
+ */
+volatile mma8451q_drdy_stats_t mma8451q_drdy_stats;
+
+/**
+ * @brief Sample being read by the I2C engine
+ */
+static mma8451q_sample_t reading;
+
+/**
+ * @brief The newest published sample, guarded by masking interrupts
+ */
+static mma8451q_sample_t latest;
+
+/**
+ * @brief Every sample in order, produced by the completion callback
+ */
+static mma8451q_sample_t queueStorage[MMA8451Q_DRDY_QUEUE_LENGTH];
+static Q_T queue = Q_INITIALIZER(queueStorage);
+
+/**
+ * @brief Sequence number of the sample last handed out by {@see MMA8451Q_DrdyTake}
+ */
+static uint32_t taken;
+
+/**
+ * @brief Sees every sample read, or NULL
+ */
+static mma8451q_tap_t tap;
+
+/**
+ * @brief The read descriptor, owned by the I2C engine while pending
+ */
+static i2c_transfer_t transfer = { .status = I2C_STATUS_OK };
+
+/**
+ * @brief Reads failed in a row, re-issued up to {@see MMA8451Q_DRDY_RETRIES} times
+ */
+static uint8_t failures;
+
+static void MMA8451Q_DrdyComplete(i2c_transfer_t *completed);
+
+/**
+ * @brief Resets the published sample and the counters
+ */
+void MMA8451Q_DrdyStart()
+{
+	/* let a read still in flight land before everything is reset */
+	I2C_HalSpin(&transfer);
+
+	memset(&reading, 0, sizeof(reading));
+	memset(&latest, 0, sizeof(latest));
+	Q_Init(&queue);
+	memset((void *)&mma8451q_drdy_stats, 0, sizeof(mma8451q_drdy_stats));
+	taken = 0;
+	failures = 0;
+}
+
+/**
+ * @brief Queues the read of the sample, once the previous read landed
+ */
+static void MMA8451Q_DrdySubmit()
+{
+	/* the descriptor and buffer are reused, a read still in flight must land first */
+	I2C_HalSpin(&transfer);
+
+	/* wait out a transaction of another engine user */
+	while (MMA8451Q_StartReadAcceleration14bit(&reading.acc, &transfer, MMA8451Q_DrdyComplete) == I2C_STATUS_BUSY) {}
+}
+
+/**
+ * @brief Completion callback of a read, runs in the I2C or DMA interrupt
+ * @param[in] completed The read descriptor
+ */
+static void MMA8451Q_DrdyComplete(i2c_transfer_t *completed)
+{
+	if (completed->status != I2C_STATUS_OK) {
+		mma8451q_drdy_stats.errors++;
+
+		/* the sample is still unread and INT2 stays low, no edge will ask again */
+		if (failures < MMA8451Q_DRDY_RETRIES) {
+			failures++;
+			mma8451q_drdy_stats.retries++;
+			MMA8451Q_DrdySubmit();
+		}
+		else {
+			failures = 0;
+			mma8451q_drdy_stats.abandoned++;
+		}
+		return;
+	}
+	failures = 0;
+
+	MMA8451Q_FinishReadAcceleration14bit(&reading.acc);
+
+	mma8451q_drdy_stats.samples++;
+	if (MMA8451Q_STATUS_ZYXOW(reading.acc.status)) {
+		mma8451q_drdy_stats.overruns++;
+	}
+	if (latest.sequence != taken) {
+		mma8451q_drdy_stats.unconsumed++;
+	}
+
+	reading.sequence = latest.sequence + 1;
+	latest = reading;
+
+	if (!Q_Push(&queue, &reading)) {
+		mma8451q_drdy_stats.dropped++;
+	}
+	if (tap != 0) {
+		const int16_t xyz[1][3] = { { reading.acc.x, reading.acc.y, reading.acc.z } };
+		tap(xyz, 1);
+	}
+	Scheduler_PostOnce(EVENT_SAMPLES, reading.sequence);
+}
+
+/**
+ * @brief Queues the read of the new sample
+ */
+void MMA8451Q_DrdyRead()
+{
+	/* the stamp goes with the buffer, a read still in flight must land first */
+	I2C_HalSpin(&transfer);
+
+	reading.timestamp = cycle_count();
+	MMA8451Q_DrdySubmit();
+}
+
+/**
+ * @brief Hands every sample read to a tap as well
+ */
+void MMA8451Q_DrdySetTap(mma8451q_tap_t sink)
+{
+	tap = sink;
+}
+
+/**
+ * @brief Fetches the newest sample if it was not taken before
+ */
+bool MMA8451Q_DrdyTake(mma8451q_sample_t *sample)
+{
+	bool fresh = false;
+
+	uint32_t masking_state = __get_PRIMASK();
+	__disable_irq();
+	if (latest.sequence != taken) {
+		*sample = latest;
+		taken = latest.sequence;
+		fresh = true;
+	}
+	else {
+		mma8451q_drdy_stats.duplicatesAvoided++;
+	}
+	__set_PRIMASK(masking_state);
+
+	return fresh;
+}
+
+/**
+ * @brief Fetches the oldest queued sample
+ */
+bool MMA8451Q_DrdyPop(mma8451q_sample_t *sample)
+{
+	return Q_Pop(&queue, sample);
+}
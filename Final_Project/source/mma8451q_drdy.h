@@ -0,0 +1,99 @@
+/*
+ * mma8451q_drdy.h
+ *
+ *  Created on: Dec 16, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Header file for data-ready interrupt driven acquisition from the MMA8451Q.
+ *
+ *      		The data-ready interrupt is routed to INT2 (PTA15). On its edge PORTA_IRQHandler
+ *      		calls {@see MMA8451Q_DrdyRead}, which stamps the sample with {@see cycle_count},
+ *      		the low word of the common {@see timestamp_cycles} clock, and queues the 7 byte
+ *      		STATUS + XYZ read on the interrupt driven I2C engine. Reading the data clears
+ *      		the interrupt, so every sample the sensor produces is read exactly once. The completion callback publishes it for {@see MMA8451Q_DrdyTake},
+ *      		which hands out the newest, and queues it for {@see MMA8451Q_DrdyPop}, which hands
+ *      		out every sample in order.
+ *
+ *    Sources of Reference :
+ * 		1) https://www.nxp.com/docs/en/data-sheet/MMA8451Q.pdf (STATUS, CTRL_REG4 INT_EN_DRDY)
+ * 		2) https://www.nxp.com/docs/en/application-note/AN4076.pdf (Data Manipulation and Basic Settings of the MMA8451Q)
+ */
+
+#ifndef MMA8451Q_DRDY_H_
+#define MMA8451Q_DRDY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "mma8451q.h"
+#include "queue.h"
+
+#define MMA8451Q_DRDY_QUEUE_LENGTH	(16)	/*< samples queued for {@see MMA8451Q_DrdyPop}, power of two */
+#define MMA8451Q_DRDY_RETRIES		(3)		/*< failed reads in a row re-issued; only reading the data clears INT2, no edge asks again */
+
+/**
+ * @brief A sample and the time it became ready
+ */
+typedef struct {
+	mma8451q_acc_t acc;			/*< STATUS and X/Y/Z, converted like {@see MMA8451Q_FinishReadAcceleration14bit} */
+	uint32_t timestamp;			/*< {@see cycle_count} at the data-ready edge */
+	uint32_t sequence;			/*< running sample number, starts at 1 */
+} mma8451q_sample_t;
+
+/**
+ * @brief Acquisition counters
+ */
+typedef struct {
+	uint32_t samples;			/*< samples read */
+	uint32_t overruns;			/*< samples whose STATUS reported ZYXOW, i.e. a sample was overwritten unread */
+	uint32_t duplicatesAvoided;	/*< requests for a sample answered without a bus read because nothing new was ready */
+	uint32_t unconsumed;		/*< samples replaced before anyone took them */
+	uint32_t errors;			/*< reads that failed on the bus */
+	uint32_t retries;			/*< failed reads re-issued */
+	uint32_t abandoned;			/*< failed reads given up on after {@see MMA8451Q_DRDY_RETRIES} retries */
+	uint32_t dropped;			/*< samples not queued because the sample queue was full */
+} mma8451q_drdy_stats_t;
+
+/**
+ * @brief The acquisition counters
+ */
+extern volatile mma8451q_drdy_stats_t mma8451q_drdy_stats;
+
+/**
+ * @brief Resets the published sample and the counters. Call before the data-ready interrupt is enabled.
+ *
+ * @param: None
+ * @return: None
+ */
+void MMA8451Q_DrdyStart();
+
+/**
+ * @brief Queues the read of the new sample; call from the INT2 edge interrupt.
+ *
+ * @param: None
+ * @return: None
+ */
+void MMA8451Q_DrdyRead();
+
+/**
+ * @brief Hands every sample read to a tap as well, before EVENT_SAMPLES is posted;
+ * 		  the tap runs in the I2C interrupt
+ * @param[in] tap The tap, NULL for none
+ */
+void MMA8451Q_DrdySetTap(mma8451q_tap_t tap);
+
+/**
+ * @brief Fetches the newest sample if it was not taken before
+ * @param[out] sample Receives the sample
+ * @return true if a new sample was copied, false if there was none
+ */
+bool MMA8451Q_DrdyTake(mma8451q_sample_t *sample);
+
+/**
+ * @brief Fetches the oldest queued sample; every sample read is queued once, unless the queue was full.
+ * 		  A single consumer only, independent of {@see MMA8451Q_DrdyTake}.
+ * @param[out] sample Receives the sample
+ * @return true if a sample was copied, false if the queue is empty
+ */
+bool MMA8451Q_DrdyPop(mma8451q_sample_t *sample);
+
+#endif /* MMA8451Q_DRDY_H_ */
@@ -0,0 +1,198 @@
+/*
+ * mma8451q_fifo.c
+ *
+ *  Created on: Dec 16, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Batch acquisition from the MMA8451Q hardware FIFO.
+ *
+ *    Sources of Reference :
+ * 		1) https://www.nxp.com/docs/en/data-sheet/MMA8451Q.pdf (F_STATUS, F_SETUP, auto-increment)
+ * 		2) https://www.nxp.com/docs/en/application-note/AN4073.pdf (Using the 32 Sample First In First Out (FIFO) in the MMA8451Q)
+ */
+
+#include <string.h>
+#include "mma8451q_fifo.h"
+#include "endian.h"
+#include "assert.h"
+#include "scheduler.h"
+#include "systick.h"
+
+/**
+ * @brief The acquisition counters
+ */
+volatile mma8451q_fifo_stats_t mma8451q_fifo_stats;
+
+/**
+ * @brief Double buffered batches
+ */
+static mma8451q_fifo_batch_t batches[2];
+
+/**
+ * @brief Index of the batch the next burst fills
+ */
+static uint8_t filling;
+
+/**
+ * @brief The newest completed batch, NULL before the first one
+ */
+static mma8451q_fifo_batch_t *volatile newest;
+
+/**
+ * @brief Sequence number of the batch last handed out by {@see MMA8451Q_FifoTake}
+ */
+static uint32_t taken;
+
+/**
+ * @brief Running batch number
+ */
+static uint32_t sequence;
+
+/**
+ * @brief Samples per burst
+ */
+static uint8_t batchSize = MMA8451Q_FIFO_WATERMARK;
+
+/**
+ * @brief Sees every completed batch, or NULL
+ */
+static mma8451q_tap_t tap;
+
+/**
+ * @brief The burst descriptor, owned by the I2C engine while pending
+ */
+static i2c_transfer_t transfer = { .status = I2C_STATUS_OK };
+
+/**
+ * @brief Bursts failed in a row, re-issued up to {@see MMA8451Q_FIFO_RETRIES} times
+ */
+static uint8_t failures;
+
+static void MMA8451Q_FifoComplete(i2c_transfer_t *completed);
+
+/**
+ * @brief Resets the batch buffers and counters and sets the batch size
+ */
+void MMA8451Q_FifoStart(uint8_t watermark)
+{
+	assert((watermark > 0) && (watermark <= MMA8451Q_FIFO_DEPTH));
+
+	/* let a burst still in flight land before the buffers are reset */
+	I2C_HalSpin(&transfer);
+
+	memset(batches, 0, sizeof(batches));
+	memset((void *)&mma8451q_fifo_stats, 0, sizeof(mma8451q_fifo_stats));
+	filling = 0;
+	newest = 0;
+	taken = 0;
+	sequence = 0;
+	failures = 0;
+	batchSize = watermark;
+}
+
+/**
+ * @brief Queues the burst read of one batch
+ */
+void MMA8451Q_FifoDrain()
+{
+	/* the descriptor is reused, so a burst still in flight must land first */
+	I2C_HalSpin(&transfer);
+
+	mma8451q_fifo_batch_t *batch = &batches[filling];
+	batch->timestamp = timestamp_us();
+
+	/* F_STATUS, then the auto-increment wraps over OUT_X_MSB .. OUT_Z_LSB once per sample */
+	transfer.slaveId = MMA8451Q_I2CADDR;
+	transfer.registerAddress = MMA8451Q_REG_F_STATUS;
+	transfer.direction = I2C_DIRECTION_READ;
+	transfer.buffer = &batch->status;
+	transfer.length = 1 + batchSize * MMA8451Q_FIFO_SAMPLE_SIZE;
+	transfer.callback = MMA8451Q_FifoComplete;
+	transfer.context = batch;
+
+	/* wait out a transaction of another engine user */
+	while (I2C_HalSubmit(&transfer) == I2C_STATUS_BUSY) {}
+}
+
+/**
+ * @brief Completion callback of a burst, runs in the I2C or DMA interrupt
+ * @param[in] completed The burst descriptor
+ */
+static void MMA8451Q_FifoComplete(i2c_transfer_t *completed)
+{
+	mma8451q_fifo_batch_t *batch = (mma8451q_fifo_batch_t *)completed->context;
+
+	if (completed->status != I2C_STATUS_OK) {
+		mma8451q_fifo_stats.errors++;
+
+		/* the FIFO still holds the batch and INT2 stays asserted, no edge will ask again */
+		if (failures < MMA8451Q_FIFO_RETRIES) {
+			failures++;
+			mma8451q_fifo_stats.retries++;
+			MMA8451Q_FifoDrain();
+		}
+		else {
+			failures = 0;
+			mma8451q_fifo_stats.abandoned++;
+		}
+		return;
+	}
+	failures = 0;
+
+	/* apply fix for endianness and correct the 14bit layout, as for a single sample */
+	const bool swap = endianCorrectionRequired(FROM_BIG_ENDIAN);
+	for (int i = 0; i < batchSize; ++i) {
+		for (int axis = 0; axis < 3; ++axis) {
+			int16_t value = batch->samples[i][axis];
+			if (swap) {
+				value = ENDIANSWAP_16(value);
+			}
+			batch->samples[i][axis] = value >> 2;
+		}
+	}
+
+	batch->count = batchSize;
+	batch->sequence = ++sequence;
+
+	mma8451q_fifo_stats.batches++;
+	mma8451q_fifo_stats.samples += batchSize;
+	if (MMA8451Q_F_STATUS_OVF(batch->status)) {
+		mma8451q_fifo_stats.overflows++;
+	}
+
+	if (tap != 0) {
+		tap((const int16_t (*)[3])batch->samples, batchSize);
+	}
+
+	newest = batch;
+	filling ^= 1;
+	Scheduler_PostOnce(EVENT_SAMPLES, batch->sequence);
+
+	/* a whole further batch was already waiting: it will not raise a new edge, so fetch it now */
+	if (MMA8451Q_F_STATUS_CNT(batch->status) >= 2 * batchSize) {
+		MMA8451Q_FifoDrain();
+	}
+}
+
+/**
+ * @brief Hands every completed batch to a tap as well
+ */
+void MMA8451Q_FifoSetTap(mma8451q_tap_t sink)
+{
+	tap = sink;
+}
+
+/**
+ * @brief Fetches the newest completed batch not taken before
+ */
+const mma8451q_fifo_batch_t *MMA8451Q_FifoTake()
+{
+	mma8451q_fifo_batch_t *batch = newest;
+
+	if ((batch == 0) || (batch->sequence == taken)) {
+		return 0;
+	}
+
+	taken = batch->sequence;
+	return batch;
+}
@@ -0,0 +1,108 @@
+/*
+ * mma8451q_fifo.h
+ *
+ *  Created on: Dec 16, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Header file for batch acquisition from the MMA8451Q hardware FIFO.
+ *
+ *      		The FIFO raises its watermark interrupt on INT2 (PTA15) once it holds
+ *      		{@see MMA8451Q_FIFO_WATERMARK} samples. PORTA_IRQHandler then calls
+ *      		{@see MMA8451Q_FifoDrain}, which queues a single burst read on the interrupt
+ *      		driven I2C engine: F_STATUS followed by watermark x 6 bytes. While the FIFO is
+ *      		enabled the auto-increment wraps from OUT_Z_LSB back to OUT_X_MSB, so the whole
+ *      		batch comes out of one transaction, moved by DMA. Reading F_STATUS first clears
+ *      		the FIFO interrupt and reports overflows.
+ *
+ *      		Batches are double buffered. A consumer fetches the newest completed one with
+ *      		{@see MMA8451Q_FifoTake} and must be done with it within one watermark period,
+ *      		after which the buffer is filled again.
+ *
+ *    Sources of Reference :
+ * 		1) https://www.nxp.com/docs/en/data-sheet/MMA8451Q.pdf (F_STATUS, F_SETUP, auto-increment)
+ * 		2) https://www.nxp.com/docs/en/application-note/AN4073.pdf (Using the 32 Sample First In First Out (FIFO) in the MMA8451Q)
+ */
+
+#ifndef MMA8451Q_FIFO_H_
+#define MMA8451Q_FIFO_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "mma8451q.h"
+
+/**
+ * @brief FIFO buffer mode used by InitMMA8451Q
+ */
+#define MMA8451Q_FIFO_MODE			MMA8451Q_FIFOMODE_CIRCULAR
+
+/**
+ * @brief Samples per batch, 1 to {@see MMA8451Q_FIFO_DEPTH}. At 800 Hz, 16 samples make a batch every 20 ms.
+ */
+#define MMA8451Q_FIFO_WATERMARK		(16)
+
+/**
+ * @brief Failed bursts in a row that are re-issued. The undrained FIFO holds INT2 asserted and raises
+ * 		  no further edge, so a burst given up on stops the acquisition until {@see MMA8451Q_FifoDrain}
+ * 		  is called otherwise.
+ */
+#define MMA8451Q_FIFO_RETRIES		(3)
+
+/**
+ * @brief One burst of FIFO samples
+ */
+typedef struct {
+	uint8_t :8;										/*< padding byte, aligns the samples */
+	uint8_t status;									/*< F_STATUS when the burst started */
+	int16_t samples[MMA8451Q_FIFO_DEPTH][3];		/*< X/Y/Z samples, oldest first, converted like {@see MMA8451Q_FinishReadAcceleration14bit} */
+	uint8_t count;									/*< valid entries in samples */
+	uint32_t sequence;								/*< running batch number, starts at 1 */
+	uint64_t timestamp;								/*< {@see timestamp_us} when the burst was queued, about the newest sample's time */
+} mma8451q_fifo_batch_t;
+
+/**
+ * @brief Acquisition counters
+ */
+typedef struct {
+	uint32_t batches;			/*< completed bursts */
+	uint32_t samples;			/*< samples delivered */
+	uint32_t overflows;			/*< bursts whose F_STATUS reported an overflow */
+	uint32_t errors;			/*< bursts that failed on the bus */
+	uint32_t retries;			/*< failed bursts re-issued */
+	uint32_t abandoned;			/*< failed bursts given up on after {@see MMA8451Q_FIFO_RETRIES} retries */
+} mma8451q_fifo_stats_t;
+
+/**
+ * @brief The acquisition counters
+ */
+extern volatile mma8451q_fifo_stats_t mma8451q_fifo_stats;
+
+/**
+ * @brief Resets the batch buffers and counters and sets the batch size.
+ * 		  Call before the FIFO interrupt is enabled.
+ * @param[in] watermark Samples per burst; must match the watermark programmed in F_SETUP
+ */
+void MMA8451Q_FifoStart(uint8_t watermark);
+
+/**
+ * @brief Queues the burst read of one batch; call from the INT2 edge interrupt.
+ * 		  Waits for a previous burst of this module to finish first.
+ *
+ * @param: None
+ * @return: None
+ */
+void MMA8451Q_FifoDrain();
+
+/**
+ * @brief Hands every completed batch to a tap as well, before EVENT_SAMPLES is posted;
+ * 		  the tap runs in the I2C or DMA interrupt and sees batches {@see MMA8451Q_FifoTake} skips
+ * @param[in] tap The tap, NULL for none
+ */
+void MMA8451Q_FifoSetTap(mma8451q_tap_t tap);
+
+/**
+ * @brief Fetches the newest completed batch not taken before
+ * @return The batch, or NULL if there is none
+ */
+const mma8451q_fifo_batch_t *MMA8451Q_FifoTake();
+
+#endif /* MMA8451Q_FIFO_H_ */
@@ -0,0 +1,297 @@
+/*
+ * mma8451q_profile.c
+ *
+ *  Created on: Dec 31, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: The MMA8451Q profile kept in flash, and the calibration of the offsets.
+ *
+ *    Sources of Reference :
+ * 		1) https://www.nxp.com/docs/en/data-sheet/MMA8451Q.pdf
+ * 		2) https://www.nxp.com/docs/en/application-note/AN4069.pdf (Offset Calibration)
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "MKL25Z4.h"
+#include "assert.h"
+#include "mma8451q_profile.h"
+#include "mma8451q_fifo.h"
+#include "init_sensors.h"
+#include "nvm.h"
+#include "crc16.h"
+#include "global_defs.h"
+
+/**
+ * @brief What the configuration goes with besides itself: the acquisition, and the batch size of a FIFO
+ */
+#if MMA8451Q_ACQUISITION == MMA8451Q_ACQUIRE_FIFO
+#define PROFILE_BUILD			((MMA8451Q_ACQUISITION << 8) | MMA8451Q_FIFO_WATERMARK)
+#else
+#define PROFILE_BUILD			(MMA8451Q_ACQUISITION << 8)
+#endif
+
+#define SLOTS_PER_SECTOR		(NVM_SECTOR_SIZE / MMA8451Q_PROFILE_RECORD_SIZE)
+
+#define CTRL_REG1_ACTIVE_MASK	(0x01u)
+#define XYZ_DATA_CFG_FS_MASK	(0x03u)
+
+/* the configuration fits a record */
+typedef char profile_fits[(MMA8451Q_PROFILE_HEADER_SIZE + sizeof(mma8451q_confreg_t) <= MMA8451Q_PROFILE_RECORD_SIZE) ? 1 : -1];
+
+/**
+ * @brief Where a calibration stands
+ */
+typedef enum {
+	CALIBRATE_IDLE = 0,		/*< none under way */
+	CALIBRATE_AVERAGING,	/*< the tap sums the samples */
+	CALIBRATE_AVERAGED		/*< the samples are in, the main loop takes over */
+} calibrate_state_t;
+
+/**
+ * @brief The counters
+ */
+mma8451q_profile_stats_t mma8451q_profile_stats;
+
+/**
+ * @brief Where the calibration stands; the tap moves it from averaging to averaged only
+ */
+static volatile calibrate_state_t state = CALIBRATE_IDLE;
+
+/**
+ * @brief Per axis sum, lowest and highest of the samples of the calibration, and their number
+ */
+static int32_t sums[3];
+static int16_t lowest[3], highest[3];
+static uint32_t count;
+
+/**
+ * @brief Flash address of a slot
+ */
+static inline uint32_t slot_address(uint8_t index)
+{
+	return NVM_PROFILE_BASE + (uint32_t)index * MMA8451Q_PROFILE_RECORD_SIZE;
+}
+
+/**
+ * @brief Divides, rounding half away from zero
+ */
+static inline int32_t divide_rounded(int32_t dividend, int32_t divisor)
+{
+	return (dividend + ((dividend < 0) ? -divisor / 2 : divisor / 2)) / divisor;
+}
+
+/**
+ * @brief CRC of a record: the header up to the CRC, then the configuration
+ */
+static uint16_t MMA8451Q_ProfileCrc(const uint8_t *record)
+{
+	const uint16_t crc = CRC16_Compute(record, MMA8451Q_PROFILE_CRC_OFFSET);
+	return CRC16_Update(crc, record + MMA8451Q_PROFILE_HEADER_SIZE, sizeof(mma8451q_confreg_t));
+}
+
+/**
+ * @brief The slot holds a whole record of this layout and acquisition
+ * @return Its header, or NULL
+ */
+static const mma8451q_profile_header_t *MMA8451Q_ProfileRead(uint8_t index)
+{
+	const uint8_t *record = Nvm_Map(slot_address(index));
+	const mma8451q_profile_header_t *header = (const mma8451q_profile_header_t *)record;
+
+	if ((header->magic != MMA8451Q_PROFILE_MAGIC) || (header->version != MMA8451Q_PROFILE_VERSION)
+			|| (header->build != PROFILE_BUILD) || (header->size != sizeof(mma8451q_confreg_t))) {
+		return 0;
+	}
+	return (MMA8451Q_ProfileCrc(record) == header->crc) ? header : 0;
+}
+
+/**
+ * @brief The newest record
+ * @return Its slot, or -1 if there is none
+ */
+static int MMA8451Q_ProfileNewest()
+{
+	const mma8451q_profile_header_t *newest = 0;
+	int slot = -1;
+
+	for (uint8_t index = 0; index < MMA8451Q_PROFILE_SLOTS; ++index) {
+		const mma8451q_profile_header_t *header = MMA8451Q_ProfileRead(index);
+		if ((header != 0) && ((newest == 0) || ((int32_t)(header->sequence - newest->sequence) > 0))) {
+			newest = header;
+			slot = index;
+		}
+	}
+	return slot;
+}
+
+/**
+ * @brief The bytes from the slot on are erased
+ */
+static bool MMA8451Q_ProfileBlank(uint8_t index, uint32_t length)
+{
+	const uint32_t *words = (const uint32_t *)Nvm_Map(slot_address(index));
+
+	for (uint32_t i = 0; i < length / sizeof(uint32_t); ++i) {
+		if (words[i] != 0xFFFFFFFFu) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Finds the newest profile
+ */
+bool MMA8451Q_ProfileLoad(mma8451q_confreg_t *const configuration)
+{
+	assert(configuration != 0x0);
+
+	/* records of another layout or acquisition, or torn, are counted and passed over */
+	for (uint8_t index = 0; index < MMA8451Q_PROFILE_SLOTS; ++index) {
+		const uint32_t magic = ((const mma8451q_profile_header_t *)Nvm_Map(slot_address(index)))->magic;
+		if ((magic == MMA8451Q_PROFILE_MAGIC) && (MMA8451Q_ProfileRead(index) == 0)) {
+			mma8451q_profile_stats.rejected++;
+		}
+	}
+
+	const int slot = MMA8451Q_ProfileNewest();
+	if (slot < 0) {
+		return false;
+	}
+	memcpy(configuration, Nvm_Map(slot_address(slot)) + MMA8451Q_PROFILE_HEADER_SIZE, sizeof(*configuration));
+	mma8451q_profile_stats.loads++;
+	return true;
+}
+
+/**
+ * @brief Writes the configuration into the slot after the newest
+ */
+bool MMA8451Q_ProfileSave(const mma8451q_confreg_t *const configuration)
+{
+	uint32_t image[MMA8451Q_PROFILE_RECORD_SIZE / sizeof(uint32_t)];
+	mma8451q_profile_header_t *header = (mma8451q_profile_header_t *)image;
+	uint8_t *record = (uint8_t *)image;
+
+	assert(configuration != 0x0);
+
+	const int newest = MMA8451Q_ProfileNewest();
+
+	memset(image, 0xFF, sizeof(image));
+	header->magic = MMA8451Q_PROFILE_MAGIC;
+	header->sequence = (newest >= 0) ? ((const mma8451q_profile_header_t *)Nvm_Map(slot_address(newest)))->sequence + 1 : 1;
+	header->version = MMA8451Q_PROFILE_VERSION;
+	header->build = PROFILE_BUILD;
+	header->size = sizeof(mma8451q_confreg_t);
+	memcpy(record + MMA8451Q_PROFILE_HEADER_SIZE, configuration, sizeof(*configuration));
+	record[MMA8451Q_PROFILE_HEADER_SIZE + offsetof(mma8451q_confreg_t, CTRL_REG1)] &= ~CTRL_REG1_ACTIVE_MASK;
+	header->crc = MMA8451Q_ProfileCrc(record);
+
+	/* the first erased slot after the newest; a sector is erased as the records enter it,
+	 * which never takes the newest, and slots of a torn write are passed over */
+	uint8_t slot = (uint8_t)((newest + 1) % MMA8451Q_PROFILE_SLOTS);
+	for (uint8_t tried = 0; ; ++tried) {
+		if (tried == MMA8451Q_PROFILE_SLOTS) {
+			mma8451q_profile_stats.errors++;
+			return false;
+		}
+		if ((slot % SLOTS_PER_SECTOR == 0) && !MMA8451Q_ProfileBlank(slot, NVM_SECTOR_SIZE)
+				&& !Nvm_Erase(slot_address(slot))) {
+			mma8451q_profile_stats.errors++;
+			return false;
+		}
+		if (MMA8451Q_ProfileBlank(slot, MMA8451Q_PROFILE_RECORD_SIZE)) {
+			break;
+		}
+		slot = (slot + 1) % MMA8451Q_PROFILE_SLOTS;
+	}
+
+	if (!Nvm_Program(slot_address(slot), image, MMA8451Q_PROFILE_RECORD_SIZE)) {
+		mma8451q_profile_stats.errors++;
+		return false;
+	}
+	mma8451q_profile_stats.saves++;
+	return true;
+}
+
+/**
+ * @brief Starts averaging
+ */
+void MMA8451Q_CalibrateStart()
+{
+	/* the tap leaves the sums alone while idle */
+	state = CALIBRATE_IDLE;
+	for (int axis = 0; axis < 3; ++axis) {
+		sums[axis] = 0;
+		lowest[axis] = INT16_MAX;
+		highest[axis] = INT16_MIN;
+	}
+	count = 0;
+	state = CALIBRATE_AVERAGING;
+
+	LOG("\r\n MMA8451Q: calibrating, keep the board still and level");
+}
+
+/**
+ * @brief Sums the samples
+ */
+void MMA8451Q_CalibrateRecord(const int16_t (*samples)[3], uint8_t samplesCount)
+{
+	for (uint8_t i = 0; (i < samplesCount) && (state == CALIBRATE_AVERAGING); ++i) {
+		for (int axis = 0; axis < 3; ++axis) {
+			const int16_t value = samples[i][axis];
+			sums[axis] += value;
+			lowest[axis] = (value < lowest[axis]) ? value : lowest[axis];
+			highest[axis] = (value > highest[axis]) ? value : highest[axis];
+		}
+		if (++count == MMA8451Q_CALIBRATE_SAMPLES) {
+			state = CALIBRATE_AVERAGED;
+		}
+	}
+}
+
+/**
+ * @brief Corrects the offsets from the averages and saves the profile
+ */
+void MMA8451Q_CalibratePoll()
+{
+	/* level and face up: 0 g, 0 g, +1 g */
+	static const int8_t level[3] = { 0, 0, 1 };
+	int32_t offsets[3];
+
+	if (state != CALIBRATE_AVERAGED) {
+		return;
+	}
+	state = CALIBRATE_IDLE;
+
+	/* 4096, 2048 or 1024 counts per g; an offset count is 2 mg whatever the range */
+	const int32_t countsPerG = 4096 >> (MMA8451Q_ReadRegister(MMA8451Q_REG_XYZ_DATA_CFG) & XYZ_DATA_CFG_FS_MASK);
+
+	for (int axis = 0; axis < 3; ++axis) {
+		const int32_t error = divide_rounded(sums[axis], MMA8451Q_CALIBRATE_SAMPLES) - level[axis] * countsPerG;
+
+		/* the samples already have the offsets of the device in them */
+		offsets[axis] = (int8_t)MMA8451Q_ReadRegister(MMA8451Q_REG_OFF_X + axis)
+						- divide_rounded(error * (1000 / MMA8451Q_OFFSET_MG), countsPerG);
+
+		if ((highest[axis] - lowest[axis] > MMA8451Q_CALIBRATE_STILL) || (offsets[axis] < INT8_MIN) || (offsets[axis] > INT8_MAX)) {
+			mma8451q_profile_stats.moved++;
+			LOG("\r\n MMA8451Q: calibration given up, the board moved or is not level");
+			return;
+		}
+	}
+
+	/* standby, the three registers in one burst, and back */
+	for (int axis = 0; axis < 3; ++axis) {
+		MMA8451Q_WriteRegister(MMA8451Q_REG_OFF_X + axis, (uint8_t)(int8_t)offsets[axis]);
+	}
+	MMA8451Q_Flush();
+	mma8451q_profile_stats.calibrations++;
+
+	mma8451q_confreg_t configuration;
+	MMA8451Q_FetchConfiguration(&configuration);
+	const bool saved = MMA8451Q_ProfileSave(&configuration);
+
+	LOG("\r\n MMA8451Q: offsets %ld %ld %ld (2 mg), profile %s", (long)offsets[0], (long)offsets[1], (long)offsets[2],
+			saved ? "saved" : "not saved");
+}
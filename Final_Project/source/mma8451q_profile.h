@@ -0,0 +1,145 @@
+/*
+ * mma8451q_profile.h
+ *
+ *  Created on: Dec 31, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Header file for the MMA8451Q profile: the whole configuration, offsets included,
+ *      		kept in flash and applied at start-up, and the calibration of the offsets.
+ *
+ *      		A calibration started by {@see MMA8451Q_CalibrateStart} averages the next
+ *      		{@see MMA8451Q_CALIBRATE_SAMPLES} samples the acquisition hands to
+ *      		{@see MMA8451Q_CalibrateRecord}. The board must lie still and level, face up:
+ *      		{@see MMA8451Q_CalibratePoll} then corrects OFF_X, OFF_Y and OFF_Z by the distance
+ *      		of the means from 0 g, 0 g and +1 g, writes them to the device and saves the
+ *      		configuration as a new profile. The device subtracts the offsets from every sample
+ *      		itself, nothing is corrected in software.
+ *
+ *      		{@see InitMMA8451Q} applies the newest profile right after the reset of the device,
+ *      		in one store of the registers differing from their reset values and without
+ *      		reading the configuration first, instead of building it call by call. A profile
+ *      		built for another acquisition, or of another layout, is not applied.
+ *
+ *      		Each profile is a record of {@see MMA8451Q_PROFILE_RECORD_SIZE} bytes in the
+ *      		sectors of nvm.h, written in turn; the sector ahead is erased when the records
+ *      		reach it, so the newest record is always kept. A record, all fields little-endian:
+ *
+ *      			offset	size	field
+ *      			0		4		{@see MMA8451Q_PROFILE_MAGIC}
+ *      			4		4		number of the profile, counting up from 1
+ *      			8		2		{@see MMA8451Q_PROFILE_VERSION}
+ *      			10		2		the acquisition it was built for
+ *      			12		2		size of {@see mma8451q_confreg_t} n
+ *      			14		2		CRC-16/CCITT-FALSE of bytes 0 - 13 and the configuration
+ *      			16		n		the {@see mma8451q_confreg_t}, ACTIVE clear
+ *
+ *    Sources of Reference :
+ * 		1) https://www.nxp.com/docs/en/data-sheet/MMA8451Q.pdf
+ * 		2) https://www.nxp.com/docs/en/application-note/AN4069.pdf (Offset Calibration)
+ */
+
+#ifndef MMA8451Q_PROFILE_H_
+#define MMA8451Q_PROFILE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mma8451q.h"
+#include "nvm.h"
+
+/**
+ * @brief Records of the profiles: size, and how many the sectors take
+ */
+#define MMA8451Q_PROFILE_RECORD_SIZE	(64)
+#define MMA8451Q_PROFILE_SLOTS			(NVM_PROFILE_SECTORS * NVM_SECTOR_SIZE / MMA8451Q_PROFILE_RECORD_SIZE)
+
+#define MMA8451Q_PROFILE_MAGIC			(0x3146504D)	/*< "MPF1" */
+#define MMA8451Q_PROFILE_VERSION		(1)
+#define MMA8451Q_PROFILE_HEADER_SIZE	(16)
+#define MMA8451Q_PROFILE_CRC_OFFSET		(14)
+
+/**
+ * @brief Samples a calibration averages; 320 ms at 800 Hz
+ */
+#define MMA8451Q_CALIBRATE_SAMPLES		(256)
+
+/**
+ * @brief Spread of an axis over the calibration above which the board counts as moving, in counts;
+ * 		  about 16 mg at 2 g full scale
+ */
+#define MMA8451Q_CALIBRATE_STILL		(64)
+
+/**
+ * @brief OFF_X/Y/Z resolution, milli-g per count whatever the full scale
+ */
+#define MMA8451Q_OFFSET_MG				(2)
+
+/**
+ * @brief The header of a record, see the layout above
+ */
+typedef struct {
+	uint32_t magic;
+	uint32_t sequence;
+	uint16_t version;
+	uint16_t build;
+	uint16_t size;
+	uint16_t crc;
+} mma8451q_profile_header_t;
+
+/**
+ * @brief Counters
+ */
+typedef struct {
+	uint32_t loads;				/*< profiles found at start-up */
+	uint32_t rejected;			/*< records of a corrupt, other layout or other acquisition */
+	uint32_t saves;				/*< profiles written */
+	uint32_t errors;			/*< profiles not written on a failed flash command */
+	uint32_t calibrations;		/*< calibrations applied */
+	uint32_t moved;				/*< calibrations given up, the board moved or was not level */
+} mma8451q_profile_stats_t;
+
+/**
+ * @brief The counters
+ */
+extern mma8451q_profile_stats_t mma8451q_profile_stats;
+
+/**
+ * @brief Finds the newest profile of this acquisition. Call after {@see Nvm_Init}.
+ * @param[out] configuration The configuration it holds; Must not be null.
+ * @return false if there is none, the configuration is untouched then
+ */
+bool MMA8451Q_ProfileLoad(mma8451q_confreg_t *const configuration);
+
+/**
+ * @brief Writes a configuration as the newest profile, the ACTIVE bit cleared; stalls for a program
+ * 		  command, and for an erase when the records reach the next sector
+ * @param[in] configuration The configuration; Must not be null.
+ * @return true if the profile was written
+ */
+bool MMA8451Q_ProfileSave(const mma8451q_confreg_t *const configuration);
+
+/**
+ * @brief Starts averaging the next samples; the board must lie still and level, face up
+ *
+ * @param: None
+ * @return: None
+ */
+void MMA8451Q_CalibrateStart();
+
+/**
+ * @brief Adds samples to a calibration under way; a tap of the acquisition, runs in its interrupt
+ * @param[in] samples X/Y/Z samples, oldest first
+ * @param[in] count Their number
+ */
+void MMA8451Q_CalibrateRecord(const int16_t (*samples)[3], uint8_t count);
+
+/**
+ * @brief Once the samples of a calibration are in: corrects the offsets, writes them to the device
+ * 		  and saves the profile. Call from the main loop whenever samples landed.
+ *
+ * @param: None
+ * @return: None
+ */
+void MMA8451Q_CalibratePoll();
+
+#endif /* MMA8451Q_PROFILE_H_ */
@@ -0,0 +1,129 @@
+/*
+ * nvm.c
+ *
+ *  Created on: Dec 30, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: The flash kept by the firmware across resets, on the SDK's fsl_flash.
+ *
+ *    Sources of Reference :
+ * 		KL25 Sub-Family Reference Manual, Chapter 27 (Flash Memory Module)
+ * 		MCUXpresso SDK drivers/fsl_flash.h
+ */
+
+#include <string.h>
+#include "fsl_flash.h"
+#include "nvm.h"
+#include "power.h"
+
+/**
+ * @brief The command counters
+ */
+nvm_stats_t nvm_stats;
+
+/**
+ * @brief The driver's view of the flash
+ */
+static flash_config_t config;
+
+/**
+ * @brief fsl_flash is set up
+ */
+static bool ready;
+
+/**
+ * @brief A program command for {@see Power_Stall}
+ */
+typedef struct {
+	uint32_t address;
+	const uint32_t *data;
+	uint32_t length;
+} nvm_program_t;
+
+/**
+ * @brief The range lies in the region
+ */
+static bool Nvm_Inside(uint32_t address, uint32_t length)
+{
+	return (address >= NVM_BASE) && (length <= NVM_SIZE) && (address - NVM_BASE <= NVM_SIZE - length);
+}
+
+/**
+ * @brief Erases the sector at *context
+ */
+static int32_t Nvm_EraseCommand(void *context)
+{
+	return FLASH_Erase(&config, *(uint32_t *)context, NVM_SECTOR_SIZE, kFLASH_ApiEraseKey);
+}
+
+/**
+ * @brief Programs the nvm_program_t at context
+ */
+static int32_t Nvm_ProgramCommand(void *context)
+{
+	const nvm_program_t *program = (const nvm_program_t *)context;
+
+	return FLASH_Program(&config, program->address, (uint32_t *)program->data, program->length);
+}
+
+/**
+ * @brief Sets up fsl_flash, once
+ */
+bool Nvm_Init()
+{
+	if (ready) {
+		return true;
+	}
+	memset(&nvm_stats, 0, sizeof(nvm_stats));
+	memset(&config, 0, sizeof(config));
+
+	ready = (FLASH_Init(&config) == kStatus_FLASH_Success);
+	return ready;
+}
+
+/**
+ * @brief Erases one sector of the region
+ */
+bool Nvm_Erase(uint32_t address)
+{
+	if (!Nvm_Inside(address, NVM_SECTOR_SIZE) || (address % NVM_SECTOR_SIZE != 0)) {
+		nvm_stats.errors++;
+		return false;
+	}
+
+	if (Power_Stall(Nvm_EraseCommand, &address) != kStatus_FLASH_Success) {
+		nvm_stats.errors++;
+		return false;
+	}
+	nvm_stats.erases++;
+	return true;
+}
+
+/**
+ * @brief Programs erased flash of the region
+ */
+bool Nvm_Program(uint32_t address, const uint32_t *data, uint32_t length)
+{
+	nvm_program_t program = { .address = address, .data = data, .length = length };
+
+	if (!Nvm_Inside(address, length) || (address % NVM_WRITE_SIZE != 0) || (length % NVM_WRITE_SIZE != 0)) {
+		nvm_stats.errors++;
+		return false;
+	}
+
+	if (Power_Stall(Nvm_ProgramCommand, &program) != kStatus_FLASH_Success) {
+		nvm_stats.errors++;
+		return false;
+	}
+	nvm_stats.programs++;
+	nvm_stats.bytes += length;
+	return true;
+}
+
+/**
+ * @brief The flash is mapped at its own addresses
+ */
+const uint8_t *Nvm_Map(uint32_t address)
+{
+	return (const uint8_t *)address;
+}
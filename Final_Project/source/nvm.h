@@ -0,0 +1,119 @@
+/*
+ * nvm.h
+ *
+ *  Created on: Dec 30, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Header file for the flash kept by the firmware across resets.
+ *
+ *      		The top 16 KB of the P-flash are left out of PROGRAM_FLASH by the linker
+ *      		script (the NVM region of the memory configuration) and written here through
+ *      		the SDK's fsl_flash. A sector is erased to all ones as a whole; programming
+ *      		only clears bits, a longword at a time.
+ *
+ *      		The KL25 has a single flash block, which cannot be read while it erases or
+ *      		programs: the core stalls on any fetch from it, the vector table included.
+ *      		Every command therefore runs with the interrupts masked through
+ *      		{@see Power_Stall}, which keeps the tick on time. An erase takes 14 ms
+ *      		(114 ms at most), a longword 65 us (145 us), so callers program in small
+ *      		pieces and erase ahead of need.
+ *
+ *      		The region is shared out here:
+ *
+ *      			sectors	use
+ *      			0 - 11	the black box of blackbox.h, a recorded event per sector
+ *      			12 - 15	the sensor profiles of mma8451q_profile.h, 16 records per sector
+ *
+ *    Sources of Reference :
+ * 		KL25 Sub-Family Reference Manual, Chapter 27 (Flash Memory Module)
+ * 		KL25 Sub-Family Data Sheet, Table 21 (Flash command timing)
+ * 		MCUXpresso SDK drivers/fsl_flash.h
+ */
+
+#ifndef NVM_H_
+#define NVM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief The region, as in the memory configuration
+ */
+#define NVM_BASE				(0x1C000)
+#define NVM_SIZE				(0x4000)
+
+/**
+ * @brief Erase unit and program unit of the P-flash
+ */
+#define NVM_SECTOR_SIZE			(1024)
+#define NVM_WRITE_SIZE			(4)
+
+/**
+ * @brief Worst case command times of the data sheet, the stall a caller must be ready for
+ */
+#define NVM_ERASE_MAX_US		(114000)
+#define NVM_PROGRAM_MAX_US		(145)	/*< per longword */
+
+/**
+ * @brief The sectors of the black box
+ */
+#define NVM_BLACKBOX_BASE		(NVM_BASE)
+#define NVM_BLACKBOX_SECTORS	(12)
+
+/**
+ * @brief The sectors of the sensor profiles
+ */
+#define NVM_PROFILE_BASE		(NVM_BLACKBOX_BASE + NVM_BLACKBOX_SECTORS * NVM_SECTOR_SIZE)
+#define NVM_PROFILE_SECTORS		(4)
+
+#if NVM_PROFILE_BASE + NVM_PROFILE_SECTORS * NVM_SECTOR_SIZE > NVM_BASE + NVM_SIZE
+#error "The partitions of the flash region overrun it"
+#endif
+
+/**
+ * @brief Command counters
+ */
+typedef struct {
+	uint32_t erases;			/*< sectors erased */
+	uint32_t programs;			/*< program commands */
+	uint32_t bytes;				/*< bytes programmed */
+	uint32_t errors;			/*< commands fsl_flash refused or the module failed */
+} nvm_stats_t;
+
+/**
+ * @brief The command counters
+ */
+extern nvm_stats_t nvm_stats;
+
+/**
+ * @brief Sets up fsl_flash once; every user of the region calls it first
+ *
+ * @param: None
+ * @return: true if the flash driver is ready
+ */
+bool Nvm_Init();
+
+/**
+ * @brief Erases one sector of the region, stalling the core for it
+ * @param[in] address Start of the sector
+ * @return true on success
+ */
+bool Nvm_Erase(uint32_t address);
+
+/**
+ * @brief Programs erased flash of the region, stalling the core for it
+ * @param[in] address Where, a multiple of {@see NVM_WRITE_SIZE}
+ * @param[in] data The longwords
+ * @param[in] length Bytes, a multiple of {@see NVM_WRITE_SIZE}
+ * @return true on success
+ */
+bool Nvm_Program(uint32_t address, const uint32_t *data, uint32_t length);
+
+/**
+ * @brief Where the contents of the region are read
+ * @param[in] address A flash address of the region
+ * @return The memory behind it
+ */
+const uint8_t *Nvm_Map(uint32_t address);
+
+#endif /* NVM_H_ */
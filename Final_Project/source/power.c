@@ -0,0 +1,212 @@
+/*
+ * power.c
+ *
+ *  Created on: Dec 29, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Tickless low power idle of the scheduler.
+ *
+ *    Sources of Reference :
+ * 		KL25 Sub-Family Reference Manual, Chapter 7 (Power Management), 15 (System Mode Controller)
+ * 		NXP AN4503, Power Management for Kinetis MCUs
+ * 		MCUXpresso SDK drivers/fsl_smc.c
+ */
+
+#include <string.h>
+#include "MKL25Z4.h"
+#include "fsl_smc.h"
+#include "power.h"
+#include "lptmr.h"
+#include "systick.h"
+#include "delay.h"
+#include "i2c_hal.h"
+#include "led.h"
+#include "uart.h"
+#include "global_defs.h"
+
+/**
+ * @brief The figures
+ */
+power_stats_t power_stats;
+
+/**
+ * @brief Printable mode names, indexed by {@see power_mode_t}
+ */
+static const char *const mode_names[POWER_MODE_COUNT] = { "run", "wait", "vlps" };
+
+/**
+ * @brief {@see timestamp_us} when the figures were cleared
+ */
+static uint64_t since;
+
+/**
+ * @brief VLPS is allowed
+ */
+static bool stop_allowed = true;
+
+/**
+ * @brief LPTMR counts times the tick rate not yet a whole tick, carried to the next time SysTick stands still
+ */
+static uint32_t tick_carry;
+
+/**
+ * @brief Allows VLPS and sets up its wake up timer
+ */
+void Power_Init()
+{
+	SMC_SetPowerModeProtection(SMC, kSMC_AllowPowerModeVlp);
+	LPTMR_Init();
+	Power_Reset();
+}
+
+/**
+ * @brief Allows or forbids VLPS
+ */
+void Power_AllowStop(bool allow)
+{
+	stop_allowed = allow;
+}
+
+/**
+ * @brief Nothing would notice the bus clock stop
+ */
+static bool Power_CanStop(void)
+{
+	return stop_allowed && I2C_HalIdle()
+			&& Q_Empty(&TxQ) && (UART0->S1 & UART0_S1_TC_MASK)
+			&& (RED_PWM == 0) && (GREEN_PWM == 0) && (BLUE_PWM == 0);
+}
+
+/**
+ * @brief WAIT, the sleep of {@see SysTick_SleepUntil}
+ */
+static void Power_Wait(void)
+{
+	(void)SMC_SetPowerModeWait(SMC);
+}
+
+/**
+ * @brief Counts the LPTMR counts SysTick stood still as ticks, carrying the rest
+ * @return The ticks
+ */
+static uint32_t Power_CountStill(uint32_t counts)
+{
+	const uint32_t scaled = counts * SYTICK_TIME_FREQ + tick_carry;
+	const uint32_t ticks = scaled / LPTMR_CLOCK_HZ;
+	tick_carry = scaled - ticks * LPTMR_CLOCK_HZ;
+	SysTick_Skip(ticks);
+	return ticks;
+}
+
+/**
+ * @brief VLPS until the LPTMR ran out or another interrupt came
+ * @param[in] ms Milliseconds to the deadline, at least 2
+ */
+static void Power_Stop(uint32_t ms)
+{
+	// wake a millisecond early, the tick takes it from there
+	uint32_t counts = ((ms - 1) * LPTMR_CLOCK_HZ) / 1000u;
+	counts = (counts < LPTMR_MAX_COUNTS) ? counts : LPTMR_MAX_COUNTS;
+
+	SMC_PreEnterStopModes();
+	LPTMR_Start(counts);
+	if (SMC_SetPowerModeVlps(SMC) != kStatus_Success) {
+		power_stats.aborted++;
+	}
+	// a plain WFI after this must not stop the clocks again
+	SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+
+	// SysTick stood still: count the ticks passed in LPTMR counts, before any handler reads the time
+	power_stats.skipped += Power_CountStill(LPTMR_Stop());
+
+	SMC_PostExitStopModes();
+	__disable_irq();
+}
+
+/**
+ * @brief Runs a flash command with SysTick stopped and counts the ticks it took
+ */
+int32_t Power_Stall(int32_t (*command)(void *context), void *context)
+{
+	uint32_t masking_state = __get_PRIMASK();
+	__disable_irq();
+
+	// the counter holds its place in the tick, a reload would be lost in the pending bit
+	SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+	LPTMR_Start(LPTMR_MAX_COUNTS);
+
+	const int32_t status = command(context);
+
+	const uint32_t counts = LPTMR_Stop();
+	SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+	power_stats.stalled += Power_CountStill(counts);
+	power_stats.stalls++;
+
+	__set_PRIMASK(masking_state);
+	return status;
+}
+
+/**
+ * @brief Sleeps until a deadline or the next interrupt
+ */
+void Power_Idle(uint32_t deadline)
+{
+	const int32_t ms = (int32_t)(deadline - systemTime());
+	const uint64_t start = timestamp_us();
+	power_mode_t mode = POWER_WAIT;
+
+	if (ms >= POWER_VLPS_MIN_MS) {
+		if (Power_CanStop()) {
+			mode = POWER_VLPS;
+		}
+		else {
+			power_stats.vetoed++;
+		}
+	}
+
+	if (mode == POWER_VLPS) {
+		Power_Stop((uint32_t)ms);
+	}
+	else {
+		power_stats.suppressed += SysTick_SleepUntil(deadline, Power_Wait);
+	}
+
+	power_stats.modes[mode].entries++;
+	power_stats.modes[mode].microseconds += timestamp_us() - start;
+	power_stats.modes[POWER_RUN].entries++;
+}
+
+/**
+ * @brief Clears the figures
+ */
+void Power_Reset()
+{
+	memset(&power_stats, 0, sizeof(power_stats));
+	since = timestamp_us();
+}
+
+/**
+ * @brief Logs the entries and time of each mode
+ */
+void Power_Dump()
+{
+	const uint64_t total = timestamp_us() - since;
+	const uint64_t asleep = power_stats.modes[POWER_WAIT].microseconds + power_stats.modes[POWER_VLPS].microseconds;
+
+	power_stats.modes[POWER_RUN].microseconds = (total > asleep) ? total - asleep : 0;
+
+	LOG("\r\n Power: %lu ms, %lu ticks suppressed, %lu skipped, %lu vlps vetoed, %lu aborted",
+			(unsigned long)(total / 1000), (unsigned long)power_stats.suppressed, (unsigned long)power_stats.skipped,
+			(unsigned long)power_stats.vetoed, (unsigned long)power_stats.aborted);
+	LOG("\r\n   %lu flash stalls, %lu ticks counted after them",
+			(unsigned long)power_stats.stalls, (unsigned long)power_stats.stalled);
+	LOG("\r\n   mode     entries        ms      %%");
+
+	for (int mode = 0; mode < POWER_MODE_COUNT; ++mode) {
+		const power_mode_stats_t *stats = &power_stats.modes[mode];
+		const uint32_t share = total ? (uint32_t)((10000 * stats->microseconds) / total) : 0;
+
+		LOG("\r\n   %-6s %9lu %9lu %3lu.%02lu", mode_names[mode], (unsigned long)stats->entries,
+				(unsigned long)(stats->microseconds / 1000), (unsigned long)(share / 100), (unsigned long)(share % 100));
+	}
+}
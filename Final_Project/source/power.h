@@ -0,0 +1,135 @@
+/*
+ * power.h
+ *
+ *  Created on: Dec 29, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Header file for the tickless low power idle of the scheduler.
+ *
+ *      		With the queue empty the scheduler calls {@see Power_Idle} with the time
+ *      		the next software timer is due. Nothing in the firmware runs on the tick
+ *      		until then: every other wake up is an interrupt (the MMA8451Q on INT1 or
+ *      		INT2, UART0, I2C0, DMA), so the core sleeps through it in one of two modes.
+ *
+ *      		- WAIT: the core clock stops, the peripherals run on. SysTick is stretched
+ *      		  by {@see SysTick_SleepUntil} to end at the deadline, so the 4 kHz tick
+ *      		  interrupts in between are not taken.
+ *      		- VLPS: the bus clock stops as well, SysTick with it, and the low power
+ *      		  timer of lptmr.c wakes the core a millisecond ahead of the deadline;
+ *      		  the ticks slept through are counted from it by {@see SysTick_Skip}.
+ *      		  PTA14 and PTA15 wake the core asynchronously. Chosen only when the
+ *      		  deadline is at least {@see POWER_VLPS_MIN_MS} away and nothing would
+ *      		  notice the stopped clock: no I2C transfer, nothing left in TxQ or the
+ *      		  UART0 shifter and the PWM of the LEDs dark. A character arriving on
+ *      		  UART0 in VLPS does not wake the core and is lost, {@see Power_AllowStop}
+ *      		  keeps the idle in WAIT while the console is in use.
+ *
+ *      		A flash command stalls the core with the interrupts masked, the flash being
+ *      		unreadable meanwhile. {@see Power_Stall} stops SysTick for it and counts the
+ *      		ticks it took from the same LPTMR, so the clock of systick.c stays on time.
+ *
+ *      		{@see Power_Dump} tells the time spent in RUN, WAIT and VLPS.
+ *
+ *    Sources of Reference :
+ * 		KL25 Sub-Family Reference Manual, Chapter 7 (Power Management), 15 (System Mode Controller)
+ * 		NXP AN4503, Power Management for Kinetis MCUs
+ * 		MCUXpresso SDK drivers/fsl_smc.c
+ */
+
+#ifndef POWER_H_
+#define POWER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Shortest idle in milliseconds that enters VLPS, shorter ones WAIT
+ */
+#define POWER_VLPS_MIN_MS		(5)
+
+/**
+ * @brief The power modes
+ */
+typedef enum {
+	POWER_RUN = 0,
+	POWER_WAIT,
+	POWER_VLPS,
+	POWER_MODE_COUNT
+} power_mode_t;
+
+/**
+ * @brief Figures of one mode
+ */
+typedef struct {
+	uint32_t entries;			/*< times entered, RUN at every wake up */
+	uint64_t microseconds;		/*< time spent */
+} power_mode_stats_t;
+
+/**
+ * @brief The figures
+ */
+typedef struct {
+	power_mode_stats_t modes[POWER_MODE_COUNT];	/*< indexed by {@see power_mode_t} */
+	uint32_t suppressed;		/*< SysTick interrupts not taken in WAIT */
+	uint32_t skipped;			/*< ticks counted after VLPS */
+	uint32_t vetoed;			/*< idles long enough for VLPS that waited, a peripheral being busy */
+	uint32_t aborted;			/*< VLPS entries an interrupt pending on the way in turned back */
+	uint32_t stalls;			/*< flash commands run by {@see Power_Stall} */
+	uint32_t stalled;			/*< ticks counted after them */
+} power_stats_t;
+
+/**
+ * @brief The figures; RUN time is worked out by {@see Power_Dump}
+ */
+extern power_stats_t power_stats;
+
+/**
+ * @brief Allows VLPS in the SMC and sets up its wake up timer
+ *
+ * @param: None
+ * @return: None
+ */
+void Power_Init();
+
+/**
+ * @brief Sleeps until a deadline or the next interrupt, in the deepest mode that is safe now.
+ * 		  Call with PRIMASK set and the scheduler's queue empty; returns with PRIMASK set
+ * 		  and the tick counted up to the wake up. The interrupt that woke the core is
+ * 		  taken once PRIMASK clears, out of VLPS it may have run already.
+ * @param[in] deadline {@see systemTime} the next software timer is due
+ */
+void Power_Idle(uint32_t deadline);
+
+/**
+ * @brief Runs a flash command with the interrupts masked and SysTick stopped, then counts the
+ * 		  ticks it took from the LPTMR. Call from thread mode after {@see Power_Init}; the
+ * 		  interrupts raised meanwhile are taken on return.
+ * @param[in] command The command, must not touch the flash otherwise
+ * @param[in] context Its argument
+ * @return What the command returned
+ */
+int32_t Power_Stall(int32_t (*command)(void *context), void *context);
+
+/**
+ * @brief Allows or forbids VLPS, e.g. while characters are expected on the console
+ * @param[in] allow false keeps every idle in WAIT
+ */
+void Power_AllowStop(bool allow);
+
+/**
+ * @brief Clears the figures
+ *
+ * @param: None
+ * @return: None
+ */
+void Power_Reset();
+
+/**
+ * @brief Logs the entries and time of each mode and the ticks not taken
+ *
+ * @param: None
+ * @return: None
+ */
+void Power_Dump();
+
+#endif /* POWER_H_ */
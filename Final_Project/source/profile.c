@@ -0,0 +1,73 @@
+/*
+ * profile.c
+ *
+ *  Created on: Dec 28, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Cycle profiler of the hot path.
+ *
+ *    Sources of Reference :
+ * 		ARM Cortex-M0+ Technical Reference Manual (SysTick; no DWT CYCCNT on ARMv6-M)
+ */
+
+#include "profile.h"
+
+#if PROFILE_ENABLE
+
+#include <string.h>
+#include "global_defs.h"
+
+/**
+ * @brief Figures, indexed by {@see profile_region_t}
+ */
+profile_stats_t profile_stats[PROFILE_COUNT];
+
+/**
+ * @brief Printable region names, indexed by {@see profile_region_t}
+ */
+static const char *const region_names[PROFILE_COUNT] = { "read xyz", "tilt", "pwm", "log" };
+
+/**
+ * @brief Clears the figures of every region
+ */
+void Profile_Reset()
+{
+	memset(profile_stats, 0, sizeof(profile_stats));
+}
+
+/**
+ * @brief Converts clock counts to hundredths of a microsecond
+ */
+static uint64_t Profile_CentiMicroseconds(uint64_t counts)
+{
+	return (counts * 100000000u) / PROFILE_CLOCK_HZ;
+}
+
+/**
+ * @brief Logs the figures of every region that ran
+ */
+void Profile_Dump()
+{
+	LOG("\r\n Profile (us): region, count, min, mean, max, total");
+
+	for (int region = 0; region < PROFILE_COUNT; ++region) {
+		const profile_stats_t *stats = &profile_stats[region];
+		if (stats->count == 0) {
+			continue;
+		}
+
+		const uint32_t min = (uint32_t)Profile_CentiMicroseconds(stats->min);
+		const uint32_t mean = (uint32_t)Profile_CentiMicroseconds(stats->total / stats->count);
+		const uint32_t max = (uint32_t)Profile_CentiMicroseconds(stats->max);
+		const uint64_t total = Profile_CentiMicroseconds(stats->total) / 100;
+
+		LOG("\r\n   %-8s %7lu %7lu.%02lu %7lu.%02lu %7lu.%02lu %10lu", region_names[region],
+				(unsigned long)stats->count,
+				(unsigned long)(min / 100), (unsigned long)(min % 100),
+				(unsigned long)(mean / 100), (unsigned long)(mean % 100),
+				(unsigned long)(max / 100), (unsigned long)(max % 100),
+				(unsigned long)total);
+	}
+}
+
+#endif
@@ -0,0 +1,148 @@
+/*
+ * profile.h
+ *
+ *  Created on: Dec 28, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Header file for the cycle profiler of the hot path.
+ *
+ *      		With {@see PROFILE_ENABLE} set, code between {@see PROFILE_BEGIN} and
+ *      		{@see PROFILE_END} of a {@see profile_region_t} is timed and added to the
+ *      		region's count, minimum, maximum and total in {@see profile_stats}. The M0+
+ *      		has no DWT cycle counter, so the firmware reads {@see cycle_count}, SysTick at
+ *      		the core clock; the host build reads CLOCK_MONOTONIC in nanoseconds through
+ *      		host/profile_host.c. {@see Profile_Dump} converts either to microseconds, so
+ *      		profiles of both compare directly. A region costs two clock reads and an
+ *      		update of its entry, and opens and closes in the same block; a return out of
+ *      		the region closes it first, or the run is lost.
+ *      		Regions are recorded in thread mode only, the table is not masked.
+ *      		With profiling disabled the hooks compile to nothing and there is no table.
+ *
+ *    Sources of Reference :
+ * 		ARM Cortex-M0+ Technical Reference Manual (SysTick; no DWT CYCCNT on ARMv6-M)
+ */
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Set to nonzero to profile the regions
+ */
+#ifndef PROFILE_ENABLE
+#define PROFILE_ENABLE			(0)
+#endif
+
+/**
+ * @brief Milliseconds between the dumps of the state machine, which restart the figures
+ */
+#define PROFILE_DUMP_PERIOD_MS	(5000)
+
+/**
+ * @brief The regions
+ */
+typedef enum {
+	PROFILE_READ_XYZ = 0,		/*< fetching the sample: read_full_xyz, or taking it from the FIFO or DRDY buffer */
+	PROFILE_TILT,				/*< convert_xyz_to_roll_pitch */
+	PROFILE_PWM,				/*< roll and pitch to duty cycles and the TPM writes */
+	PROFILE_LOG,				/*< the roll and pitch log line */
+	PROFILE_COUNT
+} profile_region_t;
+
+/**
+ * @brief Figures of one region, in {@see Profile_Clock} counts
+ */
+typedef struct {
+	uint32_t count;				/*< times the region ran */
+	uint32_t min;				/*< shortest run */
+	uint32_t max;				/*< longest run */
+	uint64_t total;				/*< all runs */
+} profile_stats_t;
+
+#if PROFILE_ENABLE
+
+#ifdef HOST_BUILD
+
+/**
+ * @brief Counts per second of {@see Profile_Clock}: nanoseconds
+ */
+#define PROFILE_CLOCK_HZ		(1000000000u)
+
+/**
+ * @brief CLOCK_MONOTONIC in nanoseconds, low word; provided by host/profile_host.c
+ */
+uint32_t Profile_Clock();
+
+#else
+
+#include "MKL25Z4.h"
+#include "systick.h"
+
+/**
+ * @brief Counts per second of {@see Profile_Clock}: core clock cycles
+ */
+#define PROFILE_CLOCK_HZ		(SYSTEM_CLOCK_FREQ)
+
+#define Profile_Clock()			cycle_count()
+
+#endif
+
+/**
+ * @brief Figures, indexed by {@see profile_region_t}
+ */
+extern profile_stats_t profile_stats[PROFILE_COUNT];
+
+/**
+ * @brief Opens a region
+ */
+#define PROFILE_BEGIN(region)	const uint32_t profile_start_##region = Profile_Clock()
+
+/**
+ * @brief Closes the region opened by {@see PROFILE_BEGIN} and adds the run to its figures
+ */
+#define PROFILE_END(region)		Profile_Record((region), Profile_Clock() - profile_start_##region)
+
+/**
+ * @brief Adds a run to the figures of a region
+ * @param[in] region The region
+ * @param[in] elapsed Its length in {@see Profile_Clock} counts
+ */
+static inline void Profile_Record(profile_region_t region, uint32_t elapsed)
+{
+	profile_stats_t *stats = &profile_stats[region];
+
+	if ((stats->count == 0) || (elapsed < stats->min)) {
+		stats->min = elapsed;
+	}
+	if (elapsed > stats->max) {
+		stats->max = elapsed;
+	}
+	stats->total += elapsed;
+	stats->count++;
+}
+
+#else
+
+#define PROFILE_BEGIN(region)	do {} while (0)
+#define PROFILE_END(region)		do {} while (0)
+
+#endif
+
+/**
+ * @brief Clears the figures of every region
+ *
+ * @param: None
+ * @return: None
+ */
+void Profile_Reset();
+
+/**
+ * @brief Logs count, minimum, mean, maximum and total of every region that ran, in microseconds
+ *
+ * @param: None
+ * @return: None
+ */
+void Profile_Dump();
+
+#endif /* PROFILE_H_ */
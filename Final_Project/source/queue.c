@@ -18,6 +18,21 @@
 #include <stdint.h>
 #include <assert.h>
 
+/*
+ * Orders the data accesses of one side before its index store, and the index
+ * load of the other side before its data accesses. The M0+ does not reorder,
+ * the barrier keeps the compiler from doing so.
+ */
+#ifdef HOST_BUILD
+/* a host test may take an interrupt at the barriers, see test_queue_spsc.c */
+__attribute__((weak)) void Q_HostBarrier(void) {
+	__DMB();
+}
+#define Q_BARRIER()	Q_HostBarrier()
+#else
+#define Q_BARRIER()	__DMB()
+#endif
+
 
 /*
  * Initializing the FIFO
@@ -29,12 +44,10 @@
  *   void
  */
 void Q_Init(Q_T * q) {
+	assert(q && q->data);
 	q->write = 0;
 	q->read = 0;
-	q->Full_Status = false;
-	q->size = 0;
-	for (int i=0; i<MAX_SIZE; i++)
-	    q->data[i] = '_';  // to simplify our lives when debugging
+	memset(q->data, '_', (q->mask + 1) * q->elementSize);  // to simplify our lives when debugging
 }
 
 
@@ -48,7 +61,7 @@ void Q_Init(Q_T * q) {
  *   The capacity, in bytes, for the FIFO
  */
 size_t Q_Capacity(Q_T * q) {
-	return MAX_SIZE;
+	return q->mask + 1;
 }
 
 /*
@@ -72,11 +85,11 @@ bool Q_Empty(Q_T * q) {
  *   Q_T : Queue Object
  *
  * Returns:
- *   bool: True/False
+ *   int: Same as Q_Length
  */
 int Q_Size(Q_T * q) {
 	assert(q);
-	return q->size;
+	return Q_Length(q);
 }
 
 
@@ -91,7 +104,7 @@ int Q_Size(Q_T * q) {
  */
 bool Q_Full(Q_T * q){
 	assert(q);
-	return (Q_Length(q) == MAX_SIZE);
+	return (Q_Length(q) == Q_Capacity(q));
 }
 
 
@@ -105,103 +118,136 @@ bool Q_Full(Q_T * q){
  *   Number of bytes currently available to be dequeued from the FIFO
  */
 size_t Q_Length(Q_T * q){
-	uint32_t masking_state;
-	size_t val=0;
+	// both counters wrap at 2^32, the unsigned difference stays correct across the wrap
+	return (uint32_t)(q->write - q->read);
+}
 
-	masking_state = __get_PRIMASK();
-	START_CRITICAL();
 
-	if(q->Full_Status){
-		val = MAX_SIZE;
-	}
-	else if(q->write >= q->read){
-		val = q->write - q->read;
-	}
-	else {
-		val = MAX_SIZE - (q->read - q->write);
-	}
-	END_CRITICAL(masking_state);
-	return val;
+/*
+ * Fills the two spans covering len elements of the ring from counter position
+ * pos on, the second one starting over at the beginning of the storage.
+ */
+static void Q_Spans(Q_T * q, uint32_t pos, size_t len, Q_Span_T span[2]) {
+	const uint32_t index = pos & q->mask;
+
+	span[0].data = q->data + index * q->elementSize;
+	span[0].length = min(len, q->mask + 1 - index);
+	span[1].data = q->data;
+	span[1].length = len - span[0].length;
 }
 
 
 /*
- * Enqueues data onto the FIFO, up to the limit of the available FIFO
- * capacity.
+ * Zero-copy producer side: hands out up to nbyte bytes of free storage to be
+ * written in place. Nothing is visible to the consumer until Q_Commit.
  *
  * Parameters:
- *   buf      Pointer to the data
- *   nbyte    Max number of bytes to enqueue
  *   Q_T : Queue Object
+ *   nbyte    Max number of bytes wanted
+ *   span     Receives the two writable spans, span[0] first
  *
  * Returns:
- *   The number of bytes actually enqueued, which could be 0. In case
- * of an error, returns -1.
+ *   The number of bytes reserved, span[0].length + span[1].length
  */
-size_t Q_Enqueue(Q_T * q, const void *buf , size_t nbyte) {
-	size_t len1 = 0;
-	size_t len2=0;
-	uint32_t masking_state;
+size_t Q_Reserve(Q_T * q, size_t nbyte, Q_Span_T span[2]) {
+	const uint32_t write = q->write;	// own index, cannot change under us
+	const uint32_t read = q->read;		// may only grow meanwhile, which just frees more room
 
-	if(q->Full_Status) {
-		return 0;
-	}
+	// the room is only written after read was loaded
+	Q_BARRIER();
 
-	masking_state = __get_PRIMASK();
-	START_CRITICAL();
-
-	if(Q_Empty(q)) {
-		len1 = nbyte;
-		q->write = len1;
-		if(nbyte == MAX_SIZE) {
-			len1 = MAX_SIZE;
-			q->Full_Status = true;
-			q->write = 0;
-		}
-		memcpy(q->data, buf, len1);
-		q->read = 0;
-		q->size += (len1 + len2);
-		END_CRITICAL(masking_state);
-		return len1 + len2;
-	}
+	const size_t len = min(nbyte, q->mask + 1 - (uint32_t)(write - read));
+	Q_Spans(q, write, len, span);
+	return len;
+}
 
-	if(q->read < q->write){
-		len1 = min(nbyte, MAX_SIZE - q->write);
-		memcpy(q->data + q->write, buf, len1);
-		q->write += len1;
 
+/*
+ * Publishes the first nbyte bytes of the last Q_Reserve to the consumer.
+ *
+ * Parameters:
+ *   Q_T : Queue Object
+ *   nbyte    Bytes written, at most what Q_Reserve returned
+ *
+ * Returns:
+ *   void
+ */
+void Q_Commit(Q_T * q, size_t nbyte) {
+	assert(nbyte <= Q_Capacity(q) - Q_Length(q));
 
-		if (q->write < MAX_SIZE) {
-			END_CRITICAL(masking_state);
-					return len1 + len2;
-		}
+	// publish the bytes only once they are in place
+	Q_BARRIER();
+	q->write += nbyte;
+}
 
-		q->write = 0;
-		if(q->read == 0) {
-			q->Full_Status = true;
-			q->size += (len1 + len2);
-			END_CRITICAL(masking_state);
-					return len1 + len2;
-		}
 
-		nbyte -= len1;
-		buf += len1;
-	}
+/*
+ * Zero-copy consumer side: hands out the queued bytes to be read in place.
+ * They stay queued until Q_Release.
+ *
+ * Parameters:
+ *   Q_T : Queue Object
+ *   span     Receives the two readable spans, span[0] oldest
+ *
+ * Returns:
+ *   The number of bytes readable, span[0].length + span[1].length
+ */
+size_t Q_Peek(Q_T * q, Q_Span_T span[2]) {
+	const uint32_t read = q->read;		// own index, cannot change under us
+	const uint32_t write = q->write;	// may only grow meanwhile, which just adds more data
 
+	// the data is only read after write was loaded
+	Q_BARRIER();
 
-	// 2nd stage
-	len2 = min(nbyte, q->read - q->write);
-	memcpy(q->data + q->write, buf, len2);
-	q->write += len2;
+	const size_t len = (uint32_t)(write - read);
+	Q_Spans(q, read, len, span);
+	return len;
+}
 
-	if(q->write == q->read) {
-		q->Full_Status = true;
-	}
-	q->size+= (len1 + len2);
 
-	END_CRITICAL(masking_state);
-	return len1 + len2;
+/*
+ * Drops the oldest nbyte bytes, handing their storage back to the producer.
+ *
+ * Parameters:
+ *   Q_T : Queue Object
+ *   nbyte    Bytes consumed, at most what Q_Peek returned
+ *
+ * Returns:
+ *   void
+ */
+void Q_Release(Q_T * q, size_t nbyte) {
+	assert(nbyte <= Q_Length(q));
 
+	// hand the room back only once the bytes are copied out
+	Q_BARRIER();
+	q->read += nbyte;
+}
+
+
+/*
+ * Enqueues data onto the FIFO, up to the limit of the available FIFO
+ * capacity.
+ *
+ * Parameters:
+ *   buf      Pointer to the data
+ *   nbyte    Max number of bytes to enqueue
+ *   Q_T : Queue Object
+ *
+ * Returns:
+ *   The number of bytes actually enqueued, which could be 0. In case
+ * of an error, returns -1.
+ */
+size_t Q_Enqueue(Q_T * q, const void *buf , size_t nbyte) {
+	const uint8_t *src = buf;
+	const size_t size = q->elementSize;
+	Q_Span_T span[2];
+
+	const size_t len = Q_Reserve(q, nbyte, span);
+	memcpy(span[0].data, src, span[0].length * size);
+	memcpy(span[1].data, src + span[0].length * size, span[1].length * size);
+	Q_Commit(q, len);
+
+	return len;
 }
 
 /*
@@ -218,40 +264,72 @@ size_t Q_Enqueue(Q_T * q, const void *buf , size_t nbyte) {
  *  nbyte. In case of an error, returns -1.
  */
 size_t Q_Dequeue(Q_T * q, void *buf , size_t nbyte) {
+	uint8_t *dst = buf;
+	const size_t size = q->elementSize;
+	Q_Span_T span[2];
+
+	// min() evaluates its arguments twice, so peek once: a second look could see more than nbyte
+	const size_t readable = Q_Peek(q, span);
+	const size_t len = min(nbyte, readable);
+	const size_t len1 = min(len, span[0].length);
+	memcpy(dst, span[0].data, len1 * size);
+	memcpy(dst + len1 * size, span[1].data, (len - len1) * size);
+	Q_Release(q, len);
+
+	return len;
+}
 
-	size_t len1 = 0, len2=0;
-	uint32_t masking_state;
 
-	masking_state = __get_PRIMASK();
+/*
+ * Enqueues one element.
+ *
+ * Parameters:
+ *   Q_T : Queue Object
+ *   element  Pointer to the element, elementSize bytes
+ *
+ * Returns:
+ *   bool: True if it was queued, False if the queue is full
+ */
+bool Q_Push(Q_T * q, const void *element) {
+	const uint32_t write = q->write;
+	const uint32_t read = q->read;
 
-	START_CRITICAL();
+	Q_BARRIER();
 
-	if(Q_Empty(q) && !q->Full_Status) {
-		q->size-= (len1 + len2);
-		END_CRITICAL(masking_state);
-		return len1 + len2;
+	if ((uint32_t)(write - read) > q->mask) {
+		return false;
 	}
+	// a single element never wraps
+	memcpy(q->data + (write & q->mask) * q->elementSize, element, q->elementSize);
 
-	q->Full_Status = false;
+	Q_BARRIER();
+	q->write = write + 1;
+	return true;
+}
 
-	len1 = min(nbyte, MAX_SIZE - q->read);
-	if((q->write > q->read) && (len1 > q->write - q->read)) {
-		len1 = q->write - q->read;
-	}
-	memcpy(buf, q->data + q->read, len1);
-	q->read += len1;
-	if(q->read < MAX_SIZE) {
-		q->size-= (len1 + len2);
-		END_CRITICAL(masking_state);
-		return len1 + len2;
-	}
 
+/*
+ * Dequeues the oldest element.
+ *
+ * Parameters:
+ *   Q_T : Queue Object
+ *   element  Receives the element, elementSize bytes
+ *
+ * Returns:
+ *   bool: True if one was copied, False if the queue is empty
+ */
+bool Q_Pop(Q_T * q, void *element) {
+	const uint32_t read = q->read;
+	const uint32_t write = q->write;
 
-	len2 = min(nbyte - len1, q->write);
-	memcpy(buf+len1, q->data, len2);
-	q->read = len2;
+	Q_BARRIER();
 
-	END_CRITICAL(masking_state);
-	return len1 + len2;
+	if (write == read) {
+		return false;
+	}
+	memcpy(element, q->data + (read & q->mask) * q->elementSize, q->elementSize);
 
+	Q_BARRIER();
+	q->read = read + 1;
+	return true;
 }
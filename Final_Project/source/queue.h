@@ -6,6 +6,24 @@
  *
  *      @brief: Header file for instantiation and functionalities for Circular Buffer
  *
+ *      		The buffer is a single-producer/single-consumer ring: exactly one context
+ *      		enqueues and exactly one context dequeues, e.g. the main loop and the UART
+ *      		interrupt. write and read are free-running counters reduced modulo the
+ *      		power-of-two capacity on access; each is stored only by its owner and with
+ *      		a single word store, which is atomic on the Cortex-M0+. No interrupts are
+ *      		masked, so an ISR on the other side is never delayed by a memcpy here.
+ *
+ *      		Each queue holds elements of one size in storage supplied by its owner, e.g.
+ *
+ *      			static uint8_t txStorage[256];
+ *      			Q_T TxQ = Q_INITIALIZER(txStorage);
+ *
+ *      			static mma8451q_acc_t sampleStorage[16];
+ *      			Q_T SampleQ = Q_INITIALIZER(sampleStorage);
+ *
+ *      		Element size and capacity follow from the storage array at compile time.
+ *      		Counts and span lengths are in elements, which are bytes for a uint8_t queue.
+ *
  *    Sources of Reference :
  * 		Textbooks : Embedded Systems Fundamentals with Arm Cortex-M based MicroControllers
  */
@@ -20,24 +38,49 @@
 #include <stdint.h>
 #include <assert.h>
 
-#define MAX_SIZE 1024
-
-// critical section macro functions
-#define START_CRITICAL()	__disable_irq()
-#define END_CRITICAL(x)	__set_PRIMASK(x)
 #define min(x,y) ((x)<(y)?(x):(y))
 
 typedef struct {
-	int write;
-	int read;
-	size_t size;
-	bool Full_Status;
-	uint8_t data[MAX_SIZE];
+	volatile uint32_t write;	/*< elements ever enqueued, stored by the producer only */
+	volatile uint32_t read;		/*< elements ever dequeued, stored by the consumer only */
+	uint8_t *data;				/*< caller supplied storage */
+	uint32_t mask;				/*< capacity - 1 */
+	uint32_t elementSize;		/*< bytes per element */
 } Q_T;
 
+/*
+ * Evaluates to n, or fails to compile when n is not a power of two
+ */
+#define Q_POWER_OF_TWO(n)	((n) + 0 * sizeof(char[(((n) > 0) && (((n) & ((n) - 1)) == 0)) ? 1 : -1]))
 
 /*
- * Initializing the FIFO
+ * Static initializer of a queue over the array storage: capacity is the
+ * number of array elements, which must be a power of two, and the element
+ * size is the size of one array element.
+ */
+#define Q_INITIALIZER(storage) {											\
+		.write = 0,															\
+		.read = 0,															\
+		.data = (uint8_t *)(storage),										\
+		.mask = Q_POWER_OF_TWO(sizeof(storage) / sizeof((storage)[0])) - 1,	\
+		.elementSize = sizeof((storage)[0]),								\
+	}
+
+/*
+ * A contiguous piece of the ring storage. The free or filled part of the ring
+ * may wrap around the end of the storage, so it is handed out as two spans;
+ * the second one has length 0 when there is no wrap.
+ */
+typedef struct {
+	uint8_t *data;
+	size_t length;		/*< in elements */
+} Q_Span_T;
+
+
+/*
+ * Initializing the FIFO, i.e. emptying it; the storage is kept. Not safe
+ * against a running producer or consumer, call it before the interrupt on
+ * the other side is enabled.
  *
  * Parameters:
  *   Q_T : Queue Object
@@ -50,7 +93,7 @@ extern void Q_Init(Q_T * q);
 
 /*
  * Enqueues data onto the FIFO, up to the limit of the available FIFO
- * capacity.
+ * capacity. Producer side only.
  *
  * Parameters:
  *   buf      Pointer to the data
@@ -67,6 +110,7 @@ extern size_t Q_Enqueue(Q_T * q, const void *buf , size_t nbyte);
 /*
  * Attempts to remove ("dequeue") up to nbyte bytes of data from the
  * FIFO. Removed data will be copied into the buffer pointed to by buf.
+ * Consumer side only.
  *
  * Parameters:
  *   buf      Destination for the dequeued data
@@ -81,7 +125,93 @@ extern size_t Q_Dequeue(Q_T * q, void *buf , size_t nbyte);
 
 
 /*
- * Returns the number of bytes currently on the FIFO.
+ * Enqueues one element. Producer side only.
+ *
+ * Parameters:
+ *   Q_T : Queue Object
+ *   element  Pointer to the element, elementSize bytes
+ *
+ * Returns:
+ *   bool: True if it was queued, False if the queue is full
+ */
+extern bool Q_Push(Q_T * q, const void *element);
+
+
+/*
+ * Dequeues the oldest element. Consumer side only.
+ *
+ * Parameters:
+ *   Q_T : Queue Object
+ *   element  Receives the element, elementSize bytes
+ *
+ * Returns:
+ *   bool: True if one was copied, False if the queue is empty
+ */
+extern bool Q_Pop(Q_T * q, void *element);
+
+
+/*
+ * Zero-copy producer side: hands out up to nbyte bytes of free storage to be
+ * written in place. Nothing is visible to the consumer until Q_Commit.
+ * Producer side only.
+ *
+ * Parameters:
+ *   Q_T : Queue Object
+ *   nbyte    Max number of bytes wanted
+ *   span     Receives the two writable spans, span[0] first
+ *
+ * Returns:
+ *   The number of bytes reserved, span[0].length + span[1].length
+ */
+extern size_t Q_Reserve(Q_T * q, size_t nbyte, Q_Span_T span[2]);
+
+
+/*
+ * Publishes the first nbyte bytes of the last Q_Reserve to the consumer.
+ * Producer side only.
+ *
+ * Parameters:
+ *   Q_T : Queue Object
+ *   nbyte    Bytes written, at most what Q_Reserve returned
+ *
+ * Returns:
+ *   void
+ */
+extern void Q_Commit(Q_T * q, size_t nbyte);
+
+
+/*
+ * Zero-copy consumer side: hands out the queued bytes to be read in place.
+ * They stay queued until Q_Release. Consumer side only.
+ *
+ * Parameters:
+ *   Q_T : Queue Object
+ *   span     Receives the two readable spans, span[0] oldest
+ *
+ * Returns:
+ *   The number of bytes readable, span[0].length + span[1].length
+ */
+extern size_t Q_Peek(Q_T * q, Q_Span_T span[2]);
+
+
+/*
+ * Drops the oldest nbyte bytes, handing their storage back to the producer.
+ * Consumer side only.
+ *
+ * Parameters:
+ *   Q_T : Queue Object
+ *   nbyte    Bytes consumed, at most what Q_Peek returned
+ *
+ * Returns:
+ *   void
+ */
+extern void Q_Release(Q_T * q, size_t nbyte);
+
+
+/*
+ * Returns the number of bytes currently on the FIFO. Safe from either side;
+ * the other side may change it right after, so the producer sees at most
+ * and the consumer at least this many.
  *
  * Parameters:
  *   Q_T : Queue Object
@@ -99,7 +229,7 @@ extern size_t Q_Length(Q_T * q);
  *   Q_T : Queue Object
  *
  * Returns:
- *   The capacity, in bytes, for the FIFO
+ *   The capacity, in elements, for the FIFO
  */
 extern size_t Q_Capacity(Q_T * q);
 
@@ -135,7 +265,7 @@ extern bool Q_Full(Q_T * q);
  *   Q_T : Queue Object
  *
  * Returns:
- *   bool: True/False
+ *   int: Same as Q_Length
  */
 extern int Q_Size(Q_T * q);
 
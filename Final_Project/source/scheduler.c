@@ -0,0 +1,241 @@
+/*
+ * scheduler.c
+ *
+ *  Created on: Dec 25, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Run-to-completion event scheduler of the main loop.
+ *
+ *    Sources of Reference :
+ * 		ARM Cortex-M0+ Devices Generic User Guide, 2.5 (Power management, WFI with PRIMASK set)
+ */
+
+#include <string.h>
+
+#include "MKL25Z4.h"
+#include "scheduler.h"
+#include "systick.h"
+#include "global_defs.h"
+
+/**
+ * @brief Counters, indexed by {@see event_type_t}
+ */
+scheduler_stats_t scheduler_stats[EVENT_COUNT];
+
+/**
+ * @brief Counters of the queue
+ */
+scheduler_queue_stats_t scheduler_queue_stats;
+
+/**
+ * @brief Handlers, indexed by {@see event_type_t}
+ */
+static scheduler_handler_t handlers[EVENT_COUNT];
+
+/**
+ * @brief The ring, indexed by the running counters modulo {@see SCHEDULER_QUEUE_LENGTH}
+ */
+static event_t ring[SCHEDULER_QUEUE_LENGTH];
+
+/**
+ * @brief Events ever posted and ever taken; both only change under PRIMASK
+ */
+static volatile uint32_t head, tail;
+
+/**
+ * @brief Events of each type in the ring, for {@see Scheduler_PostOnce}
+ */
+static volatile uint8_t pending[EVENT_COUNT];
+
+/**
+ * @brief Printable types, indexed by {@see event_type_t}
+ */
+static const char *const type_names[EVENT_COUNT] = { "motion", "samples", "uart rx", "tick" };
+
+/**
+ * @brief Sleep of the empty queue, NULL for WFI
+ */
+static scheduler_idle_t idle_sleep;
+
+/**
+ * @brief Sets the handler of a type of event
+ */
+void Scheduler_Register(event_type_t type, scheduler_handler_t handler)
+{
+	handlers[type] = handler;
+}
+
+/**
+ * @brief Sets the sleep of the empty queue
+ */
+void Scheduler_SetIdle(scheduler_idle_t idle)
+{
+	idle_sleep = idle;
+}
+
+/**
+ * @brief Queues an event, PRIMASK set by the caller
+ */
+static bool Scheduler_Enqueue(event_type_t type, uint32_t data)
+{
+	const uint32_t depth = head - tail;
+
+	if (depth == SCHEDULER_QUEUE_LENGTH) {
+		scheduler_stats[type].dropped++;
+		return false;
+	}
+
+	ring[head & (SCHEDULER_QUEUE_LENGTH - 1)].type = type;
+	ring[head & (SCHEDULER_QUEUE_LENGTH - 1)].data = data;
+	head++;
+	pending[type]++;
+	scheduler_stats[type].posted++;
+	if (depth + 1 > scheduler_queue_stats.maxDepth) {
+		scheduler_queue_stats.maxDepth = depth + 1;
+	}
+	return true;
+}
+
+/**
+ * @brief Queues an event
+ */
+bool Scheduler_Post(event_type_t type, uint32_t data)
+{
+	/* interrupts of every priority post, each may preempt another */
+	uint32_t masking_state = __get_PRIMASK();
+	__disable_irq();
+	const bool queued = Scheduler_Enqueue(type, data);
+	__set_PRIMASK(masking_state);
+
+	return queued;
+}
+
+/**
+ * @brief Queues an event unless one of the same type is still pending
+ */
+bool Scheduler_PostOnce(event_type_t type, uint32_t data)
+{
+	bool queued = true;
+
+	uint32_t masking_state = __get_PRIMASK();
+	__disable_irq();
+	if (pending[type] != 0) {
+		scheduler_stats[type].coalesced++;
+	}
+	else {
+		queued = Scheduler_Enqueue(type, data);
+	}
+	__set_PRIMASK(masking_state);
+
+	return queued;
+}
+
+/**
+ * @brief Hands the oldest event to its handler
+ */
+bool Scheduler_Dispatch()
+{
+	event_t event;
+
+	uint32_t masking_state = __get_PRIMASK();
+	__disable_irq();
+	const uint32_t depth = head - tail;
+	if (depth == 0) {
+		__set_PRIMASK(masking_state);
+		return false;
+	}
+	event = ring[tail & (SCHEDULER_QUEUE_LENGTH - 1)];
+	tail++;
+	/* a PostOnce from here on queues again: the handler below may already have missed what it announces */
+	pending[event.type]--;
+	scheduler_queue_stats.dispatched++;
+	scheduler_queue_stats.depthSum += depth;
+	__set_PRIMASK(masking_state);
+
+	scheduler_stats_t *stats = &scheduler_stats[event.type];
+	const scheduler_handler_t handler = handlers[event.type];
+	if (handler != 0) {
+		const uint32_t start = cycle_count();
+		handler(&event);
+		const uint32_t cycles = cycle_count() - start;
+
+		stats->cycles += cycles;
+		if (cycles > stats->maxCycles) {
+			stats->maxCycles = cycles;
+		}
+	}
+	stats->handled++;
+
+	return true;
+}
+
+/**
+ * @brief Dispatches events for ever
+ */
+void Scheduler_Run()
+{
+	for (;;) {
+		/* with PRIMASK set an interrupt still ends WFI, it is taken once PRIMASK is cleared;
+		 * so a post between the check and WFI cannot be slept through */
+		__disable_irq();
+		if (head == tail) {
+			scheduler_queue_stats.sleeps++;
+			if (idle_sleep != 0) {
+				idle_sleep();
+			}
+			else {
+				__DSB();
+				__WFI();
+			}
+		}
+		__enable_irq();
+
+		while (Scheduler_Dispatch()) {}
+	}
+}
+
+/**
+ * @brief Events queued now
+ */
+uint8_t Scheduler_Depth()
+{
+	return (uint8_t)(head - tail);
+}
+
+/**
+ * @brief Clears the counters
+ */
+void Scheduler_ResetStats()
+{
+	uint32_t masking_state = __get_PRIMASK();
+	__disable_irq();
+	memset(scheduler_stats, 0, sizeof(scheduler_stats));
+	memset(&scheduler_queue_stats, 0, sizeof(scheduler_queue_stats));
+	__set_PRIMASK(masking_state);
+}
+
+/**
+ * @brief Logs the counters
+ */
+void Scheduler_Dump()
+{
+	const uint32_t dispatched = scheduler_queue_stats.dispatched;
+	const uint32_t meanDepth = dispatched ? (uint32_t)((100 * (uint64_t)scheduler_queue_stats.depthSum) / dispatched) : 0;
+
+	LOG("\r\n Scheduler: %lu events, depth mean %lu.%02lu max %u of %u, %lu sleeps", (unsigned long)dispatched,
+			(unsigned long)(meanDepth / 100), (unsigned long)(meanDepth % 100),
+			(unsigned)scheduler_queue_stats.maxDepth, (unsigned)SCHEDULER_QUEUE_LENGTH,
+			(unsigned long)scheduler_queue_stats.sleeps);
+	LOG("\r\n   event      posted coalesced dropped   handled  mean us   max us");
+
+	for (int type = 0; type < EVENT_COUNT; ++type) {
+		const scheduler_stats_t *stats = &scheduler_stats[type];
+		const uint32_t mean = stats->handled ? stats->cycles / stats->handled : 0;
+
+		LOG("\r\n   %-8s %8lu %9lu %7lu %9lu %8lu %8lu", type_names[type],
+				(unsigned long)stats->posted, (unsigned long)stats->coalesced, (unsigned long)stats->dropped,
+				(unsigned long)stats->handled,
+				(unsigned long)(mean / (SYSTEM_CLOCK_FREQ / 1000000u)),
+				(unsigned long)(stats->maxCycles / (SYSTEM_CLOCK_FREQ / 1000000u)));
+	}
+}
@@ -0,0 +1,161 @@
+/*
+ * scheduler.h
+ *
+ *  Created on: Dec 25, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Header file for the run-to-completion event scheduler of the main loop.
+ *
+ *      		Interrupts do not act on what they saw, they post an {@see event_t}: PORTA
+ *      		for the motion detector on INT1, UART0 for received characters, SysTick for
+ *      		the millisecond tick and the I2C completion of a FIFO burst or data-ready read
+ *      		for new samples. {@see Scheduler_Run} takes the events in the order they were
+ *      		posted and hands each to the handler registered for its type, one at a time
+ *      		and to its end. With nothing to do the core sleeps in WFI.
+ *
+ *      		The queue is a ring of {@see SCHEDULER_QUEUE_LENGTH} events, posted to from
+ *      		any priority under PRIMASK. An event that finds the ring full is dropped and
+ *      		counted. Events that only say "look again", such as the tick or received
+ *      		characters, are posted with {@see Scheduler_PostOnce}, which leaves a pending
+ *      		one of the same type alone, so a slow handler never floods the queue.
+ *
+ *      		Per type the scheduler counts posts, drops and handler runs with their
+ *      		cycles, and for the queue its deepest fill; {@see Scheduler_Dump} prints them.
+ *
+ *    Sources of Reference :
+ * 		ARM Cortex-M0+ Devices Generic User Guide, 2.5 (Power management, WFI with PRIMASK set)
+ * 		Miro Samek, Practical UML Statecharts in C/C++ (run-to-completion event processing)
+ */
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Events the queue holds, power of two
+ */
+#define SCHEDULER_QUEUE_LENGTH	(16)
+
+/**
+ * @brief Types of events
+ */
+typedef enum {
+	EVENT_MOTION = 0,			/*< the motion detector fired on INT1, data is PORTA ISFR */
+	EVENT_SAMPLES,				/*< new samples landed, data is the batch or sample sequence number */
+	EVENT_UART_RX,				/*< characters are waiting in RxQ */
+	EVENT_TICK,					/*< a millisecond passed, data is {@see systemTime} */
+	EVENT_COUNT
+} event_type_t;
+
+/**
+ * @brief One event
+ */
+typedef struct {
+	uint8_t type;				/*< {@see event_type_t} */
+	uint32_t data;				/*< meaning by type */
+} event_t;
+
+/**
+ * @brief Handler of a type of event, runs in thread mode
+ */
+typedef void (*scheduler_handler_t)(const event_t *event);
+
+/**
+ * @brief Sleep of the empty queue, runs in thread mode with PRIMASK set and must return with it set;
+ * 		  an interrupt still ends the sleep and is taken once the scheduler clears PRIMASK
+ */
+typedef void (*scheduler_idle_t)(void);
+
+/**
+ * @brief Counters of one type of event
+ */
+typedef struct {
+	uint32_t posted;			/*< events queued */
+	uint32_t coalesced;			/*< {@see Scheduler_PostOnce} calls that found one pending */
+	uint32_t dropped;			/*< events lost to a full queue */
+	uint32_t handled;			/*< handler runs, or events taken without a handler */
+	uint32_t cycles;			/*< core cycles spent in the handler, wraps */
+	uint32_t maxCycles;			/*< longest handler run */
+} scheduler_stats_t;
+
+/**
+ * @brief Counters of the queue
+ */
+typedef struct {
+	uint32_t dispatched;		/*< events taken from the queue */
+	uint32_t depthSum;			/*< queue depth seen at each take, for the mean */
+	uint8_t maxDepth;			/*< deepest the queue has been */
+	uint32_t sleeps;			/*< WFI or the idle sleep entered with the queue empty */
+} scheduler_queue_stats_t;
+
+/**
+ * @brief Counters, indexed by {@see event_type_t}
+ */
+extern scheduler_stats_t scheduler_stats[EVENT_COUNT];
+
+/**
+ * @brief Counters of the queue
+ */
+extern scheduler_queue_stats_t scheduler_queue_stats;
+
+/**
+ * @brief Sets the handler of a type of event; events of a type without one are taken and counted
+ * @param[in] type The type
+ * @param[in] handler The handler, or NULL
+ */
+void Scheduler_Register(event_type_t type, scheduler_handler_t handler);
+
+/**
+ * @brief Sets the sleep of the empty queue, e.g. a low power mode
+ * @param[in] idle The sleep, or NULL for WFI
+ */
+void Scheduler_SetIdle(scheduler_idle_t idle);
+
+/**
+ * @brief Queues an event; callable from any context
+ * @param[in] type The type
+ * @param[in] data Passed on in {@see event_t.data}
+ * @return false if the queue was full and the event dropped
+ */
+bool Scheduler_Post(event_type_t type, uint32_t data);
+
+/**
+ * @brief Queues an event unless one of the same type is still pending; callable from any context
+ * @param[in] type The type
+ * @param[in] data Passed on in {@see event_t.data}
+ * @return false if the queue was full and the event dropped
+ */
+bool Scheduler_PostOnce(event_type_t type, uint32_t data);
+
+/**
+ * @brief Hands the oldest event to its handler
+ * @return false if the queue was empty
+ */
+bool Scheduler_Dispatch();
+
+/**
+ * @brief Dispatches events for ever, sleeping whenever the queue is empty
+ */
+void Scheduler_Run() __attribute__((noreturn));
+
+/**
+ * @brief Events queued now
+ */
+uint8_t Scheduler_Depth();
+
+/**
+ * @brief Clears the counters
+ */
+void Scheduler_ResetStats();
+
+/**
+ * @brief Logs the counters, one line per type of event, and the queue's
+ *
+ * @param: None
+ * @return: None
+ */
+void Scheduler_Dump();
+
+#endif /* SCHEDULER_H_ */
@@ -24,6 +24,16 @@
 
 #include "init_sensors.h"
 #include "mma8451q.h"
+#include "mma8451q_fifo.h"
+#include "mma8451q_drdy.h"
+#include "mma8451q_profile.h"
+#include "telemetry.h"
+#include "scheduler.h"
+#include "timer_wheel.h"
+#include "profile.h"
+#include "power.h"
+#include "blackbox.h"
+#include "uart.h"
 #include "statemachine.h"
 
 #include "global_defs.h"
@@ -52,34 +62,308 @@ static volatile uint8_t poll_mma8451q = 1;
 volatile uint8_t flag;
 
 
+/**
+ * @brief Flash period in s_ACCEL: the LEDs show the tilt for one half, are dark for the other
+ */
+#define FLASH_HALF_MS		(100)
+
+/**
+ * @brief Milliseconds between the roll and pitch logs of Control_RGB_LEDs
+ */
+#define LOG_PERIOD_MS		(1000)
+
+/**
+ * @brief The newest sample, kept across events
+ */
+static mma8451q_acc_t acc;
+
+/**
+ * @brief Flash halves of s_ACCEL, its timeout and the log cadence
+ */
+static sw_timer_t flash_timer, accel_timer, log_timer;
+
+#if PROFILE_ENABLE
+/**
+ * @brief Cadence of the profile dumps
+ */
+static sw_timer_t profile_timer;
+#endif
+
+/**
+ * @brief The flash stall the acquisition rides out without losing samples: the FIFO has room beyond a
+ * 		  waiting batch, the data-ready read only the sample period, a read on demand is merely delayed
+ */
+#if MMA8451Q_ACQUISITION == MMA8451Q_ACQUIRE_FIFO
+#define STALL_LIMIT_US		((MMA8451Q_FIFO_DEPTH - MMA8451Q_FIFO_WATERMARK) * 1000000u / BLACKBOX_RATE_HZ)
+#elif MMA8451Q_ACQUISITION == MMA8451Q_ACQUIRE_DRDY
+#define STALL_LIMIT_US		(1000000u / BLACKBOX_RATE_HZ)
+#else
+#define STALL_LIMIT_US		(BLACKBOX_STALL_ANY)
+#endif
+
+/**
+ * @brief Longest idle without a software timer armed
+ */
+#define IDLE_MAX_MS			(1000)
+
+/**
+ * @brief VLPS is allowed, toggled from the console
+ */
+static bool stop_allowed = true;
+
+/**
+ * @brief The LEDs show the tilt in the current half of the flash
+ */
+static bool flash_lit;
+
+/**
+ * @brief {@see ACCEL_TIMEOUT} passed, s_ACCEL ends with the current flash
+ */
+static bool accel_expired;
+
+
 /**
  * @brief Handler for interrupts on port A
  */
 void PORTA_IRQHandler()
 {
-//	if(flag == 1) {
-//		return;
-//	}
-
     register uint32_t isfr_mma = MMA8451Q_INT_PORT->ISFR;
 
+#if MMA8451Q_ACQUISITION != MMA8451Q_ACQUIRE_ON_DEMAND
+	/* INT2 carries the FIFO watermark or data-ready: clear only its flag and queue the read */
+	if (isfr_mma & (1 << MMA8451Q_INT2_PIN)) {
+		MMA8451Q_INT_PORT->ISFR = (1 << MMA8451Q_INT2_PIN);
+#if MMA8451Q_ACQUISITION == MMA8451Q_ACQUIRE_FIFO
+		MMA8451Q_FifoDrain();
+#else
+		MMA8451Q_DrdyRead();
+#endif
+
+		isfr_mma &= ~(1 << MMA8451Q_INT2_PIN);
+		if (!(isfr_mma & (1 << MMA8451Q_INT1_PIN))) {
+			return;
+		}
+	}
+#endif
+
 	/* check MMA8451Q */
     register uint32_t fromMMA8451Q 	= (isfr_mma & ((1 << MMA8451Q_INT1_PIN) | (1 << MMA8451Q_INT2_PIN)));
 		if (fromMMA8451Q) {
 		PORTA->PCR[MMA_ISR_PIN] |= PORT_PCR_ISF_MASK;
-//		// Trasient Mode Clean
-//		uint8_t Int_SourceTrans = I2C_ReadRegister(MMA8451Q_I2CADDR, 0x1E);
 
-		// Motion Mode Clean
-		uint8_t Int_SourceTrans = I2C_ReadRegister(MMA8451Q_I2CADDR, 0x16);
-		if(Int_SourceTrans == 0){
-			flag = 1;
-		}
+		/* clear only the flags handled here, a FIFO edge arriving meanwhile must stay pending */
+		PORTA->ISFR = fromMMA8451Q;
+	}
+
+	/* the motion source is read in thread mode; INT1 is latched low until then and raises no further edge.
+	 * Motion is routed to INT1 alone, any other flag is no jerk. */
+	if (isfr_mma & (1 << MMA8451Q_INT1_PIN)) {
+		Scheduler_Post(EVENT_MOTION, isfr_mma);
+	}
+}
+
+
+/**
+ * @brief Enters the standard routine: LEDs follow the tilt of every new sample
+ */
+static void enter_routine(void)
+{
+	mma_t.state = s_ROUTINE;
+	flag = 0;
+	LED_RedOn();
+	LOG("\n\r ORIENT Device to view Change in Pitch and Roll");
+}
+
+
+/**
+ * @brief Enters the jerk state: LEDs flash the tilt until {@see ACCEL_TIMEOUT}
+ */
+static void enter_accel(void)
+{
+	mma_t.state = s_ACCEL;
+	flag = 1;
+	LOG("\n\r Accelerated too Fast, LED Flashing");
+	(void)BlackBox_Trigger();
+
+	Control_RGB_LEDs(&acc);
+	flash_lit = true;
+	accel_expired = false;
+	Timer_Start(&flash_timer, FLASH_HALF_MS, FLASH_HALF_MS);
+	Timer_Start(&accel_timer, ACCEL_TIMEOUT, 0);
+}
+
+
+/**
+ * @brief Flash timer: alternates the halves of the flash; s_ACCEL ends after a dark half once timed out
+ */
+static void on_flash(sw_timer_t *timer)
+{
+	if (flash_lit) {
+		GREEN_PWM = 0;
+		BLUE_PWM = 0;
+		flash_lit = false;
+	}
+	else if (!accel_expired) {
+		Control_RGB_LEDs(&acc);
+		flash_lit = true;
+	}
+	else {
+		Timer_Stop(timer);
+		enter_routine();
+	}
+}
+
+
+/**
+ * @brief Timeout of s_ACCEL
+ */
+static void on_accel_timeout(sw_timer_t *timer)
+{
+	accel_expired = true;
+}
 
-		/* clear interrupts using BME decorated logical OR store */
-		PORTA->ISFR |= (1 << MMA8451Q_INT1_PIN) | (1 << MMA8451Q_INT2_PIN);
+
+/**
+ * @brief Log timer: the next LED update logs roll and pitch
+ */
+static void on_log(sw_timer_t *timer)
+{
+	flag_log = 1;
+}
+
+
+#if PROFILE_ENABLE
+/**
+ * @brief Profile timer: dumps the figures of the last period, not while they would break into the telemetry frames
+ */
+static void on_profile(sw_timer_t *timer)
+{
+	if (!TELEMETRY_ENABLE) {
+		Profile_Dump();
+	}
+	Profile_Reset();
+}
+#endif
+
+
+/**
+ * @brief EVENT_MOTION: clears the latched motion source and leaves the routine on a jerk
+ */
+static void on_motion(const event_t *event)
+{
+	// Motion Mode Clean
+	(void)MMA8451Q_ReadRegister(MMA8451Q_REG_FF_MT_SRC);
+
+	if (mma_t.state == s_ROUTINE) {
+		enter_accel();
+	}
+}
+
+
+/**
+ * @brief The tap of the acquisition, in its interrupt: the black box keeps every sample, a calibration sums them
+ */
+static void on_acquired(const int16_t (*samples)[3], uint8_t count)
+{
+	BlackBox_Record(samples, count);
+	MMA8451Q_CalibrateRecord(samples, count);
+}
+
+
+/**
+ * @brief EVENT_SAMPLES: new samples drive the LEDs in the routine; in s_ACCEL the flash picks up the newest.
+ * 		  The black box and a calibration take their next step in either, right after a batch was drained.
+ */
+static void on_samples(const event_t *event)
+{
+	if (mma_t.state == s_ROUTINE) {
+		Control_RGB_LEDs(&acc);
+	}
+#if TELEMETRY_ENABLE
+	else {
+		Telemetry_Poll();
+	}
+#endif
+	BlackBox_Poll();
+	MMA8451Q_CalibratePoll();
+}
+
+
+/**
+ * @brief EVENT_TICK: expires the software timers; reads the sensor when nothing posts samples
+ */
+static void on_tick(const event_t *event)
+{
+#if MMA8451Q_ACQUISITION == MMA8451Q_ACQUIRE_ON_DEMAND
+	if (mma_t.state == s_ROUTINE) {
+		Control_RGB_LEDs(&acc);
+	}
+	BlackBox_Poll();
+	MMA8451Q_CalibratePoll();
+#endif
+
+	/* coalesced ticks: the event's time may be behind by then */
+	Timer_Expire(systemTime());
+}
+
+
+/**
+ * @brief Idle of the scheduler: sleeps until the next software timer is due, queue empty and PRIMASK set
+ */
+static void on_idle(void)
+{
+	uint32_t deadline = systemTime() + IDLE_MAX_MS;
+
+#if MMA8451Q_ACQUISITION == MMA8451Q_ACQUIRE_ON_DEMAND
+	/* the tick reads the sensor */
+	deadline = systemTime() + 1;
+#else
+	(void)Timer_NextExpiry(&deadline);
+#endif
+	Power_Idle(deadline);
+}
+
+
+/**
+ * @brief EVENT_UART_RX: the console; 's' dumps the scheduler and power counters, 'r' clears them,
+ * 		  'v' forbids or allows VLPS, which loses characters arriving while stopped,
+ * 		  'b' dumps the black box, 'c' calibrates the offsets and saves the sensor profile
+ */
+static void on_uart_rx(const event_t *event)
+{
+	char command;
+
+	while (Receive_String(&command, 1) == 1) {
+		switch (command) {
+		case 's':
+			Scheduler_Dump();
+			Power_Dump();
+			break;
+		case 'r':
+			Scheduler_ResetStats();
+			Power_Reset();
+			LOG("\r\n Scheduler and power counters cleared");
+			break;
+		case 'v':
+			stop_allowed = !stop_allowed;
+			Power_AllowStop(stop_allowed);
+			LOG("\r\n VLPS %s", stop_allowed ? "allowed" : "off");
+			break;
+		case 'b':
+			BlackBox_Dump();
+			break;
+		case 'c':
+			MMA8451Q_CalibrateStart();
+			break;
+#if PROFILE_ENABLE
+		case 'p':
+			Profile_Dump();
+			break;
+#endif
+		default:
+			break;
+		}
 	}
-		flag = 1;
 }
 
 
@@ -87,7 +371,7 @@ void PORTA_IRQHandler()
  * @brief State Machine Function,
  * 				1) Updates the state and events in accordance to the Normal Run Vs Jerk Detection
  * 				2) Initializes the State with the Stop State
- * 				3) Updates Operation based on interrupt handled in PORTA_Irq
+ * 				3) Updates Operation based on the events posted by the interrupts
  * 				4) Brighness increases with increase in Angle
  * 				5) LED flash in case of Jolt or Jerk. ​
  *
@@ -97,59 +381,35 @@ void PORTA_IRQHandler()
  */
 void state_machine(void) {
 
-	// Instantiate States
-	state_t new_state = mma_t.state;
-
-	// Instantiate Acceleration Object
-	mma8451q_acc_t acc;
-
 	// Sets it to default which is Zero
 	MMA8451Q_InitializeData(&acc);
-	int readMMA;
 	LOG("\n\r Initializing Inertial Sensor State Machine");
 
+	Scheduler_Register(EVENT_MOTION, on_motion);
+	Scheduler_Register(EVENT_SAMPLES, on_samples);
+	Scheduler_Register(EVENT_TICK, on_tick);
+	Scheduler_Register(EVENT_UART_RX, on_uart_rx);
 
-	while(1) {
-		switch(new_state) {
-		case s_ROUTINE:
-
-			// Begin Standard Routine PWM Based LED functionaing
-			reset_timer();
-			flag = 0;
-			LOG("\n\r ORIENT Device to view Change in Pitch and Roll");
-
-			while(flag != 1) { // While Jerk is not detected
-				LED_RedOn();
-				readMMA = 1;
-
-				// This functionality is provided so as to replace
-				// This inertial sensor with any other sensor
-				if (readMMA) {
-					Control_RGB_LEDs(&acc);
-				}
-			}
-			if(flag == 1) { // If jerk detected update State
-				new_state = s_ACCEL;
-			}
-			break;
+	Timer_Init(&flash_timer, on_flash, 0);
+	Timer_Init(&accel_timer, on_accel_timeout, 0);
+	Timer_Init(&log_timer, on_log, 0);
+	Timer_Start(&log_timer, LOG_PERIOD_MS, LOG_PERIOD_MS);
+#if PROFILE_ENABLE
+	Timer_Init(&profile_timer, on_profile, 0);
+	Timer_Start(&profile_timer, PROFILE_DUMP_PERIOD_MS, PROFILE_DUMP_PERIOD_MS);
+#endif
 
-		case s_ACCEL: // Jerk Detected State
-
-			reset_timer();
-			LOG("\n\r Accelerated too Fast, LED Flashing");
-
-			// Flash LED until timeout when Jerk Detected.
-			while(get_timer() < ACCEL_TIMEOUT) {
-				Control_RGB_LEDs(&acc);
-				delay_ms(100);
-				GREEN_PWM = 0;
-				BLUE_PWM = 0;
-				delay_ms(100);
-			}
-			flag = 0;
-			// Update State
-			new_state = s_ROUTINE;
-		}
-	}
+	Power_Init();
+	Scheduler_SetIdle(on_idle);
+
+	/* the flash commands run with the tick kept by power.c; under the data-ready acquisition it stays off */
+	BlackBox_Init(STALL_LIMIT_US);
+#if MMA8451Q_ACQUISITION == MMA8451Q_ACQUIRE_FIFO
+	MMA8451Q_FifoSetTap(on_acquired);
+#elif MMA8451Q_ACQUISITION == MMA8451Q_ACQUIRE_DRDY
+	MMA8451Q_DrdySetTap(on_acquired);
+#endif
 
+	enter_routine();
+	Scheduler_Run();
 }
@@ -28,14 +28,14 @@ typedef enum {
 	s_ACCEL
 } state_t;
 
-/* Timeout Period for flashing in case of jerk detection */
-#define ACCEL_TIMEOUT 7500
+/* Timeout Period for flashing in case of jerk detection, in milliseconds (the 7500 ticks of the 4 kHz SysTick it used to count) */
+#define ACCEL_TIMEOUT 1875
 
 /**
- * @brief State Machine Function,
+ * @brief State Machine Function, never returns
  * 				1) Updates the state and events in accordance to the Normal Run Vs Jerk Detection
  * 				2) Initializes the State with the Stop State
- * 				3) Updates Operation based on interrupt handled in PORTA_Irq
+ * 				3) Updates Operation based on the events the interrupts post, see scheduler.h
  * 				4) Brighness increases with increase in Angle
  * 				5) LED flash in case of Jolt or Jerk. ​
  *
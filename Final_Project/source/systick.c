@@ -13,10 +13,12 @@
 
 
 
+#include <stdbool.h>
 #include "MKL25Z4.h"
 #include "sysclock.h"
 #include "systick.h"
 #include "global_defs.h"
+#include "scheduler.h"
 
 
 /**
@@ -34,6 +36,37 @@ volatile ticktime_t g_timer_start;
  */
 static uint32_t freeRunner = 0;
 
+/**
+ * @brief Core clock cycles and microseconds at the last reload, advanced by the handler
+ */
+static volatile uint64_t tickCycles = 0;
+static volatile uint64_t tickMicroseconds = 0;
+
+/**
+ * @brief Odd from the entry of SysTick_Handler() until it has counted its reload, the sums and
+ *        Timer_U32 moved with it in one masked step; a reader that sees it unchanged saw the sums
+ *        whole, and one that sees it odd preempted the handler and counts the reload itself
+ */
+static volatile uint32_t tickSequence = 0;
+
+/**
+ * @brief After an early wake of SysTick_SleepUntil() the counter runs off the tick grid:
+ *        restorePeriods reloads until LOAD is a tick again, loadShort is what the period
+ *        LOAD holds is short of a tick, restoreShort the same for the one after, and
+ *        gridOffset the cycles the sums are past the last tick of the grid
+ */
+static volatile uint32_t restorePeriods = 0;
+static uint32_t loadShort = 0;
+static uint32_t restoreShort = 0;
+static uint32_t gridOffset = 0;
+
+/**
+ * @brief Cycles to microseconds without a divider: 43691 / 2^21 is 1/48 to 1.6e-7, exact below 2^17 cycles
+ */
+static inline uint32_t cycles_to_us(uint32_t cycles) {
+	return (cycles * TIMESTAMP_US_RECIPROCAL) >> TIMESTAMP_US_SHIFT;
+}
+
 
 /**
 ​ * ​ ​ @brief​ ​  Instantiate a Systick Timer
@@ -51,6 +84,10 @@ void InitSysTick() {
 	SysTick->CTRL = SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk | SysTick_CTRL_CLKSOURCE_Msk ;  // Mask to Initialize TIcks, Enamble CTRL Mask and use Processer CLock Source of 48 Mhz
 
 	Timer_U32 = 0; // Overall CLock - Initialization Precauton
+	tickCycles = tickMicroseconds = 0;
+	tickSequence = 0;
+	freeRunner = 0;
+	restorePeriods = loadShort = restoreShort = gridOffset = 0;
 	g_program_start = g_timer_start = 0;
 	LOG("\n\r Clock Gating and Initialization of SysTick Complete ");
 }
@@ -90,6 +127,68 @@ ticktime_t get_timer() {
 }
 
 
+/**
+ * @brief Reads the time at the last reload and the cycles into the running period
+ * @param[out] cycles Core clock cycles at the last reload
+ * @param[out] microseconds Microseconds at the last reload
+ * @return Core clock cycles since that reload, SYSTICK_TMR_RELOAD_VAL + 1 and more if a reload is not counted yet
+ */
+static inline uint32_t timestamp_read(uint64_t *cycles, uint64_t *microseconds) {
+	uint32_t sequence;
+	uint32_t pending;
+	uint32_t value;
+
+	do {
+		sequence = tickSequence;
+		*cycles = tickCycles;
+		*microseconds = tickMicroseconds;
+		value = SysTick->VAL;
+
+		/* the counter reloaded but the handler has not run yet, e.g. we are in a more urgent ISR */
+		pending = (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) ? 1 : 0;
+		if (pending) {
+			value = SysTick->VAL;
+		}
+	} while (sequence != tickSequence);
+
+	/* odd: the handler took the reload, then a more urgent ISR preempted it before it counted it */
+	return (pending + (sequence & 1)) * (SYSTICK_TMR_RELOAD_VAL + 1) + (SYSTICK_TMR_RELOAD_VAL - value);
+}
+
+
+/**
+​ * ​ ​ @brief​ ​ Returns a free running count of core clock cycles
+​ *
+​ * ​ ​ @param​ ​ none
+​ * ​ ​ @return​ ​ Core clock cycles since InitSysTick(), the low word of timestamp_cycles()
+​ */
+uint32_t cycle_count() {
+	return (uint32_t)timestamp_cycles();
+}
+
+
+/**
+ * @brief Returns the core clock cycles since InitSysTick(), 64 bit
+ */
+uint64_t timestamp_cycles() {
+	uint64_t cycles, microseconds;
+	const uint32_t elapsed = timestamp_read(&cycles, &microseconds);
+
+	return cycles + elapsed;
+}
+
+
+/**
+ * @brief Returns the microseconds since InitSysTick(), 64 bit
+ */
+uint64_t timestamp_us() {
+	uint64_t cycles, microseconds;
+	const uint32_t elapsed = timestamp_read(&cycles, &microseconds);
+
+	return microseconds + cycles_to_us(elapsed);
+}
+
+
 /**
 ​ * ​ ​ @brief​ ​  TIRQ Handler to Update Time.
 ​ *
@@ -97,15 +196,141 @@ ticktime_t get_timer() {
 ​ * ​ ​ @return​ ​ none
 ​ */
 void SysTick_Handler() {
+	// first: a reader preempting the handler from here on counts the reload itself
+	tickSequence++;
+
 	SystemMilliseconds += ((++freeRunner) & 0b100) >> 2;
+	if (freeRunner & 0b100) {
+		// a millisecond passed; one pending tick is enough, its handler reads the time
+		Scheduler_PostOnce(EVENT_TICK, SystemMilliseconds);
+	}
 	freeRunner &= 0b11;
 
+	uint64_t cycles = tickCycles + SYSTICK_TMR_RELOAD_VAL + 1;
+	uint64_t microseconds = tickMicroseconds + 1000000u / SYTICK_TIME_FREQ;
+	if (restorePeriods != 0) {
+		// back towards the grid after an early wake; LOAD set now is taken at the next reload
+		const uint32_t offset = gridOffset - loadShort;
+		cycles -= loadShort;
+		microseconds -= cycles_to_us(gridOffset);
+		microseconds += cycles_to_us(offset);
+		gridOffset = offset;
+		loadShort = restoreShort;
+		restoreShort = 0;
+		SysTick->LOAD = SYSTICK_TMR_RELOAD_VAL - loadShort;
+		restorePeriods--;
+	}
+
+	// the sums, the total timer and the even sequence in one step, no reader sees them half way
+	uint32_t masking_state = __get_PRIMASK();
+	__disable_irq();
+	tickCycles = cycles;
+	tickMicroseconds = microseconds;
 	Timer_U32++; // Keep Track of the total timer
+	tickSequence++;
+	__set_PRIMASK(masking_state);
+}
 
-	if(Timer_U32 % 1000 == 0) {
-		flag_log = 1;
+
+/**
+ * @brief Counts ticks that passed without their interrupt, PRIMASK set by the caller
+ * @return true if SystemMilliseconds moved
+ */
+static bool SysTick_Advance(uint32_t ticks) {
+	const uint32_t before = SystemMilliseconds;
+
+	tickCycles += (uint64_t)ticks * (SYSTICK_TMR_RELOAD_VAL + 1);
+	tickMicroseconds += (uint64_t)ticks * (1000000u / SYTICK_TIME_FREQ);
+	freeRunner += ticks;
+	SystemMilliseconds += freeRunner >> 2;
+	freeRunner &= 0b11;
+	Timer_U32 += ticks;
+	tickSequence += 2;
+
+	return SystemMilliseconds != before;
+}
+
+
+/**
+ * @brief Counts ticks slept through with SysTick stopped
+ */
+void SysTick_Skip(uint32_t ticks) {
+	uint32_t masking_state = __get_PRIMASK();
+	__disable_irq();
+	if (SysTick_Advance(ticks)) {
+		Scheduler_PostOnce(EVENT_TICK, SystemMilliseconds);
+	}
+	__set_PRIMASK(masking_state);
+}
+
+
+/**
+ * @brief Sleeps until a millisecond with the ticks in between suppressed, PRIMASK set by the caller
+ */
+uint32_t SysTick_SleepUntil(uint32_t ms, void (*sleep)(void)) {
+	const uint32_t cyclesPerTick = SYSTICK_TMR_RELOAD_VAL + 1;
+	const int32_t left = (int32_t)(ms - SystemMilliseconds);
+	uint32_t skipped = 0;
+
+	/* reloads until the one that reaches ms, the first ends the running period */
+	int32_t ticks = (left > 0) ? (int32_t)(left * (SYTICK_TIME_FREQ / 1000u) - freeRunner) : 0;
+	if (ticks > SYSTICK_SLEEP_MAX_TICKS + 1) {
+		ticks = SYSTICK_SLEEP_MAX_TICKS + 1;
+	}
+	if ((ticks < 3) || (restorePeriods != 0) || (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)) {
+		sleep();
+		return 0;
+	}
+
+	/* the period after the running one covers the rest, LOAD is taken at the reload */
+	const uint32_t stretched = (uint32_t)ticks - 1;
+	SysTick->LOAD = stretched * cyclesPerTick - 1;
+	sleep();
+	SysTick->LOAD = SYSTICK_TMR_RELOAD_VAL;
+
+	if (!(SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) || (SysTick->VAL <= SYSTICK_TMR_RELOAD_VAL)) {
+		/* woken in the running period; it reloads a normal one and its handler counts it */
+		return 0;
+	}
+
+	/* the stretched period runs, the reload that started it is counted here */
+	SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+	bool moved = SysTick_Advance(1);
+	skipped = 1;
+	sleep();
+
+	const uint32_t value = SysTick->VAL;
+	if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+		/* it ran out and a normal period follows; the pending handler counts its last tick */
+		moved = SysTick_Advance(stretched - 1) || moved;
+		skipped += stretched - 1;
 	}
 	else {
-		flag_log = 0;
+		/* woken early: count the whole ticks and end the running one on the grid in three
+		 * periods, two of half the rest short and one of the odd cycle, neither of them short
+		 * enough to be pending before the handler can run */
+		const uint32_t elapsed = stretched * cyclesPerTick - 1 - value;
+		const uint32_t whole = elapsed / cyclesPerTick;
+		const uint32_t rest = elapsed - whole * cyclesPerTick;
+		const uint32_t half = rest / 2;
+
+		SysTick->LOAD = SYSTICK_TMR_RELOAD_VAL - half;
+		SysTick->VAL = 0;
+		SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;		// it may have run out meanwhile, that tick is in whole
+		loadShort = half;
+		restoreShort = rest - 2 * half;
+		restorePeriods = 2;
+
+		/* the sums stand at the restart less the half the counter shows of the running period */
+		moved = SysTick_Advance(whole) || moved;
+		gridOffset = rest - half;
+		tickCycles += gridOffset;
+		tickMicroseconds += cycles_to_us(gridOffset);
+		skipped += whole;
+	}
+
+	if (moved) {
+		Scheduler_PostOnce(EVENT_TICK, SystemMilliseconds);
 	}
+	return skipped;
 }
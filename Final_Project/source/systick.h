@@ -14,8 +14,6 @@
 #ifndef SYSTICK_H_
 #define SYSTICK_H_
 
-extern int flag_log;
-
 /**
 * @brief Defines for the system tick behaviour
 */
@@ -27,6 +25,21 @@ typedef uint32_t ticktime_t;
 #define SYTICK_TIME_FREQ       (4000U) // 1000 Khz
 #define SYSTICK_TMR_RELOAD_VAL ((SYSTEM_CLOCK_FREQ / SYTICK_TIME_FREQ) - 1UL) // 48000 - 1
 
+/**
+* @brief Cycles to microseconds within a tick as (cycles * RECIPROCAL) >> SHIFT, 1/48 for 48 MHz
+*/
+#define TIMESTAMP_US_RECIPROCAL	(43691u)
+#define TIMESTAMP_US_SHIFT		(21)
+
+/**
+* @brief Longest SysTick_SleepUntil() period in ticks, 24 bit LOAD (~350 ms)
+*/
+#define SYSTICK_SLEEP_MAX_TICKS	(0xFFFFFFu / (SYSTICK_TMR_RELOAD_VAL + 1))
+
+#if (SYSTEM_CLOCK_FREQ != 48000000UL)
+#error "TIMESTAMP_US_RECIPROCAL is 2^21 / 48, work it out again for the new core clock"
+#endif
+
 /**
 * @brief Function to initialize the SysTick interrupt
 */
@@ -61,4 +74,68 @@ void reset_timer();
 ticktime_t get_timer();
 
 
+/**
+​ * ​ ​ @brief​ ​ Returns a free running count of core clock cycles, the low word of
+ *           timestamp_cycles(). Wraps every 2^32 cycles (~89 s), differences of two
+ *           readings stay valid across the wrap.
+ *           Safe to call from interrupts that mask the SysTick handler.
+​ *
+​ * ​ ​ @param​ ​ none
+​ * ​ ​ @return​ ​ Core clock cycles since InitSysTick()
+​ */
+uint32_t cycle_count();
+
+
+/**
+​ * ​ ​ @brief​ ​ Returns the monotonic 64 bit core clock, the common time base of sample
+ *           stamps and profiling. Built from the cycles the SysTick handler adds up at
+ *           every reload and the SysTick down-counter, with no multiply or divide.
+ *           A read retries if the handler ran meanwhile, so it never tears, and
+ *           counts a reload still pending when the caller masks the handler: safe
+ *           from thread mode and from any interrupt.
+​ *
+​ * ​ ​ @param​ ​ none
+​ * ​ ​ @return​ ​ Core clock cycles since InitSysTick()
+​ */
+uint64_t timestamp_cycles();
+
+
+/**
+​ * ​ ​ @brief​ ​ Returns timestamp_cycles() in microseconds, rounded down, 64 bit.
+ *           Same read, the cycles into the tick scaled by a multiply and shift.
+​ *
+​ * ​ ​ @param​ ​ none
+​ * ​ ​ @return​ ​ Microseconds since InitSysTick()
+​ */
+uint64_t timestamp_us();
+
+
+/**
+​ * ​ ​ @brief​ ​ Tickless sleep. Stretches the SysTick period after the running one to end
+ *           on the tick that makes SystemMilliseconds reach ms, at most
+ *           SYSTICK_SLEEP_MAX_TICKS on, and calls sleep until it ran out or another
+ *           interrupt came. The ticks in between are counted without their
+ *           interrupts, timestamps stay exact and monotonic, and on an early wake
+ *           the counter is put back on the tick grid within the next three ticks.
+ *           Fewer than three ticks ahead it only calls sleep, the tick runs as ever.
+ *           Call with PRIMASK set; the interrupt that woke the core runs once the
+ *           caller clears it, the SysTick handler counts the last tick.
+​ *
+​ * ​ ​ @param​ ​ ms The SystemMilliseconds to wake at
+​ * ​ ​ @param​ ​ sleep Enters the low power mode, returns on any interrupt, e.g. WFI
+​ * ​ ​ @return​ ​ Ticks whose interrupts were suppressed
+​ */
+uint32_t SysTick_SleepUntil(uint32_t ms, void (*sleep)(void));
+
+
+/**
+​ * ​ ​ @brief​ ​ Counts ticks that passed with SysTick stopped, e.g. in VLPS, as the handler
+ *           would have and posts the tick event if a millisecond passed
+​ *
+​ * ​ ​ @param​ ​ ticks The ticks slept through
+​ * ​ ​ @return​ ​ none
+​ */
+void SysTick_Skip(uint32_t ticks);
+
+
 #endif /* SYSTICK_H_ */
@@ -0,0 +1,150 @@
+/*
+ * telemetry.c
+ *
+ *  Created on: Dec 18, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Binary sample telemetry stream over UART0.
+ *
+ *    Sources of Reference :
+ * 		1) S. Cheshire, M. Baker, "Consistent Overhead Byte Stuffing", IEEE/ACM Transactions on Networking, 1999
+ */
+
+#include <string.h>
+#include "telemetry.h"
+#include "mma8451q_drdy.h"
+#include "uart.h"
+#include "cobs.h"
+#include "crc16.h"
+
+/**
+ * @brief The stream counters
+ */
+telemetry_stats_t telemetry_stats;
+
+/**
+ * @brief The frame being filled, before COBS encoding
+ */
+static uint8_t frame[TELEMETRY_FRAME_SIZE];
+
+/**
+ * @brief Samples in {@see frame}
+ */
+static uint8_t count;
+
+/**
+ * @brief Sequence number and timestamp of the first sample in {@see frame}
+ */
+static uint32_t firstSequence;
+static uint32_t firstTimestamp;
+
+/**
+ * @brief Stores little-endian fields
+ */
+static inline void put16(uint8_t *at, uint16_t value)
+{
+	at[0] = (uint8_t)value;
+	at[1] = (uint8_t)(value >> 8);
+}
+
+static inline void put32(uint8_t *at, uint32_t value)
+{
+	put16(at, (uint16_t)value);
+	put16(at + 2, (uint16_t)(value >> 16));
+}
+
+/**
+ * @brief Resets the frame being filled and the counters
+ */
+void Telemetry_Init()
+{
+	memset(&telemetry_stats, 0, sizeof(telemetry_stats));
+	count = 0;
+
+	/* ends whatever text the receiver saw before, so it is in sync for the first frame */
+	Q_Span_T span[2];
+	if (Send_Reserve(span, 1) == 1) {
+		span[0].data[0] = COBS_DELIMITER;
+		Send_Commit(1);
+	}
+}
+
+/**
+ * @brief Sends the frame being filled, if any
+ */
+void Telemetry_Flush()
+{
+	if (count == 0) {
+		return;
+	}
+
+	frame[0] = TELEMETRY_FRAME_SAMPLES;
+	put32(&frame[1], firstSequence);
+	put32(&frame[5], firstTimestamp);
+	frame[9] = count;
+
+	const size_t length = TELEMETRY_HEADER_SIZE + count * TELEMETRY_SAMPLE_SIZE;
+	put16(&frame[length], CRC16_Compute(frame, length));
+
+	/* encoded straight into the transmit queue, possibly across its wrap */
+	const size_t needed = COBS_MAX_ENCODED(length + TELEMETRY_CRC_SIZE) + 1;
+	Q_Span_T span[2];
+	if (Send_Reserve(span, needed) < needed) {
+		telemetry_stats.framesDropped++;
+		telemetry_stats.samplesDropped += count;
+	}
+	else {
+		size_t encoded = Cobs_Encode(frame, length + TELEMETRY_CRC_SIZE, span[0].data, span[0].length, span[1].data);
+		if (encoded < span[0].length) {
+			span[0].data[encoded] = COBS_DELIMITER;
+		}
+		else {
+			span[1].data[encoded - span[0].length] = COBS_DELIMITER;
+		}
+		Send_Commit(++encoded);
+
+		telemetry_stats.frames++;
+		telemetry_stats.samples += count;
+		telemetry_stats.bytes += encoded;
+	}
+
+	count = 0;
+}
+
+/**
+ * @brief Adds a sample to the frame being filled and sends the frame when full
+ */
+void Telemetry_Sample(uint32_t sequence, uint32_t timestamp, int16_t x, int16_t y, int16_t z)
+{
+	/* the samples of a frame are consecutive */
+	if ((count > 0) && (sequence != firstSequence + count)) {
+		Telemetry_Flush();
+	}
+	if (count == 0) {
+		firstSequence = sequence;
+		firstTimestamp = timestamp;
+	}
+
+	const uint32_t offset = (timestamp - firstTimestamp) >> TELEMETRY_TICK_SHIFT;
+	uint8_t *at = &frame[TELEMETRY_HEADER_SIZE + count * TELEMETRY_SAMPLE_SIZE];
+	put16(at, (offset > 0xFFFF) ? 0xFFFF : (uint16_t)offset);
+	put16(at + 2, (uint16_t)x);
+	put16(at + 4, (uint16_t)y);
+	put16(at + 6, (uint16_t)z);
+
+	if (++count == TELEMETRY_BATCH) {
+		Telemetry_Flush();
+	}
+}
+
+/**
+ * @brief Moves the queued samples into frames
+ */
+void Telemetry_Poll()
+{
+	mma8451q_sample_t sample;
+
+	while (MMA8451Q_DrdyPop(&sample)) {
+		Telemetry_Sample(sample.sequence, sample.timestamp, sample.acc.x, sample.acc.y, sample.acc.z);
+	}
+}
@@ -0,0 +1,116 @@
+/*
+ * telemetry.h
+ *
+ *  Created on: Dec 18, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Header file for the binary sample telemetry stream over UART0.
+ *
+ *      		Every sample of the data-ready acquisition is streamed, never just the newest.
+ *      		Up to {@see TELEMETRY_BATCH} consecutive samples share a frame:
+ *
+ *      			offset	size	field
+ *      			0		1		type, {@see TELEMETRY_FRAME_SAMPLES}
+ *      			1		4		sequence number of the first sample
+ *      			5		4		cycle_count() timestamp of the first sample
+ *      			9		1		number of samples n
+ *      			10		8 n		per sample: timestamp - first timestamp in units of
+ *      							2^TELEMETRY_TICK_SHIFT cycles (uint16), then x, y, z (int16)
+ *      			10+8n	2		CRC-16/CCITT-FALSE of the bytes before it
+ *
+ *      		All fields little-endian. The frame is COBS encoded and followed by a zero.
+ *      		A full frame is 76 bytes, 78 on the wire, so 800 Hz costs 100 frames or
+ *      		7800 bytes a second: 68% of the 11520 bytes a second of 115200 baud 8N1.
+ *      		Consecutive samples fill one frame; a sequence gap closes it early.
+ *
+ *      		Frames are COBS encoded straight into the UART transmit queue. A frame that
+ *      		does not fit is dropped and counted rather than blocking acquisition; the
+ *      		receiver sees the gap in the sequence numbers. Text logged meanwhile shows up
+ *      		on the receiver as frames failing their CRC, so the periodic roll/pitch log
+ *      		is off while telemetry is enabled. host/telemetry_decode turns a capture into CSV.
+ *
+ *    Sources of Reference :
+ * 		1) S. Cheshire, M. Baker, "Consistent Overhead Byte Stuffing", IEEE/ACM Transactions on Networking, 1999
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "init_sensors.h"
+
+/**
+ * @brief Set to nonzero to stream every sample; needs the data-ready acquisition
+ */
+#define TELEMETRY_ENABLE			(0)
+
+#if TELEMETRY_ENABLE && (MMA8451Q_ACQUISITION != MMA8451Q_ACQUIRE_DRDY)
+#error "Telemetry streams the samples of the data-ready acquisition, set MMA8451Q_ACQUISITION to MMA8451Q_ACQUIRE_DRDY"
+#endif
+
+#define TELEMETRY_FRAME_SAMPLES		(0x01)		/*< frame type of a sample batch */
+#define TELEMETRY_BATCH				(8)			/*< samples per frame at most */
+#define TELEMETRY_TICK_SHIFT		(6)			/*< per sample time offsets count 64 cycles, 1.33 us at 48 MHz */
+
+#define TELEMETRY_HEADER_SIZE		(10)		/*< type, sequence, timestamp, count */
+#define TELEMETRY_SAMPLE_SIZE		(8)			/*< time offset, x, y, z */
+#define TELEMETRY_CRC_SIZE			(2)
+
+/**
+ * @brief Largest frame before COBS encoding
+ */
+#define TELEMETRY_FRAME_SIZE		(TELEMETRY_HEADER_SIZE + TELEMETRY_BATCH * TELEMETRY_SAMPLE_SIZE + TELEMETRY_CRC_SIZE)
+
+/**
+ * @brief Stream counters
+ */
+typedef struct {
+	uint32_t samples;			/*< samples sent */
+	uint32_t frames;			/*< frames sent */
+	uint32_t bytes;				/*< bytes sent, delimiters included */
+	uint32_t framesDropped;		/*< frames that did not fit into the transmit queue */
+	uint32_t samplesDropped;	/*< samples in those frames */
+} telemetry_stats_t;
+
+/**
+ * @brief The stream counters
+ */
+extern telemetry_stats_t telemetry_stats;
+
+/**
+ * @brief Resets the frame being filled and the counters
+ *
+ * @param: None
+ * @return: None
+ */
+void Telemetry_Init();
+
+/**
+ * @brief Moves the queued samples into frames; call from the main loop, the only producer of the transmit queue
+ *
+ * @param: None
+ * @return: None
+ */
+void Telemetry_Poll();
+
+/**
+ * @brief Adds a sample to the frame being filled and sends the frame when full
+ * @param[in] sequence The sample number
+ * @param[in] timestamp Its cycle_count() timestamp
+ * @param[in] x The x acceleration
+ * @param[in] y The y acceleration
+ * @param[in] z The z acceleration
+ */
+void Telemetry_Sample(uint32_t sequence, uint32_t timestamp, int16_t x, int16_t y, int16_t z);
+
+/**
+ * @brief Sends the frame being filled, if any
+ *
+ * @param: None
+ * @return: None
+ */
+void Telemetry_Flush();
+
+#endif /* TELEMETRY_H_ */
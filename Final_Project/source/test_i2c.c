@@ -11,6 +11,8 @@
 
 #include "test_i2c.h"
 #include "mma8451q.h"
+#include "i2c_dma.h"
+#include "i2c_account.h"
 #include "assert.h"
 #include "global_defs.h"
 
@@ -18,6 +20,59 @@ static int g_tests_passed = 0;
 static int g_tests_total = 0;
 static int g_skip_tests = 0;
 
+/*
+ * @brief Number of status + XYZ reads per path in {@see i2c_account_compare}
+ */
+#define ACCOUNT_SAMPLES		(100)
+
+/*
+ * @brief Reads the 7 byte status + XYZ block on the interrupt engine and waits for it
+ */
+static i2c_status_t engine_read_sample(uint8_t *buffer)
+{
+	i2c_transfer_t transfer = {
+		.slaveId = MMA8451Q_I2CADDR,
+		.registerAddress = MMA8451Q_REG_STATUS,
+		.direction = I2C_DIRECTION_READ,
+		.buffer = buffer,
+		.length = 7
+	};
+	I2C_IrqSubmit(&i2c0_engine, &transfer);
+	return I2C_IrqWait(&i2c0_engine, &transfer);
+}
+
+#if I2C_ACCOUNTING
+/*
+ * @brief Reads the status + XYZ block {@see ACCOUNT_SAMPLES} times on every path and logs the accounting
+ */
+static void i2c_account_compare()
+{
+	uint8_t buffer[7];
+	struct i2c_dma *dma = i2c0_engine.dma;
+
+	I2C_AccountReset();
+
+	for (int i = 0; i < ACCOUNT_SAMPLES; ++i) {
+		I2C_ReadRegisters(MMA8451Q_I2CADDR, MMA8451Q_REG_STATUS, sizeof(buffer), buffer);
+	}
+
+	i2c0_engine.dma = 0;
+	for (int i = 0; i < ACCOUNT_SAMPLES; ++i) {
+		engine_read_sample(buffer);
+	}
+	i2c0_engine.dma = dma;
+
+	if (dma != 0) {
+		for (int i = 0; i < ACCOUNT_SAMPLES; ++i) {
+			engine_read_sample(buffer);
+		}
+	}
+
+	I2C_AccountReport();
+	I2C_AccountReset();
+}
+#endif
+
 void i2c_test_setup() {
 
 	mma8451q_acc_t val;
@@ -29,11 +84,45 @@ void i2c_test_setup() {
 	test_equal(id, 0x1A);
 	assert(id == 0x1A);
 
+	// Same read on the interrupt driven engine
+	uint8_t irq_id = 0;
+	i2c_transfer_t transfer = {
+		.slaveId = MMA8451Q_I2CADDR,
+		.registerAddress = MMA8451Q_REG_WHOAMI,
+		.direction = I2C_DIRECTION_READ,
+		.buffer = &irq_id,
+		.length = 1
+	};
+	test_equal(I2C_IrqSubmit(&i2c0_engine, &transfer), I2C_STATUS_PENDING);
+	test_equal(I2C_IrqWait(&i2c0_engine, &transfer), I2C_STATUS_OK);
+	test_equal(irq_id, 0x1A);
+
+	// Burst read of the static control registers, polled against the engine (DMA if attached)
+	uint8_t polled[8], burst[8] = { 0 };
+	I2C_ReadRegisters(MMA8451Q_I2CADDR, MMA8451Q_REG_CTRL_REG1, sizeof(polled), polled);
+	transfer.registerAddress = MMA8451Q_REG_CTRL_REG1;
+	transfer.buffer = burst;
+	transfer.length = sizeof(burst);
+	test_equal(I2C_IrqSubmit(&i2c0_engine, &transfer), I2C_STATUS_PENDING);
+	test_equal(I2C_IrqWait(&i2c0_engine, &transfer), I2C_STATUS_OK);
+	test_equal(i2c0_engine.viaDma, i2c0_engine.dma != 0);
+	for (int i = 0; i < sizeof(polled); ++i) {
+		test_equal(burst[i], polled[i]);
+	}
+
+	// The status + XYZ block used for sampling
+	uint8_t sample[7];
+	test_equal(engine_read_sample(sample), I2C_STATUS_OK);
+
 	// Validation of Invalid Slave Address
 	id = I2C_ReadRegister(0x00, 0x00);
 	test_equal(id, 255);
 	assert(id == 255);
 
+	// A healthy bus never needs recovering, not even after a NACK
+	test_equal(i2c_bus_stats.recoveries, 0);
+	test_equal(i2c_bus_stats.timeouts, 0);
+
 	// Static Board Acceleration Limits on Ground
 	test_equal(1, val.x != 0);
 	test_equal(1, val.y != 0);
@@ -49,6 +138,11 @@ void test_i2c_mma() {
 
 	i2c_test_setup();
 
+#if I2C_ACCOUNTING
+	i2c_account_compare();
+#endif
+	I2C_BusReport();
+
 	LOG("\r\n %s: passed %d/%d test cases", __FUNCTION__, g_tests_passed, g_tests_total);
 
 	LOG("\r\n");
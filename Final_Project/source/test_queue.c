@@ -12,13 +12,21 @@
 
 #include "test_queue.h"
 #include "uart.h"
+#include "uart_dma.h"
+#include "systick.h"
 #include "global_defs.h"
 
 static int g_tests_passed = 0;
 static int g_tests_total = 0;
 static int g_skip_tests = 0;
 
-Q_T Q;
+/*
+ * @brief Lines logged per path in {@see test_uart_load}
+ */
+#define LOAD_LINES		(20)
+
+static uint8_t QStorage[256];
+Q_T Q = Q_INITIALIZER(QStorage);
 
 /*
 ​ * ​ ​ @brief​ ​ Sets up the testing harness for Circular Buffer
@@ -44,7 +52,7 @@ void queue_test_setup() {
 	      "Must give us pause. \n"
 	    ;
 
-	char temp_str[1024];
+	char temp_str[sizeof(QStorage)];
 	const int limit = Q_Capacity(&Q);
 
 
@@ -139,3 +147,35 @@ void test_queue()
   LOG("\r\n %s: passed %d/%d test cases \r\n", __FUNCTION__, g_tests_passed, g_tests_total);
 
 }
+
+
+/*
+​ * ​ ​ @brief​ ​ Logs LOAD_LINES lines per transmit path and reports the CPU load of each
+ *
+​ * ​ ​ @param​ ​ void
+ *
+ *   @return​ ​ void
+ */
+void test_uart_load()
+{
+#if UART_ACCOUNTING
+	const bool dma = UART_TxDmaSelected();
+
+	for (int path = 0; path < UART_TX_PATH_COUNT; ++path) {
+		UART_TxDmaSelect(path == UART_TX_PATH_DMA);
+		UART_AccountReset();
+
+		const uint32_t start = cycle_count();
+		for (int i = 0; i < LOAD_LINES; ++i) {
+			LOG("\r\n UART load line %2d: 0123456789 abcdefghijklmnopqrstuvwxyz", i);
+		}
+		// until the last byte left TxQ
+		UART_TxDrain();
+		const uint32_t elapsed = cycle_count() - start;
+
+		UART_AccountReport(elapsed);
+	}
+
+	UART_TxDmaSelect(dma);
+#endif
+}
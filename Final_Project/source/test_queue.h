@@ -71,4 +71,14 @@ void queue_test_setup();
  */
 void test_queue();
 
+/*
+ * @brief Logs the same lines on the interrupt and on the DMA transmit path and reports
+ *        the CPU load of each; does nothing unless UART_ACCOUNTING is set. Needs SysTick.
+ *
+ * @param void
+ *
+ * @return void
+ */
+void test_uart_load();
+
 #endif /* TEST_QUEUE_H_ */
@@ -0,0 +1,116 @@
+/*
+ * tilt.c
+ *
+ *  Created on: Dec 19, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Integer tilt kernel, CORDIC vectoring in centi-degrees.
+ *
+ *    Sources of Reference :
+ * 		1) J. E. Volder, "The CORDIC Trigonometric Computing Technique", IRE Transactions on Electronic Computers, 1959
+ * 		2) https://www.nxp.com/docs/en/application-note/AN3461.pdf (Tilt Sensing Using a Three-Axis Accelerometer)
+ */
+
+#include "tilt.h"
+
+/**
+ * @brief Fraction bits of the angle accumulator, below the centi-degree
+ */
+#define TILT_ANGLE_SHIFT		(8)
+
+/**
+ * @brief 14bit inputs are scaled up by this many bits; with the CORDIC gain and two
+ * 		  chained rotations they stay below 2^30
+ */
+#define TILT_INPUT_SHIFT		(14)
+
+/**
+ * @brief CORDIC gain of the 16 iterations, 1.64676, in Q14
+ */
+#define TILT_GAIN_Q14			(26981)
+
+#define TILT_ITERATIONS			(16)
+
+/**
+ * @brief atan(2^-i) in centi-degrees, Q8
+ */
+static const int32_t atanTable[TILT_ITERATIONS] = {
+	1152000, 680065, 359328, 182400, 91554, 45822, 22916, 11459,
+	5730, 2865, 1432, 716, 358, 179, 90, 45
+};
+
+/**
+ * @brief Rotates (x, y) with x >= 0 onto the positive X axis
+ * @param[in,out] x The X component, scaled; receives the length times the CORDIC gain
+ * @param[in] y The Y component, scaled
+ * @return The angle of (x, y) in centi-degrees, Q8
+ */
+static int32_t Tilt_Vector(int32_t *x, int32_t y)
+{
+	int32_t vx = *x;
+	int32_t angle = 0;
+
+	/* rotate towards the axis, by +-atan(2^-i); branch free, -1 flips the direction */
+	for (int i = 0; i < TILT_ITERATIONS; ++i) {
+		const int32_t sign = y >> 31;
+		const int32_t dx = ((y >> i) ^ sign) - sign;
+		const int32_t dy = ((vx >> i) ^ sign) - sign;
+		vx += dx;
+		y -= dy;
+		angle += (atanTable[i] ^ sign) - sign;
+	}
+
+	*x = vx;
+	return angle;
+}
+
+/**
+ * @brief Angle of a vector in any quadrant
+ * @param[in,out] x The X component, scaled; receives the length times the CORDIC gain
+ * @param[in] y The Y component, scaled
+ * @return The angle in centi-degrees, Q8
+ */
+static int32_t Tilt_Angle(int32_t *x, int32_t y)
+{
+	const int32_t quarter = 90 * TILT_CENTIDEGREES << TILT_ANGLE_SHIFT;
+
+	if ((*x == 0) && (y == 0)) {
+		return 0;
+	}
+
+	/* CORDIC converges within +-99.9 degrees: a quarter turn first brings X >= 0 */
+	if (*x < 0) {
+		const int32_t vx = *x;
+		if (y >= 0) {
+			*x = y;
+			return quarter + Tilt_Vector(x, -vx);
+		}
+		*x = -y;
+		return -quarter + Tilt_Vector(x, vx);
+	}
+	return Tilt_Vector(x, y);
+}
+
+/**
+ * @brief Rounds an accumulated angle to centi-degrees
+ */
+static inline int16_t Tilt_Round(int32_t angle)
+{
+	return (int16_t)((angle + (1 << (TILT_ANGLE_SHIFT - 1))) >> TILT_ANGLE_SHIFT);
+}
+
+int16_t Tilt_Atan2(int16_t y, int16_t x)
+{
+	int32_t vx = (int32_t)x << TILT_INPUT_SHIFT;
+	return Tilt_Round(Tilt_Angle(&vx, (int32_t)y << TILT_INPUT_SHIFT));
+}
+
+void Tilt_RollPitch(int16_t x, int16_t y, int16_t z, int16_t *roll, int16_t *pitch)
+{
+	/* roll, leaving sqrt(y^2 + z^2) times the gain in length */
+	int32_t length = (int32_t)z << TILT_INPUT_SHIFT;
+	*roll = Tilt_Round(Tilt_Angle(&length, (int32_t)y << TILT_INPUT_SHIFT));
+
+	/* pitch: the length is never negative, X takes the same gain to match it */
+	*pitch = Tilt_Round(Tilt_Angle(&length, (int32_t)x * TILT_GAIN_Q14));
+}
@@ -0,0 +1,176 @@
+/*
+ * timer_wheel.c
+ *
+ *  Created on: Dec 26, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Software timers on the millisecond tick, in a hashed timer wheel.
+ *
+ *    Sources of Reference :
+ * 		G. Varghese, T. Lauck, Hashed and Hierarchical Timing Wheels, SOSP 1987 (scheme 6)
+ */
+
+#include "MKL25Z4.h"
+#include "timer_wheel.h"
+#include "delay.h"
+
+/**
+ * @brief The counters
+ */
+timer_wheel_stats_t timer_wheel_stats;
+
+/**
+ * @brief Heads of the slots' lists, a timer due at t in slot t modulo {@see TIMER_WHEEL_SLOTS}
+ */
+static sw_timer_t *slots[TIMER_WHEEL_SLOTS];
+
+/**
+ * @brief The millisecond the wheel was last turned to
+ */
+static uint32_t turned;
+
+/**
+ * @brief The timer the running turn visits next; moved on when a callback stops that timer
+ */
+static sw_timer_t *visit_next;
+
+static void Timer_Link(sw_timer_t *timer)
+{
+	sw_timer_t **head = &slots[timer->expires & (TIMER_WHEEL_SLOTS - 1)];
+
+	timer->prev = 0;
+	timer->next = *head;
+	if (*head != 0) {
+		(*head)->prev = timer;
+	}
+	*head = timer;
+}
+
+static void Timer_Unlink(sw_timer_t *timer)
+{
+	if (visit_next == timer) {
+		visit_next = timer->next;
+	}
+	if (timer->prev != 0) {
+		timer->prev->next = timer->next;
+	}
+	else {
+		slots[timer->expires & (TIMER_WHEEL_SLOTS - 1)] = timer->next;
+	}
+	if (timer->next != 0) {
+		timer->next->prev = timer->prev;
+	}
+}
+
+/**
+ * @brief Prepares a timer, disarmed
+ */
+void Timer_Init(sw_timer_t *timer, sw_timer_callback_t callback, void *context)
+{
+	timer->next = timer->prev = 0;
+	timer->expires = 0;
+	timer->period = 0;
+	timer->callback = callback;
+	timer->context = context;
+	timer->armed = false;
+}
+
+/**
+ * @brief Arms a timer
+ */
+void Timer_Start(sw_timer_t *timer, uint32_t delay, uint32_t period)
+{
+	Timer_Stop(timer);
+
+	timer->expires = systemTime() + ((delay != 0) ? delay : 1);
+	/* a slot the wheel has passed already would only come round a turn later */
+	if ((int32_t)(timer->expires - turned) <= 0) {
+		timer->expires = turned + 1;
+	}
+	timer->period = period;
+	timer->armed = true;
+	timer_wheel_stats.armed++;
+	Timer_Link(timer);
+}
+
+/**
+ * @brief Disarms a timer
+ */
+void Timer_Stop(sw_timer_t *timer)
+{
+	if (!timer->armed) {
+		return;
+	}
+	Timer_Unlink(timer);
+	timer->armed = false;
+	timer_wheel_stats.armed--;
+}
+
+/**
+ * @brief Runs the timers of one slot due at tick
+ */
+static void Timer_Turn(uint32_t tick, uint32_t now)
+{
+	/* a callback may stop the timer visited next, Timer_Unlink then moves visit_next on */
+	for (sw_timer_t *timer = slots[tick & (TIMER_WHEEL_SLOTS - 1)]; timer != 0; timer = visit_next) {
+		visit_next = timer->next;
+		if (timer->expires != tick) {
+			continue;		/* due on a later turn */
+		}
+
+		Timer_Unlink(timer);
+		if (timer->period != 0) {
+			/* drift free; periods missed while the thread was busy are skipped, not caught up */
+			timer->expires += timer->period;
+			if ((int32_t)(timer->expires - now) <= 0) {
+				timer->expires = now + timer->period;
+			}
+			Timer_Link(timer);
+		}
+		else {
+			timer->armed = false;
+			timer_wheel_stats.armed--;
+		}
+
+		timer_wheel_stats.fired++;
+		if (now - tick > timer_wheel_stats.maxLate) {
+			timer_wheel_stats.maxLate = now - tick;
+		}
+		timer->callback(timer);
+	}
+	visit_next = 0;
+}
+
+/**
+ * @brief Turns the wheel to a time
+ */
+void Timer_Expire(uint32_t now)
+{
+	while ((int32_t)(now - turned) > 0) {
+		Timer_Turn(++turned, now);
+	}
+}
+
+/**
+ * @brief Finds the earliest expiry of the armed timers
+ */
+bool Timer_NextExpiry(uint32_t *expires)
+{
+	bool found = false;
+	uint32_t earliest = 0;
+
+	if (timer_wheel_stats.armed == 0) {
+		return false;
+	}
+	for (int slot = 0; slot < TIMER_WHEEL_SLOTS; ++slot) {
+		for (const sw_timer_t *timer = slots[slot]; timer != 0; timer = timer->next) {
+			/* times wrap, compare their distances from the wheel */
+			if (!found || (timer->expires - turned < earliest - turned)) {
+				earliest = timer->expires;
+				found = true;
+			}
+		}
+	}
+	*expires = earliest;
+	return found;
+}
@@ -0,0 +1,116 @@
+/*
+ * timer_wheel.h
+ *
+ *  Created on: Dec 26, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Header file for the software timers on the millisecond tick.
+ *
+ *      		Any number of one-shot and periodic {@see sw_timer_t} run at once. They hang
+ *      		in a hashed wheel of {@see TIMER_WHEEL_SLOTS} slots, each an unsorted doubly
+ *      		linked list: a timer due at millisecond t sits in slot t modulo the slot
+ *      		count, whatever the number of turns until then. Starting and stopping a
+ *      		timer are a list insert and unlink.
+ *
+ *      		The SysTick interrupt only posts EVENT_TICK, the same constant work however
+ *      		many timers are armed. {@see Timer_Expire}, called by the tick's handler in
+ *      		thread mode, turns the wheel to the current millisecond, one slot per
+ *      		millisecond passed, and calls the callbacks of the timers due. Each slot holds
+ *      		only the timers hashed to it, so a turn costs the timers of that slot.
+ *
+ *      		Timers are started, stopped and expired in thread mode only, from the
+ *      		scheduler's handlers and the timer callbacks, so the wheel needs no masking.
+ *
+ *    Sources of Reference :
+ * 		G. Varghese, T. Lauck, Hashed and Hierarchical Timing Wheels, SOSP 1987 (scheme 6)
+ */
+
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Slots of the wheel, power of two; delays up to this many milliseconds cost no extra passes
+ */
+#define TIMER_WHEEL_SLOTS		(32)
+
+struct sw_timer;
+
+/**
+ * @brief Callback of an expired timer, runs in thread mode; may start and stop any timer, this one included
+ */
+typedef void (*sw_timer_callback_t)(struct sw_timer *timer);
+
+/**
+ * @brief A software timer, owned by the caller and linked into the wheel while armed
+ */
+typedef struct sw_timer {
+	struct sw_timer *next;			/*< the slot's list */
+	struct sw_timer *prev;
+	uint32_t expires;				/*< {@see systemTime} when due */
+	uint32_t period;				/*< milliseconds between expiries, 0 for one-shot */
+	sw_timer_callback_t callback;
+	void *context;					/*< for the callback */
+	bool armed;
+} sw_timer_t;
+
+/**
+ * @brief Counters of the wheel
+ */
+typedef struct {
+	uint32_t fired;					/*< callbacks run */
+	uint32_t armed;					/*< timers armed now */
+	uint32_t maxLate;				/*< most milliseconds a callback ran after its due time */
+} timer_wheel_stats_t;
+
+/**
+ * @brief The counters
+ */
+extern timer_wheel_stats_t timer_wheel_stats;
+
+/**
+ * @brief Prepares a timer, disarmed
+ * @param[out] timer The timer
+ * @param[in] callback Called on expiry
+ * @param[in] context For the callback
+ */
+void Timer_Init(sw_timer_t *timer, sw_timer_callback_t callback, void *context);
+
+/**
+ * @brief Arms a timer, re-arming it if it was
+ * @param[inout] timer The timer
+ * @param[in] delay Milliseconds from now to the first expiry, at least 1
+ * @param[in] period Milliseconds between further expiries, 0 for one-shot
+ */
+void Timer_Start(sw_timer_t *timer, uint32_t delay, uint32_t period);
+
+/**
+ * @brief Disarms a timer; nothing happens if it is not armed
+ */
+void Timer_Stop(sw_timer_t *timer);
+
+/**
+ * @brief Whether a timer is armed
+ */
+static inline bool Timer_Armed(const sw_timer_t *timer)
+{
+	return timer->armed;
+}
+
+/**
+ * @brief Turns the wheel to a time and runs the callbacks of the timers due up to it, in order of their slots
+ * @param[in] now The {@see systemTime} to turn to
+ */
+void Timer_Expire(uint32_t now);
+
+/**
+ * @brief Finds the earliest expiry of the armed timers, for an idle core to sleep up to it.
+ * 		  Visits every armed timer, so for the idle path only.
+ * @param[out] expires The {@see systemTime} it is due; untouched when no timer is armed
+ * @return true if a timer is armed
+ */
+bool Timer_NextExpiry(uint32_t *expires);
+
+#endif /* TIMER_WHEEL_H_ */
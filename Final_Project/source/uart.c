@@ -18,23 +18,42 @@
 
 #include "sysclock.h"
 #include "queue.h"
+#include "uart_dma.h"
+#include "scheduler.h"
 
-Q_T TxQ, RxQ;
+static uint8_t TxStorage[UART_TX_QUEUE_SIZE];
+static uint8_t RxStorage[UART_RX_QUEUE_SIZE];
+Q_T TxQ = Q_INITIALIZER(TxStorage);
+Q_T RxQ = Q_INITIALIZER(RxStorage);
 
-int __sys_write(int handle, char* buffer, int count) {
-	if(buffer == NULL) {
-		return -1;
+/*
+ * Starts draining TxQ on the selected path unless it already is
+ *
+ * Parameters:
+ *   void
+ * Returns:
+ *   void
+ */
+static void startTransmit(void) {
+	if (UART_TxDmaSelected()) {
+		UART_TxDmaKick();
 	}
-	while(Q_Full(&TxQ)) {
-		; // Wait for the space to openup
+	else if (!(UART0->C2 & UART0_C2_TIE_MASK)) {
+		UART0->C2 |= UART0_C2_TIE(1);
 	}
+}
 
-	if(Q_Enqueue(&TxQ, buffer, count) != count) {
+int __sys_write(int handle, char* buffer, int count) {
+	if(buffer == NULL) {
 		return -1;
 	}
+	// the queue is smaller than a burst of log lines, so feed it as it drains
+	while(count > 0) {
+		const size_t queued = Q_Enqueue(&TxQ, buffer, count);
+		buffer += queued;
+		count -= queued;
 
-	if(!(UART0->C2 & UART0_C2_TIE_MASK)) {
-		UART0->C2 |= UART0_C2_TIE(1);
+		startTransmit();
 	}
 
 	return 0;
@@ -113,6 +132,10 @@ void Init_UART0(uint32_t baud_rate) {
 	// Enable UART receiver and transmitter
 	UART0->C2 |= UART0_C2_RE(1) | UART0_C2_TE(1);
 
+	// Transmit by DMA, one interrupt per block instead of per byte
+	UART_TxDmaInit();
+	UART_TxDmaSelect(UART_TX_DMA_ENABLE);
+
 	LOG("\n\r Clock Gating and Instantiation for UART0 at 115200 Baud Rate Complete");
 
 }
@@ -131,9 +154,37 @@ void Send_String(const void* str, size_t count){
 	Q_Enqueue(&TxQ, str, count);
 
 	// start transmitting if it isint already
-	if (!(UART0->C2 & UART0_C2_TIE_MASK)) {
-		UART0->C2 |= UART0_C2_TIE(1);
-	}
+	startTransmit();
+}
+
+
+/*
+ * Hands out free transmit queue storage for a formatter to write a message in place
+ *
+ * Parameters:
+ *   span: Receives the two writable spans, see Q_Reserve
+ *	 count: The Length wanted
+ * Returns:
+ *   The Length reserved, which may be less than count when the queue is nearly full
+ */
+size_t Send_Reserve(Q_Span_T span[2], size_t count) {
+	return Q_Reserve(&TxQ, count, span);
+}
+
+
+/*
+ * Transmits the first count bytes written into the last Send_Reserve
+ *
+ * Parameters:
+ *	 count: The Length written
+ * Returns:
+ *   void
+ */
+void Send_Commit(size_t count) {
+	Q_Commit(&TxQ, count);
+
+	// start transmitting if it isint already
+	startTransmit();
 }
 
 
@@ -173,27 +224,37 @@ static void clearUARTErrors(void) {
  */
 void UART0_IRQHandler(void) {
 
-	uint8_t ch;
+	Q_Span_T span[2];
 
 	if (UART0->S1 & (UART_S1_OR_MASK |UART_S1_NF_MASK | UART_S1_FE_MASK | UART_S1_PF_MASK)) {
 		clearUARTErrors();
-		ch = UART0->D;
+		(void)UART0->D;
 	}
 
 	if (UART0->S1 & UART0_S1_RDRF_MASK) {
-			// received a character
-			ch = UART0->D;
-			Q_Enqueue(&RxQ, &ch, 1);
+			// received a character, straight into the queue storage; dropped if the queue is full
+			if (Q_Reserve(&RxQ, 1, span)) {
+				*span[0].data = UART0->D;
+				Q_Commit(&RxQ, 1);
+				Scheduler_PostOnce(EVENT_UART_RX, 0);
+			} else {
+				(void)UART0->D;
+			}
 		}
 
 	if ( (UART0->C2 & UART0_C2_TIE_MASK) && // transmitter interrupt enabled
+				!(UART0->C5 & UART0_C5_TDMAE_MASK) && // and TDRE not routed to the DMA
 				(UART0->S1 & UART0_S1_TDRE_MASK) ) {
+		UART_ACCOUNT_BEGIN();
 
-		if(Q_Dequeue(&TxQ, &ch, 1)) {
-			UART0->D = ch;
+		if(Q_Peek(&TxQ, span)) {
+			UART0->D = *span[0].data;
+			Q_Release(&TxQ, 1);
+			UART_ACCOUNT_END(UART_TX_PATH_IRQ, 1);
 		} else {
 			// queue is empty so disable transmitter interrupt
 			UART0->C2 &= ~UART0_C2_TIE_MASK;
+			UART_ACCOUNT_END(UART_TX_PATH_IRQ, 0);
 		}
 	}
 }
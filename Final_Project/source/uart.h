@@ -19,17 +19,26 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include "queue.h"
 
 #define USE_UART_INTERRUPTS 	(0) // 0 for polled UART communications, 1 for interrupt-driven
 #define UART_OVERSAMPLE_RATE 	(16)
 #define BUS_CLOCK 				(24e6)
 #define SYS_CLOCK				(48e6)
+#define UART_TX_QUEUE_SIZE		(256)	// bytes of log output buffered, power of two
+#define UART_RX_QUEUE_SIZE		(32)	// bytes of received commands buffered, power of two
 
 // critical section macro functions
 #define START_CRITICAL()	__disable_irq()
 #define END_CRITICAL(x)	__set_PRIMASK(x)
 
 
+/*
+ * The transmit and receive queues, drained by UART0_IRQHandler or by the DMA transmit path
+ */
+extern Q_T TxQ, RxQ;
+
+
 /*
  * Initializing the UART for BAUD_RATE: 38400, Data Size: 8, Parity: None, Stop Bits: 2
  *
@@ -54,6 +63,29 @@ void Init_UART0(uint32_t baud_rate);
 void Send_String(const void* str, size_t count);
 
 
+/*
+ * Hands out free transmit queue storage for a formatter to write a message in place
+ *
+ * Parameters:
+ *   span: Receives the two writable spans, see Q_Reserve
+ *	 count: The Length wanted
+ * Returns:
+ *   The Length reserved, which may be less than count when the queue is nearly full
+ */
+size_t Send_Reserve(Q_Span_T span[2], size_t count);
+
+
+/*
+ * Transmits the first count bytes written into the last Send_Reserve
+ *
+ * Parameters:
+ *	 count: The Length written
+ * Returns:
+ *   void
+ */
+void Send_Commit(size_t count);
+
+
 /*
  * Receive the Data from UART to Receive Buffer to store
  *
@@ -0,0 +1,230 @@
+/*
+ * uart_dma.c
+ *
+ *  Created on: Dec 18, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: DMA transmit path of UART0 and the accounting of both transmit paths.
+ *
+ *    Sources of Reference :
+ * 		KL25 Sub-Family Reference Manual, Chapter 23 (DMA Controller Module) and 39.2.9 (UART0 C5 TDMAE)
+ * 		MCUXpresso SDK drivers/fsl_lpsci_dma.c, drivers/fsl_dma.c
+ */
+
+#include <string.h>
+#include "uart_dma.h"
+#include "uart.h"
+#include "global_defs.h"
+#include "fsl_dma.h"
+#include "fsl_dmamux.h"
+#include "fsl_lpsci_dma.h"
+
+/**
+ * @brief The fsl_dma handler of channel 1, called by DMA1_IRQHandler
+ */
+extern void DMA1_DriverIRQHandler(void);
+
+/**
+ * @brief NVIC priority of the channel interrupt, the same as UART0_IRQHandler
+ */
+#define UART_TX_DMA_PRIORITY	(2)
+
+/**
+ * @brief Totals, indexed by {@see uart_tx_path_t}
+ */
+uart_account_t uart_accounts[UART_TX_PATH_COUNT];
+
+/**
+ * @brief Printable path names, indexed by {@see uart_tx_path_t}
+ */
+static const char *const path_names[UART_TX_PATH_COUNT] = { "irq", "dma" };
+
+/**
+ * @brief SDK handles of the channel and of the LPSCI transfer
+ */
+static dma_handle_t txDmaHandle;
+static lpsci_dma_handle_t lpsciDmaHandle;
+
+/**
+ * @brief Whether TxQ is drained by DMA
+ */
+static volatile bool selected;
+
+/**
+ * @brief Bytes of TxQ owned by the running transfer, 0 while idle
+ */
+static volatile size_t inFlight;
+
+/**
+ * @brief Hands the oldest contiguous region of TxQ to the channel; the caller owns the channel
+ */
+static void UART_TxDmaStart()
+{
+	Q_Span_T span[2];
+
+	if ((inFlight != 0) || (Q_Peek(&TxQ, span) == 0)) {
+		return;
+	}
+
+	/* the bytes stay queued, and their storage untouched by the producer, until the completion */
+	lpsci_transfer_t transfer = { .data = span[0].data, .dataSize = span[0].length };
+	inFlight = span[0].length;
+	LPSCI_TransferSendDMA(UART0, &lpsciDmaHandle, &transfer);
+}
+
+/**
+ * @brief Transfer completion, runs in DMA1_IRQHandler once fsl_lpsci_dma disabled the transmit request
+ */
+static void UART_TxDmaComplete(UART0_Type *base, lpsci_dma_handle_t *handle, status_t status, void *userData)
+{
+	Q_Release(&TxQ, inFlight);
+	inFlight = 0;
+
+	/* chain the next region, wrapped or queued meanwhile */
+	UART_TxDmaStart();
+}
+
+/**
+ * @brief Routes the transmit request and creates the SDK handles
+ */
+void UART_TxDmaInit()
+{
+	DMAMUX_Init(DMAMUX0);
+	DMAMUX_SetSource(DMAMUX0, UART_TX_DMA_CHANNEL, kDmaRequestMux0LPSCI0Tx);
+	DMAMUX_EnableChannel(DMAMUX0, UART_TX_DMA_CHANNEL);
+
+	DMA_Init(DMA0);
+	DMA_CreateHandle(&txDmaHandle, DMA0, UART_TX_DMA_CHANNEL);
+	LPSCI_TransferCreateHandleDMA(UART0, &lpsciDmaHandle, UART_TxDmaComplete, NULL, &txDmaHandle, NULL);
+
+	/* DMA_CreateHandle enabled the interrupt at the highest priority */
+	NVIC_SetPriority(DMA1_IRQn, UART_TX_DMA_PRIORITY);
+
+	inFlight = 0;
+	selected = false;
+}
+
+/**
+ * @brief Sleeps until TxQ is drained and the transmitter went idle
+ */
+void UART_TxDrain()
+{
+	/* the interrupt path drops TIE on an empty queue, the DMA path drops it with the transmit
+	 * request after the last region; with PRIMASK set the interrupt that does so still ends WFI,
+	 * it is taken once PRIMASK is cleared, so it cannot be slept through */
+	for (;;) {
+		__disable_irq();
+		const bool idle = Q_Empty(&TxQ) && (inFlight == 0) && !(UART0->C2 & UART0_C2_TIE_MASK);
+		if (!idle) {
+			__DSB();
+			__WFI();
+		}
+		__enable_irq();
+
+		if (idle) {
+			return;
+		}
+	}
+}
+
+/**
+ * @brief Switches between the interrupt and the DMA path once the transmitter went idle
+ */
+void UART_TxDmaSelect(bool enable)
+{
+	if (enable == selected) {
+		return;
+	}
+
+	/* drain on the current path */
+	UART_TxDrain();
+
+	selected = enable;
+
+	/* bytes queued while draining wait for this */
+	if (enable) {
+		UART_TxDmaKick();
+	}
+	else if (!Q_Empty(&TxQ)) {
+		UART0->C2 |= UART0_C2_TIE(1);
+	}
+}
+
+/**
+ * @brief Whether TxQ is drained by DMA
+ */
+bool UART_TxDmaSelected()
+{
+	return selected;
+}
+
+/**
+ * @brief Starts a transfer of the oldest contiguous region of TxQ unless one is running
+ */
+void UART_TxDmaKick()
+{
+	/* a running transfer picks up the new bytes when it completes */
+	if (inFlight != 0) {
+		return;
+	}
+
+	UART_ACCOUNT_BEGIN();
+
+	/* the completion interrupt starts transfers too; keep it out meanwhile */
+	NVIC_DisableIRQ(DMA1_IRQn);
+	UART_TxDmaStart();
+	NVIC_EnableIRQ(DMA1_IRQn);
+
+	UART_ACCOUNT_END(UART_TX_PATH_DMA, 0);
+}
+
+/**
+ * @brief Whether a transfer is running
+ */
+bool UART_TxDmaBusy()
+{
+	return inFlight != 0;
+}
+
+/**
+ * @brief DMA channel 1 interrupt handler, accounted around the SDK handler
+ */
+void DMA1_IRQHandler()
+{
+	UART_ACCOUNT_BEGIN();
+	const size_t sent = inFlight;
+	(void)sent;
+
+	DMA1_DriverIRQHandler();
+	UART_ACCOUNT_END(UART_TX_PATH_DMA, sent);
+}
+
+/**
+ * @brief Clears all totals
+ */
+void UART_AccountReset()
+{
+	memset(uart_accounts, 0, sizeof(uart_accounts));
+}
+
+/**
+ * @brief Logs the totals of both paths and the CPU load they caused over a period
+ */
+void UART_AccountReport(uint32_t elapsed)
+{
+	LOG("\r\n UART accounting: path, bytes, entries, cycles/byte, load over %lu cycles", (unsigned long)elapsed);
+
+	for (int path = 0; path < UART_TX_PATH_COUNT; ++path) {
+		const uart_account_t *account = &uart_accounts[path];
+		if ((account->bytes == 0) || (elapsed == 0)) {
+			continue;
+		}
+
+		/* in hundredths of a percent; 64 bit, cycles * 10000 overflows 32 bit within a second */
+		const uint32_t load = (uint32_t)(((uint64_t)account->cycles * 10000u) / elapsed);
+		LOG("\r\n   %-6s %7lu %6lu %6lu %3lu.%02lu%%", path_names[path],
+				(unsigned long)account->bytes, (unsigned long)account->entries,
+				(unsigned long)(account->cycles / account->bytes),
+				(unsigned long)(load / 100), (unsigned long)(load % 100));
+	}
+}
@@ -0,0 +1,163 @@
+/*
+ * uart_dma.h
+ *
+ *  Created on: Dec 18, 2020
+ *      Author: Arpit Savarkar
+ *
+ *      @brief: Header file for the DMA transmit path of UART0.
+ *
+ *      		With the DMA path selected, TxQ is drained by DMA channel 1 instead of one
+ *      		UART0 interrupt per byte. {@see UART_TxDmaKick} hands the oldest contiguous
+ *      		region of the queue to fsl_lpsci_dma, which moves it into UART0->D on the
+ *      		transmit request. The completion interrupt releases the region from the queue
+ *      		and starts on the next one, so the CPU takes one interrupt per region: at most
+ *      		two per lap around the ring, however many bytes were queued.
+ *
+ *      		With {@see UART_ACCOUNTING} set, both paths add the core cycles spent in their
+ *      		handlers to a {@see uart_account_t}, for the CPU load of logging.
+ *
+ *    Sources of Reference :
+ * 		KL25 Sub-Family Reference Manual, Chapter 23 (DMA Controller Module) and 39.2.9 (UART0 C5 TDMAE)
+ * 		MCUXpresso SDK drivers/fsl_lpsci_dma.c, drivers/fsl_dma.c
+ */
+
+#ifndef UART_DMA_H_
+#define UART_DMA_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "MKL25Z4.h"
+
+/**
+ * @brief Set to nonzero to transmit by DMA from start-up; {@see UART_TxDmaSelect} switches at run time
+ */
+#define UART_TX_DMA_ENABLE		(1)
+
+/**
+ * @brief DMA channel reserved for the UART0 transmitter; channel 0 belongs to I2C0
+ */
+#define UART_TX_DMA_CHANNEL		(1)
+
+/**
+ * @brief Set to nonzero to account the cycles of the transmit handlers
+ */
+#define UART_ACCOUNTING			(0)
+
+/**
+ * @brief The ways TxQ can be drained
+ */
+typedef enum {
+	UART_TX_PATH_IRQ = 0,		/*< one UART0 interrupt per byte */
+	UART_TX_PATH_DMA,			/*< one DMA1 interrupt per contiguous region */
+	UART_TX_PATH_COUNT
+} uart_tx_path_t;
+
+/**
+ * @brief Totals of one path
+ */
+typedef struct {
+	uint32_t bytes;				/*< bytes handed to the transmitter */
+	uint32_t cycles;			/*< core cycles spent in the transmit handlers */
+	uint32_t entries;			/*< interrupts and kicks that made up those cycles */
+} uart_account_t;
+
+/**
+ * @brief Totals, indexed by {@see uart_tx_path_t}
+ */
+extern uart_account_t uart_accounts[UART_TX_PATH_COUNT];
+
+#if UART_ACCOUNTING
+
+#include "systick.h"
+
+/**
+ * @brief Opens a measured section
+ */
+#define UART_ACCOUNT_BEGIN()			const uint32_t uart_account_start = cycle_count()
+
+/**
+ * @brief Closes the section opened by {@see UART_ACCOUNT_BEGIN} and charges it and n bytes to a path
+ */
+#define UART_ACCOUNT_END(path, n)		UART_AccountCycles((path), cycle_count() - uart_account_start, (n))
+
+#else
+
+#define UART_ACCOUNT_BEGIN()			do {} while (0)
+#define UART_ACCOUNT_END(path, n)		do {} while (0)
+
+#endif
+
+/**
+ * @brief Charges cycles and bytes to a path
+ * @param[in] path The path
+ * @param[in] cycles Core cycles spent
+ * @param[in] bytes Bytes handed to the transmitter
+ */
+static inline void UART_AccountCycles(uart_tx_path_t path, uint32_t cycles, uint32_t bytes)
+{
+	uart_accounts[path].cycles += cycles;
+	uart_accounts[path].bytes += bytes;
+	uart_accounts[path].entries++;
+}
+
+/**
+ * @brief Routes the UART0 transmit request to {@see UART_TX_DMA_CHANNEL} and creates the
+ * 		  fsl_dma and fsl_lpsci_dma handles; the DMA path stays unselected.
+ *
+ * @param: None
+ * @return: None
+ */
+void UART_TxDmaInit();
+
+/**
+ * @brief Switches between the interrupt and the DMA path once the transmitter went idle.
+ * 		  Call from the main loop only.
+ * @param[in] enable true for DMA, false for one interrupt per byte
+ */
+void UART_TxDmaSelect(bool enable);
+
+/**
+ * @brief Whether TxQ is drained by DMA
+ * @return true if the DMA path is selected
+ */
+bool UART_TxDmaSelected();
+
+/**
+ * @brief Starts a transfer of the oldest contiguous region of TxQ unless one is running.
+ * 		  Call after queuing bytes.
+ *
+ * @param: None
+ * @return: None
+ */
+void UART_TxDmaKick();
+
+/**
+ * @brief Whether a transfer is running
+ * @return true while the channel owns a region of TxQ
+ */
+bool UART_TxDmaBusy();
+
+/**
+ * @brief Sleeps until TxQ is drained on the selected path and the transmitter went idle.
+ * 		  Call from the main loop with interrupts unmasked.
+ *
+ * @param: None
+ * @return: None
+ */
+void UART_TxDrain();
+
+/**
+ * @brief Clears all totals
+ *
+ * @param: None
+ * @return: None
+ */
+void UART_AccountReset();
+
+/**
+ * @brief Logs the totals of both paths and the CPU load they caused over a period
+ * @param[in] elapsed Core cycles of the period the totals were collected in
+ */
+void UART_AccountReport(uint32_t elapsed);
+
+#endif /* UART_DMA_H_ */